@@ -0,0 +1,130 @@
+#pragma once
+#include "agg_hash_table.h"
+#include "join_hash_table.cpp"
+
+#define AGG_NULL_HASH 0x6a09e667f3bcc909ULL
+
+u64 agg_keys_hash(const Value* keys, u32 num_keys) {
+    u64 hash = FNV_offset_basis;
+    for(u32 i = 0; i < num_keys; ++i) {
+        u64 h = keys[i].isNull() ? AGG_NULL_HASH : value_hash(keys[i]);
+        hash = hash_mix(hash ^ h) + i;
+    }
+    return hash;
+}
+
+bool agg_key_eq(const Value& lhs, const Value& rhs) {
+    if(lhs.isNull() || rhs.isNull()) return lhs.isNull() && rhs.isNull();
+    return value_key_eq(lhs, rhs);
+}
+
+AggHashTable::AggHashTable(Arena* arena):
+    groups_(arena), slots_(arena), distinct_(arena), distinct_slots_(arena)
+{}
+
+void AggHashTable::init(u32 num_keys, u32 num_aggregates) {
+    clear();
+    num_keys_ = num_keys;
+    num_aggregates_ = num_aggregates;
+}
+
+void AggHashTable::clear() {
+    groups_.clear();
+    slots_.clear();
+    distinct_.clear();
+    distinct_slots_.clear();
+    slot_mask_ = 0;
+    distinct_slot_mask_ = 0;
+}
+
+u32 AggHashTable::find(const Value* keys, u64 hash) {
+    if(slots_.size() == 0) return AGG_NO_GROUP;
+    u64 idx = hash & slot_mask_;
+    while(slots_[idx].group_ != AGG_NO_GROUP) {
+        if(slots_[idx].hash_ == hash) {
+            AggGroup& group = groups_[slots_[idx].group_];
+            bool eq = true;
+            for(u32 i = 0; eq && i < num_keys_; ++i)
+                eq = agg_key_eq(group.keys_[i], keys[i]);
+            if(eq) return slots_[idx].group_;
+        }
+        idx = (idx + 1) & slot_mask_;
+    }
+    return AGG_NO_GROUP;
+}
+
+u32 AggHashTable::insert(Arena* arena, const Value* keys, u64 hash) {
+    if((groups_.size() + 1) * 2 > slots_.size()) grow();
+    AggGroup group;
+    group.hash_ = hash;
+    if(num_keys_) group.keys_ = (Value*) arena->alloc(sizeof(Value) * num_keys_);
+    for(u32 i = 0; i < num_keys_; ++i)
+        group.keys_[i] = Value(keys[i]).get_copy(arena);
+    if(num_aggregates_) group.states_ = (AggState*) arena->alloc(sizeof(AggState) * num_aggregates_);
+    for(u32 i = 0; i < num_aggregates_; ++i)
+        new(&group.states_[i]) AggState();
+    u32 g = groups_.size();
+    groups_.push_back(group);
+
+    u64 idx = hash & slot_mask_;
+    while(slots_[idx].group_ != AGG_NO_GROUP)
+        idx = (idx + 1) & slot_mask_;
+    slots_[idx].hash_ = hash;
+    slots_[idx].group_ = g;
+    return g;
+}
+
+void AggHashTable::grow() {
+    u64 n_slots = std::max<u64>(16, slots_.size() * 2);
+    slots_.assign(n_slots, AggSlot());
+    slot_mask_ = n_slots - 1;
+    for(u32 g = 0; g < groups_.size(); ++g) {
+        u64 idx = groups_[g].hash_ & slot_mask_;
+        while(slots_[idx].group_ != AGG_NO_GROUP)
+            idx = (idx + 1) & slot_mask_;
+        slots_[idx].hash_ = groups_[g].hash_;
+        slots_[idx].group_ = g;
+    }
+}
+
+bool AggHashTable::insert_distinct(Arena* arena, u32 group, u32 agg, const Value& val) {
+    if(val.isNull()) return false;
+    u64 hash = hash_mix(value_hash(val) ^ ((u64)group << 8) ^ agg);
+    if((distinct_.size() + 1) * 2 > distinct_slots_.size()) grow_distinct();
+    u64 idx = hash & distinct_slot_mask_;
+    while(distinct_slots_[idx] != AGG_NO_GROUP) {
+        AggDistinctEntry& entry = distinct_[distinct_slots_[idx]];
+        if(entry.hash_ == hash && entry.group_ == group && entry.agg_ == agg && value_key_eq(entry.val_, val))
+            return false;
+        idx = (idx + 1) & distinct_slot_mask_;
+    }
+    distinct_slots_[idx] = distinct_.size();
+    AggDistinctEntry entry;
+    entry.val_ = Value(val).get_copy(arena);
+    entry.hash_ = hash;
+    entry.group_ = group;
+    entry.agg_ = agg;
+    distinct_.push_back(entry);
+    return true;
+}
+
+void AggHashTable::grow_distinct() {
+    u64 n_slots = std::max<u64>(16, distinct_slots_.size() * 2);
+    distinct_slots_.assign(n_slots, AGG_NO_GROUP);
+    distinct_slot_mask_ = n_slots - 1;
+    for(u32 e = 0; e < distinct_.size(); ++e) {
+        u64 idx = distinct_[e].hash_ & distinct_slot_mask_;
+        while(distinct_slots_[idx] != AGG_NO_GROUP)
+            idx = (idx + 1) & distinct_slot_mask_;
+        distinct_slots_[idx] = e;
+    }
+}
+
+u32 AggHashTable::size() {
+    return groups_.size();
+}
+
+u64 AggHashTable::memory_usage() {
+    return groups_.size() * sizeof(AggGroup) + slots_.size() * sizeof(AggSlot) +
+        distinct_.size() * sizeof(AggDistinctEntry) + distinct_slots_.size() * sizeof(u32);
+}
@@ -9,6 +9,29 @@ Vector<ExpressionNode*> split_by_and(QueryCTX* ctx, ExpressionNode* expression);
 void accessed_tables(ASTNode* expression ,Vector<String8>& tables, Catalog* catalog, bool only_one = true);
 void get_fields_of_query(QueryData* data, Vector<FieldNode*>& fields);
 
+// join order search (see order_joins): above this many inputs the joins are ordered greedily.
+#define JOIN_DP_MAX_RELATIONS 10
+// an index lookup of the index nested loop join costs about as much as reading this many rows sequentially.
+#define INDEX_PROBE_COST 8
+
+// the best found way to join a set of inputs: the estimated rows and cost, the inputs of its left child.
+struct JoinPlan {
+    double rows_ = 0;
+    double cost_ = 0;
+    u64 lhs_ = 0;
+};
+
+// the inputs of the join order search and the conjuncts of the where clause that connect them,
+// sets of inputs are bit masks over inputs_.
+struct JoinGraph {
+    Vector<AlgebraOperation*> inputs_;
+    Vector<double> rows_;
+    Vector<ExpressionNode*> conds_;
+    Vector<u64> cond_masks_;
+    Vector<double> cond_sels_;
+    std::unordered_map<u64, JoinPlan> plans_;
+};
+
 class AlgebraEngine {
     public:
         AlgebraEngine(Catalog* catalog): catalog_(catalog)
@@ -133,6 +156,10 @@ class AlgebraEngine {
                                     data->idx_, (int)fields[i]->token_.val_.size_, fields[i]->token_.val_.str_);
                             data->corelated_ = true;
                         }
+                        // the queries in between are re-evaluated for every row of the owner of the field as well.
+                        for(int q = data->parent_idx_; query_idx != data->idx_ && q != query_idx; 
+                                q = ctx.queries_call_stack_[q]->parent_idx_)
+                            ctx.queries_call_stack_[q]->corelated_ = true;
                         fields[i]->query_idx_ = query_idx;
                         data->accessed_fields_[i] = fields[i];
                         fields[i] = nullptr;
@@ -149,18 +176,28 @@ class AlgebraEngine {
         }
         
         void createAlgebraExpression(QueryCTX& ctx){
+            // every query knows if it is corelated before planning any of them (see match_semi_join).
             for(auto data : ctx.queries_call_stack_){
                 if(!assign_tables_to_fields(ctx, data)) assert(0);
+            }
+            for(auto data : ctx.queries_call_stack_){
                 switch(data->type_){
                     case SELECT_DATA:
                         {
                             auto select_data = reinterpret_cast<SelectStatementData*>(data);
+                            // already planned by its parent (see unnest_subqueries).
+                            if(select_data->unnested_) {
+                                ctx.operators_call_stack_.push_back(nullptr);
+                                break;
+                            }
                             AlgebraOperation* op = createSelectStatementExpression(ctx, select_data);
                             if(!op){
                                 ctx.error_status_ = Error::LOGICAL_PLAN_ERROR;
                                 return;
                             }
-                            op->distinct_ = select_data->distinct_;
+                            // duplicates are removed before applying the limit.
+                            if(op->type_ == LIMIT) ((LimitOperation*)op)->child_->distinct_ = select_data->distinct_;
+                            else op->distinct_ = select_data->distinct_;
                             ctx.operators_call_stack_.push_back(op);
                         } break;
                     case INSERT_DATA:
@@ -384,6 +421,7 @@ class AlgebraEngine {
                           product->rhs_, 
                           op->filter_,
                           INNER_JOIN, join_algorithm);
+                  if(!match_index_join(ctx, join_node)) match_merge_join(ctx, join_node);
                   *root = join_node;
                   replaceFilteredProductWithJoin(ctx, root);
                 }  else if(op->child_){
@@ -433,7 +471,8 @@ class AlgebraEngine {
                                     continue;
                     case AND:{
                                 auto ptr = ((AndNode*)ex);
-                                if(ptr->next_ == nullptr) {
+                                // a conjunct of a split where clause is only the first operand.
+                                if(ptr->next_ == nullptr || ptr->mark_split_) {
                                     ex = ptr->cur_;
                                     continue;
                                 }
@@ -453,9 +492,338 @@ class AlgebraEngine {
             }
             return false;
         }
+        // splits a condition into the conjuncts that have to hold for every joined row.
+        void split_conjuncts(ASTNode* ex, Vector<ASTNode*>& conjuncts) {
+            while(ex && ex->category_ == EXPRESSION) ex = ((ExpressionNode*)ex)->cur_;
+            if(!ex) return;
+            if(ex->category_ == AND) {
+                split_conjuncts(((AndNode*)ex)->cur_, conjuncts);
+                // the rest of a split where clause belongs to other filters.
+                if(!((AndNode*)ex)->mark_split_) split_conjuncts(((AndNode*)ex)->next_, conjuncts);
+                return;
+            }
+            conjuncts.push_back(ex);
+        }
+
+        // the column of a numeric field of the scanned table, otherwise -1.
+        // merge join keys are compared as numbers, so only numeric columns are used.
+        int merge_key_column(ScanOperation* scan, ASTNode* ex, FieldNode** field) {
+            while(ex && ex->category_ == EXPRESSION) ex = ((ExpressionNode*)ex)->cur_;
+            TableSchema* tschema = catalog_->get_table_schema(scan->table_name_);
+            if(!ex || !tschema) return -1;
+            int col = scan_field_column(scan, tschema, ex);
+            if(col == -1) return -1;
+            Type type = tschema->getCol(col).getType();
+            if(type != INT && type != BIGINT && type != FLOAT && type != DOUBLE) return -1;
+            *field = (FieldNode*)ex;
+            return col;
+        }
+
+        // a merge join bound has to grow with the driver key, so it is either the key itself 
+        // or the key plus or minus constants (a.x - 5 + 1), return the key column or -1.
+        int merge_bound_column(ScanOperation* driver, ASTNode* ex, FieldNode** field) {
+            while(ex && ex->category_ == EXPRESSION) ex = ((ExpressionNode*)ex)->cur_;
+            if(!ex) return -1;
+            if(ex->category_ != TERM) return merge_key_column(driver, ex, field);
+            int col = -1;
+            TokenType sign = TokenType::PLUS;
+            while(ex) {
+                ASTNode* operand = ex;
+                ASTNode* next = nullptr;
+                TokenType next_sign = sign;
+                if(ex->category_ == TERM) {
+                    operand = ((TermNode*)ex)->cur_;
+                    next = ((TermNode*)ex)->next_;
+                    next_sign = ex->token_.type_;
+                }
+                while(operand && operand->category_ == EXPRESSION) operand = ((ExpressionNode*)operand)->cur_;
+                if(!operand) return -1;
+                if(operand->category_ != INTEGER_CONSTANT && operand->category_ != FLOAT_CONSTANT) {
+                    // exactly one added (not subtracted) key.
+                    if(col != -1 || sign != TokenType::PLUS) return -1;
+                    col = merge_key_column(driver, operand, field);
+                    if(col == -1) return -1;
+                }
+                sign = next_sign;
+                ex = next;
+            }
+            return col;
+        }
+
+        // collects the bounds of the window key from the conjuncts of the join condition:
+        // w = d, w (<, <=, >, >=) d, d (<, <=, >, >=) w and w BETWEEN d1 AND d2,
+        // where w is the window key and every d is a bound of the same driver key,
+        // an equality is used as both bounds, otherwise a lower and an upper bound are needed.
+        // the other conjuncts (and the used ones) are still checked by the join filter.
+        bool match_merge_bounds(ScanOperation* driver, ScanOperation* window, Vector<ASTNode*>& conjuncts, 
+                JoinOperation* join) {
+            int driver_col = -1, window_col = -1;
+            FieldNode* driver_key = nullptr;
+            FieldNode* window_key = nullptr;
+            ASTNode* lower = nullptr;
+            ASTNode* upper = nullptr;
+            bool lower_inclusive = true, upper_inclusive = true;
+            ASTNode* equal = nullptr;
+            // checks that both expressions use the keys of the first matched conjunct.
+            auto match_keys = [&](ASTNode* key, ASTNode* bound) {
+                FieldNode* wfield = nullptr;
+                FieldNode* dfield = nullptr;
+                int wcol = merge_key_column(window, key, &wfield);
+                if(wcol == -1 || (window_col != -1 && wcol != window_col)) return false;
+                int dcol = merge_bound_column(driver, bound, &dfield);
+                if(dcol == -1 || (driver_col != -1 && dcol != driver_col)) return false;
+                window_col = wcol;
+                driver_col = dcol;
+                window_key = wfield;
+                driver_key = dfield;
+                return true;
+            };
+            auto set_bound = [&](ASTNode* bound, bool is_lower, bool inclusive) {
+                if(is_lower && !lower) {
+                    lower = bound;
+                    lower_inclusive = inclusive;
+                } else if(!is_lower && !upper) {
+                    upper = bound;
+                    upper_inclusive = inclusive;
+                }
+            };
+            for(int i = 0; i < conjuncts.size(); ++i) {
+                ASTNode* ex = conjuncts[i];
+                if(ex->category_ == EQUALITY) {
+                    EqualityNode* eq = (EqualityNode*)ex;
+                    if(eq->token_.type_ != TokenType::EQ || !eq->next_ || eq->next_->category_ == EQUALITY) continue;
+                    if(match_keys(eq->cur_, eq->next_)) {
+                        if(!equal) equal = eq->next_;
+                    } else if(match_keys(eq->next_, eq->cur_)) {
+                        if(!equal) equal = eq->cur_;
+                    }
+                } else if(ex->category_ == COMPARISON) {
+                    ComparisonNode* cmp = (ComparisonNode*)ex;
+                    if(!cmp->next_ || cmp->next_->category_ == COMPARISON) continue;
+                    TokenType op = cmp->token_.type_;
+                    bool less = (op == TokenType::LT || op == TokenType::LTE);
+                    bool inclusive = (op == TokenType::LTE || op == TokenType::GTE);
+                    // w < d is an upper bound, d < w is a lower bound.
+                    if(match_keys(cmp->cur_, cmp->next_))
+                        set_bound(cmp->next_, !less, inclusive);
+                    else if(match_keys(cmp->next_, cmp->cur_))
+                        set_bound(cmp->cur_, less, inclusive);
+                } else if(ex->category_ == BETWEEN) {
+                    BetweenNode* between = (BetweenNode*)ex;
+                    if(between->negated_) continue;
+                    if(match_keys(between->val_, between->lhs_) && match_keys(between->val_, between->rhs_)) {
+                        set_bound(between->lhs_, true, true);
+                        set_bound(between->rhs_, false, true);
+                    }
+                }
+            }
+            if(equal) {
+                lower = upper = equal;
+                lower_inclusive = upper_inclusive = true;
+            }
+            if(!lower || !upper) return false;
+            join->merge_driver_key_ = driver_key;
+            join->merge_window_key_ = window_key;
+            join->merge_lower_ = lower;
+            join->merge_upper_ = upper;
+            join->merge_lower_inclusive_ = lower_inclusive;
+            join->merge_upper_inclusive_ = upper_inclusive;
+            return true;
+        }
+
+        // true if the rows of the scan come out in ascending order of the column: it is read through a b-tree index 
+        // whose first column that is not fixed by an equality filter is that column.
+        bool scan_sorted_on(ScanOperation* scan, int col) {
+            if(scan->scan_type_ != INDEX_SCAN) return false;
+            TableSchema* tschema = catalog_->get_table_schema(scan->table_name_);
+            if(!tschema) return false;
+            Vector<IndexHeader> table_indexes = catalog_->get_indexes_of_table(scan->table_name_);
+            for(int i = 0; i < table_indexes.size(); ++i) {
+                IndexHeader& index = table_indexes[i];
+                if(index.index_name_ != scan->index_name_) continue;
+                if(index.is_hash()) return false;
+                auto& index_fields = index.fields_numbers_;
+                std::vector<bool> fixed(index_fields.size(), false);
+                for(int j = 0; j < scan->index_filters_.size(); ++j) {
+                    IndexFilterKind kind = INDEX_FILTER_EQ;
+                    int offset = match_index_to_filter(index, tschema, scan->index_filters_[j], &kind);
+                    if(offset >= 0 && kind == INDEX_FILTER_EQ) fixed[offset] = true;
+                }
+                for(int j = 0; j < index_fields.size(); ++j) {
+                    if(fixed[j]) continue;
+                    // nulls may come first or last, the merge join skips them wherever they are.
+                    return index_fields[j].idx_ == col && index_fields[j].desc_ == scan->index_reverse_;
+                }
+                return false;
+            }
+            return false;
+        }
+
+        // picks a merge join for joins of two tables whose condition bounds the key of one of them by the key of 
+        // the other one, for example: 
+        // a JOIN b ON a.x = b.y                        => window key b.y, bounds [a.x, a.x].
+        // a JOIN b ON b.y BETWEEN a.x - 5 AND a.x + 5  => window key b.y, bounds [a.x - 5, a.x + 5].
+        // a JOIN b ON a.x >= b.y AND a.x < b.y + 10    => window key a.x, bounds [b.y, b.y + 10).
+        // equality joins are only merged if both inputs already come out sorted by their index scans,
+        // otherwise the hash join is cheaper than sorting both of them.
+        // range-band joins can't be hashed, so the inputs that are not sorted yet get a sort on top of them 
+        // which is still much cheaper than a nested loop join.
+        bool match_merge_join(QueryCTX& ctx, JoinOperation* join) {
+            if(join->lhs_->type_ != SCAN || join->rhs_->type_ != SCAN) return false;
+            ScanOperation* lhs = (ScanOperation*)join->lhs_;
+            ScanOperation* rhs = (ScanOperation*)join->rhs_;
+            Vector<ASTNode*> conjuncts;
+            split_conjuncts(join->filter_, conjuncts);
+            join->merge_driver_left_ = true;
+            if(!match_merge_bounds(lhs, rhs, conjuncts, join)) {
+                if(!match_merge_bounds(rhs, lhs, conjuncts, join)) return false;
+                join->merge_driver_left_ = false;
+            }
+            TableSchema* lhs_schema = catalog_->get_table_schema(lhs->table_name_);
+            TableSchema* rhs_schema = catalog_->get_table_schema(rhs->table_name_);
+            FieldNode* lhs_key = join->merge_driver_left_ ? join->merge_driver_key_ : join->merge_window_key_;
+            FieldNode* rhs_key = join->merge_driver_left_ ? join->merge_window_key_ : join->merge_driver_key_;
+            int lhs_col = scan_field_column(lhs, lhs_schema, lhs_key);
+            int rhs_col = scan_field_column(rhs, rhs_schema, rhs_key);
+            bool lhs_sorted = scan_sorted_on(lhs, lhs_col);
+            bool rhs_sorted = scan_sorted_on(rhs, rhs_col);
+            if(join->join_algo_ == HASH_JOIN && !(lhs_sorted && rhs_sorted)) return false;
+            Vector<bool> desc;
+            desc.push_back(false);
+            if(!lhs_sorted) {
+                Vector<int> order_by;
+                order_by.push_back(lhs_col);
+                join->lhs_ = New(SortOperation, ctx.arena_, lhs->query_idx_, lhs, order_by, desc);
+            }
+            if(!rhs_sorted) {
+                Vector<int> order_by;
+                order_by.push_back(rhs_col);
+                join->rhs_ = New(SortOperation, ctx.arena_, rhs->query_idx_, rhs, order_by, desc);
+            }
+            join->join_algo_ = MERGE_JOIN;
+            return true;
+        }
+
+        // how few rows a scan is expected to return without table statistics:
+        // 2 => its filters use an index, 1 => it has other filters, 0 => it reads the whole table.
+        int scan_selectivity_rank(ScanOperation* scan) {
+            if(scan->scan_type_ != SEQ_SCAN) return 2;
+            return scan->filters_.size() ? 1 : 0;
+        }
+
+        // picks an index nested loop join when the inner input is a sequential scan of a table that has an index 
+        // whose leading key columns are fixed by equalities of the join condition with expressions of the outer row,
+        // for example:
+        // a JOIN b ON b.y = a.x + 1 WHERE a.id = 10  => one lookup of a.x + 1 in the index on b.y for every row of a.
+        // every outer row costs an index lookup, so the outer input has to be more selective than the inner one
+        // (or estimated to be much smaller when both tables have statistics),
+        // otherwise reading the inner table once (hash or merge join) is cheaper.
+        // hash indexes need all of their key columns, b-tree indexes a prefix of them.
+        // the joined rows are still checked by the whole join condition.
+        bool match_index_join(QueryCTX& ctx, JoinOperation* join) {
+            if(join->join_type_ == FULL_JOIN) return false;
+            if(join->lhs_->type_ != SCAN || join->rhs_->type_ != SCAN) return false;
+            Vector<ASTNode*> conjuncts;
+            split_conjuncts(join->filter_, conjuncts);
+            for(int side = 0; side < 2; ++side) {
+                bool inner_left = (side == 1);
+                // the outer input of a left (right) join is the one whose rows are all kept.
+                if(join->join_type_ == LEFT_JOIN && inner_left) continue;
+                if(join->join_type_ == RIGHT_JOIN && !inner_left) continue;
+                ScanOperation* outer = (ScanOperation*)(inner_left ? join->rhs_ : join->lhs_);
+                ScanOperation* inner = (ScanOperation*)(inner_left ? join->lhs_ : join->rhs_);
+                if(inner->scan_type_ != SEQ_SCAN) continue;
+                // with statistics the lookups have to cost less than reading the inner table once.
+                double outer_rows = estimate_scan_rows(outer);
+                TableStats* inner_stats = catalog_->get_table_stats(inner->table_name_);
+                if(outer_rows >= 0 && inner_stats) {
+                    if(outer_rows * INDEX_PROBE_COST >= inner_stats->row_count_) continue;
+                } else if(scan_selectivity_rank(outer) <= scan_selectivity_rank(inner)) {
+                    continue;
+                }
+                TableSchema* inner_schema = catalog_->get_table_schema(inner->table_name_);
+                TableSchema* outer_schema = catalog_->get_table_schema(outer->table_name_);
+                if(!inner_schema || !outer_schema) continue;
+
+                // the inner column and the outer expression of every usable equality.
+                std::vector<std::pair<int, ASTNode*>> equalities;
+                auto only_outer = [&](ASTNode* ex) {
+                    Vector<FieldNode*> fields;
+                    accessed_fields(ex, fields);
+                    if(fields.size() == 0) return false;
+                    for(int i = 0; i < fields.size(); ++i)
+                        if(scan_field_column(outer, outer_schema, fields[i]) == -1) return false;
+                    return true;
+                };
+                for(int i = 0; i < conjuncts.size(); ++i) {
+                    if(conjuncts[i]->category_ != EQUALITY) continue;
+                    EqualityNode* eq = (EqualityNode*)conjuncts[i];
+                    if(eq->token_.type_ != TokenType::EQ || !eq->next_ || eq->next_->category_ == EQUALITY) continue;
+                    int col = scan_field_column(inner, inner_schema, eq->cur_);
+                    if(col != -1 && only_outer(eq->next_)) {
+                        equalities.push_back({col, eq->next_});
+                        continue;
+                    }
+                    col = scan_field_column(inner, inner_schema, eq->next_);
+                    if(col != -1 && only_outer(eq->cur_)) 
+                        equalities.push_back({col, eq->cur_});
+                }
+                if(equalities.size() == 0) continue;
+
+                Vector<IndexHeader> indexes = catalog_->get_indexes_of_table(inner->table_name_);
+                int best_index = -1;
+                std::vector<ASTNode*> best_keys;
+                for(int i = 0; i < indexes.size(); ++i) {
+                    std::vector<ASTNode*> keys;
+                    for(int j = 0; j < indexes[i].fields_numbers_.size(); ++j) {
+                        int col = indexes[i].fields_numbers_[j].idx_;
+                        Type type = inner_schema->getCol(col).getType();
+                        if(type != INT && type != BIGINT && type != FLOAT && type != DOUBLE && type != VARCHAR) break;
+                        ASTNode* key = nullptr;
+                        for(int k = 0; k < equalities.size() && !key; ++k)
+                            if(equalities[k].first == col) key = equalities[k].second;
+                        if(!key) break;
+                        keys.push_back(key);
+                    }
+                    if(keys.size() == 0) continue;
+                    if(indexes[i].is_hash() && keys.size() != indexes[i].fields_numbers_.size()) continue;
+                    if(keys.size() > best_keys.size()) {
+                        best_index = i;
+                        best_keys = keys;
+                    }
+                }
+                if(best_index == -1) continue;
+
+                inner->scan_type_ = INDEX_SCAN;
+                inner->index_name_ = indexes[best_index].index_name_;
+                join->index_probe_keys_.clear();
+                for(int i = 0; i < best_keys.size(); ++i)
+                    join->index_probe_keys_.push_back(best_keys[i]);
+                join->index_inner_left_ = inner_left;
+                join->join_algo_ = INDEX_NESTED_LOOP_JOIN;
+                return true;
+            }
+            return false;
+        }
+
+        // the type of the value of a constant (the same one flatten_expression picks), INVALID for anything else.
+        Type constant_type(ASTNode* ex) {
+            while(ex && ex->category_ == EXPRESSION) ex = ((ExpressionNode*)ex)->cur_;
+            if(!ex) return INVALID;
+            switch(ex->category_) {
+                case UNARY:            return ex->token_.type_ == TokenType::MINUS ? constant_type(((UnaryNode*)ex)->cur_) : INVALID;
+                case STRING_CONSTANT:  return VARCHAR;
+                case NULL_CONSTANT:    return NULL_TYPE;
+                case INTEGER_CONSTANT: return str_to_i64(ex->token_.val_) <= MAX_I32 ? INT : BIGINT;
+                case FLOAT_CONSTANT:   return str_to_f64(ex->token_.val_) <= MAX_F32 ? FLOAT : DOUBLE;
+                default:               return INVALID;
+            }
+        }
+
         // return: if ret < 0  => didn't find a match.
         //         if ret >= 0 => the offset of the field within the IndexKey.
-        int match_index_to_filter(IndexHeader& index, TableSchema* table, ASTNode* ex) {
+        // kind (output) tells how the filter restricts that field.
+        int match_index_to_filter(IndexHeader& index, TableSchema* table, ASTNode* ex, IndexFilterKind* kind) {
             while(ex){
                 CategoryType cat = ex->category_;
                 switch(cat) {
@@ -471,11 +839,43 @@ class AlgebraEngine {
                                  }
                                  return -1;
                              }
+                    case IN:{
+                                auto in = ((InNode*)ex);
+                                if(in->negated_ || in->list_.size() == 0 || in->val_->category_ != FIELD_EXPR) 
+                                    return -1;
+                                Vector<FieldNode*> key;
+                                for(int i = 0; i < in->list_.size(); ++i){
+                                    if(in->list_[i]->category_ == SUB_QUERY) return -1;
+                                    accessed_fields(in->list_[i], key);
+                                }
+                                if(key.size() != 0) return -1;
+                                accessed_fields(in->val_, key);
+                                assert(key.size() == 1);
+                                // fields are scoped by the table rename but the catalog schema by the table name.
+                                int key_idx = table->col_exist(key[0]->token_.val_, table->getTableName());
+                                assert(key_idx != -1);
+                                // the values are put into the index keys as they are and keys of different 
+                                // numeric types can't be compared.
+                                Type key_type = table->getCol(key_idx).getType();
+                                for(int i = 0; i < in->list_.size(); ++i) {
+                                    Type type = constant_type(in->list_[i]);
+                                    if(type != key_type && type != NULL_TYPE) return -1;
+                                }
+                                for(int i = 0; i < index.fields_numbers_.size(); ++i) {
+                                    if(index.fields_numbers_[i].idx_ == key_idx) {
+                                        *kind = INDEX_FILTER_IN;
+                                        return i;
+                                    }
+                                }
+                                return -1;
+                            }
                     case EQUALITY:
                     case COMPARISON:{
                                         ASTNode* left  = nullptr; 
                                         ASTNode* right = nullptr; 
                                         if(cat == EQUALITY){
+                                            // (!=, IS, IS NOT) can't be answered by a single key range.
+                                            if(ex->token_.type_ != TokenType::EQ) return -1;
                                             left  = ((EqualityNode*)ex)->cur_;
                                             right = ((EqualityNode*)ex)->next_;
                                         } else if(COMPARISON){
@@ -489,14 +889,15 @@ class AlgebraEngine {
                                         accessed_fields(left , key);
                                         accessed_fields(right, key);
                                         if(key.size() != 1) return -1;
-                                        int key_idx = 
-                                            table->col_exist(key[0]->token_.val_, key[0]->table_name_->token_.val_);
+                                        int key_idx = table->col_exist(key[0]->token_.val_, table->getTableName());
                                         assert(key_idx != -1);
-                                        if(key[0]->table_name_) 
-                                            assert(table->getTableName() == key[0]->table_name_->token_.val_);
+                                        // same as IN-lists, the value must already have the type of the column.
+                                        Type type = constant_type(left->category_ == FIELD_EXPR ? right : left);
+                                        if(type != table->getCol(key_idx).getType() && type != NULL_TYPE) return -1;
 
                                         for(int i = 0; i < index.fields_numbers_.size(); ++i) {
                                             if(index.fields_numbers_[i].idx_ == key_idx) {
+                                                *kind = (cat == COMPARISON ? INDEX_FILTER_RANGE : INDEX_FILTER_EQ);
                                                 return i;
                                             }
                                         }
@@ -509,50 +910,198 @@ class AlgebraEngine {
             return -1;
         }
 
-        bool match_index(ScanOperation* cur_scan) {
+        // picks the index that matches the longest key prefix of the given filters,
+        // a prefix is every leading column that has an equality(or IN-list) predicate followed by at most one column 
+        // that is bounded by range predicates, all range predicates of that column are used so the scan
+        // can seek directly to the tightest [lo, hi] bound, for example:
+        // index with fields (a, b, c), 
+        // a query with predicates: a = 1 AND b > 10 AND b <= 20 AND c = 5
+        // will use (a = 1, b > 10, b <= 20) as index filters and (c = 5) as a regular filter.
+        //
+        // hash indexes only match if every one of their columns has an equality(or IN-list) predicate.
+        //
+        // return: score = 2 * (number of equality columns) + (1 if the prefix ends with a range column),
+        // a hash index gets the extra point instead because a lookup costs a single bucket read,
+        // a score of 0 means that no index could be used.
+        // index_idx (output) the position of the picked index inside of 'indexes'.
+        // used_filters (output) the positions of the matched filters ordered by the index key columns.
+        // skip (input) indexes that should not be considered.
+        int best_index_for_filters(Vector<IndexHeader>& indexes, TableSchema* tschema, Vector<ASTNode*>& filters,
+                int* index_idx, std::vector<int>* used_filters, std::vector<bool>* skip = nullptr) {
+            int best_score = 0;
+            for(int i = 0 ; i < indexes.size(); ++i) {
+                if(skip && (*skip)[i]) continue;
+                int ncols = indexes[i].fields_numbers_.size();
+                std::vector<int> eq_filters(ncols, -1);
+                std::vector<int> in_filters(ncols, -1);
+                std::vector<std::vector<int>> range_filters(ncols);
+                for(int j = 0; j < filters.size(); ++j) {
+                    if(!filters[j]) continue;
+                    IndexFilterKind kind = INDEX_FILTER_EQ;
+                    int filter_offset = match_index_to_filter(indexes[i], tschema, filters[j], &kind);
+                    if(filter_offset < 0) continue;
+                    if(kind == INDEX_FILTER_RANGE) 
+                        range_filters[filter_offset].push_back(j);
+                    else if(kind == INDEX_FILTER_IN && in_filters[filter_offset] == -1) 
+                        in_filters[filter_offset] = j;
+                    else if(kind == INDEX_FILTER_EQ && eq_filters[filter_offset] == -1) 
+                        eq_filters[filter_offset] = j;
+                }
+
+                int score = 0;
+                std::vector<int> cur_used_filters;
+                for(int j = 0; j < ncols; ++j){
+                    // a single value is always tighter than a list of values.
+                    int eq = (eq_filters[j] != -1 ? eq_filters[j] : in_filters[j]);
+                    if(eq != -1) {
+                        cur_used_filters.push_back(eq);
+                        score += 2;
+                        continue;
+                    }
+                    if(range_filters[j].size()) {
+                        for(int k = 0; k < range_filters[j].size(); ++k)
+                            cur_used_filters.push_back(range_filters[j][k]);
+                        score += 1;
+                    }
+                    break;
+                }
+                if(indexes[i].is_hash()) 
+                    score = (cur_used_filters.size() == ncols && score == 2 * ncols) ? score + 1 : 0;
+                if(score > best_score) {
+                    best_score = score;
+                    *index_idx = i;
+                    *used_filters = cur_used_filters;
+                }
+            }
+            return best_score;
+        }
+
+        // create an index scan that is used by a rid set scan to collect record ids,
+        // the used filters are copied into the new scan and set to null inside of 'filters' if remove_used is true.
+        ScanOperation* create_rid_scan(QueryCTX& ctx, ScanOperation* cur_scan, IndexHeader& index, 
+                Vector<ASTNode*>& filters, std::vector<int>& used_filters, bool remove_used) {
+            ScanOperation* rid_scan = 
+                New(ScanOperation, ctx.arena_, cur_scan->query_idx_, cur_scan->table_name_, cur_scan->table_rename_);
+            rid_scan->scan_type_ = INDEX_SCAN;
+            rid_scan->index_name_ = index.index_name_;
+            for(int i = 0; i < used_filters.size(); ++i){
+                rid_scan->index_filters_.push_back(filters[used_filters[i]]);
+                if(remove_used) filters[used_filters[i]] = nullptr;
+            }
+            return rid_scan;
+        }
+
+        // index-OR: a filter of the form (p1 OR p2 OR ... pn) can use indexes only if every pi can use an index,
+        // the record ids of all of them are unioned, the filter itself is kept to be checked on the fetched records.
+        bool match_index_union(QueryCTX& ctx, ScanOperation* cur_scan, 
+                Vector<IndexHeader>& table_indexes, TableSchema* tschema) {
+            for(int f = 0; f < cur_scan->filters_.size(); ++f) {
+                ASTNode* ex = cur_scan->filters_[f];
+                while(ex) {
+                    if(ex->category_ == EXPRESSION) {
+                        ex = ((ExpressionNode*)ex)->cur_;
+                    } else if(ex->category_ == AND && 
+                            (((AndNode*)ex)->next_ == nullptr || ((AndNode*)ex)->mark_split_)) {
+                        ex = ((AndNode*)ex)->cur_;
+                    } else {
+                        break;
+                    }
+                }
+                if(!ex || ex->category_ != OR) continue;
+
+                Vector<ScanOperation*> rid_scans;
+                bool all_matched = true;
+                ASTNode* disjunct_ptr = ex;
+                while(disjunct_ptr && all_matched) {
+                    ASTNode* disjunct = disjunct_ptr;
+                    disjunct_ptr = nullptr;
+                    if(disjunct->category_ == OR) {
+                        disjunct_ptr = ((OrNode*)disjunct)->next_;
+                        disjunct = ((OrNode*)disjunct)->cur_;
+                    }
+                    while(disjunct && disjunct->category_ == EXPRESSION) 
+                        disjunct = ((ExpressionNode*)disjunct)->cur_;
+                    // split the disjunct into its conjuncts.
+                    Vector<ASTNode*> conjuncts;
+                    while(disjunct && disjunct->category_ == AND) {
+                        conjuncts.push_back(((AndNode*)disjunct)->cur_);
+                        disjunct = ((AndNode*)disjunct)->next_;
+                    }
+                    if(disjunct) conjuncts.push_back(disjunct);
+
+                    int index_idx = -1;
+                    std::vector<int> used_filters;
+                    int score = best_index_for_filters(table_indexes, tschema, conjuncts, &index_idx, &used_filters);
+                    if(score == 0) {
+                        all_matched = false;
+                        break;
+                    }
+                    rid_scans.push_back(
+                            create_rid_scan(ctx, cur_scan, table_indexes[index_idx], conjuncts, used_filters, false));
+                }
+                if(!all_matched) continue;
+                cur_scan->scan_type_ = RID_SET_SCAN;
+                cur_scan->rid_set_union_ = true;
+                cur_scan->rid_scans_ = rid_scans;
+                return true;
+            }
+            return false;
+        }
+
+        // index-AND: every index that can seek on an equality prefix of the remaining filters is used,
+        // the record ids of all of them are intersected before fetching any table pages.
+        bool match_index_intersection(QueryCTX& ctx, ScanOperation* cur_scan, 
+                Vector<IndexHeader>& table_indexes, TableSchema* tschema, int first_index, std::vector<int>& first_used) {
+            Vector<ASTNode*> filters = cur_scan->filters_;
+            std::vector<bool> used_indexes(table_indexes.size(), false);
+            Vector<ScanOperation*> rid_scans;
+
+            used_indexes[first_index] = true;
+            rid_scans.push_back(create_rid_scan(ctx, cur_scan, table_indexes[first_index], filters, first_used, true));
+            while(true) {
+                int index_idx = -1;
+                std::vector<int> used_filters;
+                int score = best_index_for_filters(table_indexes, tschema, filters, &index_idx, &used_filters, &used_indexes);
+                // range only matches are not selective enough to be worth intersecting.
+                if(score < 2) break;
+                used_indexes[index_idx] = true;
+                rid_scans.push_back(create_rid_scan(ctx, cur_scan, table_indexes[index_idx], filters, used_filters, true));
+            }
+            if(rid_scans.size() < 2) return false;
+
+            cur_scan->scan_type_ = RID_SET_SCAN;
+            cur_scan->rid_set_union_ = false;
+            cur_scan->rid_scans_ = rid_scans;
+            cur_scan->filters_.clear();
+            for(int i = 0; i < filters.size(); ++i)
+                if(filters[i]) cur_scan->filters_.push_back(filters[i]);
+            return true;
+        }
+
+        bool match_index(QueryCTX& ctx, ScanOperation* cur_scan) {
             if(cur_scan->filters_.size() == 0) return false;
             String8 tname = cur_scan->table_name_;
             TableSchema* tschema = catalog_->get_table_schema(tname);
             assert(tschema);
             Vector<IndexHeader> table_indexes = catalog_->get_indexes_of_table(tname);
             if(table_indexes.size() == 0) return false;
-            std::pair<int, std::vector<int>> best_index = {-1, {}};
-            for(int i = 0 ; i < table_indexes.size(); ++i) {
-                std::vector<int> matched_filters(table_indexes[i].fields_numbers_.size(), -1);
-                int max_offset = -1;
-                for(int j = 0; j < cur_scan->filters_.size(); ++j) {
-                    int filter_offset = match_index_to_filter(table_indexes[i], tschema, cur_scan->filters_[j]);
-                    if(filter_offset >= 0)
-                        matched_filters[filter_offset] = j;
-                }
-
-                for(int j = 0; j < matched_filters.size(); ++j){
-                    if(matched_filters[j] == -1) break;
-                     //TODO: fix this condition.
-                    // this condition makes sure that:
-                    // all matched_filters are stored with the same order(desc or asc) within the index.
-                    // for example:
-                    // index with fields (col0 desc, col1 asc), 
-                    // a query with predicates: col0 > 5000 AND col1 > 1000
-                    // will only use the first predicate as a search key.
-                    //if(j > 0 && 
-                     //       table_indexes[i].fields_numbers_[j].desc_ != table_indexes[i].fields_numbers_[j-1].desc_) break;
-                    if(j > 0) break;
-                    max_offset = j;
-                }
-                if(max_offset >= 0 && max_offset >= best_index.second.size()) {
-                    best_index = {i, {}};
-                    for(int i = 0; i <= max_offset; ++i)
-                        best_index.second.push_back(matched_filters[i]);
-                }
-            }
+
+            int index_idx = -1;
+            std::vector<int> used_filters;
+            int score = best_index_for_filters(table_indexes, tschema, cur_scan->filters_, &index_idx, &used_filters);
+            if(score >= 2 && match_index_intersection(ctx, cur_scan, table_indexes, tschema, index_idx, used_filters))
+                return true;
+            // a single index with an equality prefix is preferred over a union of multiple index scans.
+            if(score < 2 && match_index_union(ctx, cur_scan, table_indexes, tschema)) 
+                return true;
             // didn't match any indexes.
-            if(best_index.first == -1) return false;
-            assert(best_index.second.size() > 0);
+            if(score == 0) return false;
+            assert(used_filters.size() > 0);
             cur_scan->scan_type_ = INDEX_SCAN;
-            cur_scan->index_name_ = table_indexes[best_index.first].index_name_;
-            for(int i = 0; i < best_index.second.size(); ++i){
-                int cur_filter_idx = best_index.second[i];
+            cur_scan->index_name_ = table_indexes[index_idx].index_name_;
+            // index filters are stored in the same order of the index key columns.
+            for(int i = 0; i < used_filters.size(); ++i){
+                int cur_filter_idx = used_filters[i];
                 cur_scan->index_filters_.push_back(cur_scan->filters_[cur_filter_idx]);
                 cur_scan->filters_[cur_filter_idx] = nullptr;
             }
@@ -568,7 +1117,988 @@ class AlgebraEngine {
             return true;
         }
 
+        // return the column index of an expression that is just a field of the scanned table, otherwise -1.
+        int scan_field_column(ScanOperation* scan, TableSchema* table, ASTNode* ex) {
+            while(ex && ex->category_ == EXPRESSION) ex = ((ExpressionNode*)ex)->cur_;
+            if(!ex || ex->category_ != FIELD_EXPR) return -1;
+            FieldNode* field = (FieldNode*)ex;
+            if(!field->table_name_ || field->table_name_->token_.val_ != scan->table_rename_) return -1;
+            return table->col_exist(field->token_.val_, table->getTableName());
+        }
+
+        // a loose index scan answers DISTINCT and GROUP BY over a leading prefix of an index by reading 
+        // one entry per group and seeking directly to the next group instead of reading every row, for example:
+        // index with fields (a, b),
+        // SELECT DISTINCT a FROM t                   => one entry for every value of a.
+        // SELECT a, MIN(b), MAX(b) FROM t GROUP BY a => the first and the last non-null b for every value of a.
+        // SELECT MIN(a) FROM t                       => the first and the last non-null a of the whole index.
+        // the distinct and aggregation operators on top are kept but they only see a couple of rows per group.
+        bool match_loose_index_scan(QueryCTX& ctx, SelectStatementData* data, ScanOperation* scan) {
+            if(scan->scan_type_ != SEQ_SCAN || scan->filters_.size() || data->where_ || data->has_star_) 
+                return false;
+            if(data->tables_.size() != 1 || data->joined_tables_.size()) return false;
+            // sub-queries can access any column of the skipped rows.
+            for(int i = 0; i < ctx.queries_call_stack_.size(); ++i)
+                if(ctx.queries_call_stack_[i]->parent_idx_ == data->idx_) return false;
+            TableSchema* tschema = catalog_->get_table_schema(scan->table_name_);
+            if(!tschema) return false;
+
+            std::vector<int> group_cols;
+            auto is_group_col = [&group_cols](int col) {
+                return std::find(group_cols.begin(), group_cols.end(), col) != group_cols.end();
+            };
+            if(data->group_by_.size()) {
+                for(int i = 0; i < data->group_by_.size(); ++i) {
+                    int col = scan_field_column(scan, tschema, data->group_by_[i]);
+                    if(col == -1) return false;
+                    if(!is_group_col(col)) group_cols.push_back(col);
+                }
+            } else if(data->distinct_ && data->aggregates_.size() == 0) {
+                for(int i = 0; i < data->fields_.size(); ++i) {
+                    int col = scan_field_column(scan, tschema, data->fields_[i]);
+                    if(col == -1) return false;
+                    if(!is_group_col(col)) group_cols.push_back(col);
+                }
+            } else if(data->aggregates_.size() == 0) {
+                return false;
+            }
+
+            // the output can only depend on the group columns and the aggregates.
+            Vector<FieldNode*> fields;
+            for(int i = 0; i < data->fields_.size(); ++i)
+                accessed_fields(data->fields_[i], fields);
+            accessed_fields(data->having_, fields);
+            for(int i = 0; i < fields.size(); ++i) {
+                if(!is_group_col(scan_field_column(scan, tschema, fields[i]))) return false;
+            }
+
+            // MIN and MAX of a single column that comes right after the group columns inside of the index.
+            int agg_col = -1;
+            for(int i = 0; i < data->aggregates_.size(); ++i) {
+                AggregateFuncNode* agg = data->aggregates_[i];
+                if(agg->type_ != MIN && agg->type_ != MAX) return false;
+                int col = scan_field_column(scan, tschema, agg->exp_);
+                if(col == -1) return false;
+                if(is_group_col(col)) continue;
+                if(agg_col != -1 && agg_col != col) return false;
+                agg_col = col;
+            }
+            int prefix_len = group_cols.size();
+            // nothing to skip.
+            if(prefix_len == 0 && agg_col == -1) return false;
+
+            Vector<IndexHeader> table_indexes = catalog_->get_indexes_of_table(scan->table_name_);
+            for(int i = 0; i < table_indexes.size(); ++i) {
+                if(table_indexes[i].is_hash()) continue;
+                auto& index_fields = table_indexes[i].fields_numbers_;
+                if(index_fields.size() < prefix_len + (agg_col != -1)) continue;
+                bool matched = true;
+                for(int j = 0; j < prefix_len && matched; ++j)
+                    matched = is_group_col(index_fields[j].idx_);
+                if(!matched || (agg_col != -1 && index_fields[prefix_len].idx_ != agg_col)) continue;
+                scan->scan_type_ = LOOSE_INDEX_SCAN;
+                scan->index_name_ = table_indexes[i].index_name_;
+                scan->loose_prefix_len_ = prefix_len;
+                scan->loose_min_max_ = (agg_col != -1);
+                return true;
+            }
+            return false;
+        }
+
+        // the rows of a single table scan come out in ORDER BY order if they are read through an index whose key 
+        // columns match the ORDER BY list after skipping the columns that are fixed by an equality filter, 
+        // the index can be read forward or backward as long as all ORDER BY columns agree on the direction, 
+        // for example:
+        // index with fields (a, b DESC),
+        // SELECT a, b FROM t ORDER BY 1, 2 DESC       => forward scan.
+        // SELECT a, b FROM t ORDER BY 1 DESC, 2       => backward scan.
+        // SELECT b FROM t WHERE a = 1 ORDER BY 1 DESC => forward scan of the (a = 1) range.
+        // nulls are stored first in both directions of a column but sorted as the smallest values,
+        // so a column that is stored in the opposite direction of the scan only matches if it can't be null.
+        // a sequential scan is turned into a full index scan, an index scan only checks its own index.
+        // the sort itself is dropped later if the properties of the plan show the order (see derive_properties).
+        // return true if the scan output is already sorted.
+        bool match_index_order(QueryCTX& ctx, SelectStatementData* data, ScanOperation* scan) {
+            if(!data->order_by_list_.size()) return false;
+            if(scan->scan_type_ != SEQ_SCAN && scan->scan_type_ != INDEX_SCAN) return false;
+            if(data->tables_.size() != 1 || data->joined_tables_.size()) return false;
+            if(data->aggregates_.size() || data->group_by_.size()) return false;
+            TableSchema* tschema = catalog_->get_table_schema(scan->table_name_);
+            if(!tschema) return false;
+
+            std::vector<int> order_cols;
+            for(int i = 0; i < data->order_by_list_.size(); ++i) {
+                int pos = data->order_by_list_[i];
+                int col = -1;
+                if(data->has_star_) {
+                    // only a lonely star maps the output positions to the table columns.
+                    if(data->fields_.size() == 1 && pos < tschema->numOfCols()) col = pos;
+                } else {
+                    col = scan_field_column(scan, tschema, data->fields_[pos]);
+                }
+                if(col == -1) return false;
+                order_cols.push_back(col);
+            }
+
+            Vector<IndexHeader> table_indexes = catalog_->get_indexes_of_table(scan->table_name_);
+            for(int i = 0; i < table_indexes.size(); ++i) {
+                IndexHeader& index = table_indexes[i];
+                if(index.is_hash()) continue;
+                if(scan->scan_type_ == INDEX_SCAN && index.index_name_ != scan->index_name_) continue;
+                auto& index_fields = index.fields_numbers_;
+                int ncols = index_fields.size();
+                std::vector<bool> fixed(ncols, false);
+                std::vector<bool> no_nulls(ncols, false);
+                for(int j = 0; j < scan->index_filters_.size(); ++j) {
+                    IndexFilterKind kind = INDEX_FILTER_EQ;
+                    int offset = match_index_to_filter(index, tschema, scan->index_filters_[j], &kind);
+                    if(offset < 0) continue;
+                    if(kind == INDEX_FILTER_EQ) fixed[offset] = true;
+                    // IN-lists and ranges never match nulls.
+                    no_nulls[offset] = true;
+                }
+                auto is_fixed = [&](int col) {
+                    for(int j = 0; j < ncols; ++j)
+                        if(index_fields[j].idx_ == col && fixed[j]) return true;
+                    return false;
+                };
+
+                int dir = 0; // 1 => forward, -1 => backward.
+                bool matched = true;
+                int j = 0;
+                for(int k = 0; k < order_cols.size() && matched; ++k) {
+                    int col = order_cols[k];
+                    if(is_fixed(col)) continue;
+                    while(j < ncols && fixed[j]) ++j;
+                    if(j >= ncols || index_fields[j].idx_ != col) {
+                        matched = false;
+                        break;
+                    }
+                    bool desc = data->order_by_desc_[k];
+                    int cur_dir = (desc != index_fields[j].desc_) ? -1 : 1;
+                    if(dir != 0 && dir != cur_dir) matched = false;
+                    dir = cur_dir;
+                    bool nulls_first = (dir == 1);
+                    if(nulls_first == desc && !no_nulls[j] && tschema->getCol(col).isNullable()) 
+                        matched = false;
+                    ++j;
+                }
+                if(!matched) continue;
+                scan->scan_type_ = INDEX_SCAN;
+                scan->index_name_ = index.index_name_;
+                scan->index_reverse_ = (dir == -1);
+                return true;
+            }
+            return false;
+        }
+
+        // x [NOT] IN (sub-query) as a conjunct of the where clause of a select, x is a field of this query
+        // and the sub-query is an uncorrelated select of one column: the sub-query is read once into the hash table
+        // of a semi join (anti join for NOT IN) instead of scanning its output for every row.
+        // returns the IN node or nullptr.
+        InNode* match_semi_join(QueryCTX& ctx, QueryData* data, ExpressionNode* conjunct) {
+            if(data->type_ != SELECT_DATA) return nullptr;
+            ASTNode* ex = split_conjunct(conjunct);
+            if(!ex || ex->category_ != IN) return nullptr;
+            InNode* in = (InNode*)ex;
+            if(in->list_.size() != 1) return nullptr;
+            ASTNode* sub = split_conjunct(in->list_[0]);
+            ASTNode* val = split_conjunct(in->val_);
+            if(!sub || sub->category_ != SUB_QUERY || !val || val->category_ != FIELD_EXPR) return nullptr;
+            if(((FieldNode*)val)->query_idx_ != data->idx_) return nullptr;
+            int sub_idx = ((SubQueryNode*)sub)->idx_;
+            if(sub_idx <= 0 || sub_idx >= ctx.queries_call_stack_.size()) return nullptr;
+            QueryData* sub_data = ctx.queries_call_stack_[sub_idx];
+            if(sub_data->type_ != SELECT_DATA || sub_data->corelated_) return nullptr;
+            SelectStatementData* sub_select = (SelectStatementData*)sub_data;
+            if(sub_select->has_star_ || sub_select->fields_.size() != 1) return nullptr;
+            return in;
+        }
+
+        // the sub-queries that are used as values in an expression (not with EXISTS and not as the list of an IN),
+        // the expressions of the sub-queries themselves are not visited.
+        void collect_scalar_subqueries(ASTNode* ex, Vector<SubQueryNode*>& subs) {
+            if(!ex) return;
+            switch(ex->category_) {
+                case EXPRESSION:
+                    collect_scalar_subqueries(((ExpressionNode*)ex)->cur_, subs);
+                    return;
+                case SUB_QUERY:
+                    if(!((SubQueryNode*)ex)->used_with_exists_) subs.push_back((SubQueryNode*)ex);
+                    return;
+                case CASE_EXPRESSION:
+                    {
+                        auto case_ex = (CaseExpressionNode*)ex;
+                        collect_scalar_subqueries(case_ex->initial_value_, subs);
+                        for(auto& [when, then] : case_ex->when_then_pairs_) {
+                            collect_scalar_subqueries(when, subs);
+                            collect_scalar_subqueries(then, subs);
+                        }
+                        collect_scalar_subqueries(case_ex->else_, subs);
+                        return;
+                    }
+                case NULLIF_EXPRESSION:
+                    collect_scalar_subqueries(((NullifExpressionNode*)ex)->lhs_, subs);
+                    collect_scalar_subqueries(((NullifExpressionNode*)ex)->rhs_, subs);
+                    return;
+                case IN:
+                    collect_scalar_subqueries(((InNode*)ex)->val_, subs);
+                    return;
+                case BETWEEN:
+                    collect_scalar_subqueries(((BetweenNode*)ex)->val_, subs);
+                    collect_scalar_subqueries(((BetweenNode*)ex)->lhs_, subs);
+                    collect_scalar_subqueries(((BetweenNode*)ex)->rhs_, subs);
+                    return;
+                case NOT:
+                    collect_scalar_subqueries(((NotNode*)ex)->cur_, subs);
+                    return;
+                case UNARY:
+                    collect_scalar_subqueries(((UnaryNode*)ex)->cur_, subs);
+                    return;
+                case TYPE_CAST:
+                    collect_scalar_subqueries(((TypeCastNode*)ex)->exp_, subs);
+                    return;
+                case SCALAR_FUNC:
+                    for(auto arg : ((ScalarFuncNode*)ex)->args_) collect_scalar_subqueries(arg, subs);
+                    return;
+                case AND:
+                    collect_scalar_subqueries(((AndNode*)ex)->cur_, subs);
+                    // the rest of a split where clause belongs to other filters.
+                    if(!((AndNode*)ex)->mark_split_) collect_scalar_subqueries(((AndNode*)ex)->next_, subs);
+                    return;
+                case OR:
+                    collect_scalar_subqueries(((OrNode*)ex)->cur_, subs);
+                    collect_scalar_subqueries(((OrNode*)ex)->next_, subs);
+                    return;
+                case EQUALITY:
+                    collect_scalar_subqueries(((EqualityNode*)ex)->cur_, subs);
+                    collect_scalar_subqueries(((EqualityNode*)ex)->next_, subs);
+                    return;
+                case COMPARISON:
+                    collect_scalar_subqueries(((ComparisonNode*)ex)->cur_, subs);
+                    collect_scalar_subqueries(((ComparisonNode*)ex)->next_, subs);
+                    return;
+                case TERM:
+                    collect_scalar_subqueries(((TermNode*)ex)->cur_, subs);
+                    collect_scalar_subqueries(((TermNode*)ex)->next_, subs);
+                    return;
+                case FACTOR:
+                    collect_scalar_subqueries(((FactorNode*)ex)->cur_, subs);
+                    collect_scalar_subqueries(((FactorNode*)ex)->next_, subs);
+                    return;
+                default:
+                    return;
+            }
+        }
+
+        // the query of a corelated sub-query of data that can be planned as a join of data, otherwise nullptr.
+        // it has to be a plain select (no grouping, limit or outer joins) without sub-queries of its own,
+        // and its table names can't be used by data or by the sub-queries that were already unnested into it
+        // because their columns end up in the same joined rows.
+        SelectStatementData* unnest_candidate(QueryCTX& ctx, SelectStatementData* data, SubQueryNode* sub, 
+                Vector<String8>& names) {
+            if(sub->idx_ <= data->idx_ || sub->idx_ >= ctx.queries_call_stack_.size()) return nullptr;
+            QueryData* sub_data = ctx.queries_call_stack_[sub->idx_];
+            if(sub_data->type_ != SELECT_DATA || !sub_data->corelated_ || sub_data->unnested_) return nullptr;
+            if(sub_data->parent_idx_ != data->idx_) return nullptr;
+            SelectStatementData* sub_select = (SelectStatementData*)sub_data;
+            if(!sub_select->tables_.size() || !isValidSelectStatementData(sub_select)) return nullptr;
+            if(sub_select->group_by_.size() || sub_select->having_) return nullptr;
+            if(sub_select->limit_ != MAX_U64 || sub_select->offset_) return nullptr;
+            for(int i = 0; i < sub_select->joined_tables_.size(); ++i)
+                if(sub_select->joined_tables_[i].type_ != INNER_JOIN) return nullptr;
+            for(int i = 0; i < sub_select->table_names_.size(); ++i)
+                for(int j = 0; j < names.size(); ++j)
+                    if(sub_select->table_names_[i] == names[j]) return nullptr;
+            for(auto query : ctx.queries_call_stack_)
+                if(query->parent_idx_ == sub_select->idx_) return nullptr;
+            return sub_select;
+        }
+
+        // a = b where a is a field of the sub-query and b is a field of data (or the other way around).
+        bool is_correlation_key(ASTNode* ex, QueryData* data, QueryData* sub) {
+            ex = split_conjunct(ex);
+            if(!ex || ex->category_ != EQUALITY || ex->token_.type_ != TokenType::EQ) return false;
+            ASTNode* lhs = split_conjunct(((EqualityNode*)ex)->cur_);
+            ASTNode* rhs = split_conjunct(((EqualityNode*)ex)->next_);
+            if(!lhs || !rhs || lhs->category_ != FIELD_EXPR || rhs->category_ != FIELD_EXPR) return false;
+            int l = ((FieldNode*)lhs)->query_idx_, r = ((FieldNode*)rhs)->query_idx_;
+            return (l == sub->idx_ && r == data->idx_) || (l == data->idx_ && r == sub->idx_);
+        }
+
+        // splits the where clause of a sub-query into its local conjuncts (only fields of the sub-query),
+        // the correlation keys (see is_correlation_key) and the other conjuncts that use fields of data.
+        // false if a conjunct uses fields of any other query.
+        bool split_correlated_where(QueryCTX& ctx, QueryData* data, QueryData* sub,
+                Vector<ASTNode*>& local, Vector<ASTNode*>& keys, Vector<ASTNode*>& residuals) {
+            Vector<ASTNode*> conjuncts;
+            split_conjuncts(sub->where_, conjuncts);
+            for(int i = 0; i < conjuncts.size(); ++i) {
+                Vector<FieldNode*> fields;
+                accessed_fields_deep(ctx, conjuncts[i], fields);
+                bool outer = false;
+                for(int j = 0; j < fields.size(); ++j) {
+                    if(fields[j]->query_idx_ == data->idx_) outer = true;
+                    else if(fields[j]->query_idx_ != sub->idx_) return false;
+                }
+                if(!outer) local.push_back(conjuncts[i]);
+                else if(is_correlation_key(conjuncts[i], data, sub)) keys.push_back(conjuncts[i]);
+                else residuals.push_back(conjuncts[i]);
+            }
+            return true;
+        }
+
+        // an AND chain of the conditions, nullptr if there are none.
+        ExpressionNode* and_chain(QueryCTX& ctx, QueryData* data, Vector<ASTNode*>& conds) {
+            if(!conds.size()) return nullptr;
+            ASTNode* chain = conds.back();
+            for(int i = (int)conds.size() - 2; i >= 0; --i) {
+                AndNode* land = nullptr;
+                ALLOCATE_INIT(ctx.arena_, land, AndNode, (NotNode*)conds[i], nullptr, Token(TokenType::AND));
+                land->next_ = chain;
+                chain = land;
+            }
+            ExpressionNode* ex = nullptr;
+            ALLOCATE_INIT(ctx.arena_, ex, ExpressionNode, data, data->idx_, chain);
+            return ex;
+        }
+
+        // moves the fields of one query to another, the conditions of an unnested sub-query are evaluated by its parent.
+        void move_fields(QueryCTX& ctx, ASTNode* ex, int from_idx, int to_idx) {
+            Vector<FieldNode*> fields;
+            accessed_fields_deep(ctx, ex, fields);
+            for(int i = 0; i < fields.size(); ++i)
+                if(fields[i]->query_idx_ == from_idx) fields[i]->query_idx_ = to_idx;
+        }
+
+        FieldNode* copy_field(QueryCTX& ctx, FieldNode* field, int query_idx) {
+            FieldNode* copy = nullptr;
+            ALLOCATE_INIT(ctx.arena_, copy, FieldNode, field->token_, field->table_name_);
+            copy->query_idx_ = query_idx;
+            return copy;
+        }
+
+        // plans the sub-query with only its local conjuncts, the rest of its where clause is evaluated by the join.
+        AlgebraOperation* plan_unnested(QueryCTX& ctx, SelectStatementData* sub, Vector<ASTNode*>& local, 
+                Vector<String8>& names) {
+            sub->where_ = and_chain(ctx, sub, local);
+            sub->unnested_ = true;
+            for(int i = 0; i < sub->table_names_.size(); ++i) names.push_back(sub->table_names_[i]);
+            printf("Query %d is unnested into query %d\n", sub->idx_, sub->parent_idx_);
+            return optimize(ctx, sub);
+        }
+
+        // [NOT] EXISTS (sub-query) or x IN (sub-query) as a conjunct of the where clause of data, the sub-query is
+        // corelated to data by equalities of its fields and fields of data (x = the selected field for IN).
+        // instead of running the sub-query for every row of data, it runs once without its corelated conjuncts
+        // and its rows are the build side of a hash semi join (anti join for NOT EXISTS) with the rows of data,
+        // the join condition is the corelated conjuncts starting with an equality that is used as the key.
+        // NOT IN is not unnested, it needs the null semantics of the whole sub-query for every outer row.
+        JoinOperation* unnest_semi_join(QueryCTX& ctx, SelectStatementData* data, ExpressionNode* conjunct, 
+                Vector<String8>& names) {
+            ASTNode* ex = split_conjunct(conjunct);
+            bool negated = false;
+            while(ex && (ex->category_ == NOT || ex->category_ == EXPRESSION)) {
+                if(ex->category_ == NOT) negated ^= ((NotNode*)ex)->effective_;
+                ex = ex->category_ == NOT ? (ASTNode*)((NotNode*)ex)->cur_ : ((ExpressionNode*)ex)->cur_;
+            }
+            if(!ex) return nullptr;
+            SubQueryNode* sub = nullptr;
+            FieldNode* in_val = nullptr;
+            if(ex->category_ == SUB_QUERY && ((SubQueryNode*)ex)->used_with_exists_) {
+                sub = (SubQueryNode*)ex;
+            } else if(ex->category_ == IN && !negated && !((InNode*)ex)->negated_ && ((InNode*)ex)->list_.size() == 1) {
+                ASTNode* list = split_conjunct(((InNode*)ex)->list_[0]);
+                ASTNode* val = split_conjunct(((InNode*)ex)->val_);
+                if(!list || list->category_ != SUB_QUERY || !val || val->category_ != FIELD_EXPR) return nullptr;
+                if(((FieldNode*)val)->query_idx_ != data->idx_) return nullptr;
+                sub = (SubQueryNode*)list;
+                in_val = (FieldNode*)val;
+            } else {
+                return nullptr;
+            }
+            SelectStatementData* sub_select = unnest_candidate(ctx, data, sub, names);
+            if(!sub_select || sub_select->aggregates_.size()) return nullptr;
+            Vector<ASTNode*> local, keys, residuals;
+            if(in_val) {
+                if(sub_select->has_star_ || sub_select->fields_.size() != 1) return nullptr;
+                ASTNode* selected = split_conjunct(sub_select->fields_[0]);
+                if(!selected || selected->category_ != FIELD_EXPR || ((FieldNode*)selected)->query_idx_ != sub_select->idx_)
+                    return nullptr;
+                EqualityNode* eq = nullptr;
+                ALLOCATE_INIT(ctx.arena_, eq, EqualityNode, (ComparisonNode*)in_val, nullptr, Token(TokenType::EQ));
+                eq->next_ = copy_field(ctx, (FieldNode*)selected, sub_select->idx_);
+                keys.push_back(eq);
+            }
+            if(!split_correlated_where(ctx, data, sub_select, local, keys, residuals) || !keys.size()) return nullptr;
+
+            AlgebraOperation* inner = plan_unnested(ctx, sub_select, local, names);
+            for(int i = 0; i < residuals.size(); ++i) keys.push_back(residuals[i]);
+            ExpressionNode* filter = and_chain(ctx, data, keys);
+            move_fields(ctx, filter, sub_select->idx_, data->idx_);
+            return New(JoinOperation, ctx.arena_, data->idx_, inner, nullptr, filter, 
+                    negated ? ANTI_JOIN : SEMI_JOIN, HASH_JOIN);
+        }
+
+        // a corelated scalar sub-query that computes aggregates over the rows that match the current row of data:
+        // (SELECT COUNT(*) FROM u WHERE u.x = t.x). it runs once grouped by its side of the correlation keys
+        // and its groups are right joined to the rows of data on them, then the value of the sub-query
+        // is read from the joined row (SubQueryNode::unnested_).
+        // rows of data without a group get nulls, that is the value of the aggregates over no rows except for COUNT
+        // which is read through COALESCE(..., 0), so COUNT can't be part of a bigger expression.
+        JoinOperation* unnest_scalar_subquery(QueryCTX& ctx, SelectStatementData* data, SubQueryNode* sub,
+                Vector<String8>& names) {
+            SelectStatementData* sub_select = unnest_candidate(ctx, data, sub, names);
+            if(!sub_select || sub_select->has_star_ || sub_select->fields_.size() != 1) return nullptr;
+            if(!sub_select->aggregates_.size()) return nullptr;
+            // only the aggregates can be read after the join.
+            ExpressionNode* value = sub_select->fields_[0];
+            Vector<FieldNode*> fields;
+            accessed_fields_deep(ctx, value, fields);
+            for(int i = 0; i < fields.size(); ++i) {
+                if(!fields[i]->table_name_ || fields[i]->table_name_->token_.val_ != str_lit(AGG_FUNC_IDENTIFIER_PREFIX))
+                    return nullptr;
+            }
+            bool has_count = false;
+            for(int i = 0; i < sub_select->aggregates_.size(); ++i) {
+                if(sub_select->aggregates_[i]->type_ == COUNT) has_count = true;
+                Vector<FieldNode*> agg_fields;
+                accessed_fields_deep(ctx, sub_select->aggregates_[i], agg_fields);
+                for(int j = 0; j < agg_fields.size(); ++j)
+                    if(agg_fields[j]->query_idx_ != sub_select->idx_) return nullptr;
+            }
+            ASTNode* bare_value = split_conjunct(value);
+            if(has_count && (!bare_value || bare_value->category_ != FIELD_EXPR)) return nullptr;
+            // other corelated conjuncts can't be checked after grouping.
+            Vector<ASTNode*> local, keys, residuals;
+            if(!split_correlated_where(ctx, data, sub_select, local, keys, residuals)) return nullptr;
+            if(!keys.size() || residuals.size()) return nullptr;
+
+            Vector<ASTNode*> group_by;
+            for(int i = 0; i < keys.size(); ++i) {
+                EqualityNode* eq = (EqualityNode*)split_conjunct(keys[i]);
+                FieldNode* lhs = (FieldNode*)split_conjunct(eq->cur_);
+                FieldNode* rhs = (FieldNode*)split_conjunct(eq->next_);
+                group_by.push_back(copy_field(ctx, lhs->query_idx_ == sub_select->idx_ ? lhs : rhs, sub_select->idx_));
+            }
+            AlgebraOperation* inner = plan_unnested(ctx, sub_select, local, names);
+            AggregationOperation* agg = New(AggregationOperation, ctx.arena_, sub_select->idx_, inner, 
+                    sub_select->aggregates_, group_by);
+            ExpressionNode* filter = and_chain(ctx, data, keys);
+            move_fields(ctx, filter, sub_select->idx_, data->idx_);
+            move_fields(ctx, value, sub_select->idx_, data->idx_);
+            sub->unnested_ = value;
+            if(has_count) {
+                ASTNode* zero = nullptr;
+                ALLOCATE_INIT(ctx.arena_, zero, ASTNode, INTEGER_CONSTANT, Token(TokenType::NUMBER_CONSTANT, str_lit("0")));
+                ExpressionNode* zero_ex = nullptr;
+                ALLOCATE_INIT(ctx.arena_, zero_ex, ExpressionNode, data, data->idx_, zero);
+                Vector<ExpressionNode*> args;
+                args.push_back(value);
+                args.push_back(zero_ex);
+                ScalarFuncNode* coalesce = nullptr;
+                ALLOCATE_INIT(ctx.arena_, coalesce, ScalarFuncNode, args, str_lit("COALESCE"), data->idx_);
+                sub->unnested_ = coalesce;
+            }
+            return New(JoinOperation, ctx.arena_, data->idx_, agg, nullptr, filter, RIGHT_JOIN, HASH_JOIN);
+        }
+
+        // turns the corelated sub-queries of a select into joins (see unnest_semi_join and unnest_scalar_subquery),
+        // the joins are placed on top of the rest of the plan of data with their rhs_ left empty for the caller,
+        // the conjuncts they replace are removed from splitted_where and the conjuncts that read the value of
+        // an unnested scalar sub-query are moved to filters to be checked after its join.
+        // only one scalar sub-query is unnested because the columns of its aggregates are named by their position.
+        void unnest_subqueries(QueryCTX& ctx, SelectStatementData* data, Vector<ExpressionNode*>& splitted_where,
+                Vector<JoinOperation*>& joins, Vector<ExpressionNode*>& filters) {
+            Vector<String8> names;
+            for(int i = 0; i < data->table_names_.size(); ++i) names.push_back(data->table_names_[i]);
+            for(int i = 0; i < splitted_where.size(); ++i) {
+                JoinOperation* join = unnest_semi_join(ctx, data, splitted_where[i], names);
+                if(!join) continue;
+                joins.push_back(join);
+                splitted_where.erase(splitted_where.begin() + i--);
+            }
+            // the output of the scalar join has the columns of the sub-query as well.
+            if(data->aggregates_.size() || data->group_by_.size() || data->has_star_) return;
+            // the sub-queries and the conjunct that uses them (-1 for the select list).
+            Vector<SubQueryNode*> subs;
+            Vector<int> owners;
+            for(int i = 0; i < data->fields_.size(); ++i) {
+                collect_scalar_subqueries(data->fields_[i], subs);
+                owners.resize(subs.size(), -1);
+            }
+            for(int i = 0; i < splitted_where.size(); ++i) {
+                collect_scalar_subqueries(split_conjunct(splitted_where[i]), subs);
+                owners.resize(subs.size(), i);
+            }
+            for(int i = 0; i < subs.size(); ++i) {
+                JoinOperation* join = unnest_scalar_subquery(ctx, data, subs[i], names);
+                if(!join) continue;
+                joins.push_back(join);
+                if(owners[i] != -1) {
+                    filters.push_back(splitted_where[owners[i]]);
+                    splitted_where.erase(splitted_where.begin() + owners[i]);
+                }
+                return;
+            }
+        }
+
         // should only be used with 'select', 'delete' and 'update' statements.
+        // the tables of this query that are accessed by a filter, tables of outer queries are not counted.
+        Vector<String8> filter_tables(QueryData* data, ASTNode* filter) {
+            Vector<String8> table_access;
+            accessed_tables(filter, table_access, catalog_);
+            Vector<String8> ta;
+            std::unordered_map<String8, bool, String_hash, String_eq> f;
+            for(auto &s: table_access){
+                bool used_in_query = false;
+                for(int j = 0; j < data->table_names_.size(); ++j){
+                    if(data->table_names_[j] == s) {
+                        used_in_query = true;
+                        break;
+                    }
+                }
+                if(!f.count(s) && used_in_query){
+                    ta.push_back(s);
+                    f[s] = 1;
+                }
+            }
+            return ta;
+        }
+
+        // a conjunct of a split where clause is the first operand of its AND node (see split_by_and).
+        ASTNode* split_conjunct(ASTNode* ex) {
+            while(ex) {
+                if(ex->category_ == EXPRESSION) {
+                    ex = ((ExpressionNode*)ex)->cur_;
+                } else if(ex->category_ == AND && (((AndNode*)ex)->next_ == nullptr || ((AndNode*)ex)->mark_split_)) {
+                    ex = ((AndNode*)ex)->cur_;
+                } else {
+                    break;
+                }
+            }
+            return ex;
+        }
+
+        void collect_scans(AlgebraOperation* op, Vector<ScanOperation*>& scans) {
+            if(!op) return;
+            switch(op->type_) {
+                case SCAN:
+                    scans.push_back((ScanOperation*)op);
+                    return;
+                case FILTER:
+                    collect_scans(((FilterOperation*)op)->child_, scans);
+                    return;
+                case JOIN:
+                    collect_scans(((JoinOperation*)op)->lhs_, scans);
+                    collect_scans(((JoinOperation*)op)->rhs_, scans);
+                    return;
+                case PRODUCT:
+                    collect_scans(((ProductOperation*)op)->lhs_, scans);
+                    collect_scans(((ProductOperation*)op)->rhs_, scans);
+                    return;
+                default:
+                    return;
+            }
+        }
+
+        // cardinality estimation:
+        // a scan returns the row count of its table (as of the last ANALYZE) times the selectivity of its filters,
+        // a join returns |lhs| * |rhs| * the selectivity of its condition, conjuncts are assumed to be independent.
+        // selectivities come from the column statistics:
+        // col = constant      => 1 / ndv of the non null rows.
+        // col1 = col2         => 1 / max(ndv1, ndv2) of the pairs.
+        // col < constant      => the histogram, assuming uniform values inside of every bucket.
+        // col IN (k values)   => k / ndv.
+        // col IS NULL         => the null fraction.
+        // anything else gets the defaults of statistics.h.
+
+        // the statistics of the column behind a field of one of the scans, nullptr if the table was never analyzed.
+        ColumnStats* field_column_stats(Vector<ScanOperation*>& scans, ASTNode* ex) {
+            while(ex && ex->category_ == EXPRESSION) ex = ((ExpressionNode*)ex)->cur_;
+            if(!ex || ex->category_ != FIELD_EXPR) return nullptr;
+            for(int i = 0; i < scans.size(); ++i) {
+                TableSchema* schema = catalog_->get_table_schema(scans[i]->table_name_);
+                int col = schema ? scan_field_column(scans[i], schema, ex) : -1;
+                if(col == -1) continue;
+                TableStats* stats = catalog_->get_table_stats(scans[i]->table_name_);
+                if(!stats || col >= stats->columns_.size()) return nullptr;
+                return &stats->columns_[col];
+            }
+            return nullptr;
+        }
+
+        bool constant_number(ASTNode* ex, double* out) {
+            while(ex && ex->category_ == EXPRESSION) ex = ((ExpressionNode*)ex)->cur_;
+            if(!ex) return false;
+            switch(ex->category_) {
+                case INTEGER_CONSTANT:
+                    *out = str_to_i64(ex->token_.val_);
+                    return true;
+                case FLOAT_CONSTANT:
+                    *out = str_to_f64(ex->token_.val_);
+                    return true;
+                case UNARY:
+                    if(!constant_number(((UnaryNode*)ex)->cur_, out)) return false;
+                    if(ex->token_.type_ == TokenType::MINUS) *out = -*out;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // col op val.
+        double range_selectivity(ColumnStats* col, TokenType op, double val) {
+            if(!col || col->bounds_.size() < 2) return STATS_DEFAULT_RANGE_SEL;
+            double non_null = 1 - col->null_frac_;
+            double sel = STATS_DEFAULT_RANGE_SEL;
+            switch(op) {
+                case TokenType::LT:  sel = stats_less_selectivity(*col, val, false); break;
+                case TokenType::LTE: sel = stats_less_selectivity(*col, val, true); break;
+                case TokenType::GT:  sel = non_null - stats_less_selectivity(*col, val, true); break;
+                case TokenType::GTE: sel = non_null - stats_less_selectivity(*col, val, false); break;
+                default: break;
+            }
+            return std::min(1.0, std::max(0.0, sel));
+        }
+
+        double condition_selectivity(Vector<ScanOperation*>& scans, ASTNode* ex) {
+            ex = split_conjunct(ex);
+            if(!ex) return 1;
+            switch(ex->category_) {
+                case AND:
+                    {
+                        AndNode* land = (AndNode*)ex;
+                        return condition_selectivity(scans, land->cur_) * condition_selectivity(scans, land->next_);
+                    }
+                case OR:
+                    {
+                        OrNode* lor = (OrNode*)ex;
+                        double lhs = condition_selectivity(scans, lor->cur_);
+                        if(!lor->next_) return lhs;
+                        double rhs = condition_selectivity(scans, lor->next_);
+                        return lhs + rhs - lhs * rhs;
+                    }
+                case NOT:
+                    {
+                        NotNode* lnot = (NotNode*)ex;
+                        double sel = condition_selectivity(scans, lnot->cur_);
+                        return lnot->effective_ ? 1 - sel : sel;
+                    }
+                case EQUALITY:
+                    {
+                        EqualityNode* eq = (EqualityNode*)ex;
+                        if(!eq->next_) return condition_selectivity(scans, eq->cur_);
+                        TokenType op = eq->token_.type_;
+                        ColumnStats* lhs = field_column_stats(scans, eq->cur_);
+                        ColumnStats* rhs = field_column_stats(scans, eq->next_);
+                        if(op == TokenType::IS || op == TokenType::ISNOT) {
+                            double sel = STATS_DEFAULT_EQ_SEL;
+                            if(lhs && eq->next_->category_ == NULL_CONSTANT) sel = lhs->null_frac_;
+                            return op == TokenType::IS ? sel : 1 - sel;
+                        }
+                        double sel = STATS_DEFAULT_EQ_SEL;
+                        if(lhs && rhs)
+                            sel = (1 - lhs->null_frac_) * (1 - rhs->null_frac_) / std::max<i64>(1, std::max(lhs->ndv_, rhs->ndv_));
+                        else if(lhs) sel = stats_eq_selectivity(*lhs);
+                        else if(rhs) sel = stats_eq_selectivity(*rhs);
+                        return op == TokenType::NEQ ? 1 - sel : sel;
+                    }
+                case COMPARISON:
+                    {
+                        ComparisonNode* cmp = (ComparisonNode*)ex;
+                        if(!cmp->next_) return condition_selectivity(scans, cmp->cur_);
+                        TokenType op = cmp->token_.type_;
+                        double val = 0;
+                        ColumnStats* col = field_column_stats(scans, cmp->cur_);
+                        if(col && constant_number(cmp->next_, &val)) return range_selectivity(col, op, val);
+                        // constant op col.
+                        col = field_column_stats(scans, cmp->next_);
+                        if(col && constant_number(cmp->cur_, &val)) {
+                            switch(op) {
+                                case TokenType::LT:  op = TokenType::GT;  break;
+                                case TokenType::LTE: op = TokenType::GTE; break;
+                                case TokenType::GT:  op = TokenType::LT;  break;
+                                case TokenType::GTE: op = TokenType::LTE; break;
+                                default: break;
+                            }
+                            return range_selectivity(col, op, val);
+                        }
+                        return STATS_DEFAULT_RANGE_SEL;
+                    }
+                case BETWEEN:
+                    {
+                        BetweenNode* between = (BetweenNode*)ex;
+                        ColumnStats* col = field_column_stats(scans, between->val_);
+                        double lo = 0, hi = 0;
+                        double sel = STATS_DEFAULT_RANGE_SEL;
+                        if(col && col->bounds_.size() >= 2 && 
+                                constant_number(between->lhs_, &lo) && constant_number(between->rhs_, &hi)) {
+                            sel = stats_less_selectivity(*col, hi, true) - stats_less_selectivity(*col, lo, false);
+                            sel = std::min(1.0, std::max(0.0, sel));
+                        }
+                        return between->negated_ ? 1 - sel : sel;
+                    }
+                case IN:
+                    {
+                        InNode* in = (InNode*)ex;
+                        ColumnStats* col = field_column_stats(scans, in->val_);
+                        double sel = 0.5;
+                        bool sub_query = in->list_.size() == 1 && split_conjunct(in->list_[0])->category_ == SUB_QUERY;
+                        if(!sub_query) {
+                            double each = col ? stats_eq_selectivity(*col) : STATS_DEFAULT_EQ_SEL;
+                            sel = std::min(1.0, in->list_.size() * each);
+                        }
+                        return in->negated_ ? 1 - sel : sel;
+                    }
+                default:
+                    return STATS_DEFAULT_RANGE_SEL;
+            }
+        }
+
+        // the estimated rows of a scan, negative if its table was never analyzed.
+        double estimate_scan_rows(ScanOperation* scan) {
+            TableStats* stats = catalog_->get_table_stats(scan->table_name_);
+            if(!stats) return -1;
+            Vector<ScanOperation*> scans;
+            scans.push_back(scan);
+            double rows = stats->row_count_;
+            for(int i = 0; i < scan->filters_.size(); ++i)
+                rows *= condition_selectivity(scans, scan->filters_[i]);
+            for(int i = 0; i < scan->index_filters_.size(); ++i)
+                rows *= condition_selectivity(scans, scan->index_filters_[i]);
+            // an index-OR keeps its filter in filters_, an index-AND moves the filters into its rid scans.
+            for(int i = 0; !scan->rid_set_union_ && i < scan->rid_scans_.size(); ++i)
+                for(int j = 0; j < scan->rid_scans_[i]->index_filters_.size(); ++j)
+                    rows *= condition_selectivity(scans, scan->rid_scans_[i]->index_filters_[j]);
+            return rows;
+        }
+
+        // the estimated rows of a plan of scans, filters and joins, negative if a table was never analyzed.
+        double estimate_rows(Vector<ScanOperation*>& scans, AlgebraOperation* op) {
+            if(!op) return -1;
+            switch(op->type_) {
+                case SCAN:
+                    return estimate_scan_rows((ScanOperation*)op);
+                case FILTER:
+                    {
+                        FilterOperation* filter = (FilterOperation*)op;
+                        double rows = estimate_rows(scans, filter->child_);
+                        if(rows < 0) return rows;
+                        return rows * condition_selectivity(scans, filter->filter_);
+                    }
+                case PRODUCT:
+                case JOIN:
+                    {
+                        ProductOperation* product = (ProductOperation*)op;
+                        double lhs = estimate_rows(scans, product->lhs_);
+                        double rhs = estimate_rows(scans, product->rhs_);
+                        if(lhs < 0 || rhs < 0) return -1;
+                        if(op->type_ == PRODUCT) return lhs * rhs;
+                        JoinOperation* join = (JoinOperation*)op;
+                        double rows = lhs * rhs * condition_selectivity(scans, join->filter_);
+                        // outer joins keep every row of their outer inputs.
+                        if(join->join_type_ == LEFT_JOIN  || join->join_type_ == FULL_JOIN) rows = std::max(rows, lhs);
+                        if(join->join_type_ == RIGHT_JOIN || join->join_type_ == FULL_JOIN) rows = std::max(rows, rhs);
+                        return rows;
+                    }
+                default:
+                    return -1;
+            }
+        }
+
+        // the estimated rows of joining a set of inputs.
+        double join_rows(JoinGraph& g, u64 mask) {
+            double rows = 1;
+            for(int i = 0; i < g.inputs_.size(); ++i)
+                if(mask & (1ULL << i)) rows *= g.rows_[i];
+            for(int i = 0; i < g.conds_.size(); ++i)
+                if((g.cond_masks_[i] & mask) == g.cond_masks_[i]) rows *= g.cond_sels_[i];
+            return std::max(1.0, rows);
+        }
+
+        // the cost of joining two sets of inputs on their own (without the cost of the inputs),
+        // infinite if no condition connects them and cross products are not allowed.
+        double join_cost(JoinGraph& g, u64 lhs, u64 rhs, bool allow_product) {
+            bool connected = false, hashable = false;
+            for(int i = 0; i < g.conds_.size(); ++i) {
+                u64 m = g.cond_masks_[i];
+                if((m & (lhs | rhs)) != m || !(m & lhs) || !(m & rhs)) continue;
+                connected = true;
+                if(is_hashable_condition(g.conds_[i])) hashable = true;
+            }
+            if(!connected && !allow_product) return INFINITY;
+            double lrows = g.plans_[lhs].rows_;
+            double rrows = g.plans_[rhs].rows_;
+            double out = join_rows(g, lhs | rhs);
+            // the smaller input is read twice: building the hash table and probing it.
+            if(hashable) return 2 * std::min(lrows, rrows) + std::max(lrows, rrows) + out;
+            return lrows * rrows + out;
+        }
+
+        // dynamic programming over the subsets of the inputs: the best plan of a set is the cheapest join of 
+        // the best plans of two of its halves.
+        void search_join_order_dp(JoinGraph& g) {
+            int n = g.inputs_.size();
+            u64 full = (1ULL << n) - 1;
+            for(u64 mask = 1; mask <= full; ++mask) {
+                if(__builtin_popcountll(mask) < 2) continue;
+                JoinPlan best;
+                best.cost_ = INFINITY;
+                // cross products only when the set can't be split into connected halves.
+                for(int pass = 0; pass < 2 && best.cost_ == INFINITY; ++pass) {
+                    for(u64 lhs = (mask - 1) & mask; lhs > 0; lhs = (lhs - 1) & mask) {
+                        u64 rhs = mask ^ lhs;
+                        if(lhs < rhs) continue;
+                        double cost = join_cost(g, lhs, rhs, pass == 1);
+                        if(cost == INFINITY) continue;
+                        cost += g.plans_[lhs].cost_ + g.plans_[rhs].cost_;
+                        if(cost < best.cost_) {
+                            best.cost_ = cost;
+                            best.lhs_ = lhs;
+                        }
+                    }
+                }
+                best.rows_ = join_rows(g, mask);
+                g.plans_[mask] = best;
+            }
+        }
+
+        // greedy search for queries with many inputs: joins the cheapest pair of connected plans until one is left.
+        void search_join_order_greedy(JoinGraph& g) {
+            Vector<u64> plans;
+            for(int i = 0; i < g.inputs_.size(); ++i) plans.push_back(1ULL << i);
+            while(plans.size() > 1) {
+                int best_i = -1, best_j = -1;
+                double best_cost = INFINITY;
+                for(int pass = 0; pass < 2 && best_i == -1; ++pass) {
+                    for(int i = 0; i < plans.size(); ++i) {
+                        for(int j = i + 1; j < plans.size(); ++j) {
+                            double cost = join_cost(g, plans[i], plans[j], pass == 1);
+                            if(cost < best_cost) {
+                                best_cost = cost;
+                                best_i = i;
+                                best_j = j;
+                            }
+                        }
+                    }
+                }
+                u64 lhs = plans[best_i], rhs = plans[best_j];
+                JoinPlan plan;
+                plan.rows_ = join_rows(g, lhs | rhs);
+                plan.cost_ = g.plans_[lhs].cost_ + g.plans_[rhs].cost_ + best_cost;
+                plan.lhs_ = lhs;
+                g.plans_[lhs | rhs] = plan;
+                plans[best_i] = lhs | rhs;
+                plans.erase(plans.begin() + best_j);
+            }
+        }
+
+        // turns the best plan of a set of inputs into filtered products, replaceFilteredProductWithJoin picks their
+        // join algorithms later. the first condition of a join is a hashable one if there is any,
+        // the smaller input goes to the left because hash joins build their table from the left input.
+        AlgebraOperation* build_join_tree(QueryCTX& ctx, int query_idx, JoinGraph& g, u64 mask) {
+            if(__builtin_popcountll(mask) == 1) return g.inputs_[__builtin_ctzll(mask)];
+            u64 lhs_mask = g.plans_[mask].lhs_;
+            u64 rhs_mask = mask ^ lhs_mask;
+            AlgebraOperation* lhs = build_join_tree(ctx, query_idx, g, lhs_mask);
+            AlgebraOperation* rhs = build_join_tree(ctx, query_idx, g, rhs_mask);
+            if(g.plans_[lhs_mask].rows_ > g.plans_[rhs_mask].rows_) std::swap(lhs, rhs);
+
+            Vector<ExpressionNode*> conds;
+            for(int i = 0; i < g.conds_.size(); ++i) {
+                u64 m = g.cond_masks_[i];
+                if((m & mask) != m || !(m & lhs_mask) || !(m & rhs_mask)) continue;
+                if(is_hashable_condition(g.conds_[i])) conds.insert(conds.begin(), g.conds_[i]);
+                else conds.push_back(g.conds_[i]);
+            }
+            AlgebraOperation* result = New(ProductOperation, ctx.arena_, query_idx, lhs, rhs);
+            for(int i = 0; i < conds.size(); ++i)
+                result = New(FilterOperation, ctx.arena_, query_idx, result, conds[i]);
+            return result;
+        }
+
+        // cost based join ordering:
+        // the inputs left after the explicit joins (scans and 'join ... on' trees, which keep their own order)
+        // are joined in the order with the smallest estimated cost, the conjuncts of the where clause that access 
+        // more than one input become the conditions of the joins.
+        // the cost of a join is the rows it reads and returns, hash joins read their smaller input twice
+        // and nested loops read every pair of rows. joins of inputs that no condition connects are only considered 
+        // when there is no other choice, so cross products are postponed as much as possible.
+        // up to JOIN_DP_MAX_RELATIONS inputs every order is searched, larger queries are ordered greedily.
+        // returns nullptr when the default rules should build the tree instead: when any table was never analyzed and
+        // for select *, which takes its columns in the order of the join tree.
+        AlgebraOperation* order_joins(QueryCTX& ctx, QueryData* data,
+                std::unordered_map<String8, AlgebraOperation*, String_hash, String_eq>& table_scanner,
+                std::unordered_map<String8, String8, String_hash, String_eq>& joined_into,
+                Vector<std::pair<Vector<String8>, ExpressionNode*>>& tables_per_filter) {
+            if(data->type_ != SELECT_DATA || ((SelectStatementData*)data)->has_star_) return nullptr;
+            JoinGraph g;
+            Vector<String8> names;
+            for(String8 t : data->table_names_) {
+                if(!table_scanner.count(t)) continue;
+                names.push_back(t);
+                g.inputs_.push_back(table_scanner[t]);
+            }
+            int n = g.inputs_.size();
+            if(n < 2 || n > 63) return nullptr;
+            Vector<ScanOperation*> scans;
+            for(int i = 0; i < n; ++i) collect_scans(g.inputs_[i], scans);
+            for(int i = 0; i < scans.size(); ++i)
+                if(!catalog_->get_table_stats(scans[i]->table_name_)) return nullptr;
+            for(int i = 0; i < n; ++i) {
+                double rows = estimate_rows(scans, g.inputs_[i]);
+                if(rows < 0) return nullptr;
+                g.rows_.push_back(std::max(1.0, rows));
+            }
+
+            // the input that holds a table.
+            auto input_of = [&](String8 t) {
+                while(joined_into.count(t)) t = joined_into[t];
+                for(int i = 0; i < n; ++i) 
+                    if(names[i] == t) return i;
+                return -1;
+            };
+            Vector<ExpressionNode*> top_filters;
+            for(int i = 0; i < tables_per_filter.size(); ++i) {
+                if(tables_per_filter[i].first.size() < 2) continue;
+                ExpressionNode* filter = tables_per_filter[i].second;
+                u64 mask = 0;
+                for(int j = 0; j < tables_per_filter[i].first.size(); ++j) {
+                    int input = input_of(tables_per_filter[i].first[j]);
+                    if(input != -1) mask |= (1ULL << input);
+                }
+                if(mask == 0) {
+                    top_filters.push_back(filter);
+                } else if(__builtin_popcountll(mask) == 1) {
+                    // all of its tables are inside of the same input.
+                    int input = __builtin_ctzll(mask);
+                    g.inputs_[input] = New(FilterOperation, ctx.arena_, data->idx_, g.inputs_[input], filter);
+                    g.rows_[input] = std::max(1.0, g.rows_[input] * condition_selectivity(scans, filter));
+                } else {
+                    g.conds_.push_back(filter);
+                    g.cond_masks_.push_back(mask);
+                    g.cond_sels_.push_back(condition_selectivity(scans, filter));
+                }
+            }
+
+            for(int i = 0; i < n; ++i) {
+                JoinPlan plan;
+                plan.rows_ = g.rows_[i];
+                plan.cost_ = g.rows_[i];
+                g.plans_[1ULL << i] = plan;
+            }
+            if(n <= JOIN_DP_MAX_RELATIONS) search_join_order_dp(g);
+            else search_join_order_greedy(g);
+
+            AlgebraOperation* result = build_join_tree(ctx, data->idx_, g, (1ULL << n) - 1);
+            for(int i = 0; i < top_filters.size(); ++i)
+                result = New(FilterOperation, ctx.arena_, data->idx_, result, top_filters[i]);
+            replaceFilteredProductWithJoin(ctx, &result);
+            for(int i = 0; i < names.size(); ++i) table_scanner.erase(names[i]);
+            return result;
+        }
+
         AlgebraOperation* optimize(QueryCTX& ctx, QueryData* data) {
             int query_idx = data->idx_;
             Vector<ExpressionNode*> splitted_where;
@@ -576,28 +2106,24 @@ class AlgebraEngine {
                 // split conjunctive predicates.
                 splitted_where = split_by_and(&ctx, data->where_);
             }
+            // IN (sub-query) conjuncts that become semi joins on top of the tables of this query.
+            Vector<InNode*> semi_joins;
+            for(int i = 0; i < splitted_where.size(); ++i) {
+                InNode* in = match_semi_join(ctx, data, splitted_where[i]);
+                if(!in) continue;
+                semi_joins.push_back(in);
+                splitted_where.erase(splitted_where.begin() + i--);
+            }
+            // corelated sub-queries that become joins on top of the tables of this query.
+            Vector<JoinOperation*> unnested_joins;
+            Vector<ExpressionNode*> unnested_filters;
+            if(data->type_ == SELECT_DATA)
+                unnest_subqueries(ctx, (SelectStatementData*)data, splitted_where, unnested_joins, unnested_filters);
             // collect data about which tables did we access for each splitted predicate from the previous step.
             Vector<std::pair<Vector<String8>, ExpressionNode*>> tables_per_filter;
-            for(int i = 0; i < splitted_where.size(); ++i){
-                Vector<String8> table_access;
-                std::unordered_map<String8, bool, String_hash, String_eq> f;
-                accessed_tables(splitted_where[i], table_access, catalog_);
-                Vector<String8> ta;
-                for(auto &s: table_access){
-                    bool used_in_query = false;
-                    for(int j = 0; j < data->table_names_.size(); ++j){
-                        if(data->table_names_[j] == s) {
-                            used_in_query = true;
-                            break;
-                        }
-                    }
-                    if(!f.count(s) && used_in_query){
-                        ta.push_back(s);
-                        f[s] = 1;
-                    }
-                }
-                tables_per_filter.push_back({ta, splitted_where[i]});
-            }
+            // only the first operand of a split AND node belongs to its filter.
+            for(int i = 0; i < splitted_where.size(); ++i)
+                tables_per_filter.push_back({filter_tables(data, split_conjunct(splitted_where[i])), splitted_where[i]});
 
             // sort predicates by the least accessed number of tables.
             sort(tables_per_filter.begin(), tables_per_filter.end(),
@@ -640,10 +2166,12 @@ class AlgebraEngine {
                 // => no index scan for the table to be deleted/updated from.
                 if(data->type_ != SELECT_DATA && scan->table_name_ == data->table_names_[0]) continue;
                 // check for a suitable index.
-                match_index(scan);
+                match_index(ctx, scan);
             }
 
             AlgebraOperation* result = nullptr;
+            // the table whose input took over a table that was joined explicitly.
+            std::unordered_map<String8, String8, String_hash, String_eq> joined_into;
             // join tables that where explicitly joined by a 'join ... on' operator.
             for(int i = 0; i < data->joined_tables_.size(); ++i) {
                 // TODO: check that fields used inside the ON clause are scoped only to the two tables being joined.
@@ -665,14 +2193,18 @@ class AlgebraEngine {
                         join_data.type_,
                         join_algorithm
                         );
+                if(!match_index_join(ctx, join_op)) match_merge_join(ctx, join_op);
                 // lhs scanner eats rhs scanner and becomes a join node for latter use.
                 // TODO: maybe there is a better way.
                 table_scanner.erase(rhs_name);
                 table_scanner[lhs_name] = join_op;
+                joined_into[rhs_name] = lhs_name;
             }
 
+            AlgebraOperation* ordered = order_joins(ctx, data, table_scanner, joined_into, tables_per_filter);
+            if(ordered) result = ordered;
             // handle filters with 2 or more table access.
-            for(int i = 0; i < splitted_where.size(); ++i){
+            for(int i = 0; !ordered && i < splitted_where.size(); ++i){
                 if(tables_per_filter[i].first.size() < 2) continue;
                 // loop over all tables that was accessed with in filter number 'i'
                 for(int j = 0; j < tables_per_filter[i].first.size(); ++j) {
@@ -717,9 +2249,328 @@ class AlgebraEngine {
                     result = tmp;
                 }
             }
+
+            for(int i = 0; i < semi_joins.size(); ++i) {
+                InNode* in = semi_joins[i];
+                JoinOperation* join = New(JoinOperation, ctx.arena_, query_idx, nullptr, result, nullptr,
+                        in->negated_ ? ANTI_JOIN : SEMI_JOIN, HASH_JOIN);
+                join->semi_query_idx_ = ((SubQueryNode*)split_conjunct(in->list_[0]))->idx_;
+                join->semi_key_ = (FieldNode*)split_conjunct(in->val_);
+                join->null_aware_ = in->negated_;
+                result = join;
+            }
+            for(int i = 0; i < unnested_joins.size(); ++i) {
+                unnested_joins[i]->rhs_ = result;
+                result = unnested_joins[i];
+            }
+            for(int i = 0; i < unnested_filters.size(); ++i)
+                result = New(FilterOperation, ctx.arena_, query_idx, result, unnested_filters[i]);
             return result;
         };
 
+        // physical properties of the plan (see PlanProperties), computed bottom up once the plan of a query is built:
+        // scan              => an index scan is sorted by the index columns that are not fixed by its equality filters,
+        //                      any scan is unique on the columns of a unique index of its table.
+        // filter, limit     => the properties of the child.
+        // merge join        => the order of the driver, unless the unmatched rows of the window are returned too.
+        // index nested loop => the order of the outer input.
+        // other joins       => no order, the hash join partitions its inputs and the nested loops repeat the inner one,
+        //                      inner joins and products are unique on the keys of both inputs.
+        // aggregation       => unique on the group by columns (at most one row without them), no order.
+        // projection        => the properties of the child over the output columns, as far as they are projected.
+        // sort              => its own order and the uniqueness of the child.
+        PlanProperties* derive_properties(QueryCTX& ctx, AlgebraOperation* op) {
+            if(op && op->props_) return op->props_;
+            if(op && (op->type_ == FILTER || op->type_ == LIMIT)) {
+                AlgebraOperation* child = (op->type_ == FILTER) ? 
+                    ((FilterOperation*)op)->child_ : ((LimitOperation*)op)->child_;
+                op->props_ = derive_properties(ctx, child);
+                return op->props_;
+            }
+            PlanProperties* props = new(ALLOCATE(ctx.arena_, PlanProperties)) PlanProperties(&ctx.arena_);
+            // a select without tables.
+            if(!op) return props;
+            op->props_ = props;
+            switch(op->type_) {
+                case SCAN:
+                    scan_properties((ScanOperation*)op, props);
+                    break;
+                case JOIN:
+                    join_properties(ctx, (JoinOperation*)op, props);
+                    break;
+                case PRODUCT:
+                    {
+                        ProductOperation* product = (ProductOperation*)op;
+                        merge_unique_keys(derive_properties(ctx, product->lhs_), derive_properties(ctx, product->rhs_), props);
+                    } break;
+                case AGGREGATION:
+                    {
+                        AggregationOperation* agg = (AggregationOperation*)op;
+                        PlanProperties* child = derive_properties(ctx, agg->child_);
+                        props->fixed_ = child->fixed_;
+                        props->unique_ = true;
+                        for(int i = 0; i < agg->group_by_.size() && props->unique_; ++i) {
+                            PlanColumn col;
+                            if(!field_plan_column(ctx, agg->group_by_[i], &col)) props->unique_ = false;
+                            else if(!has_column(child->fixed_, col)) props->unique_key_.push_back(col);
+                        }
+                        if(!props->unique_) props->unique_key_.clear();
+                    } break;
+                case PROJECTION:
+                    projection_properties(ctx, (ProjectionOperation*)op, props);
+                    break;
+                case SORT:
+                    {
+                        SortOperation* sort = (SortOperation*)op;
+                        PlanProperties* child = derive_properties(ctx, sort->child_);
+                        props->fixed_ = child->fixed_;
+                        props->unique_ = child->unique_;
+                        props->unique_key_ = child->unique_key_;
+                        // the merge join sorts its scans by their table columns, the sort of a query by its output columns.
+                        ScanOperation* scan = nullptr;
+                        if(sort->child_->type_ != PROJECTION) {
+                            AlgebraOperation* cur = sort->child_;
+                            while(cur && cur->type_ == FILTER) cur = ((FilterOperation*)cur)->child_;
+                            if(!cur || cur->type_ != SCAN) break;
+                            scan = (ScanOperation*)cur;
+                        }
+                        for(int i = 0; i < sort->order_by_list_.size(); ++i) {
+                            PlanColumn col;
+                            if(scan) {
+                                col.query_idx_ = scan->query_idx_;
+                                col.table_ = scan->table_rename_;
+                            }
+                            col.col_ = sort->order_by_list_[i];
+                            col.desc_ = sort->order_by_desc_[i];
+                            props->order_.push_back(col);
+                        }
+                    } break;
+                default:
+                    break;
+            }
+            return props;
+        }
+
+        bool same_column(const PlanColumn& lhs, const PlanColumn& rhs) {
+            return lhs.query_idx_ == rhs.query_idx_ && lhs.col_ == rhs.col_ && lhs.table_ == rhs.table_;
+        }
+
+        bool has_column(Vector<PlanColumn>& cols, const PlanColumn& col) {
+            for(int i = 0; i < cols.size(); ++i)
+                if(same_column(cols[i], col)) return true;
+            return false;
+        }
+
+        // the table column behind an expression that is just a field, false for anything else.
+        bool field_plan_column(QueryCTX& ctx, ASTNode* ex, PlanColumn* out) {
+            while(ex && ex->category_ == EXPRESSION) ex = ((ExpressionNode*)ex)->cur_;
+            if(!ex || ex->category_ != FIELD_EXPR) return false;
+            FieldNode* field = (FieldNode*)ex;
+            if(!field->table_name_ || field->query_idx_ < 0 || field->query_idx_ >= ctx.queries_call_stack_.size()) 
+                return false;
+            QueryData* data = ctx.queries_call_stack_[field->query_idx_];
+            String8 rename = field->table_name_->token_.val_;
+            for(int i = 0; i < data->table_names_.size(); ++i) {
+                if(data->table_names_[i] != rename) continue;
+                TableSchema* tschema = catalog_->get_table_schema(data->tables_[i]);
+                if(!tschema) return false;
+                int col = tschema->col_exist(field->token_.val_, tschema->getTableName());
+                if(col == -1) return false;
+                out->query_idx_ = field->query_idx_;
+                out->table_ = rename;
+                out->col_ = col;
+                return true;
+            }
+            return false;
+        }
+
+        void scan_properties(ScanOperation* scan, PlanProperties* props) {
+            // the rows of a loose index scan for MIN/MAX are the first and the last entries of every group.
+            if(scan->scan_type_ == LOOSE_INDEX_SCAN && scan->loose_min_max_) return;
+            bool loose = (scan->scan_type_ == LOOSE_INDEX_SCAN);
+            TableSchema* tschema = catalog_->get_table_schema(scan->table_name_);
+            if(!tschema) return;
+            auto table_column = [&](int col) {
+                PlanColumn c;
+                c.query_idx_ = scan->query_idx_;
+                c.table_ = scan->table_rename_;
+                c.col_ = col;
+                Type type = tschema->getCol(col).getType();
+                c.exact_ = (type == INT || type == BIGINT || type == FLOAT || type == DOUBLE);
+                return c;
+            };
+
+            Vector<IndexHeader> table_indexes = catalog_->get_indexes_of_table(scan->table_name_);
+            for(int i = 0; (scan->scan_type_ == INDEX_SCAN || loose) && i < table_indexes.size(); ++i) {
+                IndexHeader& index = table_indexes[i];
+                if(index.index_name_ != scan->index_name_) continue;
+                auto& index_fields = index.fields_numbers_;
+                // a loose index scan returns one row for every value of its prefix columns.
+                int ncols = loose ? scan->loose_prefix_len_ : index_fields.size();
+                std::vector<bool> fixed(ncols, false);
+                std::vector<bool> no_nulls(ncols, false);
+                for(int j = 0; j < scan->index_filters_.size(); ++j) {
+                    IndexFilterKind kind = INDEX_FILTER_EQ;
+                    int offset = match_index_to_filter(index, tschema, scan->index_filters_[j], &kind);
+                    if(offset < 0) continue;
+                    if(kind == INDEX_FILTER_EQ) fixed[offset] = true;
+                    // IN-lists and ranges never match nulls.
+                    no_nulls[offset] = true;
+                }
+                for(int j = 0; j < ncols; ++j)
+                    if(fixed[j]) props->fixed_.push_back(table_column(index_fields[j].idx_));
+                if(index.is_hash()) break;
+                bool exact = true;
+                for(int j = 0; j < ncols; ++j) {
+                    if(fixed[j]) continue;
+                    int col = index_fields[j].idx_;
+                    // nulls are stored first in both directions of a column but sorted as the smallest values.
+                    if(index_fields[j].desc_ && !no_nulls[j] && tschema->getCol(col).isNullable()) break;
+                    PlanColumn c = table_column(col);
+                    c.desc_ = (index_fields[j].desc_ != scan->index_reverse_);
+                    // the rows that share a text prefix are only sorted by the columns after it as one group.
+                    exact = exact && c.exact_;
+                    c.exact_ = exact;
+                    props->order_.push_back(c);
+                }
+                // the index groups equal values (and all the nulls) together, except for text that shares a prefix.
+                if(loose && props->order_.size() == ncols && (ncols == 0 || props->order_[ncols - 1].exact_)) {
+                    props->unique_ = true;
+                    props->unique_key_ = props->order_;
+                }
+                break;
+            }
+
+            // the shortest key of a unique index, its columns can't be null (two nulls are equal for DISTINCT).
+            for(int i = 0; i < table_indexes.size(); ++i) {
+                IndexHeader& index = table_indexes[i];
+                if(!index.is_unique()) continue;
+                Vector<PlanColumn> key;
+                bool nullable = false;
+                for(int j = 0; j < index.fields_numbers_.size(); ++j) {
+                    Column col = tschema->getCol(index.fields_numbers_[j].idx_);
+                    if(col.isNullable() && !col.isPrimaryKey()) nullable = true;
+                    PlanColumn c = table_column(index.fields_numbers_[j].idx_);
+                    if(!has_column(props->fixed_, c)) key.push_back(c);
+                }
+                if(nullable || (props->unique_ && props->unique_key_.size() <= key.size())) continue;
+                props->unique_ = true;
+                props->unique_key_ = key;
+            }
+        }
+
+        // every pair of the rows of two unique inputs is unique on the keys of both of them.
+        void merge_unique_keys(PlanProperties* lhs, PlanProperties* rhs, PlanProperties* props) {
+            props->fixed_ = lhs->fixed_;
+            props->fixed_.insert(props->fixed_.end(), rhs->fixed_.begin(), rhs->fixed_.end());
+            if(!lhs->unique_ || !rhs->unique_) return;
+            props->unique_ = true;
+            props->unique_key_ = lhs->unique_key_;
+            props->unique_key_.insert(props->unique_key_.end(), rhs->unique_key_.begin(), rhs->unique_key_.end());
+        }
+
+        void join_properties(QueryCTX& ctx, JoinOperation* join, PlanProperties* props) {
+            PlanProperties* rhs = derive_properties(ctx, join->rhs_);
+            // the rows of the right input that have (don't have) a match.
+            if(join->join_type_ == SEMI_JOIN || join->join_type_ == ANTI_JOIN) {
+                props->fixed_ = rhs->fixed_;
+                props->unique_ = rhs->unique_;
+                props->unique_key_ = rhs->unique_key_;
+                return;
+            }
+            PlanProperties* lhs = derive_properties(ctx, join->lhs_);
+            JoinType type = join->join_type_;
+            // the columns of the input whose unmatched rows are returned with nulls are not fixed anymore.
+            if(type == INNER_JOIN) {
+                merge_unique_keys(lhs, rhs, props);
+            } else if(type == LEFT_JOIN) {
+                props->fixed_ = lhs->fixed_;
+            } else if(type == RIGHT_JOIN) {
+                props->fixed_ = rhs->fixed_;
+            }
+
+            if(join->join_algo_ == MERGE_JOIN) {
+                bool driver_left = join->merge_driver_left_;
+                bool window_outer = (type == FULL_JOIN) || 
+                    (type == LEFT_JOIN && !driver_left) || (type == RIGHT_JOIN && driver_left);
+                if(!window_outer) props->order_ = driver_left ? lhs->order_ : rhs->order_;
+            } else if(join->join_algo_ == INDEX_NESTED_LOOP_JOIN) {
+                props->order_ = join->index_inner_left_ ? rhs->order_ : lhs->order_;
+            }
+        }
+
+        void projection_properties(QueryCTX& ctx, ProjectionOperation* proj, PlanProperties* props) {
+            PlanProperties* child = derive_properties(ctx, proj->child_);
+            // a lonely star returns the columns of a single table as they are.
+            ScanOperation* star_scan = nullptr;
+            if(proj->fields_.size() == 1 && !proj->fields_[0]) {
+                AlgebraOperation* cur = proj->child_;
+                while(cur && cur->type_ == FILTER) cur = ((FilterOperation*)cur)->child_;
+                if(!cur || cur->type_ != SCAN) return;
+                star_scan = (ScanOperation*)cur;
+            }
+            Vector<PlanColumn> fields;
+            for(int i = 0; !star_scan && i < proj->fields_.size(); ++i) {
+                PlanColumn col;
+                if(!proj->fields_[i] || !field_plan_column(ctx, proj->fields_[i], &col)) col.col_ = -1;
+                fields.push_back(col);
+            }
+            // the output column of a column of the child or false if it is not projected.
+            auto output_column = [&](const PlanColumn& col, PlanColumn* out) {
+                int pos = -1;
+                if(star_scan) {
+                    if(col.query_idx_ == star_scan->query_idx_ && col.table_ == star_scan->table_rename_) pos = col.col_;
+                } else {
+                    for(int i = 0; pos == -1 && i < fields.size(); ++i)
+                        if(fields[i].col_ != -1 && same_column(fields[i], col)) pos = i;
+                }
+                if(pos == -1) return false;
+                *out = col;
+                out->query_idx_ = -1;
+                out->table_ = {};
+                out->col_ = pos;
+                return true;
+            };
+
+            PlanColumn out;
+            for(int i = 0; i < child->fixed_.size(); ++i)
+                if(output_column(child->fixed_[i], &out)) props->fixed_.push_back(out);
+            for(int i = 0; i < child->order_.size(); ++i) {
+                if(!output_column(child->order_[i], &out)) break;
+                props->order_.push_back(out);
+            }
+            if(!child->unique_) return;
+            props->unique_ = true;
+            for(int i = 0; i < child->unique_key_.size() && props->unique_; ++i) {
+                if(!output_column(child->unique_key_[i], &out)) props->unique_ = false;
+                else props->unique_key_.push_back(out);
+            }
+            if(!props->unique_) props->unique_key_.clear();
+        }
+
+        // the rows of the plan come sorted by the ORDER BY list (output columns), the columns that are fixed are skipped.
+        // exact is set if the values are in their exact order (see PlanColumn).
+        bool order_satisfied(PlanProperties* props, Vector<int>& order_by, Vector<bool>& order_by_desc, bool* exact) {
+            *exact = true;
+            int j = 0;
+            for(int i = 0; i < order_by.size(); ++i) {
+                PlanColumn col;
+                col.col_ = order_by[i];
+                bool fixed = false;
+                for(int k = 0; !fixed && k < props->fixed_.size(); ++k) {
+                    if(!same_column(props->fixed_[k], col)) continue;
+                    fixed = true;
+                    *exact = *exact && props->fixed_[k].exact_;
+                }
+                if(fixed) continue;
+                if(j >= props->order_.size()) return false;
+                PlanColumn& sorted = props->order_[j++];
+                if(!same_column(sorted, col) || sorted.desc_ != order_by_desc[i]) return false;
+                *exact = *exact && sorted.exact_;
+            }
+            return true;
+        }
+
         AlgebraOperation* createSelectStatementExpression(QueryCTX& ctx, SelectStatementData* data) {
             if(!isValidSelectStatementData(data))
                 return nullptr;
@@ -727,6 +2578,10 @@ class AlgebraEngine {
             int query_idx = data->idx_;
 
             auto result = optimize(ctx, data);
+            if(result && result->type_ == SCAN) {
+                match_loose_index_scan(ctx, data, (ScanOperation*)result);
+                match_index_order(ctx, data, (ScanOperation*)result);
+            }
             if(data->aggregates_.size() || data->group_by_.size()){
                 AggregationOperation* tmp = New(AggregationOperation, ctx.arena_, query_idx, result, data->aggregates_, data->group_by_);
                 result = tmp;
@@ -742,8 +2597,31 @@ class AlgebraEngine {
                 ProjectionOperation* tmp = New(ProjectionOperation, ctx.arena_, query_idx, result, data->fields_);
                 result = tmp;
             }
-            if(data->order_by_list_.size()){
-                SortOperation* tmp = New(SortOperation, ctx.arena_, query_idx, result, data->order_by_list_);
+            // the plan may already return distinct rows in ORDER BY order, then DISTINCT and the sort have nothing to do.
+            PlanProperties* props = derive_properties(ctx, result);
+            if(data->distinct_ && props->unique_) data->distinct_ = false;
+            bool exact_order = false;
+            bool sorted = data->order_by_list_.size() && 
+                order_satisfied(props, data->order_by_list_, data->order_by_desc_, &exact_order);
+            if(data->order_by_list_.size() && !sorted){
+                SortOperation* tmp = New(SortOperation, ctx.arena_, query_idx, result, 
+                        data->order_by_list_, data->order_by_desc_);
+                result = tmp;
+            }
+            // lets DISTINCT and the set operations above work on sorted input (see sorted_on_all_columns).
+            if(result->type_ == SORT || (sorted && exact_order)) {
+                result->sorted_by_ = &data->order_by_list_;
+                result->sorted_desc_ = &data->order_by_desc_;
+            }
+            if(data->limit_ != MAX_U64 || data->offset_){
+                // DISTINCT runs after the sort, so the sort can only drop rows when there are no duplicates to remove.
+                if(result->type_ == SORT && data->limit_ != MAX_U64 && !data->distinct_) {
+                    u64 top_n = data->limit_ > MAX_U64 - data->offset_ ? MAX_U64 : data->limit_ + data->offset_;
+                    ((SortOperation*)result)->limit_ = top_n;
+                }
+                LimitOperation* tmp = New(LimitOperation, ctx.arena_, query_idx, result, data->limit_, data->offset_);
+                tmp->sorted_by_ = result->sorted_by_;
+                tmp->sorted_desc_ = result->sorted_desc_;
                 result = tmp;
             }
             result->print(0);
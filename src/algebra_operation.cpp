@@ -2,6 +2,10 @@
 #include "ast_nodes.cpp"
 #include "executor.h"
 
+PlanProperties::PlanProperties(Arena* arena):
+    order_(arena), fixed_(arena), unique_key_(arena)
+{}
+
 AlgebraOperation::AlgebraOperation(AlgebraOperationType type, int query_idx):
     type_(type), query_idx_(query_idx)
 {}
@@ -9,15 +13,22 @@ AlgebraOperation::AlgebraOperation(AlgebraOperationType type, int query_idx):
 ScanOperation::ScanOperation(Arena* arena, int query_idx, String8 table_name, String8 table_rename):
     AlgebraOperation(SCAN, query_idx),
     table_name_(table_name), table_rename_(table_rename),
-    filters_(arena), index_filters_(arena)
+    filters_(arena), index_filters_(arena), rid_scans_(arena)
 {}
 void ScanOperation::print(int prefix_space_cnt) {
     for(int i = 0; i < prefix_space_cnt; ++i)
         std::cout << " ";
     //std::cout << "Scan operation, name: " << to_string(table_name_) << " rename: " << to_string(table_rename_);
     std::cout << "Scan operation ";
-    std::cout << " type: " << (scan_type_ == SEQ_SCAN ? "SEQ_SCAN " : "INDEX_SCAN ") << ", table: ";
+    std::cout << " type: ";
+    if(scan_type_ == SEQ_SCAN)        std::cout << "SEQ_SCAN ";
+    else if(scan_type_ == INDEX_SCAN) std::cout << (index_reverse_ ? "INDEX_SCAN(REVERSE) " : "INDEX_SCAN ");
+    else if(scan_type_ == LOOSE_INDEX_SCAN) std::cout << (loose_min_max_ ? "LOOSE_INDEX_SCAN(MIN/MAX) " : "LOOSE_INDEX_SCAN ");
+    else std::cout << (rid_set_union_ ? "RID_SET_SCAN(OR) " : "RID_SET_SCAN(AND) ");
+    std::cout << ", table: ";
     printf("%.*s\n", (int)table_rename_.size_ , table_rename_.str_);
+    for(int j = 0; j < rid_scans_.size(); ++j)
+        rid_scans_[j]->print(prefix_space_cnt + 1);
     if(filters_.size()){
         for(int j = 0; j < filters_.size(); ++j){
             for(int i = 0; i < prefix_space_cnt; ++i)
@@ -82,14 +93,26 @@ JoinOperation::JoinOperation(Arena* arena, int query_idx, AlgebraOperation* lhs,
         ExpressionNode* filter,
         JoinType type, JoinAlgorithm join_algo):
     AlgebraOperation(JOIN, query_idx),
-    lhs_(lhs), rhs_(rhs), filter_(filter), join_type_(type), join_algo_(join_algo)
+    lhs_(lhs), rhs_(rhs), filter_(filter), join_type_(type), join_algo_(join_algo), index_probe_keys_(arena)
 {}
 void JoinOperation::print(int prefix_space_cnt) {
     for(int i = 0; i < prefix_space_cnt; ++i)
         std::cout << " ";
     std::cout << "join operation: "; 
-    std::cout << (join_algo_ == NESTED_LOOP_JOIN ? "NESTED_LOOP_JOIN" : "HASH_JOIN") << "\n";
-    lhs_->print(prefix_space_cnt + 1);
+    switch(join_algo_) {
+        case NESTED_LOOP_JOIN: std::cout << "NESTED_LOOP_JOIN\n"; break;
+        case HASH_JOIN:        std::cout << "HASH_JOIN\n";        break;
+        case MERGE_JOIN:       std::cout << "MERGE_JOIN\n";       break;
+        case INDEX_NESTED_LOOP_JOIN: std::cout << "INDEX_NESTED_LOOP_JOIN\n"; break;
+    }
+    if(join_type_ == SEMI_JOIN || join_type_ == ANTI_JOIN) {
+        for(int i = 0; i <= prefix_space_cnt; ++i)
+            std::cout << " ";
+        std::cout << (join_type_ == SEMI_JOIN ? "SEMI_JOIN" : "ANTI_JOIN");
+        if(semi_query_idx_ != -1) std::cout << " with sub-query (" << semi_query_idx_ << ")";
+        std::cout << "\n";
+    }
+    if(lhs_) lhs_->print(prefix_space_cnt + 1);
     rhs_->print(prefix_space_cnt + 1);
 }
 
@@ -163,9 +186,10 @@ void ProjectionOperation::print(int prefix_space_cnt) {
         child_->print(prefix_space_cnt + 1);
 }
 
-SortOperation::SortOperation(Arena* arena, int query_idx, AlgebraOperation* child, Vector<int>& order_by_list):
+SortOperation::SortOperation(Arena* arena, int query_idx, AlgebraOperation* child, Vector<int>& order_by_list,
+        Vector<bool>& order_by_desc):
     AlgebraOperation(SORT, query_idx),
-    child_(child), order_by_list_(order_by_list, arena)
+    child_(child), order_by_list_(order_by_list, arena), order_by_desc_(order_by_desc, arena)
 {}
 void SortOperation::print(int prefix_space_cnt) {
     for(int i = 0; i < prefix_space_cnt; ++i)
@@ -175,3 +199,14 @@ void SortOperation::print(int prefix_space_cnt) {
         child_->print(prefix_space_cnt + 1);
 }
 
+LimitOperation::LimitOperation(Arena* arena, int query_idx, AlgebraOperation* child, u64 limit, u64 offset):
+    AlgebraOperation(LIMIT, query_idx),
+    child_(child), limit_(limit), offset_(offset)
+{}
+void LimitOperation::print(int prefix_space_cnt) {
+    for(int i = 0; i < prefix_space_cnt; ++i)
+        std::cout << " ";
+    std::cout << "limit operation\n"; 
+    if(child_)
+        child_->print(prefix_space_cnt + 1);
+}
@@ -58,9 +58,9 @@ void Arena::init() {
 void Arena::destroy() {
     if(!buffer_) return;
     memory_release(buffer_, max_);
-    u8* buffer_      = nullptr;
-    u64 alloc_pos_   = 0;
-    u64 commit_pos_  = 0;
+    buffer_      = nullptr;
+    alloc_pos_   = 0;
+    commit_pos_  = 0;
 }
 
 void Arena::realign() {
@@ -72,7 +72,8 @@ void Arena::realign() {
 void* Arena::alloc(size_t size, u64 alignment) {
     void* memory = nullptr;
     if(size == 0) return memory;
-    size = align_forward_u64(size, alignment);
+    // alignment = 0 packs the memory right after the previous allocation.
+    if(alignment) size = align_forward_u64(size, alignment);
 
     if(alloc_pos_ + size > commit_pos_) {
         u64 commit_size = size;
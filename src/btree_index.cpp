@@ -27,8 +27,15 @@ void BTreeIndex::init(CacheManager* cm, FileID fid, int nkey_cols, bool is_uniqu
     PageNum root_pnum = *(PageNum*)(meta_page->data_+ROOT_PNUM_OFFSET);
     if(root_pnum == 0) root_page_id_ = INVALID_PAGE_ID;
     else root_page_id_   = {.fid_ = fid_, .page_num_ = root_pnum};
+    format_version_ = *(u32*)(meta_page->data_+FORMAT_VERSION_OFFSET);
 
     cache_manager_->unpinPage(zero_pid, false);
+
+    // an empty index has no pages yet, the ones it will get use the current layout.
+    if(root_pnum == 0 && format_version_ != BTREE_FORMAT_VERSION) {
+        format_version_ = BTREE_FORMAT_VERSION;
+        cache_manager_->update_format_version(fid_, format_version_);
+    }
 }
 
 void BTreeIndex::destroy(){}
@@ -129,7 +136,7 @@ BTreeInternalPage* BTreeIndex::create_internal_page(Page** new_page_raw){
 // return true if inserted successfully.
 bool BTreeIndex::Insert(QueryCTX* ctx, const IndexKey &key) {
     std::unique_lock locker(root_page_id_lock_);
-    if((key.size_ + 16) * 3 > BTreePage::get_max_key_size()){
+    if(key.size_ > BTreePage::get_max_insert_key_size()){
         std::cout << "Key can't fit in one page\n";
       return false;
     }
@@ -185,8 +192,11 @@ bool BTreeIndex::Insert(QueryCTX* ctx, const IndexKey &key) {
             auto *place_holder = reinterpret_cast<BTreeLeafPage *>(ptr);
             is_full = place_holder->IsFull(key);
         } else {
+            // the key that gets pushed up by a split of a lower level page can be larger than the inserted key,
+            // so an internal page is only safe if it can fit the largest key we accept.
             auto *place_holder = reinterpret_cast<BTreeInternalPage *>(ptr);
-            is_full = place_holder->IsFull(key);
+            is_full = (BTreePage::INTERNAL_SLOT_ENTRY_SIZE_ + BTreePage::get_max_local_key_size() 
+                    >= place_holder->get_free_space_size());
         }
 
         // meaning the the current node is empty weather it's an internal or a leaf node.
@@ -270,7 +280,9 @@ bool BTreeIndex::Insert(QueryCTX* ctx, const IndexKey &key) {
               new_root_raw->mutex_.unlock();
               cache_manager_->unpinPage(root_page_id_, true);
             }
+            set_prev_link(cur->GetNextPageId(fid_), new_page_id);
             new_page->set_next_page_number(cur->get_next_page_number());
+            new_page->set_prev_page_number(cur->get_page_number());
             cur->set_next_page_number(new_page_id.page_num_);
 
             // unpin the current_page and the new_page we don't need them any more and they are dirty.
@@ -284,7 +296,7 @@ bool BTreeIndex::Insert(QueryCTX* ctx, const IndexKey &key) {
         } else {
             auto *cur = reinterpret_cast<BTreeInternalPage *>(custom_stk.back());
             // if it's empty then add the key
-            bool full = cur->IsFull(key);
+            bool full = cur->IsFull(current_key);
             if (!full) {
                 cur->Insert(current_key, current_internal_value);
                 break;
@@ -476,6 +488,7 @@ void BTreeIndex::Remove(QueryCTX* ctx, const IndexKey &key) {
                         //prev->SetValAt(prev_size + i, cur->ValAt(i));
                     }
                     prev->SetNextPageId(cur->GetNextPageId(fid_));
+                    set_prev_link(cur->GetNextPageId(fid_), prev_page_id);
 
                     lock_cnt--;
                     cur_page->mutex_.unlock();
@@ -511,6 +524,7 @@ void BTreeIndex::Remove(QueryCTX* ctx, const IndexKey &key) {
                         //cur->SetValAt(cur_size + i, next->ValAt(i));
                     }
                     cur->SetNextPageId(next->GetNextPageId(fid_));
+                    set_prev_link(next->GetNextPageId(fid_), cur_page_id);
 
                     lock_cnt--;
                     next_page->mutex_.unlock();
@@ -809,6 +823,47 @@ IndexIterator BTreeIndex::end() {
     return it;
 }
 
+// the last entry is right before the end of the last leaf page.
+IndexIterator BTreeIndex::rbegin() {
+    auto it = end();
+    it.retreat();
+    return it;
+}
+
+// for backward range queries
+IndexIterator BTreeIndex::reverse_bound(const IndexKey &key, bool inclusive) {
+    if (isEmpty()) {
+        return IndexIterator(nullptr, INVALID_PAGE_ID, 0);
+    }
+    std::shared_lock locker(root_page_id_lock_);
+    auto *root_page = cache_manager_->fetchPage(root_page_id_);
+    auto *root = reinterpret_cast<BTreePage *>(root_page->data_);
+    while (!root->IsLeafPage()) {
+        auto *cur = reinterpret_cast<BTreeInternalPage *>(root);
+        auto next_page_id = inclusive ? cur->next_page_upper_bound(key, fid_) : cur->NextPage(key, fid_);
+
+        auto *next_page = cache_manager_->fetchPage(next_page_id);
+        auto *next = reinterpret_cast<BTreePage *>(next_page->data_);
+
+        cache_manager_->unpinPage(cur->GetPageId(fid_), false);
+
+        if (cur->GetPageId(fid_) == root_page_id_) {
+            locker.unlock();
+        }
+
+        root = next;
+        root_page = next_page;
+    }
+    auto *tmp = reinterpret_cast<BTreeLeafPage *>(root);
+    // pos is the first entry that is past the key, the entry right before it is the answer
+    // and it might live at the end of the previous leaf page.
+    int pos = inclusive ? tmp->get_pos_upper_bound(key) : tmp->GetPos(key);
+    auto it = IndexIterator(cache_manager_, root->GetPageId(fid_), pos);
+    cache_manager_->unpinPage(root->GetPageId(fid_), false);
+    it.retreat();
+    return it;
+}
+
 void BTreeIndex::See(){
     std::ofstream out("btree_vis.dot");
     auto *root = reinterpret_cast<BTreePage *>(cache_manager_->fetchPage(root_page_id_)->data_);
@@ -893,6 +948,17 @@ void BTreeIndex::ToString(BTreePage* page, std::ofstream& out){
     out.flush();
 }
 
+// keeps the backward links of the leaf pages in sync after a split or a merge.
+void BTreeIndex::set_prev_link(PageID page_id, PageID prev_page_id) {
+    if(page_id == INVALID_PAGE_ID) return;
+    auto *raw_page = cache_manager_->fetchPage(page_id);
+    assert(raw_page);
+    if(!raw_page) return;
+    auto *leaf = reinterpret_cast<BTreeLeafPage *>(raw_page->data_);
+    leaf->SetPrevPageId(prev_page_id);
+    cache_manager_->unpinPage(page_id, true);
+}
+
 bool BTreeIndex::isEmpty() {
     if (root_page_id_ == INVALID_PAGE_ID || root_page_id_.page_num_ == -1) {
         return true;
@@ -907,3 +973,11 @@ bool BTreeIndex::isEmpty() {
 FileID BTreeIndex::get_fid() {
     return fid_;
 }
+
+bool BTreeIndex::is_unique() {
+    return is_unique_index_;
+}
+
+bool BTreeIndex::is_outdated() {
+    return format_version_ != BTREE_FORMAT_VERSION;
+}
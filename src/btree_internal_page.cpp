@@ -8,9 +8,8 @@
 
 bool BTreeInternalPage::IsFull(IndexKey k) { 
     u64 ksz = normalize_index_key_size(k);
-    // 9 for worst case varint + 4 for the overflow page number
     if(ksz != k.size_)
-        ksz += 9 + 4; 
+        ksz += BTREE_OVERFLOW_HEADER_SIZE; 
     return (INTERNAL_SLOT_ENTRY_SIZE_ + ksz >= get_free_space_size());
 }
 
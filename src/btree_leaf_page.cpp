@@ -43,9 +43,8 @@ inline IndexKey BTreeLeafPage::get_last_key_cpy(Arena* arena, int elements_to_ch
 }
 bool BTreeLeafPage::IsFull(IndexKey k) { 
     u64 ksz = normalize_index_key_size(k);
-    // 9 for worst case varint + 4 for the overflow page number
     if(ksz != k.size_)
-        ksz += 9 + 4; 
+        ksz += BTREE_OVERFLOW_HEADER_SIZE; 
     return ((LEAF_SLOT_ENTRY_SIZE_ + ksz) >= get_free_space_size());
 }
 
@@ -53,6 +52,7 @@ void BTreeLeafPage::Init(PageID page_id) {
   SetPageType(BTreePageType::LEAF_PAGE);
   SetPageId(page_id);
   set_next_page_number(INVALID_PAGE_NUM);
+  set_prev_page_number(INVALID_PAGE_NUM);
   set_free_space_offset(PAGE_SIZE - 1);
 }
 
@@ -79,6 +79,28 @@ void BTreeLeafPage::set_next_page_number(PageNum next_page_num) {
   *ptr = next_page_num;
 }
 
+PageID BTreeLeafPage::GetPrevPageId(FileID fid) { 
+    PageNum pg = get_prev_page_number();
+    if(pg == INVALID_PAGE_NUM) return INVALID_PAGE_ID;
+  return {
+    .fid_ = fid,
+    .page_num_ = pg,
+  };
+}
+
+void BTreeLeafPage::SetPrevPageId(PageID pid) {
+  set_prev_page_number(pid.page_num_);
+}
+
+PageNum BTreeLeafPage::get_prev_page_number() { 
+  return *(PageNum*)get_ptr_to(PREV_PAGE_NUMBER_OFFSET_); 
+}
+
+void BTreeLeafPage::set_prev_page_number(PageNum prev_page_num) { 
+  auto ptr = (PageNum*)get_ptr_to(PREV_PAGE_NUMBER_OFFSET_);
+  *ptr = prev_page_num;
+}
+
 
 /*
 RecordID BTreeLeafPage::ValAt(int index){
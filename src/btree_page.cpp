@@ -11,6 +11,17 @@ int BTreePage::get_max_key_size() {
     return PAGE_SIZE-(BTREE_HEADER_SIZE+mx);
 }
 
+int BTreePage::get_max_insert_key_size() {
+    return get_max_key_size() / BTREE_MIN_KEYS_PER_PAGE - BTREE_KEY_SLACK;
+}
+
+int BTreePage::get_max_local_key_size() {
+    int largest = get_max_insert_key_size();
+    if(largest <= BTREE_X_CONST) return largest;
+    // larger keys keep at most BTREE_X_CONST bytes in the page (see normalize_index_key_size).
+    return BTREE_X_CONST + BTREE_OVERFLOW_HEADER_SIZE;
+}
+
 uint32_t BTreePage::get_num_of_slots() const {
     return *reinterpret_cast<uint32_t*>(get_ptr_to(NUMBER_OF_SLOTS_OFFSET_));
 }
@@ -188,6 +188,12 @@ bool CacheManager::update_root_page_number(FileID fid, PageNum pnum){
     return !err;
 }
 
+bool CacheManager::update_format_version(FileID fid, u32 version){
+    int err = disk_manager_->update_format_version(fid, version);
+    assert(!err);
+    return !err;
+}
+
 
 
 void CacheManager::flushAllPages() {
@@ -7,8 +7,10 @@
 #include "value.cpp"
 #include "tokenizer.cpp"
 #include "btree_index.cpp"
+#include "hash_index.cpp"
 #include "table_schema.cpp"
 #include "parser.cpp"
+#include "statistics.cpp"
 #include <sstream>
 #include <algorithm>
 #include <cstdint>
@@ -122,25 +124,27 @@ void Catalog::init(CacheManager *cm) {
     }
     it.destroy();
     // load indexes meta data:
-    // indexes_meta_data (text index_name, text table_name, int fid, boolean is_unique).
+    // indexes_meta_data (text index_name, text table_name, int fid, boolean is_unique, boolean is_hash).
     // indexs_keys       (text index_name, int field_number_in_table, int field_number_in_index).
     // both should either exist or not.
     assert(tables_.count(str_lit(INDEX_META_TABLE)) == tables_.count(str_lit(INDEX_KEYS_TABLE)));
     if(tables_.count(str_lit(INDEX_META_TABLE))){
         load_indexes();
+        rebuild_outdated_indexes();
     } else {
         // create a pseudo context and destroy it after.
         QueryCTX pctx;
         String8 index_query = 
             str_lit("CREATE TABLE " 
             INDEX_META_TABLE
-            "(index_name TEXT, table_name TEXT, fid INTEGER, is_unique BOOLEAN)");
+            "(index_name TEXT, table_name TEXT, fid INTEGER, is_unique BOOLEAN, is_hash BOOLEAN)");
         pctx.init(index_query);
         Vector<Column> index_meta_columns;
         index_meta_columns.emplace_back(str_lit("index_name")    , VARCHAR, 0 );
         index_meta_columns.emplace_back(str_lit("table_name")    , VARCHAR, 4 );
         index_meta_columns.emplace_back(str_lit("fid")           , INT    , 8 );
         index_meta_columns.emplace_back(str_lit("is_unique")     , BOOLEAN, 12);
+        index_meta_columns.emplace_back(str_lit("is_hash")       , BOOLEAN, 13);
         TableSchema* ret = create_table(&pctx, str_lit(INDEX_META_TABLE), index_meta_columns, false); 
         assert(ret != nullptr);
 
@@ -161,6 +165,45 @@ void Catalog::init(CacheManager *cm) {
         assert(ret != nullptr);
         pctx.clean();
     }
+    // load statistics:
+    // table_stats  (text table_name, bigint row_count).
+    // column_stats (text table_name, int field_number, bigint ndv, real null_frac, text histogram).
+    // databases created before statistics get both tables on their next boot.
+    assert(tables_.count(str_lit(TABLE_STATS_TABLE)) == tables_.count(str_lit(COLUMN_STATS_TABLE)));
+    if(tables_.count(str_lit(TABLE_STATS_TABLE))){
+        load_stats();
+    } else {
+        create_stats_tables();
+    }
+}
+
+void Catalog::create_stats_tables() {
+    QueryCTX pctx;
+    String8 table_stats_query = 
+        str_lit("CREATE TABLE " TABLE_STATS_TABLE "(table_name TEXT, row_count BIGINT)");
+    pctx.init(table_stats_query);
+    Vector<Column> table_stats_columns;
+    table_stats_columns.emplace_back(str_lit("table_name")   , VARCHAR, 0);
+    table_stats_columns.emplace_back(str_lit("row_count")    , BIGINT , 4);
+    TableSchema* ret = create_table(&pctx, str_lit(TABLE_STATS_TABLE), table_stats_columns, false);
+    assert(ret != nullptr);
+
+    String8 column_stats_query = 
+        str_lit(
+            "CREATE TABLE "
+            COLUMN_STATS_TABLE
+            "(table_name TEXT, field_number INTEGER, ndv BIGINT, null_frac REAL, histogram TEXT)"
+        );
+    pctx.query_ = column_stats_query;
+    Vector<Column> column_stats_columns;
+    column_stats_columns.emplace_back(str_lit("table_name")   , VARCHAR, 0);
+    column_stats_columns.emplace_back(str_lit("field_number") , INT    , 4);
+    column_stats_columns.emplace_back(str_lit("ndv")          , BIGINT , 8);
+    column_stats_columns.emplace_back(str_lit("null_frac")    , DOUBLE , 16);
+    column_stats_columns.emplace_back(str_lit("histogram")    , VARCHAR, 24);
+    ret = create_table(&pctx, str_lit(COLUMN_STATS_TABLE), column_stats_columns, false);
+    assert(ret != nullptr);
+    pctx.clean();
 }
 
 void Catalog::destroy () {
@@ -209,12 +252,11 @@ TableSchema* Catalog::create_table(QueryCTX* ctx, String8 table_name, Vector<Col
 }
 
 TableSchema* Catalog::create_temp_table(QueryCTX* ctx, TableSchema* temp_schema) {
-    printf("creating a temp table!\n");
     FileID nfid = generate_max_fid();
     assert((fid_to_fname.count(nfid) == 0 && fid_to_fname.count(nfid+1) == 0) && "[FATAL] fid already exists!");
-    u64 cur_time = std::time(nullptr);
 
-    String8 table_name =  i64_to_str(&ctx->arena_, cur_time);
+    // the file id is unique among the open files, so are the names of the temp tables that are based on it.
+    String8 table_name = str_cat(&ctx->arena_, str_lit("NDB_TEMP_"), i64_to_str(&ctx->arena_, nfid));
 
     if (tables_.count(table_name) || fid_to_fname.count(nfid)){
         assert(0);
@@ -223,12 +265,16 @@ TableSchema* Catalog::create_temp_table(QueryCTX* ctx, TableSchema* temp_schema)
 
     String8 fname = str_cat(&ctx->arena_, table_name, str_lit(".ndb"), true);
     String8 fsm   = str_cat(&ctx->arena_, table_name, str_lit("_fsm.ndb"), true);
+    // files left behind by a crashed query are not reused.
+    std::remove((char*)fname.str_);
+    std::remove((char*)fsm.str_);
     fid_to_fname[nfid]   = fname;
     fid_to_fname[nfid+1] = fsm;
 
     // initialize the table
     Table* table = nullptr;
     ALLOCATE_INIT(ctx->arena_, table, Table, cache_manager_, nfid);
+    table->set_append_only();
 
     TableSchema* schema = New(TableSchema, ctx->arena_, table_name, table, temp_schema->getColumns());
 
@@ -241,6 +287,8 @@ int Catalog::delete_temp_table(TableSchema* schema) {
     auto fid = schema->getTable()->get_fid();
     int err = cache_manager_->deleteFile(fid);
     assert(err == 0);
+    // fsm of any table is by convention the second file after that table.
+    if(fid_to_fname.count(fid+1)) cache_manager_->deleteFile(fid+1);
     fid_to_fname.erase(fid);
     fid_to_fname.erase(fid+1);
     return err;
@@ -248,9 +296,12 @@ int Catalog::delete_temp_table(TableSchema* schema) {
 
 
 bool Catalog::create_index(QueryCTX* ctx, String8 table_name, String8 index_name,
-        Vector<IndexField> &fields, bool is_unique, bool deep_copy) {
+        Vector<IndexField> &fields, bool is_unique, bool deep_copy, bool is_hash) {
     if (!tables_.count(table_name) || indexes_.count(index_name))
         return 1;
+    // the meta table of databases created before hash indexes can't record them.
+    if (is_hash && tables_[str_lit(INDEX_META_TABLE)]->numOfCols() <= 4)
+        return 1;
     TableSchema* table = tables_[table_name];
     Vector<NumberedIndexField> cols;
     for(int i = 0; i < fields.size(); ++i){
@@ -270,9 +321,18 @@ bool Catalog::create_index(QueryCTX* ctx, String8 table_name, String8 index_name
     TableSchema* index_meta_data = tables_[str_lit(INDEX_META_TABLE)];
     TableSchema* index_keys      = tables_[str_lit(INDEX_KEYS_TABLE)];
 
-    BTreeIndex* index = nullptr; 
-    ALLOCATE_INIT(arena_, index, 
-            BTreeIndex, cache_manager_, nfid, cols.size(), is_unique);
+    IndexHeader header;
+    if(is_hash) {
+        HashIndex* index = nullptr; 
+        ALLOCATE_INIT(arena_, index, 
+                HashIndex, cache_manager_, nfid, cols.size(), is_unique);
+        header = IndexHeader(index, index_name);
+    } else {
+        BTreeIndex* index = nullptr; 
+        ALLOCATE_INIT(arena_, index, 
+                BTreeIndex, cache_manager_, nfid, cols.size(), is_unique);
+        header = IndexHeader(index, index_name);
+    }
 
     if(deep_copy){
         index_name = str_copy(&arena_, index_name);
@@ -282,7 +342,8 @@ bool Catalog::create_index(QueryCTX* ctx, String8 table_name, String8 index_name
         }
     }
 
-    IndexHeader header = IndexHeader(index, index_name, cols);
+    header.index_name_     = index_name;
+    header.fields_numbers_ = cols;
     indexes_.insert({index_name, header});
 
     if(indexes_of_table_.count(table_name))
@@ -297,6 +358,7 @@ bool Catalog::create_index(QueryCTX* ctx, String8 table_name, String8 index_name
     t.put_val_at(1, Value(table_name));
     t.put_val_at(2, Value(nfid));
     t.put_val_at(3, Value((bool) is_unique));
+    if(index_meta_data->numOfCols() > 4) t.put_val_at(4, Value((bool) is_hash));
     RecordID rid = RecordID();
     int err = index_meta_data->insert(ctx->arena_, t, &rid);
     assert(err == 0);
@@ -317,6 +379,11 @@ bool Catalog::create_index(QueryCTX* ctx, String8 table_name, String8 index_name
     }
 
     // insert rows of the table.
+    fill_index(ctx, table, index_name);
+    return false;
+}
+
+void Catalog::fill_index(QueryCTX* ctx, TableSchema* table, String8 index_name) {
     TableIterator table_it = table->begin();
     table_it.init();
     ArenaTemp tmp = ctx->arena_.start_temp_arena();
@@ -327,11 +394,35 @@ bool Catalog::create_index(QueryCTX* ctx, String8 table_name, String8 index_name
         assert(err == 0 && "Could not traverse the table.");
         IndexKey k = getIndexKeyFromTuple(tmp.arena_, indexes_[index_name].fields_numbers_, t, table_it.getCurRecordID());
         assert(k.size_ != 0);
-        bool success = indexes_[index_name].index_->Insert(ctx, k);
+        bool success = indexes_[index_name].insert(ctx, k);
         assert(success);
     }
     table_it.destroy();
-    return false;
+}
+
+// btree files written with an older page layout would be misread by the current code,
+// their index is dropped from the disk and built again from the rows of its table.
+void Catalog::rebuild_outdated_indexes() {
+    QueryCTX pctx;
+    pctx.init(str_lit(""));
+    for(auto& [table_name, index_names] : indexes_of_table_) {
+        assert(tables_.count(table_name));
+        TableSchema* table = tables_[table_name];
+        for(u32 i = 0; i < index_names.size(); ++i) {
+            IndexHeader* header = &indexes_[index_names[i]];
+            if(header->is_hash() || !header->index_->is_outdated()) continue;
+            printf("[INFO] rebuilding index %.*s: it was written in an older btree format.\n",
+                    (int)index_names[i].size_, index_names[i].str_);
+            BTreeIndex* index = header->index_;
+            FileID fid = index->get_fid();
+            String8 fname = fid_to_fname[fid];
+            cache_manager_->deleteFile(fid);
+            fid_to_fname[fid] = fname;
+            index->init(cache_manager_, fid, header->fields_numbers_.size(), index->is_unique());
+            fill_index(&pctx, table, index_names[i]);
+        }
+    }
+    pctx.clean();
 }
 
 IndexHeader Catalog::create_temp_index(QueryCTX* ctx, Vector<NumberedIndexField> &fields, bool is_unique) {
@@ -404,7 +495,7 @@ Vector<IndexHeader> Catalog::get_indexes_of_table(String8 tname) {
 }
 
 bool Catalog::load_indexes() {
-    // indexes_meta_data (text index_name, text table_name, int fid, is_unique).
+    // indexes_meta_data (text index_name, text table_name, int fid, is_unique, is_hash).
     TableSchema* indexes_meta_schema = tables_[str_lit(INDEX_META_TABLE)];
     //TableIterator it_meta = indexes_meta_schema->getTable()->begin();
     TableIterator it_meta = indexes_meta_schema->begin();
@@ -424,6 +515,8 @@ bool Catalog::load_indexes() {
         String8 table_name  = t.get_val_at(1).getStringView(&arena_);
         FileID fid         = t.get_val_at(2).getIntVal();
         bool is_unique     = t.get_val_at(3).getBoolVal();
+        // databases created before hash indexes don't have the is_hash column.
+        bool is_hash       = t.size() > 4 && t.get_val_at(4).getBoolVal();
 
         // each index must exist only once on this table.
         assert(indexes_.count(index_name) == 0 && "Index accured multiple times on meta data!");
@@ -434,10 +527,18 @@ bool Catalog::load_indexes() {
         fid_to_fname[fid] = index_fname;
 
         // save results into memory.
-        BTreeIndex* index_ptr = nullptr; 
-        ALLOCATE_INIT(arena_, index_ptr, 
-                        BTreeIndex, cache_manager_, fid, 1, is_unique);
-        std::pair<String8, IndexHeader> entry = {index_name, IndexHeader(index_ptr, index_name)};
+        std::pair<String8, IndexHeader> entry;
+        if(is_hash) {
+            HashIndex* index_ptr = nullptr; 
+            ALLOCATE_INIT(arena_, index_ptr, 
+                            HashIndex, cache_manager_, fid, 1, is_unique);
+            entry = {index_name, IndexHeader(index_ptr, index_name)};
+        } else {
+            BTreeIndex* index_ptr = nullptr; 
+            ALLOCATE_INIT(arena_, index_ptr, 
+                            BTreeIndex, cache_manager_, fid, 1, is_unique);
+            entry = {index_name, IndexHeader(index_ptr, index_name)};
+        }
         indexes_.insert(entry);
         if(indexes_of_table_.count(table_name))
             indexes_of_table_[table_name].push_back(index_name);
@@ -479,7 +580,8 @@ bool Catalog::load_indexes() {
             .idx_ = field_number_in_table,
             .desc_ = is_desc_order
         };
-        header->index_->resize_nkey_cols(header->fields_numbers_.size());
+        if(header->is_hash()) header->hash_index_->resize_nkey_cols(header->fields_numbers_.size());
+        else header->index_->resize_nkey_cols(header->fields_numbers_.size());
     }
     it_keys.destroy();
     return success;
@@ -497,11 +599,10 @@ int Catalog::delete_index(QueryCTX* ctx, String8 index_name) {
     if (!indexes_.count(index_name))
         return 1;
     IndexHeader header = indexes_[index_name];
-    assert(header.index_);
+    assert(header.index_ || header.hash_index_);
 
     // gather data related to the index in the system.
-    BTreeIndex* index = indexes_[index_name].index_; 
-    FileID fid = index->get_fid();
+    FileID fid = header.is_hash() ? header.hash_index_->get_fid() : header.index_->get_fid();
     String8 index_table_name = {};
 
     assert(fid_to_fname.count(fid));
@@ -530,8 +631,9 @@ int Catalog::delete_index(QueryCTX* ctx, String8 index_name) {
             ctx->arena_.clear_temp_arena(tmp);
             continue;
         }
+        // the tuple lives inside of the temp arena that is cleared below.
         if(index_table_name.size_ == 0) 
-            index_table_name = cur_table_name;
+            index_table_name = str_copy(&arena_, cur_table_name);
 
         RecordID rid = it_meta.getCurRecordID();
 
@@ -639,6 +741,7 @@ int Catalog::delete_table(QueryCTX* ctx, String8 table_name) {
     // delete the fsm file.
     err = cache_manager_->deleteFile(fsm_fid);
     assert(err == 0);
+    delete_stats(ctx, table_name);
     // clear the catalog's in-memory data.
     tables_.erase(table_name);
     fid_to_fname.erase(table_fid);
@@ -647,3 +750,164 @@ int Catalog::delete_table(QueryCTX* ctx, String8 table_name) {
 }
 
 // TODO: implement alter index and table.
+
+bool Catalog::is_catalog_table(String8 table_name) {
+    return table_name == str_lit(META_DATA_TABLE)   || table_name == str_lit(INDEX_META_TABLE) ||
+           table_name == str_lit(INDEX_KEYS_TABLE)  || table_name == str_lit(TABLE_STATS_TABLE) ||
+           table_name == str_lit(COLUMN_STATS_TABLE);
+}
+
+TableStats* Catalog::get_table_stats(String8 table_name) {
+    auto it = stats_.find(table_name);
+    if(it == stats_.end()) return nullptr;
+    return &it->second;
+}
+
+bool Catalog::load_stats() {
+    // table_stats (text table_name, bigint row_count).
+    TableSchema* table_stats = tables_[str_lit(TABLE_STATS_TABLE)];
+    TableIterator it_tables = table_stats->begin();
+    bool success = true;
+    it_tables.init();
+    while(it_tables.advance()){
+        Tuple t;
+        int err = it_tables.getCurTupleCpy(arena_, &t);
+        assert(err == 0 && "Could not traverse the table statistics.");
+        if(err) {
+            success = false;
+            break;
+        }
+        String8 table_name = t.get_val_at(0).getStringView(&arena_);
+        stats_[table_name].row_count_ = t.get_val_at(1).getBigIntVal();
+    }
+    it_tables.destroy();
+    if(!success) return false;
+
+    // column_stats (text table_name, int field_number, bigint ndv, real null_frac, text histogram).
+    TableSchema* column_stats = tables_[str_lit(COLUMN_STATS_TABLE)];
+    TableIterator it_columns = column_stats->begin();
+    it_columns.init();
+    while(it_columns.advance()){
+        Tuple t;
+        int err = it_columns.getCurTupleCpy(arena_, &t);
+        assert(err == 0 && "Could not traverse the column statistics.");
+        if(err) {
+            success = false;
+            break;
+        }
+        String8 table_name = t.get_val_at(0).getStringView(&arena_);
+        int field_number   = t.get_val_at(1).getIntVal();
+        if(!stats_.count(table_name)) continue;
+        TableStats* stats = &stats_[table_name];
+        if(field_number >= stats->columns_.size()) stats->columns_.resize(field_number + 1);
+        ColumnStats* col = &stats->columns_[field_number];
+        col->ndv_       = t.get_val_at(2).getBigIntVal();
+        col->null_frac_ = t.get_val_at(3).getDoubleVal();
+        if(!t.get_val_at(4).isNull())
+            col->bounds_ = stats_histogram_from_str(t.get_val_at(4).getStringView(&arena_));
+    }
+    it_columns.destroy();
+    return success;
+}
+
+// removes the persisted and the in-memory statistics of a table.
+void Catalog::delete_stats(QueryCTX* ctx, String8 table_name) {
+    stats_.erase(table_name);
+    String8 stats_tables[] = { str_lit(TABLE_STATS_TABLE), str_lit(COLUMN_STATS_TABLE) };
+    for(String8 name : stats_tables) {
+        TableSchema* schema = tables_[name];
+        TableIterator it = schema->begin();
+        std::set<u64> halloween_preventer;
+        it.init();
+        while(it.advance()){
+            if(halloween_preventer.count(it.getCurRecordID().get_hash())) continue;
+            ArenaTemp tmp = ctx->arena_.start_temp_arena();
+            Tuple t;
+            int err = it.getCurTupleCpy(ctx->arena_, &t);
+            assert(err == 0 && "Could not traverse the statistics table.");
+            String8 cur_table_name = t.get_val_at(0).getStringView(&ctx->arena_);
+            if(cur_table_name != table_name) {
+                ctx->arena_.clear_temp_arena(tmp);
+                continue;
+            }
+            RecordID rid = it.getCurRecordID();
+            err = schema->remove(rid);
+            ctx->arena_.clear_temp_arena(tmp);
+            assert(err == 0 && "Could not delete record.");
+            halloween_preventer.insert(rid.get_hash());
+        }
+        it.destroy();
+    }
+}
+
+int Catalog::analyze_table(QueryCTX* ctx, String8 table_name) {
+    if(table_name.size_ == 0) {
+        Vector<String8> names;
+        for(auto& t : tables_)
+            if(!is_catalog_table(t.first)) names.push_back(t.first);
+        for(int i = 0; i < names.size(); ++i){
+            int err = analyze_table(ctx, names[i]);
+            if(err) return err;
+        }
+        return 0;
+    }
+    if(!tables_.count(table_name) || is_catalog_table(table_name))
+        return 1;
+    TableSchema* schema = tables_[table_name];
+    // the name of the schema lives as long as the catalog.
+    table_name = schema->getTableName();
+
+    StatsCollector collector;
+    collector.init(schema->numOfCols());
+    TableIterator it = schema->begin();
+    it.init();
+    ArenaTemp tmp = ctx->arena_.start_temp_arena();
+    while(it.advance()){
+        ctx->arena_.clear_temp_arena(tmp);
+        Tuple t;
+        int err = it.getCurTupleCpy(ctx->arena_, &t);
+        assert(err == 0 && "Could not traverse the table.");
+        if(err) {
+            it.destroy();
+            return err;
+        }
+        for(int i = 0; i < t.size(); ++i){
+            Value v = t.get_val_at(i);
+            if(v.type_ == OVERFLOW_ITERATOR) t.put_val_at(i, Value(v.getStringView(&ctx->arena_)));
+        }
+        collector.add_row(t);
+    }
+    ctx->arena_.clear_temp_arena(tmp);
+    it.destroy();
+
+    TableStats stats;
+    collector.finish(&stats);
+    delete_stats(ctx, table_name);
+
+    // persist the statistics.
+    TableSchema* table_stats  = tables_[str_lit(TABLE_STATS_TABLE)];
+    TableSchema* column_stats = tables_[str_lit(COLUMN_STATS_TABLE)];
+    RecordID rid = RecordID();
+    Tuple t(&ctx->arena_);
+    t.resize(table_stats->numOfCols());
+    t.put_val_at(0, Value(table_name));
+    t.put_val_at(1, Value((i64) stats.row_count_));
+    int err = table_stats->insert(ctx->arena_, t, &rid);
+    if(err) return err;
+    for(int i = 0; i < stats.columns_.size(); ++i){
+        ColumnStats& col = stats.columns_[i];
+        String histogram = stats_histogram_to_str(col.bounds_);
+        Tuple t(&ctx->arena_);
+        t.resize(column_stats->numOfCols());
+        t.put_val_at(0, Value(table_name));
+        t.put_val_at(1, Value(i));
+        t.put_val_at(2, Value((i64) col.ndv_));
+        t.put_val_at(3, Value((double) col.null_frac_));
+        t.put_val_at(4, Value(str_copy(&ctx->arena_, {.str_ = (u8*)histogram.data(), .size_ = histogram.size()})));
+        err = column_stats->insert(ctx->arena_, t, &rid);
+        if(err) return err;
+    }
+    stats_[table_name] = std::move(stats);
+    return 0;
+}
+
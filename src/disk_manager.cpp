@@ -185,6 +185,15 @@ int DiskManager::writePage(PageID page_id, char* input_buffer) {
 
 int DiskManager::update_root_page_number(FileID fid, PageNum pnum){
     assert(sizeof(pnum) == 4);
+    return write_file_meta(fid, ROOT_PNUM_OFFSET, pnum);
+}
+
+int DiskManager::update_format_version(FileID fid, u32 version){
+    return write_file_meta(fid, FORMAT_VERSION_OFFSET, version);
+}
+
+int DiskManager::write_file_meta(FileID fid, u32 offset, u32 val){
+    assert(offset + sizeof(val) <= PAGE_SIZE);
     assert(fid_to_fname.count(fid) != 0); // TODO: replace assertion with an error message.
     auto file_name = fid_to_fname[fid];
     int open_err = openFile(file_name);
@@ -193,11 +202,11 @@ int DiskManager::update_root_page_number(FileID fid, PageNum pnum){
         return 1;
     }
     auto file_stream = &cached_files_[file_name].fs_;
-    file_stream->seekp(ROOT_PNUM_OFFSET);
+    file_stream->seekp(offset);
 
     char bytes[4];
-    memcpy(bytes, &pnum, sizeof(pnum));
-    file_stream->write(bytes, sizeof(pnum));
+    memcpy(bytes, &val, sizeof(val));
+    file_stream->write(bytes, sizeof(val));
     if (file_stream->bad()) {
         std::cerr << "I/O error while writing" << std::endl;
         file_stream->clear();
@@ -84,7 +84,8 @@ class ExecutionEngine {
             String8 table_name = create_index->table_name_;
             Vector<IndexField> fields = create_index->fields_;
             bool is_unique_index = create_index->is_unique_index_;
-            bool err = catalog_->create_index(&ctx, table_name, index_name, fields, is_unique_index);
+            bool is_hash_index   = create_index->is_hash_index_;
+            bool err = catalog_->create_index(&ctx, table_name, index_name, fields, is_unique_index, true, is_hash_index);
             if(err) return false;
             return true;
         }
@@ -105,6 +106,13 @@ class ExecutionEngine {
             return true;
         }
 
+        bool analyze_handler(QueryCTX& ctx) {
+            auto analyze = reinterpret_cast<AnalyzeStatementData*>(ctx.queries_call_stack_[0]);
+            int err = catalog_->analyze_table(&ctx, analyze->table_name_);
+            if(err) return false;
+            return true;
+        }
+
         // DDL execution.
         bool directExecute(QueryCTX& ctx){
             // should always be 1.
@@ -120,6 +128,8 @@ class ExecutionEngine {
                     return drop_table_handler(ctx);
                 case DROP_INDEX_DATA:
                     return drop_index_handler(ctx);
+                case ANALYZE_DATA:
+                    return analyze_handler(ctx);
                 default:
                     return false;
             }
@@ -129,8 +139,15 @@ class ExecutionEngine {
         bool executePlan(QueryCTX& ctx, Executor** execution_root){
             if(ctx.queries_call_stack_.size() < 1) return false;
             std::cout << "[INFO] Creating physical plan" << std::endl;
+            // executors that run out of memory spill into temp tables.
+            ctx.catalog_ = catalog_;
 
             for(auto cur_plan : ctx.operators_call_stack_){
+                // unnested sub-queries are executed by the joins of their parents.
+                if(!cur_plan) {
+                    ctx.executors_call_stack_.push_back(nullptr);
+                    continue;
+                }
                 Executor* created_physical_plan = buildExecutionPlan(ctx, cur_plan);
                 if(!created_physical_plan){
                     std::cout << "[ERROR] Could not build physical operation\n";
@@ -138,6 +155,7 @@ class ExecutionEngine {
                 }
                 if(cur_plan->distinct_){
                     DistinctExecutor* dis = New(DistinctExecutor , ctx.arena_, &ctx, created_physical_plan);
+                    dis->sorted_input_ = sorted_on_all_columns(cur_plan, created_physical_plan);
                     created_physical_plan = dis;
                 }
 
@@ -157,6 +175,27 @@ class ExecutionEngine {
 
     private:
 
+        // true if the rows of the plan come out sorted by all of their columns, so equal rows are next to each other.
+        bool sorted_on_all_columns(AlgebraOperation* plan, Executor* executor) {
+            if(!plan || !plan->sorted_by_ || !executor->output_schema_) return false;
+            int num_cols = executor->output_schema_->numOfCols();
+            for(int col = 0; col < num_cols; ++col){
+                bool found = false;
+                for(int i = 0; !found && i < plan->sorted_by_->size(); ++i)
+                    found = (*plan->sorted_by_)[i] == col;
+                if(!found) return false;
+            }
+            return true;
+        }
+
+        // both inputs of INTERSECT or EXCEPT are sorted by all of their columns in the same order,
+        // so they can be merged (see SetMergeState).
+        bool can_merge_set_inputs(AlgebraOperation* lhs_plan, Executor* lhs, AlgebraOperation* rhs_plan, Executor* rhs) {
+            if(!sorted_on_all_columns(lhs_plan, lhs) || !sorted_on_all_columns(rhs_plan, rhs)) return false;
+            if(lhs->output_schema_->numOfCols() != rhs->output_schema_->numOfCols()) return false;
+            return *lhs_plan->sorted_by_ == *rhs_plan->sorted_by_ && *lhs_plan->sorted_desc_ == *rhs_plan->sorted_desc_;
+        }
+
         Executor* buildExecutionPlan(QueryCTX& ctx, AlgebraOperation* logical_plan) {
             if(!logical_plan) return nullptr;
             switch(logical_plan->type_) {
@@ -167,6 +206,18 @@ class ExecutionEngine {
                         SortExecutor* sort = New(SortExecutor, ctx.arena_, &ctx, op, child);
                         return sort;
                     } break;
+                case LIMIT: 
+                    {
+                        LimitOperation* op = reinterpret_cast<LimitOperation*>(logical_plan);
+                        Executor* child = buildExecutionPlan(ctx, op->child_);
+                        if(op->child_->distinct_) {
+                            DistinctExecutor* dis = New(DistinctExecutor, ctx.arena_, &ctx, child);
+                            dis->sorted_input_ = sorted_on_all_columns(op->child_, child);
+                            child = dis;
+                        }
+                        LimitExecutor* limit = New(LimitExecutor, ctx.arena_, &ctx, op, child);
+                        return limit;
+                    } break;
                 case PROJECTION: 
                     {
                         ProjectionOperation* op = reinterpret_cast<ProjectionOperation*>(logical_plan);
@@ -201,6 +252,16 @@ class ExecutionEngine {
                         Executor* scan = nullptr;
                         if(op->scan_type_ == SEQ_SCAN){
                             scan = New(SeqScanExecutor, ctx.arena_, &ctx, op, new_output_schema);
+                        } else if(op->scan_type_ == RID_SET_SCAN){
+                            Vector<IndexScanExecutor*> index_scans;
+                            for(int i = 0; i < op->rid_scans_.size(); ++i){
+                                index_scans.push_back(New(IndexScanExecutor, ctx.arena_, &ctx, op->rid_scans_[i],
+                                            new_output_schema, catalog_->get_index_header(op->rid_scans_[i]->index_name_)));
+                            }
+                            scan = New(RidSetScanExecutor, ctx.arena_, &ctx, op, new_output_schema, index_scans);
+                        } else if(op->scan_type_ == LOOSE_INDEX_SCAN){
+                            scan = New(LooseIndexScanExecutor, ctx.arena_, &ctx, op,
+                                    new_output_schema, catalog_->get_index_header(op->index_name_));
                         } else {
                             scan = New(IndexScanExecutor, ctx.arena_, &ctx, op,
                                     new_output_schema, catalog_->get_index_header(op->index_name_));
@@ -219,12 +280,31 @@ class ExecutionEngine {
                     {
                         auto op = reinterpret_cast<JoinOperation*>(logical_plan);
                         JoinAlgorithm join_algo = op->join_algo_;
-                        Executor* lhs = buildExecutionPlan(ctx, op->lhs_);
+                        if(join_algo == INDEX_NESTED_LOOP_JOIN){
+                            AlgebraOperation* outer_op = op->index_inner_left_ ? op->rhs_ : op->lhs_;
+                            AlgebraOperation* inner_op = op->index_inner_left_ ? op->lhs_ : op->rhs_;
+                            assert(inner_op->type_ == SCAN && ((ScanOperation*)inner_op)->scan_type_ == INDEX_SCAN);
+                            Executor* outer = buildExecutionPlan(ctx, outer_op);
+                            Executor* inner = buildExecutionPlan(ctx, inner_op);
+                            if(!outer || !inner) return nullptr;
+                            IndexNestedLoopJoinExecutor* join = New(IndexNestedLoopJoinExecutor, ctx.arena_, &ctx, op, 
+                                    outer, (IndexScanExecutor*)inner, op->index_inner_left_);
+                            return join;
+                        }
+                        Executor* lhs = nullptr;
+                        // the build side of a semi join is the plan of its sub-query, all plans are created by now.
+                        if(op->semi_query_idx_ != -1) 
+                            lhs = buildExecutionPlan(ctx, ctx.operators_call_stack_[op->semi_query_idx_]);
+                        else 
+                            lhs = buildExecutionPlan(ctx, op->lhs_);
                         Executor* rhs = buildExecutionPlan(ctx, op->rhs_);
                         if(join_algo == NESTED_LOOP_JOIN){
                             NestedLoopJoinExecutor* join = New(NestedLoopJoinExecutor, ctx.arena_, &ctx, op, lhs, rhs);
                             return join;
 
+                        } else if(join_algo == MERGE_JOIN){
+                            MergeJoinExecutor* join = New(MergeJoinExecutor, ctx.arena_, &ctx, op, lhs, rhs);
+                            return join;
                         } else {
                             HashJoinExecutor* join = New(HashJoinExecutor, ctx.arena_, &ctx, op, lhs, rhs);
                             return join;
@@ -255,12 +335,7 @@ class ExecutionEngine {
                             
                             UnionExecutor* un = New(UnionExecutor, ctx.arena_, &ctx, op, lhs, rhs);
 
-                            // TODO: don't use an extra distinct executor for the all = false case, 
-                            // Use a built-in hashtable inside of the set-operation executor instead.
-                            if(op->all_ == false) {
-                                DistinctExecutor* dis = New(DistinctExecutor, ctx.arena_, &ctx, un);
-                                return dis;
-                            }
+                            // without ALL the duplicates are dropped by the set table of the executor.
                             return un;
                         } else if(logical_plan->type_ == AL_EXCEPT) {
                             ExceptOperation* op = reinterpret_cast<ExceptOperation*>(logical_plan);
@@ -279,13 +354,12 @@ class ExecutionEngine {
                                 rhs = ctx.executors_call_stack_[op->rhs_->query_idx_];
                             // TODO: check that lhs and rhs have the same schema.
                             ExceptExecutor* ex = New(ExceptExecutor, ctx.arena_, &ctx, op, lhs, rhs);
-
-                            // TODO: don't use an extra distinct executor for the all = false case, 
-                            // Use a built-in hashtable inside of the set-operation executor instead.
-                            if(op->all_ == false) {
-                                DistinctExecutor* dis = New(DistinctExecutor, ctx.arena_, &ctx, ex);
-                                return dis;
+                            if(can_merge_set_inputs(op->lhs_, lhs, op->rhs_, rhs)) {
+                                ex->merge_cols_ = op->lhs_->sorted_by_;
+                                ex->merge_desc_ = op->lhs_->sorted_desc_;
                             }
+
+                            // without ALL the duplicates are dropped by the set table of the executor.
                             return ex;
                         } else {
                             IntersectOperation* op = reinterpret_cast<IntersectOperation*>(logical_plan);
@@ -305,13 +379,12 @@ class ExecutionEngine {
                                 rhs = ctx.executors_call_stack_[op->rhs_->query_idx_];
                             // TODO: check that lhs and rhs have the same schema.
                             IntersectExecutor* intersect = New(IntersectExecutor, ctx.arena_, &ctx, op, lhs, rhs);
-
-                            // TODO: don't use an extra distinct executor for the all = false case, 
-                            // Use a built-in hashtable inside of the set-operation executor instead.
-                            if(op->all_ == false) {
-                                DistinctExecutor* dis = New(DistinctExecutor, ctx.arena_, &ctx, intersect);
-                                return dis;
+                            if(can_merge_set_inputs(op->lhs_, lhs, op->rhs_, rhs)) {
+                                intersect->merge_cols_ = op->lhs_->sorted_by_;
+                                intersect->merge_desc_ = op->lhs_->sorted_desc_;
                             }
+
+                            // without ALL the duplicates are dropped by the set table of the executor.
                             return intersect;
                         }
                     } break;
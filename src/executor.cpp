@@ -3,6 +3,11 @@
 #include "catalog.cpp"
 #include "string"
 #include "tuple.cpp"
+#include "join_hash_table.cpp"
+#include "agg_hash_table.cpp"
+#include "sort_key.cpp"
+#include "subquery_cache.cpp"
+#include "set_hash_table.cpp"
 #include <expression.h>
 
 struct QueryCTX;
@@ -41,6 +46,135 @@ Executor::Executor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Tab
     //parent_query_idx_ = ctx->queries_call_stack_[query_idx_]->parent_idx_;
 }
 
+// copies the variable length part of a value that has to outlive the memory it points to.
+Value copy_var_len_value(Arena* arena, Value v) {
+    if(v.type_ == OVERFLOW_ITERATOR) {
+        OverflowIterator* it = (OverflowIterator*) arena->alloc(sizeof(OverflowIterator));
+        *it = **((OverflowIterator**) v.get_ptr());
+        return Value((char*)it, OVERFLOW_ITERATOR, v.size_);
+    }
+    return v.get_copy(arena);
+}
+
+// large text values are read from their overflow pages into the temp arena so they can be hashed and compared.
+static Value materialize_value(Arena* arena, Value v) {
+    if(v.type_ != OVERFLOW_ITERATOR) return v;
+    return Value(v.getStringView(arena));
+}
+
+// the row itself unless it has overflow values, then a copy of it with those values materialized.
+static Tuple materialize_row(Arena* arena, const Tuple& row) {
+    Tuple out = row;
+    for(u32 i = 0; i < row.size(); ++i){
+        if(row.values_[i].type_ != OVERFLOW_ITERATOR) continue;
+        if(out.values_ == row.values_) {
+            out = Tuple(arena);
+            out.resize(row.size());
+            for(u32 j = 0; j < row.size(); ++j)
+                out.values_[j] = row.values_[j];
+        }
+        out.values_[i] = materialize_value(arena, row.values_[i]);
+    }
+    return out;
+}
+
+void RowBatch::init(QueryCTX* ctx) {
+    ctx_ = ctx;
+    arena_ = ALLOCATE(ctx_->arena_, Arena);
+    new(arena_) Arena();
+    arena_->init();
+    ctx_->batch_arenas_.push_back(arena_);
+    rids_ = (RecordID*) ctx_->arena_.alloc(sizeof(RecordID) * BATCH_SIZE);
+    sel_  = (u16*) ctx_->arena_.alloc(sizeof(u16) * BATCH_SIZE);
+}
+
+void RowBatch::reset() {
+    count_ = 0;
+    sel_count_ = 0;
+    arena_->clear();
+}
+
+bool RowBatch::is_full() {
+    return count_ >= capacity_ || count_ >= BATCH_SIZE;
+}
+
+u32 RowBatch::size() {
+    return sel_count_;
+}
+
+void RowBatch::append(const Tuple& t, bool deep_copy) {
+    assert(count_ < BATCH_SIZE);
+    if(count_ == 0 && width_ != t.size()) {
+        // the column vectors are kept across refills and only grow.
+        if(t.size() > max_width_) {
+            Value** columns = (Value**) ctx_->arena_.alloc(sizeof(Value*) * t.size());
+            for(u32 c = 0; c < max_width_; ++c) columns[c] = columns_[c];
+            for(u32 c = max_width_; c < t.size(); ++c)
+                columns[c] = (Value*) ctx_->arena_.alloc(sizeof(Value) * BATCH_SIZE);
+            columns_ = columns;
+            max_width_ = t.size();
+        }
+        width_ = t.size();
+    }
+    assert(width_ == t.size());
+    for(u32 c = 0; c < width_; ++c)
+        columns_[c][count_] = deep_copy ? copy_var_len_value(arena_, t.values_[c]) : t.values_[c];
+    rids_[count_] = t.left_most_rid_;
+    sel_[sel_count_++] = count_++;
+}
+
+void RowBatch::get_row(u32 i, Tuple* out) {
+    assert(i < sel_count_);
+    if(out->size() != width_) out->resize(width_);
+    u16 r = sel_[i];
+    for(u32 c = 0; c < width_; ++c)
+        out->values_[c] = columns_[c][r];
+    out->left_most_rid_ = rids_[r];
+}
+
+Value& RowBatch::at(u32 col, u32 i) {
+    assert(col < width_ && i < sel_count_);
+    return columns_[col][sel_[i]];
+}
+
+bool Executor::next_batch(RowBatch* batch) {
+    batch->reset();
+    while(!batch->is_full() && !error_status_ && !finished_){
+        Tuple t = next();
+        if(error_status_ || t.is_empty()) break;
+        batch->append(t, true);
+    }
+    if(error_status_ || batch->size() == 0) {
+        finished_ = true;
+        return false;
+    }
+    return true;
+}
+
+Tuple Executor::next_from_batch() {
+    if(error_status_ || finished_) return {};
+    if(!row_batch_) {
+        row_batch_ = ALLOCATE(ctx_->arena_, RowBatch);
+        new(row_batch_) RowBatch();
+        row_batch_->init(ctx_);
+        row_batch_->capacity_ = 1;
+    }
+    if(row_batch_pos_ >= row_batch_->size()) {
+        if(!next_batch(row_batch_)) return {};
+        row_batch_pos_ = 0;
+        row_batch_->capacity_ = std::min<u32>(row_batch_->capacity_ * 2, BATCH_SIZE);
+    }
+    row_batch_->get_row(row_batch_pos_++, &output_);
+    return output_;
+}
+
+void Executor::reset_batch() {
+    row_batch_pos_ = 0;
+    if(!row_batch_) return;
+    row_batch_->reset();
+    row_batch_->capacity_ = 1;
+}
+
 NestedLoopJoinExecutor::NestedLoopJoinExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs):
     Executor(arena, ctx, plan_node, nullptr, nullptr, NESTED_LOOP_JOIN_EXECUTOR),
     left_child_(lhs), right_child_(rhs), left_output_(Tuple(arena))
@@ -208,10 +342,317 @@ Tuple ProductExecutor::next() {
     return output_;
 }
 
+// temp tables of the executors that run out of memory, each row is stored as one serialized text value.
+TableSchema* new_spill_table(QueryCTX* ctx) {
+    assert(ctx->catalog_);
+    Vector<Column> columns;
+    columns.emplace_back(str_lit("row"), VARCHAR, 0);
+    TableSchema tmp(&ctx->arena_, str_lit("SPILL"), nullptr, columns, true);
+    TableSchema* table = ctx->catalog_->create_temp_table(ctx, &tmp);
+    if(table) ctx->temp_tables_.push_back(table);
+    return table;
+}
+
+void drop_spill_table(QueryCTX* ctx, TableSchema* table) {
+    if(!table) return;
+    for(int i = 0; i < ctx->temp_tables_.size(); ++i){
+        if(ctx->temp_tables_[i] != table) continue;
+        ctx->temp_tables_.erase(ctx->temp_tables_.begin() + i);
+        ctx->catalog_->delete_temp_table(table);
+        return;
+    }
+}
+
+// return non 0 value in case of an error.
+int write_spill_data(QueryCTX* ctx, TableSchema* table, String8 data) {
+    ArenaTemp scratch = ctx->temp_arena_.start_temp_arena();
+    Tuple record(&ctx->temp_arena_);
+    record.resize(1);
+    record.put_val_at(0, Value(data));
+    RecordID rid;
+    int err = table->insert(ctx->temp_arena_, record, &rid);
+    ctx->temp_arena_.clear_temp_arena(scratch);
+    return err;
+}
+
+int write_spill_row(QueryCTX* ctx, TableSchema* table, const Tuple& row) {
+    ArenaTemp scratch = ctx->temp_arena_.start_temp_arena();
+    int err = write_spill_data(ctx, table, row.serialize(&ctx->temp_arena_));
+    ctx->temp_arena_.clear_temp_arena(scratch);
+    return err;
+}
+
+// the data of the current row of the iterator copied into the arena, str_ is nullptr in case of an error.
+String8 read_spill_data(TableIterator* it, Arena* arena) {
+    Tuple record;
+    if(it->getCurTupleCpy(*arena, &record)) return {};
+    return record.get_val_at(0).getStringView(arena);
+}
+
+// reads the current row of the iterator into out, the values live in the arena.
+// return non 0 value in case of an error.
+int read_spill_row(TableIterator* it, Arena* arena, Tuple* out) {
+    String8 data = read_spill_data(it, arena);
+    if(!data.str_) return 1;
+    *out = Tuple(arena);
+    return out->deserialize(data);
+}
+
+SetOpState::SetOpState(Arena* arena):
+    table_(arena), partitions_(arena), pending_(arena)
+{}
+
+void SetOpState::init(QueryCTX* ctx, SetOpType type, bool all) {
+    ctx_ = ctx;
+    type_ = type;
+    all_ = all;
+    error_status_ = false;
+    // the temp tables of a previous run (re-evaluated sub-queries).
+    spill_it_.destroy();
+    for(int i = 0; i < partitions_.size(); ++i)
+        pending_.push_back(partitions_[i]);
+    pending_.push_back(current_);
+    for(int i = 0; i < pending_.size(); ++i){
+        drop_spill_table(ctx_, pending_[i].build_);
+        drop_spill_table(ctx_, pending_[i].probe_);
+    }
+    partitions_.clear();
+    pending_.clear();
+    current_ = JoinPartition();
+    reading_partition_ = false;
+    level_ = 0;
+    frozen_ = false;
+    table_.clear();
+
+    if(!table_arena_) {
+        Arena** arenas[] = {&table_arena_, &spill_arena_};
+        for(int i = 0; i < 2; ++i){
+            *arenas[i] = ALLOCATE(ctx_->arena_, Arena);
+            new(*arenas[i]) Arena();
+            (*arenas[i])->init();
+            ctx_->batch_arenas_.push_back(*arenas[i]);
+        }
+    }
+    table_arena_->clear();
+}
+
+bool SetOpState::over_budget() {
+    // the last level is kept in memory whatever its size (usually a few rows that are repeated a lot).
+    return level_ < SET_MAX_LEVEL && table_arena_->alloc_pos_ + table_.memory_usage() > ctx_->work_mem_;
+}
+
+void SetOpState::freeze() {
+    frozen_ = true;
+    partitions_.assign(HASH_JOIN_FANOUT, JoinPartition());
+    for(int i = 0; i < partitions_.size(); ++i)
+        partitions_[i].level_ = level_ + 1;
+}
+
+void SetOpState::spill_row(u64 hash, bool build_side, const Tuple& row) {
+    JoinPartition& part = partitions_[join_partition_of(hash, level_)];
+    TableSchema** table = build_side ? &part.build_ : &part.probe_;
+    if(!*table) *table = new_spill_table(ctx_);
+    if(!*table || write_spill_row(ctx_, *table, row))
+        error_status_ = true;
+}
+
+void SetOpState::build(const Tuple& row) {
+    ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+    Tuple key = materialize_row(&ctx_->temp_arena_, row);
+    u64 hash = set_row_hash(key);
+    u32 e = table_.find(key, hash);
+    if(e != SET_NO_ENTRY) {
+        table_.entries_[e].count_++;
+    } else if(frozen_) {
+        spill_row(hash, true, key);
+    } else {
+        e = table_.insert(table_arena_, key, hash);
+        table_.entries_[e].count_ = 1;
+        if(over_budget()) freeze();
+    }
+    ctx_->temp_arena_.clear_temp_arena(scratch);
+}
+
+bool SetOpState::probe(const Tuple& row) {
+    ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+    Tuple key = materialize_row(&ctx_->temp_arena_, row);
+    u64 hash = set_row_hash(key);
+    u32 e = table_.find(key, hash);
+    bool output = false;
+    if(e != SET_NO_ENTRY) {
+        SetEntry& entry = table_.entries_[e];
+        if(type_ == SET_INTERSECT && entry.count_ > 0 && (all_ || !entry.emitted_)) {
+            if(all_) entry.count_--;
+            output = entry.emitted_ = true;
+        } else if(type_ == SET_EXCEPT && all_ && entry.count_ > 0) {
+            entry.count_--;
+        } else if(type_ == SET_EXCEPT && entry.count_ == 0 && (all_ || !entry.emitted_)) {
+            output = entry.emitted_ = true;
+        }
+    } else if(frozen_) {
+        // without right rows in its partition the row is decided right away, unless it has to be checked for duplicates.
+        bool no_build = !partitions_[join_partition_of(hash, level_)].build_;
+        if(type_ == SET_EXCEPT && all_ && no_build) output = true;
+        else if(type_ != SET_INTERSECT || !no_build) spill_row(hash, false, key);
+    } else if(type_ == SET_DISTINCT || (type_ == SET_EXCEPT && !all_)) {
+        table_.entries_[table_.insert(table_arena_, key, hash)].emitted_ = true;
+        output = true;
+        if(over_budget()) freeze();
+    } else {
+        output = type_ == SET_EXCEPT;
+    }
+    ctx_->temp_arena_.clear_temp_arena(scratch);
+    return output;
+}
+
+bool SetOpState::load_partition() {
+    // the partitions of the finished level are processed before the ones that are already pending.
+    for(int i = 0; i < partitions_.size(); ++i){
+        if(partitions_[i].build_ || partitions_[i].probe_) pending_.push_back(partitions_[i]);
+    }
+    partitions_.clear();
+    frozen_ = false;
+    while(!error_status_ && pending_.size()){
+        JoinPartition part = pending_.back();
+        pending_.pop_back();
+        // the output rows all come from the probe side, INTERSECT also needs build rows to match them.
+        if(!part.probe_ || (type_ == SET_INTERSECT && !part.build_)) {
+            drop_spill_table(ctx_, part.build_);
+            drop_spill_table(ctx_, part.probe_);
+            continue;
+        }
+        level_ = part.level_;
+        table_.clear();
+        table_arena_->clear();
+        if(part.build_) {
+            TableIterator it = part.build_->begin();
+            it.init();
+            Tuple row;
+            while(!error_status_ && it.advance()){
+                spill_arena_->clear();
+                if(read_spill_row(&it, spill_arena_, &row)) {
+                    error_status_ = true;
+                    break;
+                }
+                build(row);
+            }
+            it.destroy();
+            drop_spill_table(ctx_, part.build_);
+            part.build_ = nullptr;
+        }
+        if(error_status_) {
+            drop_spill_table(ctx_, part.probe_);
+            return false;
+        }
+        current_ = part;
+        reading_partition_ = true;
+        spill_it_ = current_.probe_->begin();
+        spill_it_.init();
+        ctx_->table_handles_.push_back(&spill_it_);
+        return true;
+    }
+    return false;
+}
+
+bool SetOpState::next_spilled(Tuple* out) {
+    while(!error_status_){
+        if(reading_partition_) {
+            spill_arena_->clear();
+            if(spill_it_.advance()) {
+                if(read_spill_row(&spill_it_, spill_arena_, out)) {
+                    error_status_ = true;
+                    break;
+                }
+                if(probe(*out)) return true;
+                continue;
+            }
+            spill_it_.destroy();
+            drop_spill_table(ctx_, current_.probe_);
+            current_ = JoinPartition();
+            reading_partition_ = false;
+        }
+        if(!load_partition()) break;
+    }
+    return false;
+}
+
+void SetMergeState::init(QueryCTX* ctx, SetOpType type, bool all, Vector<int>* cols, Vector<bool>* desc) {
+    ctx_ = ctx;
+    type_ = type;
+    all_ = all;
+    cols_ = cols;
+    desc_ = desc;
+    error_status_ = false;
+    has_left_ = has_right_ = has_last_ = false;
+    right_done_ = false;
+    if(!left_arena_) {
+        Arena** arenas[] = {&left_arena_, &right_arena_, &last_arena_};
+        for(int i = 0; i < 3; ++i){
+            *arenas[i] = ALLOCATE(ctx_->arena_, Arena);
+            new(*arenas[i]) Arena();
+            (*arenas[i])->init();
+            ctx_->batch_arenas_.push_back(*arenas[i]);
+        }
+    }
+}
+
+bool SetMergeState::read_row(Executor* child, Arena* arena, Tuple* row, String8* key) {
+    arena->clear();
+    Tuple t = child->next();
+    if(child->error_status_) {
+        error_status_ = true;
+        return false;
+    }
+    if(t.is_empty()) return false;
+    *row = materialize_row(arena, t).duplicate(arena);
+    *key = build_sort_key(arena, *row, *cols_, *desc_);
+    return true;
+}
+
+bool SetMergeState::next(Executor* left_child, Executor* right_child, Tuple* out) {
+    while(!error_status_){
+        // nothing is left to intersect with.
+        if(right_done_ && type_ == SET_INTERSECT) return false;
+        if(!has_left_ && !read_row(left_child, left_arena_, &left_row_, &left_key_)) return false;
+        has_left_ = true;
+        // skip the right rows that are smaller than the left row.
+        int cmp = -1;
+        while(!right_done_){
+            if(!has_right_ && !read_row(right_child, right_arena_, &right_row_, &right_key_)) {
+                right_done_ = true;
+                break;
+            }
+            has_right_ = true;
+            cmp = sort_key_cmp(left_key_, right_key_);
+            if(cmp <= 0) break;
+            has_right_ = false;
+        }
+        if(error_status_) return false;
+        if(right_done_) cmp = -1;
+        // the left row is consumed either way, ALL consumes one equal right row for every equal left row.
+        has_left_ = false;
+        if(cmp == 0 && all_) has_right_ = false;
+        bool output = (cmp == 0) == (type_ == SET_INTERSECT);
+        if(!output) continue;
+        if(!all_) {
+            if(has_last_ && sort_key_cmp(left_key_, last_key_) == 0) continue;
+            last_arena_->clear();
+            last_key_ = str_alloc(last_arena_, left_key_.size_);
+            memcpy(last_key_.str_, left_key_.str_, left_key_.size_);
+            has_last_ = true;
+        }
+        *out = left_row_;
+        return true;
+    }
+    return false;
+}
+
 HashJoinExecutor::HashJoinExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs):
     Executor(arena, ctx, plan_node, nullptr, nullptr, HASH_JOIN_EXECUTOR),
     left_child_(lhs), right_child_(rhs), 
-    left_child_fields_(arena), right_child_fields_(arena)
+    probe_row_(arena), joined_(arena),
+    left_child_fields_(arena), right_child_fields_(arena), hash_table_(arena),
+    partitions_(arena), pending_(arena)
 {
     assert(plan_node != nullptr && plan_node->type_ == JOIN);
     //type_ = HASH_JOIN_EXECUTOR;
@@ -230,8 +671,12 @@ HashJoinExecutor::HashJoinExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation
     for(int i = 0; i < rhs_columns.size(); i++)
         lhs_columns.push_back(rhs_columns[i]);
 
-    output_schema_ = New(TableSchema, ctx_->arena_, str_lit("TMP_JOIN_TABLE"), nullptr, lhs_columns, true);
+    joined_schema_ = New(TableSchema, ctx_->arena_, str_lit("TMP_JOIN_TABLE"), nullptr, lhs_columns, true);
+    output_schema_ = joined_schema_;
+    if(join_type_ == SEMI_JOIN || join_type_ == ANTI_JOIN)
+        output_schema_ = rhs->output_schema_;
     output_.resize(output_schema_->numOfCols());
+    joined_.resize(joined_schema_->numOfCols());
 }
 
 void HashJoinExecutor::init() {
@@ -241,13 +686,12 @@ void HashJoinExecutor::init() {
         error_status_ = true;
         return;
     }
-    auto cur_filter = ((JoinOperation*)plan_node_)->filter_;
-
-    left_child_->init();
-    right_child_->init();
+    JoinOperation* op = (JoinOperation*)plan_node_;
+    auto cur_filter = op->filter_;
 
-    if(!filter_){
-        assign_schema_to_fields(ctx_, plan_node_->query_idx_, cur_filter, output_schema_);
+    // semi joins of IN (sub-query) have no filter, only their key.
+    if(!filter_ && cur_filter){
+        assign_schema_to_fields(ctx_, plan_node_->query_idx_, cur_filter, joined_schema_);
         auto tmp_flat_filter = ALLOCATE(ctx_->arena_, FlatExpr);
         new(tmp_flat_filter) FlatExpr();
         tmp_flat_filter->query_idx_ = plan_node_->query_idx_;
@@ -255,19 +699,62 @@ void HashJoinExecutor::init() {
         filter_ = tmp_flat_filter;
     }
 
+    right_child_->init();
+    reset_batch();
+    probe_pos_ = 0;
+    probe_done_ = false;
+    chain_pos_ = JOIN_NO_ROW;
+    has_probe_row_ = false;
+    probe_matched_ = false;
+    unmatched_pos_ = 0;
+    if(build_cached_) {
+        probe_batch_->reset();
+        error_status_ = right_child_->error_status_;
+        finished_ = 0;
+        return;
+    }
 
-
+    left_child_->init();
     error_status_ = left_child_->error_status_ || right_child_->error_status_;
     finished_ = left_child_->finished_;
-    prev_key_ = {};
-    duplicated_idx_ = -1;
-    hashed_left_child_.clear();
-    non_visited_left_keys_.clear();
+    build_rows_ = 0;
+    build_has_null_ = false;
+    hash_table_.clear();
     right_child_fields_.clear();
     left_child_fields_.clear();
+    // the temp tables of a previous run (re-evaluated sub-queries).
+    spill_it_.destroy();
+    for(int i = 0; i < partitions_.size(); ++i)
+        pending_.push_back(partitions_[i]);
+    pending_.push_back(current_);
+    for(int i = 0; i < pending_.size(); ++i){
+        drop_spill_table(ctx_, pending_[i].build_);
+        drop_spill_table(ctx_, pending_[i].probe_);
+    }
+    partitions_.clear();
+    pending_.clear();
+    current_ = JoinPartition();
+    reading_partition_ = false;
+    spilled_ = false;
+    resident_ = false;
     // find out which attributes to use as keys for the hash table.
+    // a conjunct of a split where clause is only the first operand of its AND node,
+    // the conditions of unnested sub-queries are AND chains that start with their key.
+    ASTNode* key_cond = cur_filter;
+    while(key_cond && key_cond->category_ == EXPRESSION) key_cond = ((ExpressionNode*)key_cond)->cur_;
+    if(key_cond && key_cond->category_ == AND) key_cond = ((AndNode*)key_cond)->cur_;
     Vector<FieldNode*> fields;
-    accessed_fields(cur_filter, fields);
+    accessed_fields(key_cond, fields);
+    // x IN (sub-query): the only column of the sub-query = x.
+    if(op->semi_key_) {
+        left_child_fields_.push_back(0);
+        FieldNode* key = op->semi_key_;
+        right_child_fields_.push_back(right_child_->output_schema_->col_exist(key->token_.val_, key->table_name_->token_.val_));
+        if(left_child_->output_schema_->numOfCols() != 1 || right_child_fields_[0] == -1) {
+            error_status_ = 1;
+            return;
+        }
+    }
 
     for(int i = 0; i < fields.size(); ++i) {
         int idx = left_child_->output_schema_->col_exist(fields[i]->token_.val_, fields[i]->table_name_->token_.val_);
@@ -294,165 +781,820 @@ void HashJoinExecutor::init() {
         error_status_ = 1;
         return;
     }
+    if(!build_batch_) {
+        build_batch_ = ALLOCATE(ctx_->arena_, RowBatch);
+        new(build_batch_) RowBatch();
+        build_batch_->init(ctx_);
+        probe_batch_ = ALLOCATE(ctx_->arena_, RowBatch);
+        new(probe_batch_) RowBatch();
+        probe_batch_->init(ctx_);
+        Arena** arenas[] = {&build_arena_, &spare_arena_, &spill_arena_};
+        for(int i = 0; i < 3; ++i){
+            *arenas[i] = ALLOCATE(ctx_->arena_, Arena);
+            new(*arenas[i]) Arena();
+            (*arenas[i])->init();
+            ctx_->batch_arenas_.push_back(*arenas[i]);
+        }
+    }
+    probe_batch_->reset();
+    build_arena_->clear();
     // build the hash table.
-    while(!left_child_->finished_ && !left_child_->error_status_){
-        Tuple left_output = left_child_->next();
-        //Tuple left_output = left_child_->next();
-        if(left_output.is_empty()) continue;
-        left_output = left_output.duplicate(&ctx_->arena_);
-        // build the hash key and assume non-unique keys.
-        String tmp_k = left_output.build_hash_key(left_child_fields_);
-        String8 key = str_alloc(&ctx_->arena_, tmp_k.size());
-        memcpy(key.str_, tmp_k.c_str(), tmp_k.size());
-
-        if(hashed_left_child_.count(key)) 
-            hashed_left_child_[key].push_back(left_output);
-        else {
-            hashed_left_child_[key] = {left_output};
-            non_visited_left_keys_.insert(key);
+    Tuple left_row(&ctx_->arena_);
+    while(!error_status_ && left_child_->next_batch(build_batch_)){
+        for(u32 i = 0; !error_status_ && i < build_batch_->size(); ++i){
+            build_batch_->get_row(i, &left_row);
+            materialize_key_columns(&left_row, left_child_fields_, build_batch_->arena_);
+            bool null_key = false;
+            u64 hash = hash_key_columns(left_row, left_child_fields_, &null_key);
+            ++build_rows_;
+            build_has_null_ = build_has_null_ || null_key;
+            u32 part = join_partition_of(hash, 0);
+            if(spilled_ && (part != 0 || !resident_)) {
+                spill_row(&partitions_[part], true, left_row);
+                continue;
+            }
+            hash_table_.insert(left_row.duplicate(build_arena_), hash, null_key);
+            if(!over_budget()) continue;
+            if(!spilled_) start_spill();
+            else spill_resident();
         }
     }
+    hash_table_.build();
+    if(left_child_->error_status_) error_status_ = 1;
+    // the sub-query does not depend on the outer row, only the probe side changes between runs.
+    build_cached_ = op->semi_query_idx_ != -1 && !spilled_ && !error_status_;
 }
 
-// TODO: implement merge and nested loop joines, 
-// hash join is not good for cases of none equality conditions, and full outer joins.
-Tuple HashJoinExecutor::next() {
-    if(error_status_ || finished_)  return {};
+bool HashJoinExecutor::over_budget() {
+    return build_arena_->alloc_pos_ + hash_table_.size() * sizeof(JoinRow) > ctx_->work_mem_;
+}
 
-    while(!right_child_->finished_){
-        if(duplicated_idx_ != -1){
-            duplicated_idx_++;
-            // no need to change the right output.
-            output_.put_tuple_at_start(&hashed_left_child_[prev_key_][duplicated_idx_]);
-
-            if(duplicated_idx_+1 >= hashed_left_child_[prev_key_].size())
-                duplicated_idx_ = -1;
-            //finished_ = right_child_->finished_ && duplicated_idx_ == -1;
-            Value v = evaluate_flat_expression(ctx_, *filter_, output_);
-            if(!v.isNull() && v.getBoolVal() == true)
-                return output_;
+void HashJoinExecutor::spill_row(JoinPartition* part, bool build_side, const Tuple& row) {
+    TableSchema** table = build_side ? &part->build_ : &part->probe_;
+    if(!*table) *table = new_spill_table(ctx_);
+    if(!*table || write_spill_row(ctx_, *table, row))
+        error_status_ = 1;
+}
+
+// the build side does not fit in memory, keep partition 0 and write the rest of the rows to their partitions.
+void HashJoinExecutor::start_spill() {
+    spilled_ = true;
+    resident_ = true;
+    partitions_.assign(HASH_JOIN_FANOUT, JoinPartition());
+    spare_arena_->clear();
+    u32 kept = 0;
+    for(u32 r = 0; r < hash_table_.size(); ++r){
+        JoinRow row = hash_table_.rows_[r];
+        u32 part = join_partition_of(row.hash_, 0);
+        if(part != 0) {
+            spill_row(&partitions_[part], true, row.tuple_);
             continue;
         }
+        row.tuple_ = row.tuple_.duplicate(spare_arena_);
+        hash_table_.rows_[kept++] = row;
+    }
+    hash_table_.rows_.resize(kept);
+    std::swap(build_arena_, spare_arena_);
+    spare_arena_->clear();
+    if(over_budget()) spill_resident();
+}
 
-        Tuple right_output;
-        while(true){
-            right_output = right_child_->next();
-            //right_output = right_child_->next();
-            if(right_output.is_empty()) {
-                //finished_ = true;
-                //return {};
+// partition 0 does not fit either, nothing is joined in memory while reading the inputs.
+void HashJoinExecutor::spill_resident() {
+    for(u32 r = 0; r < hash_table_.size(); ++r)
+        spill_row(&partitions_[0], true, hash_table_.rows_[r].tuple_);
+    hash_table_.clear();
+    build_arena_->clear();
+    resident_ = false;
+}
+
+// splits a partition that does not fit in memory into the partitions of the next level.
+void HashJoinExecutor::repartition(JoinPartition part) {
+    hash_table_.clear();
+    build_arena_->clear();
+    Vector<JoinPartition> children(HASH_JOIN_FANOUT, JoinPartition(), &ctx_->temp_arena_);
+    for(int side = 0; side < 2; ++side){
+        TableSchema* table = side == 0 ? part.build_ : part.probe_;
+        Vector<int>& key_fields = side == 0 ? left_child_fields_ : right_child_fields_;
+        if(!table) continue;
+        TableIterator it = table->begin();
+        it.init();
+        Tuple row;
+        while(!error_status_ && it.advance()){
+            spill_arena_->clear();
+            if(read_spill_row(&it, spill_arena_, &row)) {
+                error_status_ = 1;
                 break;
             }
-            right_output = right_output.duplicate(&ctx_->arena_);
+            bool null_key = false;
+            u64 hash = hash_key_columns(row, key_fields, &null_key);
+            spill_row(&children[join_partition_of(hash, part.level_ + 1)], side == 0, row);
+        }
+        it.destroy();
+        drop_spill_table(ctx_, table);
+    }
+    for(int i = 0; i < children.size(); ++i){
+        children[i].level_ = part.level_ + 1;
+        if(children[i].build_ || children[i].probe_) pending_.push_back(children[i]);
+    }
+}
+
+bool HashJoinExecutor::load_partition() {
+    // the first level partitions are joined once the resident partition is done.
+    for(int i = 0; i < partitions_.size(); ++i)
+        pending_.push_back(partitions_[i]);
+    partitions_.clear();
+    spill_it_.destroy();
+    drop_spill_table(ctx_, current_.probe_);
+    current_ = JoinPartition();
+
+    bool keep_build_rows = (join_type_ == LEFT_JOIN  || join_type_ == FULL_JOIN);
+    bool keep_probe_rows = (join_type_ == RIGHT_JOIN || join_type_ == FULL_JOIN || join_type_ == ANTI_JOIN);
+    while(!error_status_ && pending_.size()){
+        JoinPartition part = pending_.back();
+        pending_.pop_back();
+        // a side without rows can only produce the null extended rows of outer joins.
+        if((!part.build_ && !keep_probe_rows) || (!part.probe_ && !keep_build_rows) || (!part.build_ && !part.probe_)){
+            drop_spill_table(ctx_, part.build_);
+            drop_spill_table(ctx_, part.probe_);
+            continue;
+        }
+        hash_table_.clear();
+        build_arena_->clear();
+        bool fits = true;
+        if(part.build_) {
+            TableIterator it = part.build_->begin();
+            it.init();
+            Tuple row;
+            while(it.advance()){
+                if(read_spill_row(&it, build_arena_, &row)) {
+                    error_status_ = 1;
+                    break;
+                }
+                bool null_key = false;
+                u64 hash = hash_key_columns(row, left_child_fields_, &null_key);
+                hash_table_.insert(row, hash, null_key);
+                if(part.level_ + 1 < HASH_JOIN_MAX_LEVEL && over_budget()) {
+                    fits = false;
+                    break;
+                }
+            }
+            it.destroy();
+        }
+        if(error_status_) return false;
+        if(!fits) {
+            repartition(part);
+            continue;
+        }
+        drop_spill_table(ctx_, part.build_);
+        part.build_ = nullptr;
+        hash_table_.build();
+
+        current_ = part;
+        reading_partition_ = true;
+        probe_done_ = !current_.probe_;
+        chain_pos_ = JOIN_NO_ROW;
+        has_probe_row_ = false;
+        probe_matched_ = false;
+        unmatched_pos_ = 0;
+        if(current_.probe_) {
+            spill_it_ = current_.probe_->begin();
+            spill_it_.init();
+            ctx_->table_handles_.push_back(&spill_it_);
+        }
+        return true;
+    }
+    return false;
+}
 
-            String tmp_k = right_output.build_hash_key(right_child_fields_);
-            String8 key = str_alloc(&ctx_->arena_, tmp_k.size());
-            memcpy(key.str_, tmp_k.c_str(), tmp_k.size());
+Tuple HashJoinExecutor::next() {
+    return next_from_batch();
+}
 
-            if(!hashed_left_child_.count(key) && (join_type_ == RIGHT_JOIN || join_type_ == FULL_JOIN)){
-                int start = output_.size()-right_output.size();
-                output_.nullify(0, start);
-                output_.put_tuple_at_end(&right_output);
-                return output_;
-            } else if(!hashed_left_child_.count(key)){
-                continue;
+bool HashJoinExecutor::next_batch(RowBatch* batch) {
+    batch->reset();
+    if(error_status_ || finished_) return false;
+    probe_batch_->capacity_ = batch->capacity_;
+    ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+    while(!batch->is_full()){
+        Tuple t = join_next();
+        if(error_status_ || t.is_empty()) break;
+        batch->append(t, true);
+        ctx_->temp_arena_.clear_temp_arena(scratch);
+    }
+    if(error_status_ || batch->size() == 0) {
+        finished_ = true;
+        return false;
+    }
+    return true;
+}
+
+// the next probe row with its key hash in probe_hash_, it stays valid until the next call.
+// while the build side is spilled the probe rows of the spilled partitions are written to their temp tables.
+Tuple HashJoinExecutor::probe_next() {
+    while(!probe_done_ && !error_status_) {
+        if(reading_partition_) {
+            spill_arena_->clear();
+            if(!spill_it_.advance()) {
+                probe_done_ = true;
+                break;
+            }
+            if(read_spill_row(&spill_it_, spill_arena_, &probe_row_)) {
+                error_status_ = 1;
+                break;
             }
-            // this key is now visited so no need to count it for left joins.
-            if(non_visited_left_keys_.count(key)) non_visited_left_keys_.erase(key);
+        } else {
+            if(probe_pos_ >= probe_batch_->size()) {
+                if(!right_child_->next_batch(probe_batch_)) {
+                    error_status_ = right_child_->error_status_;
+                    probe_done_ = true;
+                    break;
+                }
+                probe_pos_ = 0;
+            }
+            probe_batch_->get_row(probe_pos_++, &probe_row_);
+            materialize_key_columns(&probe_row_, right_child_fields_, probe_batch_->arena_);
+        }
+        bool null_key = false;
+        probe_hash_ = hash_key_columns(probe_row_, right_child_fields_, &null_key);
+        probe_null_key_ = null_key;
+        u32 part = join_partition_of(probe_hash_, 0);
+        if(spilled_ && !reading_partition_ && (part != 0 || !resident_)) {
+            // rows that can't match anything are only kept for right, full and anti joins.
+            if(partitions_[part].build_ || join_type_ == RIGHT_JOIN || join_type_ == FULL_JOIN || join_type_ == ANTI_JOIN)
+                spill_row(&partitions_[part], false, probe_row_);
+            continue;
+        }
+        return probe_row_;
+    }
+    return {};
+}
+
+Tuple HashJoinExecutor::join_next() {
+    while(true) {
+        Tuple t = join_in_memory();
+        if(error_status_ || !t.is_empty()) return t;
+        // the rows in memory are done, move on to the next spilled partition.
+        if(!load_partition()) return {};
+    }
+}
 
-            output_.put_tuple_at_end(&right_output);
+Tuple HashJoinExecutor::join_in_memory() {
+    if(error_status_)  return {};
+    int left_size = left_child_->output_schema_->numOfCols();
 
-            int duplications = hashed_left_child_[key].size();
-            output_.put_tuple_at_start(&hashed_left_child_[key][0]);
-            if(duplications > 1){
-                duplicated_idx_ = 0;
-                prev_key_ = key;
+    while(true){
+        // walk the chain of the current probe row, the key is compared before evaluating the join filter
+        // because different keys may share the same hash.
+        while(chain_pos_ != JOIN_NO_ROW){
+            JoinRow& row = hash_table_.rows_[chain_pos_];
+            chain_pos_ = row.next_;
+            if(row.hash_ != probe_hash_ || !key_columns_eq(row.tuple_, left_child_fields_, probe_row_, right_child_fields_))
+                continue;
+            joined_.put_tuple_at_start(&row.tuple_);
+            if(filter_) {
+                Value v = evaluate_flat_expression(ctx_, *filter_, joined_);
+                if(v.isNull() || v.getBoolVal() != true) continue;
             }
-            break;
+            row.visited_ = true;
+            probe_matched_ = true;
+            if(join_type_ == ANTI_JOIN) break;
+            if(join_type_ == SEMI_JOIN) {
+                // one match is enough.
+                chain_pos_ = JOIN_NO_ROW;
+                has_probe_row_ = false;
+                return probe_row_;
+            }
+            return joined_;
+        }
+        if(has_probe_row_ && !probe_matched_ && (join_type_ == RIGHT_JOIN || join_type_ == FULL_JOIN)){
+            has_probe_row_ = false;
+            joined_.nullify(0, left_size);
+            return joined_;
         }
+        if(has_probe_row_ && !probe_matched_ && join_type_ == ANTI_JOIN){
+            has_probe_row_ = false;
+            chain_pos_ = JOIN_NO_ROW;
+            // x NOT IN (...) is null if x is null or the sub-query has a null, unless the sub-query is empty.
+            bool unknown = (probe_null_key_ || build_has_null_) && build_rows_ != 0;
+            if(!((JoinOperation*)plan_node_)->null_aware_ || !unknown) return probe_row_;
+        }
+        chain_pos_ = JOIN_NO_ROW;
+        has_probe_row_ = false;
+
+        Tuple right_output = probe_next();
         if(right_output.is_empty()) break;
-        // if this is an outer join don't finish yet, 
-        // we still need to look at the non visited left keys.
-        // finished_ = right_child_->finished_ && duplicated_idx_ == -1;
-        Value v = evaluate_flat_expression(ctx_, *filter_, output_);
-        if(!v.isNull() && v.getBoolVal() == true)
-            return output_;
-    }
-    // we got out of the loop but this is not an outer join,
-    // or it is an outer join but all keys were visited, then we are done.
-    if((join_type_ != LEFT_JOIN && join_type_!= FULL_JOIN) || non_visited_left_keys_.size() == 0) {
-        finished_ = true;
-        return {};
+        joined_.put_tuple_at_end(&probe_row_);
+        has_probe_row_ = true;
+        probe_matched_ = false;
+
+        if(probe_null_key_ || !hash_table_.may_contain(probe_hash_)) chain_pos_ = JOIN_NO_ROW;
+        else chain_pos_ = hash_table_.find(probe_hash_);
     }
-    String8 key = *(non_visited_left_keys_.begin());
+    if(error_status_ || (join_type_ != LEFT_JOIN && join_type_!= FULL_JOIN)) return {};
 
-    int duplications = hashed_left_child_[key].size();
-    if(duplicated_idx_ == -1)
-        duplicated_idx_ = 0;
-    output_.put_tuple_at_start(&hashed_left_child_[key][duplicated_idx_]);
-    // TODO: redundent should be done onle once not on every iteration.
-    output_.nullify(hashed_left_child_[key][duplicated_idx_].size(), output_.size());
-    duplicated_idx_++;
-    if(duplicated_idx_ == duplications){
-        non_visited_left_keys_.erase(key);
-        duplicated_idx_ = -1;
+    // the probe side is exhausted, return the build rows that never matched.
+    while(unmatched_pos_ < hash_table_.size()){
+        JoinRow& row = hash_table_.rows_[unmatched_pos_++];
+        if(row.visited_) continue;
+        joined_.put_tuple_at_start(&row.tuple_);
+        joined_.nullify(left_size, joined_.size());
+        return joined_;
     }
-    return output_;
+    return {};
 }
 
-UnionExecutor::UnionExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs):
-    Executor(arena, ctx, plan_node, nullptr, nullptr, UNION_EXECUTOR),
-    left_child_(lhs), right_child_(rhs)
+MergeJoinExecutor::MergeJoinExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs):
+    Executor(arena, ctx, plan_node, nullptr, nullptr, MERGE_JOIN_EXECUTOR),
+    left_child_(lhs), right_child_(rhs),
+    driver_row_(arena), window_row_(arena), joined_(arena), window_(arena)
 {
-    assert(plan_node != nullptr && plan_node->type_ == AL_UNION);
+    assert(plan_node != nullptr && plan_node->type_ == JOIN);
     assert(lhs && rhs);
-    //type_ = UNION_EXECUTOR;
-    //ctx_ = ctx; 
-    //plan_node_ = plan_node;
-    output_schema_ = lhs->output_schema_;
-    //query_idx_ = plan_node->query_idx_;
-    //assert(query_idx_ < ctx->set_operations_.size());
-    //parent_query_idx_ = ctx->set_operations_[query_idx_]->parent_idx_;
-    left_child_  = lhs;
-    right_child_ = rhs;
+    query_idx_ = plan_node->query_idx_;
+    assert(query_idx_ < ctx->queries_call_stack_.size());
+    parent_query_idx_ = ctx->queries_call_stack_[query_idx_]->parent_idx_;
+
+    JoinOperation* op = (JoinOperation*)plan_node_;
+    join_type_ = op->join_type_;
+    driver_left_ = op->merge_driver_left_;
+    driver_child_ = driver_left_ ? lhs : rhs;
+    window_child_ = driver_left_ ? rhs : lhs;
+    bool left_outer  = (join_type_ == LEFT_JOIN  || join_type_ == FULL_JOIN);
+    bool right_outer = (join_type_ == RIGHT_JOIN || join_type_ == FULL_JOIN);
+    driver_outer_ = driver_left_ ? left_outer : right_outer;
+    window_outer_ = driver_left_ ? right_outer : left_outer;
+    lower_inclusive_ = op->merge_lower_inclusive_;
+    upper_inclusive_ = op->merge_upper_inclusive_;
+
+    Vector<Column> lhs_columns = lhs->output_schema_->getColumns();
+    Vector<Column> rhs_columns = rhs->output_schema_->getColumns();
+    for(int i = 0; i < rhs_columns.size(); i++)
+        lhs_columns.push_back(rhs_columns[i]);
+
+    output_schema_ = New(TableSchema, ctx_->arena_, str_lit("TMP_JOIN_TABLE"), nullptr, lhs_columns, true);
     output_.resize(output_schema_->numOfCols());
+    joined_.resize(output_schema_->numOfCols());
 }
 
-void UnionExecutor::init() {
+void MergeJoinExecutor::init() {
     error_status_ = 0;
     finished_ = 0;
     if(!left_child_ || !right_child_){
         error_status_ = true;
         return;
     }
+    JoinOperation* op = (JoinOperation*)plan_node_;
     left_child_->init();
     right_child_->init();
+
+    if(!filter_){
+        FlatExpr** exprs[] = {&filter_, &lower_, &upper_};
+        ASTNode* nodes[] = {op->filter_, op->merge_lower_, op->merge_upper_};
+        for(int i = 0; i < 3; ++i){
+            assign_schema_to_fields(ctx_, plan_node_->query_idx_, nodes[i], output_schema_);
+            *exprs[i] = ALLOCATE(ctx_->arena_, FlatExpr);
+            new(*exprs[i]) FlatExpr();
+            (*exprs[i])->query_idx_ = plan_node_->query_idx_;
+            flatten_expression(ctx_, nodes[i], *exprs[i], false);
+        }
+        FieldNode* driver_key = op->merge_driver_key_;
+        FieldNode* window_key = op->merge_window_key_;
+        driver_key_ = driver_child_->output_schema_->col_exist(driver_key->token_.val_, driver_key->table_name_->token_.val_);
+        window_key_ = window_child_->output_schema_->col_exist(window_key->token_.val_, window_key->table_name_->token_.val_);
+    }
     error_status_ = left_child_->error_status_ || right_child_->error_status_;
-    finished_ = left_child_->finished_ && right_child_->finished_;
+    if(driver_key_ == -1 || window_key_ == -1) error_status_ = 1;
+    if(error_status_) return;
+
+    if(!driver_batch_) {
+        RowBatch** batches[] = {&driver_batch_, &window_batch_};
+        for(int i = 0; i < 2; ++i){
+            *batches[i] = ALLOCATE(ctx_->arena_, RowBatch);
+            new(*batches[i]) RowBatch();
+            (*batches[i])->init(ctx_);
+        }
+        Arena** arenas[] = {&window_arena_, &spare_arena_};
+        for(int i = 0; i < 2; ++i){
+            *arenas[i] = ALLOCATE(ctx_->arena_, Arena);
+            new(*arenas[i]) Arena();
+            (*arenas[i])->init();
+            ctx_->batch_arenas_.push_back(*arenas[i]);
+        }
+    }
+    reset_batch();
+    driver_batch_->reset();
+    window_batch_->reset();
+    driver_pos_ = 0;
+    window_input_pos_ = 0;
+    window_done_ = false;
+    window_.clear();
+    window_start_ = 0;
+    match_pos_ = 0;
+    window_arena_->clear();
+    state_ = MERGE_NEXT_DRIVER;
 }
 
-Tuple UnionExecutor::next() {
-    if(error_status_ || finished_)  return {};
+Tuple MergeJoinExecutor::next() {
+    return next_from_batch();
+}
 
-    if(!left_child_->finished_){
-        output_ = left_child_->next();
-        error_status_ = left_child_->error_status_;
-        if(left_child_->finished_ && output_.is_empty()) {
-            return next();
+bool MergeJoinExecutor::next_batch(RowBatch* batch) {
+    batch->reset();
+    if(error_status_ || finished_) return false;
+    driver_batch_->capacity_ = batch->capacity_;
+    window_batch_->capacity_ = batch->capacity_;
+    ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+    while(!batch->is_full()){
+        Tuple t = join_next();
+        if(error_status_ || t.is_empty()) break;
+        batch->append(t, true);
+        ctx_->temp_arena_.clear_temp_arena(scratch);
+    }
+    if(error_status_ || batch->size() == 0) {
+        finished_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool MergeJoinExecutor::next_driver() {
+    if(driver_pos_ >= driver_batch_->size()) {
+        if(!driver_child_->next_batch(driver_batch_)) {
+            error_status_ = driver_child_->error_status_;
+            return false;
         }
+        driver_pos_ = 0;
     }
-    else if(!right_child_->finished_){
-        output_ = right_child_->next();
-        error_status_ = right_child_->error_status_;
+    driver_batch_->get_row(driver_pos_++, &driver_row_);
+    return true;
+}
+
+bool MergeJoinExecutor::peek_window() {
+    if(window_input_pos_ >= window_batch_->size()) {
+        if(window_done_) return false;
+        if(!window_child_->next_batch(window_batch_)) {
+            error_status_ = window_child_->error_status_;
+            window_done_ = true;
+            return false;
+        }
+        window_input_pos_ = 0;
     }
+    window_batch_->get_row(window_input_pos_, &window_row_);
+    return true;
+}
 
-    finished_ = left_child_->finished_ && right_child_->finished_;
-    return output_;
+void MergeJoinExecutor::compact_window() {
+    spare_arena_->clear();
+    u32 n = 0;
+    for(u32 i = window_start_; i < window_.size(); ++i, ++n){
+        window_[n].tuple_ = window_[i].tuple_.duplicate(spare_arena_);
+        window_[n].visited_ = window_[i].visited_;
+    }
+    window_.resize(n);
+    window_start_ = 0;
+    window_arena_->clear();
+    std::swap(window_arena_, spare_arena_);
 }
 
-ExceptExecutor::ExceptExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs):
+Tuple MergeJoinExecutor::unmatched_window_row(const Tuple& row) {
+    int left_size = left_child_->output_schema_->numOfCols();
+    if(driver_left_) {
+        output_.nullify(0, left_size);
+        output_.put_tuple_at_end(&row);
+    } else {
+        output_.put_tuple_at_start(&row);
+        output_.nullify(left_size, output_.size());
+    }
+    return output_;
+}
+
+Tuple MergeJoinExecutor::join_next() {
+    int left_size = left_child_->output_schema_->numOfCols();
+    while(!error_status_) {
+        switch(state_) {
+            case MERGE_MATCH:
+                {
+                    while(match_pos_ < window_.size()) {
+                        MergeRow& row = window_[match_pos_++];
+                        if(driver_left_) joined_.put_tuple_at_end(&row.tuple_);
+                        else joined_.put_tuple_at_start(&row.tuple_);
+                        Value v = evaluate_flat_expression(ctx_, *filter_, joined_);
+                        if(!v.isNull() && v.getBoolVal() == true) {
+                            row.visited_ = true;
+                            driver_matched_ = true;
+                            return joined_;
+                        }
+                    }
+                    state_ = MERGE_NEXT_DRIVER;
+                    if(!driver_matched_ && driver_outer_) {
+                        if(driver_left_) joined_.nullify(left_size, joined_.size());
+                        else joined_.nullify(0, left_size);
+                        return joined_;
+                    }
+                } break;
+            case MERGE_NEXT_DRIVER:
+                {
+                    if(!next_driver()) {
+                        state_ = MERGE_DRAIN;
+                        break;
+                    }
+                    if(driver_left_) joined_.put_tuple_at_start(&driver_row_);
+                    else joined_.put_tuple_at_end(&driver_row_);
+                    driver_matched_ = false;
+                    no_bounds_ = driver_row_.get_val_at(driver_key_).isNull();
+                    if(!no_bounds_) {
+                        lower_val_ = evaluate_flat_expression(ctx_, *lower_, joined_);
+                        upper_val_ = evaluate_flat_expression(ctx_, *upper_, joined_);
+                        no_bounds_ = lower_val_.isNull() || upper_val_.isNull();
+                    }
+                    // a null key matches nothing and does not move the window.
+                    if(no_bounds_) {
+                        match_pos_ = window_.size();
+                        state_ = MERGE_MATCH;
+                        break;
+                    }
+                    if(window_start_ == window_.size()) {
+                        window_.clear();
+                        window_start_ = 0;
+                        window_arena_->clear();
+                    } else if(window_start_ >= BATCH_SIZE && window_start_ * 2 >= window_.size()) {
+                        compact_window();
+                    }
+                    state_ = MERGE_SLIDE;
+                } break;
+            case MERGE_SLIDE:
+                {
+                    // the rows below the lower bound can't match the next driver rows either.
+                    while(window_start_ < window_.size()) {
+                        MergeRow& row = window_[window_start_];
+                        int cmp = value_key_cmp(row.tuple_.get_val_at(window_key_), lower_val_);
+                        if(cmp > 0 || (cmp == 0 && lower_inclusive_)) break;
+                        ++window_start_;
+                        if(window_outer_ && !row.visited_) return unmatched_window_row(row.tuple_);
+                    }
+                    // read the window input up to the upper bound, rows that are below the lower bound skip the window.
+                    bool skipped = false;
+                    while(!skipped && peek_window()) {
+                        const Value& key = window_row_.get_val_at(window_key_);
+                        if(!key.isNull()) {
+                            int cmp = value_key_cmp(key, upper_val_);
+                            if(cmp > 0 || (cmp == 0 && !upper_inclusive_)) break;
+                            cmp = value_key_cmp(key, lower_val_);
+                            if(cmp > 0 || (cmp == 0 && lower_inclusive_)) {
+                                window_.push_back({window_row_.duplicate(window_arena_), false});
+                                ++window_input_pos_;
+                                continue;
+                            }
+                        }
+                        ++window_input_pos_;
+                        skipped = window_outer_;
+                    }
+                    if(skipped) return unmatched_window_row(window_row_);
+                    if(error_status_) return {};
+                    match_pos_ = window_start_;
+                    state_ = MERGE_MATCH;
+                } break;
+            case MERGE_DRAIN:
+                {
+                    if(error_status_ || !window_outer_) return {};
+                    while(window_start_ < window_.size()) {
+                        MergeRow& row = window_[window_start_++];
+                        if(!row.visited_) return unmatched_window_row(row.tuple_);
+                    }
+                    if(!peek_window()) return {};
+                    ++window_input_pos_;
+                    return unmatched_window_row(window_row_);
+                } break;
+        }
+    }
+    return {};
+}
+
+// converts a probe value to the type of the index column it is looked up in (index keys of different numeric types
+// can't be compared), return false if the value can't be equal to any value of that type.
+static bool index_probe_value(Arena* arena, Value val, Type type, Value* out) {
+    if(val.isNull()) return false;
+    if(val.type_ == OVERFLOW_ITERATOR) val = Value(val.getStringView(arena));
+    if(type == VARCHAR) {
+        *out = val;
+        return val.type_ == VARCHAR;
+    }
+    i64 ival = 0;
+    double dval = 0;
+    switch(key_domain(val, &ival, &dval)) {
+        case KEY_INTEGER: 
+            if(type == INT) {
+                if(ival < INT32_MN || ival > INT32_MX) return false;
+                *out = Value((int)ival);
+            } else if(type == BIGINT) {
+                *out = Value((i64)ival);
+            } else if(type == FLOAT) {
+                *out = Value((float)ival);
+            } else {
+                *out = Value((double)ival);
+            }
+            return true;
+        case KEY_REAL:
+            // a fraction is never equal to an integer.
+            if(type == FLOAT)  *out = Value((float)dval);
+            else if(type == DOUBLE) *out = Value(dval);
+            else return false;
+            return true;
+        case KEY_BYTES:
+            return false;
+    }
+    return false;
+}
+
+IndexNestedLoopJoinExecutor::IndexNestedLoopJoinExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, 
+        Executor* outer, IndexScanExecutor* inner, bool inner_left):
+    Executor(arena, ctx, plan_node, nullptr, nullptr, INDEX_NESTED_LOOP_JOIN_EXECUTOR),
+    outer_child_(outer), inner_child_(inner), inner_left_(inner_left), 
+    outer_row_(arena), probe_keys_(arena), key_types_(arena), key_vals_(arena)
+{
+    assert(plan_node != nullptr && plan_node->type_ == JOIN);
+    assert(outer && inner);
+    query_idx_ = plan_node->query_idx_;
+    assert(query_idx_ < ctx->queries_call_stack_.size());
+    parent_query_idx_ = ctx->queries_call_stack_[query_idx_]->parent_idx_;
+    join_type_ = ((JoinOperation*)plan_node_)->join_type_;
+
+    Executor* lhs = inner_left_ ? (Executor*)inner_child_ : outer_child_;
+    Executor* rhs = inner_left_ ? outer_child_ : (Executor*)inner_child_;
+    Vector<Column> lhs_columns = lhs->output_schema_->getColumns();
+    Vector<Column> rhs_columns = rhs->output_schema_->getColumns();
+    for(int i = 0; i < rhs_columns.size(); i++)
+        lhs_columns.push_back(rhs_columns[i]);
+
+    output_schema_ = New(TableSchema, ctx_->arena_, str_lit("TMP_JOIN_TABLE"), nullptr, lhs_columns, true);
+    output_.resize(output_schema_->numOfCols());
+    outer_row_.resize(outer_child_->output_schema_->numOfCols());
+}
+
+void IndexNestedLoopJoinExecutor::init() {
+    error_status_ = 0;
+    finished_ = 0;
+    outer_child_->init();
+    inner_child_->init();
+    error_status_ = outer_child_->error_status_ || inner_child_->error_status_;
+    if(error_status_) return;
+
+    JoinOperation* op = (JoinOperation*)plan_node_;
+    if(!filter_) {
+        assign_schema_to_fields(ctx_, plan_node_->query_idx_, op->filter_, output_schema_);
+        filter_ = ALLOCATE(ctx_->arena_, FlatExpr);
+        new(filter_) FlatExpr();
+        filter_->query_idx_ = plan_node_->query_idx_;
+        flatten_expression(ctx_, op->filter_, filter_, false);
+
+        IndexHeader& index = inner_child_->index_header_;
+        for(int i = 0; i < op->index_probe_keys_.size(); ++i) {
+            assign_schema_to_fields(ctx_, plan_node_->query_idx_, op->index_probe_keys_[i], outer_child_->output_schema_);
+            FlatExpr* key = ALLOCATE(ctx_->arena_, FlatExpr);
+            new(key) FlatExpr();
+            key->query_idx_ = plan_node_->query_idx_;
+            flatten_expression(ctx_, op->index_probe_keys_[i], key, false);
+            probe_keys_.push_back(key);
+            key_types_.push_back(inner_child_->table_->getCol(index.fields_numbers_[i].idx_).getType());
+        }
+        outer_arena_ = ALLOCATE(ctx_->arena_, Arena);
+        new(outer_arena_) Arena();
+        outer_arena_->init();
+        ctx_->batch_arenas_.push_back(outer_arena_);
+    }
+    has_outer_ = false;
+}
+
+bool IndexNestedLoopJoinExecutor::next_outer() {
+    Tuple t = outer_child_->next();
+    if(outer_child_->error_status_) error_status_ = 1;
+    if(t.is_empty()) return false;
+    outer_arena_->clear();
+    for(int i = 0; i < outer_row_.size(); ++i)
+        outer_row_.put_val_at(i, copy_var_len_value(outer_arena_, t.get_val_at(i)));
+    if(inner_left_) output_.put_tuple_at_end(&outer_row_);
+    else output_.put_tuple_at_start(&outer_row_);
+
+    no_match_ = false;
+    key_vals_.clear();
+    for(int i = 0; i < probe_keys_.size() && !no_match_; ++i) {
+        Value val = evaluate_flat_expression(ctx_, *probe_keys_[i], outer_row_);
+        Value key;
+        // nothing is equal to a null.
+        if(!index_probe_value(outer_arena_, val, key_types_[i], &key)) no_match_ = true;
+        else key_vals_.push_back(key.get_copy(outer_arena_));
+    }
+    if(!no_match_) inner_child_->probe(outer_arena_, key_vals_);
+    outer_matched_ = false;
+    return true;
+}
+
+Tuple IndexNestedLoopJoinExecutor::next() {
+    if(error_status_ || finished_) return {};
+    int outer_size = outer_row_.size();
+    int inner_start = inner_left_ ? 0 : outer_size;
+    int inner_end   = inner_left_ ? output_.size() - outer_size : output_.size();
+    while(true) {
+        if(!has_outer_) {
+            if(!next_outer()) {
+                finished_ = true;
+                return {};
+            }
+            has_outer_ = true;
+        }
+        if(!no_match_) {
+            Tuple inner_row = inner_child_->next();
+            if(inner_child_->error_status_) {
+                error_status_ = 1;
+                return {};
+            }
+            if(!inner_row.is_empty()) {
+                if(inner_left_) output_.put_tuple_at_start(&inner_row);
+                else output_.put_tuple_at_end(&inner_row);
+                Value v = evaluate_flat_expression(ctx_, *filter_, output_);
+                if(!v.isNull() && v.getBoolVal()) {
+                    outer_matched_ = true;
+                    return output_;
+                }
+                continue;
+            }
+        }
+        has_outer_ = false;
+        if(join_type_ != INNER_JOIN && !outer_matched_) {
+            output_.nullify(inner_start, inner_end);
+            return output_;
+        }
+    }
+}
+
+UnionExecutor::UnionExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs):
+    Executor(arena, ctx, plan_node, nullptr, nullptr, UNION_EXECUTOR),
+    left_child_(lhs), right_child_(rhs), set_(arena)
+{
+    assert(plan_node != nullptr && plan_node->type_ == AL_UNION);
+    assert(lhs && rhs);
+    //type_ = UNION_EXECUTOR;
+    //ctx_ = ctx; 
+    //plan_node_ = plan_node;
+    output_schema_ = lhs->output_schema_;
+    //query_idx_ = plan_node->query_idx_;
+    //assert(query_idx_ < ctx->set_operations_.size());
+    //parent_query_idx_ = ctx->set_operations_[query_idx_]->parent_idx_;
+    left_child_  = lhs;
+    right_child_ = rhs;
+    all_ = reinterpret_cast<UnionOperation*>(plan_node)->all_;
+    output_.resize(output_schema_->numOfCols());
+}
+
+void UnionExecutor::init() {
+    error_status_ = 0;
+    finished_ = 0;
+    if(!left_child_ || !right_child_){
+        error_status_ = true;
+        return;
+    }
+    left_child_->init();
+    right_child_->init();
+    error_status_ = left_child_->error_status_ || right_child_->error_status_;
+    if(!all_) set_.init(ctx_, SET_DISTINCT, false);
+}
+
+Tuple UnionExecutor::next() {
+    if(error_status_ || finished_)  return {};
+    while(true){
+        Executor* child = !left_child_->finished_ ? left_child_ : (!right_child_->finished_ ? right_child_ : nullptr);
+        if(!child) {
+            // the rows of both inputs are done, the spilled ones are checked for duplicates last.
+            if(!all_ && set_.next_spilled(&output_)) return output_;
+            error_status_ = set_.error_status_;
+            finished_ = true;
+            return {};
+        }
+        Tuple t = child->next();
+        if(child->error_status_) {
+            error_status_ = true;
+            return {};
+        }
+        if(t.is_empty()) {
+            child->finished_ = true;
+            continue;
+        }
+        if(!all_ && !set_.probe(t)) {
+            if(set_.error_status_) {
+                error_status_ = true;
+                return {};
+            }
+            continue; // duplicated tuple => skip it.
+        }
+        output_ = t;
+        return output_;
+    }
+}
+
+ExceptExecutor::ExceptExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs):
     Executor(arena, ctx, plan_node, nullptr, nullptr, EXCEPT_EXECUTOR),
-    left_child_(lhs), right_child_(rhs), hashed_tuples_(arena)
+    left_child_(lhs), right_child_(rhs), set_(arena)
 {
     assert(plan_node != nullptr && plan_node->type_ == AL_EXCEPT);
     assert(lhs && rhs);
@@ -468,6 +1610,40 @@ ExceptExecutor::ExceptExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* pl
     output_.resize(output_schema_->numOfCols());
 }
 
+// adds the rows of the right input of INTERSECT or EXCEPT to the set table.
+// return non 0 value in case of an error.
+static int build_set_table(Executor* right_child, SetOpState* set) {
+    while(!right_child->finished_ && !set->error_status_){
+        Tuple right_tuple = right_child->next();
+        if(right_child->error_status_) return 1;
+        if(right_tuple.is_empty()) break;
+        set->build(right_tuple);
+    } 
+    return set->error_status_;
+}
+
+// the next row of the left input of INTERSECT or EXCEPT that is part of the output.
+static Tuple probe_set_table(Executor* self, Executor* left_child, SetOpState* set) {
+    while(!left_child->finished_){
+        Tuple left_tuple = left_child->next();
+        if(left_child->error_status_) {
+            self->error_status_ = true;
+            return {};
+        }
+        if(left_tuple.is_empty()) break;
+        if(set->probe(left_tuple)) return left_tuple;
+        if(set->error_status_) {
+            self->error_status_ = true;
+            return {};
+        }
+    }
+    Tuple out;
+    if(set->next_spilled(&out)) return out;
+    self->error_status_ = set->error_status_;
+    self->finished_ = true;
+    return {};
+}
+
 void ExceptExecutor::init() {
     error_status_ = 0;
     finished_ = 0;
@@ -478,35 +1654,30 @@ void ExceptExecutor::init() {
     left_child_->init();
     right_child_->init();
     error_status_ = left_child_->error_status_ || right_child_->error_status_;
-    finished_ = left_child_->finished_;
-    while(!right_child_->finished_ && !error_status_){
-        Tuple right_tuple = right_child_->next();
-        error_status_ = error_status_ && right_child_->error_status_;
-        String stringified_tuple = right_tuple.stringify();
-        String8 k = str_alloc(&ctx_->arena_, stringified_tuple.size());
-        memcpy(k.str_, stringified_tuple.c_str(), k.size_);
-        hashed_tuples_[k] =  1;
-    } 
+    bool all = reinterpret_cast<ExceptOperation*>(plan_node_)->all_;
+    if(merge_cols_) {
+        merge_.init(ctx_, SET_EXCEPT, all, merge_cols_, merge_desc_);
+        return;
+    }
+    set_.init(ctx_, SET_EXCEPT, all);
+    if(!error_status_) error_status_ = build_set_table(right_child_, &set_);
 }
 
 Tuple ExceptExecutor::next() {
     if(error_status_ || finished_)  return {};
-    while(true){
-        Tuple left_tuple = left_child_->next();
-        if(finished_ || error_status_ || left_tuple.is_empty()) return {};
-        String stringified_tuple = left_tuple.stringify();
-        String8 k = str_alloc(&ctx_->arena_, stringified_tuple.size());
-        memcpy(k.str_, stringified_tuple.c_str(), k.size_);
-        if(hashed_tuples_.count(k)) 
-            continue; // tuple exists on both relations => skip it.
-        output_ = left_tuple;
-        return output_;
+    if(merge_cols_) {
+        if(merge_.next(left_child_, right_child_, &output_)) return output_;
+        error_status_ = merge_.error_status_;
+        finished_ = true;
+        return {};
     }
+    output_ = probe_set_table(this, left_child_, &set_);
+    return output_;
 }
 
 IntersectExecutor::IntersectExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs):
     Executor(arena, ctx, plan_node, nullptr, nullptr, INTERSECT_EXECUTOR),
-    left_child_(lhs), right_child_(rhs), hashed_tuples_(arena)
+    left_child_(lhs), right_child_(rhs), set_(arena)
 {
     assert(plan_node != nullptr && plan_node->type_ == AL_INTERSECT);
     assert(lhs && rhs);
@@ -532,35 +1703,30 @@ void IntersectExecutor::init() {
     left_child_->init();
     right_child_->init();
     error_status_ = left_child_->error_status_ || right_child_->error_status_;
-    finished_ = left_child_->finished_;
-    while(!right_child_->finished_ && !error_status_){
-        Tuple right_tuple = right_child_->next();
-        error_status_ = error_status_ && right_child_->error_status_;
-        String stringified_tuple = right_tuple.stringify();
-        String8 k = str_alloc(&ctx_->arena_, stringified_tuple.size());
-        memcpy(k.str_, stringified_tuple.c_str(), k.size_);
-        hashed_tuples_[k] =  1;
-    } 
+    bool all = reinterpret_cast<IntersectOperation*>(plan_node_)->all_;
+    if(merge_cols_) {
+        merge_.init(ctx_, SET_INTERSECT, all, merge_cols_, merge_desc_);
+        return;
+    }
+    set_.init(ctx_, SET_INTERSECT, all);
+    if(!error_status_) error_status_ = build_set_table(right_child_, &set_);
 }
 
 Tuple IntersectExecutor::next() {
     if(error_status_ || finished_)  return {};
-    while(true){
-        Tuple left_tuple = left_child_->next();
-        if(finished_ || error_status_ || left_tuple.is_empty()) return {};
-        String stringified_tuple = left_tuple.stringify();
-        String8 k = str_alloc(&ctx_->arena_, stringified_tuple.size());
-        memcpy(k.str_, stringified_tuple.c_str(), k.size_);
-        if(!hashed_tuples_.count(k)) 
-            continue; // tuple does not exists on both relations => skip it.
-        output_ = left_tuple;
-        return output_;
+    if(merge_cols_) {
+        if(merge_.next(left_child_, right_child_, &output_)) return output_;
+        error_status_ = merge_.error_status_;
+        finished_ = true;
+        return {};
     }
+    output_ = probe_set_table(this, left_child_, &set_);
+    return output_;
 }
 
 SeqScanExecutor::SeqScanExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, TableSchema* table):
     Executor(arena, ctx, plan_node, table, nullptr, SEQUENTIAL_SCAN_EXECUTOR),
-    table_(table), filters_(arena)
+    table_(table), filters_(arena), pushed_filters_(arena), record_preds_(arena)
 {
     assert(plan_node != nullptr && plan_node->type_ == SCAN);
     query_idx_ = plan_node->query_idx_;
@@ -573,7 +1739,7 @@ void SeqScanExecutor::init() {
     error_status_ = 0;
     finished_ = 0;
     auto cur_filters = &(((ScanOperation*)plan_node_)->filters_);
-    if(filters_.size() == 0 && cur_filters->size()){
+    if(filters_.size() == 0 && pushed_filters_.size() == 0 && cur_filters->size()){
         filters_.reserve(cur_filters->size());
 
         for(int i = 0; i < cur_filters->size(); ++i){
@@ -582,47 +1748,150 @@ void SeqScanExecutor::init() {
             new(tmp_flat_filter) FlatExpr();
             tmp_flat_filter->query_idx_ = plan_node_->query_idx_;
             flatten_expression(ctx_, (*cur_filters)[i], tmp_flat_filter);
-            filters_.push_back(tmp_flat_filter);
+            // simple column vs constant filters are checked on the records before they are decoded.
+            if(record_predicates_of(*tmp_flat_filter, &record_preds_))
+                pushed_filters_.push_back(tmp_flat_filter);
+            else
+                filters_.push_back(tmp_flat_filter);
         }
+        for(u32 i = 0; i < record_preds_.size(); ++i)
+            record_preds_[i].col_type_ = table_->getCol(record_preds_[i].col_).getType();
     }
 
     it_.destroy();
 
     it_ = table_->begin();
     it_.init();
+    zone_map_ = table_->getTable() ? table_->getTable()->get_zone_map() : nullptr;
+    cur_page_ = INVALID_PAGE_NUM;
     ctx_->table_handles_.push_back(&it_);
+    reset_batch();
 }
 
 Tuple SeqScanExecutor::next() {
+    return next_from_batch();
+}
+
+// records are decoded straight into the arena of the batch, filtered out records are rolled back.
+bool SeqScanExecutor::next_batch(RowBatch* batch) {
+    batch->reset();
+    if(error_status_ || finished_) return false;
+    // the filters run over the whole batch once it is filled, unless one of them can only run a row at a time.
+    bool filter_batches = true;
+    for(int i = 0; i < filters_.size(); ++i)
+        filter_batches = filter_batches && can_filter_batch(ctx_, *(filters_[i]));
+    if(filter_batches) return next_filtered_batch(batch);
+
     ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
-    while(true){
-        ctx_->temp_arena_.clear_temp_arena(scratch);
+    Tuple row;
+    while(!batch->is_full()){
         // no more records.
-        if(!it_.advance()) {
-            finished_ = 1;
-            return {};
-        };
-        int err = it_.getCurTupleCpy(ctx_->temp_arena_, &output_);
+        if(!it_.advance()) break;
+        bool recheck = false;
+        if(record_rejected(&recheck)) continue;
+        ArenaTemp record_start = batch->arena_->start_temp_arena();
+        int err = it_.getCurTupleCpy(*batch->arena_, &row);
         if(err) {
             error_status_ = 1;
-            return {};
+            break;
         }
-        if(!filters_.size()) return output_;
         bool record_got_filtered = false;
-        for(int i = 0; i < filters_.size(); ++i){
-            Value exp = evaluate_flat_expression(ctx_, *(filters_[i]), output_);
+        for(int i = 0; i < filters_.size() + (recheck ? pushed_filters_.size() : 0); ++i){
+            FlatExpr* filter = i < filters_.size() ? filters_[i] : pushed_filters_[i - filters_.size()];
+            Value exp = evaluate_flat_expression(ctx_, *filter, row);
+            ctx_->temp_arena_.clear_temp_arena(scratch);
             if(exp.isNull() || exp.getBoolVal() == false){
                 record_got_filtered = true;
                 break;
             }
         }
-        if(!record_got_filtered) return output_;
+        if(record_got_filtered) {
+            batch->arena_->clear_temp_arena(record_start);
+            continue;
+        }
+        batch->append(row, false);
+    }
+    if(error_status_ || batch->size() == 0) {
+        finished_ = 1;
+        return false;
+    }
+    return true;
+}
+
+bool SeqScanExecutor::record_rejected(bool* recheck) {
+    if(record_preds_.size() == 0) return false;
+    PageNum pnum = it_.getCurRecordID().page_id_.page_num_;
+    if(zone_map_ && pnum != cur_page_) {
+        cur_page_ = pnum;
+        // pages written before the table got opened are summarized by the first scan that reads them.
+        if(!zone_map_->has_summary(pnum)) zone_map_->summarize_page(pnum, it_.getCurPage());
+        // the pages ahead that already have a summary are checked before they are fetched,
+        // the rejected ones are unlinked from the scan without being read.
+        PageNum next = it_.getNextPageNumber();
+        while(next != 0 && zone_map_->has_summary(next) && zone_map_rejects_page(zone_map_, next, record_preds_))
+            next = zone_map_->next_page(next);
+        it_.setNextPageNumber(next);
+        if(zone_map_rejects_page(zone_map_, pnum, record_preds_)) {
+            it_.skipCurPage();
+            return true;
+        }
+    }
+    Record r = it_.getCurRecord();
+    if(r.isInvalidRecord()) return false;
+    RecordCheck check = check_record_predicates(table_, r, record_preds_);
+    *recheck = (check == RECORD_UNKNOWN);
+    return check == RECORD_REJECTED;
+}
+
+// fills the batch with records and drops the ones that the filters reject from its selection vector,
+// refills it if all of them got rejected.
+bool SeqScanExecutor::next_filtered_batch(RowBatch* batch) {
+    ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+    Tuple row;
+    bool no_more_records = false;
+    while(!no_more_records) {
+        batch->reset();
+        while(!batch->is_full()){
+            if(!it_.advance()) {
+                no_more_records = true;
+                break;
+            }
+            bool recheck = false;
+            if(record_rejected(&recheck)) continue;
+            ArenaTemp record_start = batch->arena_->start_temp_arena();
+            int err = it_.getCurTupleCpy(*batch->arena_, &row);
+            if(err) {
+                error_status_ = 1;
+                break;
+            }
+            bool record_got_filtered = false;
+            for(int i = 0; recheck && i < pushed_filters_.size(); ++i){
+                Value exp = evaluate_flat_expression(ctx_, *(pushed_filters_[i]), row);
+                ctx_->temp_arena_.clear_temp_arena(scratch);
+                record_got_filtered = exp.isNull() || exp.getBoolVal() == false;
+                if(record_got_filtered) break;
+            }
+            if(record_got_filtered) {
+                batch->arena_->clear_temp_arena(record_start);
+                continue;
+            }
+            batch->append(row, false);
+        }
+        if(error_status_) break;
+        for(int i = 0; i < filters_.size() && batch->size(); ++i)
+            filter_batch(ctx_, *(filters_[i]), batch);
+        if(batch->size()) break;
     }
+    if(error_status_ || batch->size() == 0) {
+        finished_ = 1;
+        return false;
+    }
+    return true;
 }
 
 IndexScanExecutor::IndexScanExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, TableSchema* table, IndexHeader index):
     Executor(arena, ctx, plan_node, table, nullptr, INDEX_SCAN_EXECUTOR),
-    table_(table), index_header_(arena)
+    index_header_(arena), table_(table), ranges_(arena), hash_rids_(arena)
 {
     assert(plan_node != nullptr && plan_node->type_ == SCAN);
     index_header_ = index;
@@ -638,16 +1907,25 @@ IndexScanExecutor::IndexScanExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperati
     //filters_       = &((ScanOperation*)plan_node)->filters_;
     //index_filters_ = &((ScanOperation*)plan_node)->index_filters_;
     table_fid_ = table_->getTable()->get_fid();
+    reverse_ = ((ScanOperation*)plan_node)->index_reverse_;
 }
 
+// index filters are ordered by the planner as: 
+// equality(or IN-list) filters on the leading key columns followed by range filters on the next key column.
+// every combination of the equality values creates a key prefix and all range filters are merged into one [lo, hi] 
+// bound that is appended to every prefix, the resulting key ranges are sorted in index order and scanned one after 
+// the other, each one seeks directly to its start key and stops at its end key.
 void IndexScanExecutor::assign_iterators() {
     auto cur_index_filters = &(((ScanOperation*)plan_node_)->index_filters_);
 
-    Vector<Value> key_vals;
-    int num_of_compares = 0;
-    TokenType first_col_op      = TokenType::EQ;
-    bool      first_key_on_left = false;
-    for(int i = 0; i < cur_index_filters->size(); ++i) {
+    // one sorted and deduplicated list of values per equality column.
+    Vector<Vector<Value>> prefix_vals;
+    Value lo, hi;
+    bool has_lo = false, has_hi = false;
+    bool lo_inclusive = true, hi_inclusive = true;
+    bool has_range = false;
+    bool empty_range = false;
+    for(int i = 0; i < cur_index_filters->size() && !empty_range; ++i) {
         ASTNode* ptr = (*cur_index_filters)[i];
         CategoryType cat = ptr->category_;
         while(ptr){
@@ -666,61 +1944,210 @@ void IndexScanExecutor::assign_iterators() {
             break;
         }
 
-        if(i == 0) first_col_op = ptr->token_.type_;
-        if(cat == COMPARISON && i != 0) 
-            assert(0);
+        if(cat == IN) {
+            assert(!has_range && "EQUALITY INDEX FILTERS SHOULD COME BEFORE RANGE FILTERS!");
+            InNode* in = (InNode*)ptr;
+            Vector<Value> vals;
+            for(int j = 0; j < in->list_.size(); ++j) {
+                Value val = evaluate_expression(ctx_, in->list_[j], output_);
+                // a null never matches anything inside of an IN-list.
+                if(val.isNull()) continue;
+                vals.push_back(val);
+            }
+            std::sort(vals.begin(), vals.end(), 
+                    [](const Value& lhs, const Value& rhs) { return value_cmp(lhs, rhs) < 0; });
+            vals.erase(std::unique(vals.begin(), vals.end(), 
+                        [](const Value& lhs, const Value& rhs) { return value_cmp(lhs, rhs) == 0; }), vals.end());
+            if(vals.size() == 0) empty_range = true;
+            prefix_vals.push_back(vals);
+            continue;
+        }
+
+        ASTNode* left  = nullptr; 
+        ASTNode* right = nullptr; 
         switch(cat) {
             case EQUALITY:
-            case COMPARISON:{
-
-                                ASTNode* left  = nullptr; 
-                                ASTNode* right = nullptr; 
-                                if(cat == EQUALITY){
-                                    left  = ((EqualityNode*)ptr)->cur_;
-                                    right = ((EqualityNode*)ptr)->next_;
-                                } else if(cat == COMPARISON) {
-                                    left  = ((ComparisonNode*)ptr)->cur_;
-                                    right = ((ComparisonNode*)ptr)->next_;
-                                }
-                                Value val;
-                                Vector<FieldNode*> key;
-                                accessed_fields(left , key);
-                                int size_before = key.size();
-                                bool key_on_left = (size_before != 0);
-                                if(i == 0) first_key_on_left = key_on_left;
-                                accessed_fields(right, key);
-                                assert(key.size() == 1);
-
-                                if(key_on_left)
-                                    val = evaluate_expression(ctx_, right, output_);
-                                else
-                                    val = evaluate_expression(ctx_, left, output_);
-                                key_vals.push_back(val);
-                                break;
-                            }
+                left  = ((EqualityNode*)ptr)->cur_;
+                right = ((EqualityNode*)ptr)->next_;
+                break;
+            case COMPARISON:
+                left  = ((ComparisonNode*)ptr)->cur_;
+                right = ((ComparisonNode*)ptr)->next_;
+                break;
             default:
-                            assert(0 && "NOT SUPPORTED INDEX SCAN CONDITION!");
+                assert(0 && "NOT SUPPORTED INDEX SCAN CONDITION!");
+        }
+        Vector<FieldNode*> key;
+        accessed_fields(left , key);
+        bool key_on_left = (key.size() != 0);
+        accessed_fields(right, key);
+        assert(key.size() == 1);
+
+        Value val = evaluate_expression(ctx_, key_on_left ? right : left, output_);
+        // nothing is equal to or bounded by a null.
+        if(val.isNull()) {
+            empty_range = true;
+            break;
+        }
+        if(cat == EQUALITY) {
+            assert(!has_range && "EQUALITY INDEX FILTERS SHOULD COME BEFORE RANGE FILTERS!");
+            prefix_vals.push_back({val});
+            continue;
+        }
+        has_range = true;
+        // normalize the operator to be: (key op val).
+        auto op = ptr->token_.type_;
+        if(!key_on_left){
+            if      (op == TokenType::GT)  op = TokenType::LT;
+            else if (op == TokenType::LT)  op = TokenType::GT;
+            else if (op == TokenType::LTE) op = TokenType::GTE;
+            else if (op == TokenType::GTE) op = TokenType::LTE;
+        }
+        // keep the tightest bound, on ties a strict bound wins.
+        if(op == TokenType::GT || op == TokenType::GTE) {
+            int cmp = has_lo ? value_cmp(val, lo) : 1;
+            if(cmp > 0 || (cmp == 0 && op == TokenType::GT)) {
+                lo = val;
+                lo_inclusive = (op == TokenType::GTE);
+                has_lo = true;
+            }
+        } else {
+            int cmp = has_hi ? value_cmp(val, hi) : -1;
+            if(cmp < 0 || (cmp == 0 && op == TokenType::LT)) {
+                hi = val;
+                hi_inclusive = (op == TokenType::LTE);
+                has_hi = true;
+            }
         }
     }
 
-    search_key_ = temp_index_key_from_values(&ctx_->temp_arena_, key_vals);
-    search_key_.sort_order_ = create_sort_order_bitmap(&ctx_->temp_arena_, index_header_.fields_numbers_);
-    if(index_header_.fields_numbers_[0].desc_) first_key_on_left = !first_key_on_left;
-    auto op = first_col_op;
-    if(!first_key_on_left){
-        if      (op == TokenType::GT)  op = TokenType::LT;
-        else if (op == TokenType::LT)  op = TokenType::GT;
-        else if (op == TokenType::LTE) op = TokenType::GTE;
-        else if (op == TokenType::GTE) op = TokenType::LTE;
+    ranges_.clear();
+    cur_range_ = -1;
+    start_it_ = IndexIterator();
+    ctx_->index_handles_.push_back(&start_it_);
+    if(empty_range) return;
+
+    // keys are kept for the whole scan so they live in the query arena instead of the temp arena.
+    sort_order_ = create_sort_order_bitmap(&ctx_->arena_, index_header_.fields_numbers_);
+    int range_col = prefix_vals.size();
+    // a descending column is scanned from the high bound to the low bound.
+    bool desc = has_range && index_header_.fields_numbers_[range_col].desc_;
+    bool  has_start       = desc ? has_hi : has_lo;
+    bool  start_inclusive = desc ? hi_inclusive : lo_inclusive;
+    Value start_val       = desc ? hi : lo;
+    bool  has_end         = desc ? has_lo : has_hi;
+    bool  end_inclusive   = desc ? lo_inclusive : hi_inclusive;
+    Value end_val         = desc ? lo : hi;
+
+    // walk over every combination of the prefix values.
+    std::vector<int> pos(prefix_vals.size(), 0);
+    Vector<Value> key_vals;
+    while(true) {
+        key_vals.clear();
+        for(int i = 0; i < prefix_vals.size(); ++i)
+            key_vals.push_back(prefix_vals[i][pos[i]]);
+
+        IndexRange range = {};
+        if(has_end) {
+            key_vals.push_back(end_val);
+            range.end_key_ = temp_index_key_from_values(&ctx_->arena_, key_vals);
+            range.end_inclusive_ = end_inclusive;
+            key_vals.pop_back();
+        } else if(key_vals.size()) {
+            range.end_key_ = temp_index_key_from_values(&ctx_->arena_, key_vals);
+        }
+
+        if(has_start) {
+            key_vals.push_back(start_val);
+            range.start_after_ = !start_inclusive;
+        } else if(has_range) {
+            // nulls are always stored first, skip them because they can't satisfy a range predicate.
+            key_vals.push_back(Value(NULL_TYPE));
+            range.start_after_ = true;
+        }
+        // no index filters at all => scan the whole index.
+        if(key_vals.size())
+            range.start_key_ = temp_index_key_from_values(&ctx_->arena_, key_vals);
+        ranges_.push_back(range);
+
+        int i = (int)prefix_vals.size() - 1;
+        while(i >= 0 && ++pos[i] == prefix_vals[i].size()) {
+            pos[i] = 0;
+            --i;
+        }
+        if(i < 0) break;
+    }
+    // the prefix values are sorted in ascending order, but the index may store some of them in descending order.
+    char* sort_order = sort_order_;
+    std::sort(ranges_.begin(), ranges_.end(), [sort_order](const IndexRange& lhs, const IndexRange& rhs) {
+                IndexKey lhs_key = lhs.start_key_;
+                lhs_key.sort_order_ = sort_order;
+                return index_key_cmp(lhs_key, rhs.start_key_) < 0;
+            });
+    if(reverse_) std::reverse(ranges_.begin(), ranges_.end());
+}
+
+void IndexScanExecutor::seek_next_range() {
+    start_it_.clear();
+    start_it_ = IndexIterator();
+    if(++cur_range_ >= (int)ranges_.size()) return;
+    IndexRange& range = ranges_[cur_range_];
+    if(index_header_.is_hash()) {
+        hash_rids_.clear();
+        hash_pos_ = 0;
+        index_header_.hash_index_->find(range.start_key_, table_fid_, &hash_rids_);
+        return;
     }
-    if (op == TokenType::LT || op == TokenType::LTE)
+    if(reverse_) {
+        IndexKey key = range.end_key_;
+        key.sort_order_ = sort_order_;
+        if(!key.data_)
+            start_it_ = index_header_.index_->rbegin();
+        else 
+            start_it_ = index_header_.index_->reverse_bound(key, range.end_inclusive_);
+        return;
+    }
+    IndexKey key = range.start_key_;
+    key.sort_order_ = sort_order_;
+    if(!key.data_)
         start_it_ = index_header_.index_->begin();
-    else if (op == TokenType::GT)
-        start_it_ = index_header_.index_->upper_bound(search_key_);
+    else if(range.start_after_)
+        start_it_ = index_header_.index_->upper_bound(key);
     else
-        start_it_ = index_header_.index_->lower_bound(search_key_);
+        start_it_ = index_header_.index_->lower_bound(key);
+}
 
-    ctx_->index_handles_.push_back(&start_it_);
+// moves start_it_ one entry in the scan direction.
+void IndexScanExecutor::step() {
+    if(index_header_.is_hash()) hash_pos_++;
+    else if(reverse_) start_it_.retreat();
+    else start_it_.advance();
+}
+
+// moves start_it_ to the next index entry that is inside of one of the scanned ranges,
+// return false if all ranges are exhausted.
+bool IndexScanExecutor::seek_valid_entry() {
+    while(cur_range_ < (int)ranges_.size()) {
+        if(index_header_.is_hash()) {
+            if(cur_range_ >= 0 && hash_pos_ < hash_rids_.size()) return true;
+        } else if(!start_it_.isNull() && reverse_) {
+            IndexRange& range = ranges_[cur_range_];
+            if(!range.start_key_.data_) return true;
+            IndexKey start_key = range.start_key_;
+            start_key.sort_order_ = sort_order_;
+            int cmp = index_key_cmp(start_it_.getCurKey(), start_key);
+            if(cmp > 0 || (cmp == 0 && !range.start_after_)) return true;
+        } else if(!start_it_.isNull()) {
+            IndexRange& range = ranges_[cur_range_];
+            if(!range.end_key_.data_) return true;
+            IndexKey end_key = range.end_key_;
+            end_key.sort_order_ = sort_order_;
+            int cmp = index_key_cmp(start_it_.getCurKey(), end_key);
+            if(cmp < 0 || (cmp == 0 && range.end_inclusive_)) return true;
+        }
+        seek_next_range();
+    }
+    return false;
 }
 
 void IndexScanExecutor::init() {
@@ -728,7 +2155,6 @@ void IndexScanExecutor::init() {
     finished_ = 0;
 
     auto cur_filters = &(((ScanOperation*)plan_node_)->filters_);
-    auto cur_index_filters = &(((ScanOperation*)plan_node_)->index_filters_);
 
     if(filters_.size() == 0 && cur_filters->size()){
         filters_.reserve(cur_filters->size());
@@ -743,20 +2169,6 @@ void IndexScanExecutor::init() {
         }
     }
 
-    if(index_filters_.size() == 0 && cur_index_filters->size()){
-        index_filters_.reserve(cur_index_filters->size());
-
-        for(int i = 0; i < cur_index_filters->size(); ++i){
-            assign_schema_to_fields(ctx_, plan_node_->query_idx_, (*cur_index_filters)[i], output_schema_);
-            auto tmp_flat_filter = ALLOCATE(ctx_->arena_, FlatExpr);
-            new(tmp_flat_filter) FlatExpr();
-            tmp_flat_filter->query_idx_ = plan_node_->query_idx_;
-            flatten_expression(ctx_, (*cur_index_filters)[i], tmp_flat_filter);
-            index_filters_.push_back(tmp_flat_filter);
-        }
-    }
-
-    assert(index_filters_.size() == cur_index_filters->size());
     assert(filters_.size() == cur_filters->size());
 
     start_it_.clear();
@@ -764,31 +2176,149 @@ void IndexScanExecutor::init() {
 }
 
 Tuple IndexScanExecutor::next() {
-    // check if the key holds index key conditions if false => finish execution.
+    // move to the next key that is inside of the scanned ranges if there is none => finish execution.
     // then check for the rest of the filters if false => try next tuple.
-    while(!start_it_.isNull()){
-        Record r = start_it_.getCurRecordCpy(&ctx_->temp_arena_, table_fid_);
+    while(seek_valid_entry()){
+        RecordID rid = index_header_.is_hash() ? hash_rids_[hash_pos_] : start_it_.getCurRecordID(table_fid_);
+        Record r = index_header_.is_hash() ? table_->getTable()->getRecordCpy(&ctx_->temp_arena_, rid) 
+                                           : start_it_.getCurRecordCpy(&ctx_->temp_arena_, table_fid_);
         if(r.isInvalidRecord()){
             std::cout << "Could not translate record\n";
             error_status_ = 1;
             return {};
         }
-        RecordID rid = start_it_.getCurRecordID(table_fid_);
         int err = table_->translateToTuple(r, output_, rid);
         if(err) {
             error_status_ = 1;
             return {};
         }
-        start_it_.advance();
-        for(int i = 0; i < index_filters_.size(); ++i) {
-            Value exp = evaluate_flat_expression(ctx_, *(index_filters_[i]), output_);
+        step();
+        bool got_filtered = false;
+        // check regular filters
+        for(int i = 0; i < filters_.size(); ++i) {
+            Value exp = evaluate_flat_expression(ctx_, *(filters_[i]), output_);
             if(exp.isNull() || exp.getBoolVal() == false) {
-                finished_ = true; 
-                return {};
+                got_filtered = true;
+                break;
             }
         }
+        if(got_filtered) continue;
+        return output_;
+    }
+    finished_ = true;
+    return {};
+}
+
+// used by rid set scans to collect the record ids of the scanned ranges without fetching any table pages,
+// the regular filters are not checked.
+// return INVALID_RID if there are no more entries.
+RecordID IndexScanExecutor::next_rid() {
+    if(!seek_valid_entry()) {
+        finished_ = true;
+        return INVALID_RID;
+    }
+    RecordID rid = index_header_.is_hash() ? hash_rids_[hash_pos_] : start_it_.getCurRecordID(table_fid_);
+    step();
+    return rid;
+}
+
+// used by index nested loop joins instead of the index filters of the scan.
+void IndexScanExecutor::probe(Arena* arena, const Vector<Value>& key_vals) {
+    if(!sort_order_) sort_order_ = create_sort_order_bitmap(&ctx_->arena_, index_header_.fields_numbers_);
+    IndexRange range = {};
+    range.start_key_ = temp_index_key_from_values(arena, key_vals);
+    range.end_key_ = range.start_key_;
+    ranges_.clear();
+    ranges_.push_back(range);
+    cur_range_ = -1;
+    finished_ = false;
+    seek_next_range();
+}
+
+RidSetScanExecutor::RidSetScanExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, TableSchema* table,
+        Vector<IndexScanExecutor*> index_scans):
+    Executor(arena, ctx, plan_node, table, nullptr, RID_SET_SCAN_EXECUTOR),
+    table_(table), index_scans_(index_scans, arena), filters_(arena), rids_(arena)
+{
+    assert(plan_node != nullptr && plan_node->type_ == SCAN);
+    output_.resize(output_schema_->numOfCols());
+    query_idx_ = plan_node->query_idx_;
+    assert(query_idx_ < ctx->queries_call_stack_.size());
+    parent_query_idx_ = ctx->queries_call_stack_[query_idx_]->parent_idx_;
+}
+
+void RidSetScanExecutor::init() {
+    error_status_ = 0;
+    finished_ = 0;
+
+    auto cur_filters = &(((ScanOperation*)plan_node_)->filters_);
+    if(filters_.size() == 0 && cur_filters->size()){
+        filters_.reserve(cur_filters->size());
+
+        for(int i = 0; i < cur_filters->size(); ++i){
+            assign_schema_to_fields(ctx_, plan_node_->query_idx_, (*cur_filters)[i], output_schema_);
+            auto tmp_flat_filter = ALLOCATE(ctx_->arena_, FlatExpr);
+            new(tmp_flat_filter) FlatExpr();
+            tmp_flat_filter->query_idx_ = plan_node_->query_idx_;
+            flatten_expression(ctx_, (*cur_filters)[i], tmp_flat_filter);
+            filters_.push_back(tmp_flat_filter);
+        }
+    }
+
+    auto rid_less = [](const RecordID& lhs, const RecordID& rhs) {
+        if(lhs.page_id_.page_num_ != rhs.page_id_.page_num_) 
+            return lhs.page_id_.page_num_ < rhs.page_id_.page_num_;
+        return lhs.slot_number_ < rhs.slot_number_;
+    };
+    auto rid_eq = [](const RecordID& lhs, const RecordID& rhs) {
+        return lhs.page_id_.page_num_ == rhs.page_id_.page_num_ && lhs.slot_number_ == rhs.slot_number_;
+    };
+
+    bool is_union = ((ScanOperation*)plan_node_)->rid_set_union_;
+    rids_.clear();
+    cur_rid_ = 0;
+    for(int i = 0; i < index_scans_.size(); ++i) {
+        index_scans_[i]->init();
+        Vector<RecordID> cur_rids;
+        while(true) {
+            RecordID rid = index_scans_[i]->next_rid();
+            if(rid.page_id_ == INVALID_PAGE_ID) break;
+            cur_rids.push_back(rid);
+        }
+        std::sort(cur_rids.begin(), cur_rids.end(), rid_less);
+        cur_rids.erase(std::unique(cur_rids.begin(), cur_rids.end(), rid_eq), cur_rids.end());
+        if(i == 0) {
+            rids_.assign(cur_rids.begin(), cur_rids.end());
+            continue;
+        }
+        Vector<RecordID> merged;
+        if(is_union)
+            std::set_union(rids_.begin(), rids_.end(), cur_rids.begin(), cur_rids.end(), 
+                    std::back_inserter(merged), rid_less);
+        else 
+            std::set_intersection(rids_.begin(), rids_.end(), cur_rids.begin(), cur_rids.end(), 
+                    std::back_inserter(merged), rid_less);
+        rids_.assign(merged.begin(), merged.end());
+        // nothing is left to intersect with.
+        if(!is_union && rids_.size() == 0) break;
+    }
+}
+
+Tuple RidSetScanExecutor::next() {
+    // record ids are sorted by page number, so every table page is fetched only for one consecutive run of records.
+    while(cur_rid_ < rids_.size()) {
+        RecordID rid = rids_[cur_rid_++];
+        Record r = table_->getTable()->getRecordCpy(&ctx_->temp_arena_, rid);
+        if(r.isInvalidRecord()) {
+            error_status_ = 1;
+            return {};
+        }
+        int err = table_->translateToTuple(r, output_, rid);
+        if(err) {
+            error_status_ = 1;
+            return {};
+        }
         bool got_filtered = false;
-        // check regular filters
         for(int i = 0; i < filters_.size(); ++i) {
             Value exp = evaluate_flat_expression(ctx_, *(filters_[i]), output_);
             if(exp.isNull() || exp.getBoolVal() == false) {
@@ -799,8 +2329,102 @@ Tuple IndexScanExecutor::next() {
         if(got_filtered) continue;
         return output_;
     }
-    finished_ = true;
-    return {};
+    finished_ = true;
+    return {};
+}
+
+LooseIndexScanExecutor::LooseIndexScanExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, TableSchema* table,
+        IndexHeader index):
+    Executor(arena, ctx, plan_node, table, nullptr, LOOSE_INDEX_SCAN_EXECUTOR),
+    index_header_(arena), table_(table)
+{
+    assert(plan_node != nullptr && plan_node->type_ == SCAN);
+    index_header_ = index;
+    output_.resize(output_schema_->numOfCols());
+    query_idx_ = plan_node->query_idx_;
+    assert(query_idx_ < ctx->queries_call_stack_.size());
+    parent_query_idx_ = ctx->queries_call_stack_[query_idx_]->parent_idx_;
+    table_fid_ = table_->getTable()->get_fid();
+    prefix_len_ = ((ScanOperation*)plan_node)->loose_prefix_len_;
+    min_max_    = ((ScanOperation*)plan_node)->loose_min_max_;
+    assert(prefix_len_ > 0 || min_max_);
+}
+
+void LooseIndexScanExecutor::init() {
+    error_status_ = 0;
+    finished_ = 0;
+    pending_rid_ = INVALID_RID;
+    sort_order_ = create_sort_order_bitmap(&ctx_->arena_, index_header_.fields_numbers_);
+
+    it_.clear();
+    it_ = index_header_.index_->begin();
+    ctx_->index_handles_.push_back(&it_);
+}
+
+bool LooseIndexScanExecutor::in_group(IndexKey key, IndexKey prefix) {
+    if(prefix_len_ == 0) return true;
+    return index_key_cmp(key, prefix) == 0;
+}
+
+bool LooseIndexScanExecutor::fetch_tuple(RecordID rid) {
+    Record r = table_->getTable()->getRecordCpy(&ctx_->temp_arena_, rid);
+    if(r.isInvalidRecord() || table_->translateToTuple(r, output_, rid)) {
+        error_status_ = 1;
+        return false;
+    }
+    return true;
+}
+
+Tuple LooseIndexScanExecutor::next() {
+    if(pending_rid_.page_id_ != INVALID_PAGE_ID) {
+        RecordID rid = pending_rid_;
+        pending_rid_ = INVALID_RID;
+        if(!fetch_tuple(rid)) return {};
+        return output_;
+    }
+    if(it_.isNull()) {
+        finished_ = true;
+        return {};
+    }
+    // the current key lives inside of the pinned index page, copy what we need before moving the iterator.
+    IndexKey cur_key = it_.getCurKey();
+    RecordID first_rid = it_.getCurRecordID(table_fid_);
+    IndexKey prefix = {};
+    if(prefix_len_) {
+        prefix = index_key_resize_cpy(&ctx_->temp_arena_, cur_key, prefix_len_);
+        prefix.sort_order_ = sort_order_;
+    }
+
+    if(!min_max_) {
+        // skip the rest of the group.
+        it_.clear();
+        it_ = index_header_.index_->upper_bound(prefix);
+    } else {
+        // nulls are stored first, the first non-null entry holds one of the extremes of the next key column.
+        IndexKey null_key = index_key_prefix_with_null(&ctx_->temp_arena_, cur_key, prefix_len_);
+        null_key.sort_order_ = sort_order_;
+        it_.clear();
+        it_ = index_header_.index_->upper_bound(null_key);
+        bool has_values = (!it_.isNull() && in_group(it_.getCurKey(), prefix));
+        if(has_values)
+            first_rid = it_.getCurRecordID(table_fid_);
+        it_.clear();
+        it_ = IndexIterator();
+        // the last entry of the group holds the other extreme, it is found by one backward step.
+        RecordID last_rid = first_rid;
+        if(has_values) {
+            IndexIterator last_it = prefix_len_ ? index_header_.index_->reverse_bound(prefix, true) 
+                                                : index_header_.index_->rbegin();
+            if(!last_it.isNull()) last_rid = last_it.getCurRecordID(table_fid_);
+            last_it.clear();
+        }
+        if(last_rid.page_id_ != first_rid.page_id_ || last_rid.slot_number_ != first_rid.slot_number_)
+            pending_rid_ = last_rid;
+        // without a prefix there is only one group.
+        if(prefix_len_) it_ = index_header_.index_->upper_bound(prefix);
+    }
+    if(!fetch_tuple(first_rid)) return {};
+    return output_;
 }
 
 DeletionExecutor::DeletionExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child, TableSchema* table, Vector<IndexHeader> indexes):
@@ -877,7 +2501,7 @@ Tuple DeletionExecutor::next() {
                 error_status_ = 1;
                 break;
             }
-            indexes_[i].index_->Remove(ctx_, k);
+            indexes_[i].remove(ctx_, k);
         }
         if(err || error_status_) {
             error_status_ = 1;
@@ -981,7 +2605,7 @@ Tuple UpdateExecutor::next() {
                 error_status_ = 1;
                 break;
             }
-            indexes_[i].index_->Remove(ctx_, k);
+            indexes_[i].remove(ctx_, k);
         }
 
 
@@ -1019,7 +2643,7 @@ Tuple UpdateExecutor::next() {
                 error_status_ = 1;
                 break;
             }
-            int inserted = indexes_[i].index_->Insert(ctx_, k);
+            int inserted = indexes_[i].insert(ctx_, k);
             assert(inserted);
         }
         if(err || error_status_) {
@@ -1144,7 +2768,7 @@ Tuple InsertionExecutor::next() {
             error_status_ = 1;
             break;
         }
-        bool success = indexes_[i].index_->Insert(ctx_, k);
+        bool success = indexes_[i].insert(ctx_, k);
         if(!success){
             std::cout << "Could Not insert into index\n";
             error_status_ = 1;
@@ -1162,7 +2786,7 @@ Tuple InsertionExecutor::next() {
 
 AggregationExecutor::AggregationExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child_executor):
     Executor(arena, ctx, plan_node, nullptr, child_executor, AGGREGATION_EXECUTOR),
-    aggregated_values_(arena), distinct_counters_(arena)
+    child_row_(arena), groups_(arena), partitions_(arena), pending_(arena)
 {
     assert(plan_node != nullptr && plan_node->type_ == AGGREGATION);
     //type_ = AGGREGATION_EXECUTOR;
@@ -1201,11 +2825,18 @@ void AggregationExecutor::init() {
 
     finished_ = 0;
     error_status_ = 0;
-
-    int total_size = output_schema_->getCols().size();
-    for(int i = 0; i < aggregates_->size(); ++i) {
-        if((*aggregates_)[i]->distinct_) distinct_counters_[str_lit("PREFIX_")][i] = std::set<String8>();
-    }
+    reset_batch();
+    groups_.init(group_by_->size(), aggregates_->size());
+    group_pos_ = 0;
+    // the temp tables of a previous run (re-evaluated sub-queries).
+    for(int i = 0; i < partitions_.size(); ++i)
+        drop_spill_table(ctx_, partitions_[i]);
+    for(int i = 0; i < pending_.size(); ++i)
+        drop_spill_table(ctx_, pending_[i].table_);
+    partitions_.clear();
+    pending_.clear();
+    level_ = 0;
+    spilled_ = false;
 
     if(child_executor_){
         child_executor_->init();
@@ -1220,184 +2851,312 @@ void AggregationExecutor::init() {
         assign_schema_to_fields(ctx_, plan_node_->query_idx_, (*aggregates_)[i]->exp_, output_schema_);
     }
 
+    if(!keys_ && group_by_->size())
+        keys_ = (Value*) ctx_->arena_.alloc(sizeof(Value) * group_by_->size());
 
+    if(!groups_arena_) {
+        Arena** arenas[] = {&groups_arena_, &spill_arena_};
+        for(int i = 0; i < 2; ++i){
+            *arenas[i] = ALLOCATE(ctx_->arena_, Arena);
+            new(*arenas[i]) Arena();
+            (*arenas[i])->init();
+            ctx_->batch_arenas_.push_back(*arenas[i]);
+        }
+    }
+    groups_arena_->clear();
 
-    aggregated_values_.insert({str_lit("PREFIX_"), {
-            Tuple(&ctx_->arena_), 0
-            }});
-    aggregated_values_[str_lit("PREFIX_")].first.resize(output_schema_->numOfCols());
-
-    int agg_base_idx = total_size - aggregates_->size();
-    for(int i = 0;i < aggregates_->size(); ++i) {
-        if((*aggregates_)[i]->type_ == COUNT)
-            aggregated_values_[str_lit("PREFIX_")].first.put_val_at(i+agg_base_idx, Value(0)); // count can't be null.
+    if(child_executor_ && !input_){
+        input_ = ALLOCATE(ctx_->arena_, RowBatch);
+        new(input_) RowBatch();
+        input_->init(ctx_);
     }
 
+    ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
     while(true){
-        // we always maintain rows count even if the user did not ask for it, that's why the size is | colmuns | + 1
-        //output_ = Vector<Value> (output_schema_->getCols().size() + 1, Value(0));
-        output_.resize(output_schema_->numOfCols(), Value(0));
-        Tuple child_output; 
-        if(child_executor_){
-            child_output = child_executor_->next();
-            if(child_executor_->error_status_)  {
+        if(!child_executor_){
+            aggregate_row({});
+            ctx_->temp_arena_.clear_temp_arena(scratch);
+            break;
+        }
+        if(!child_executor_->next_batch(input_)) {
+            if(child_executor_->error_status_) {
                 error_status_ = true;
                 return;
             }
-            if(child_executor_->finished_) {
-                break;
-            }
-        } 
-        output_.put_tuple_at_start(&child_output);
-
-        // build the search key for the hash table.
-        String hash_key_ = "PREFIX_"; // prefix to ensure we have at least one entry in the hash table.
-        for(int i = 0; i < group_by_->size(); i++){
-            Value cur = evaluate_expression(ctx_, (*group_by_)[i], output_);
-            hash_key_ += cur.toString();
+            break;
+        }
+        for(u32 i = 0; i < input_->size(); ++i){
+            input_->get_row(i, &child_row_);
+            aggregate_row(child_row_);
+            ctx_->temp_arena_.clear_temp_arena(scratch);
+            if(error_status_)  return;
+            if(over_budget()) spill_groups(0);
         }
+    }
+    if(spilled_) {
+        load_partition();
+        return;
+    }
+    // an empty input still produces a single row (count(*) = 0 for example).
+    if(groups_.size() == 0){
+        for(int i = 0; i < group_by_->size(); ++i)
+            keys_[i] = Value(NULL_TYPE);
+        new_group({}, agg_keys_hash(keys_, group_by_->size()));
+    }
+}
 
-        String8 hash_key = str_alloc(&ctx_->arena_, hash_key_.size());
-        memcpy(hash_key.str_, hash_key_.c_str(), hash_key_.size());
+// the child row is only valid until the child refills its batch, 
+// so everything that is kept in the hash table is copied into the arena of the groups.
+u32 AggregationExecutor::new_group(const Tuple& child_output, u64 hash) {
+    int total_size = output_schema_->numOfCols();
+    u32 g = groups_.insert(groups_arena_, keys_, hash);
+    AggGroup& group = groups_.groups_[g];
+    // the group keeps a copy of its first row in front of the aggregates.
+    group.row_ = Tuple(groups_arena_);
+    group.row_.resize(total_size);
+    for(int i = 0; i < child_output.size() && i < total_size; ++i)
+        group.row_.put_val_at(i, copy_var_len_value(groups_arena_, child_output.get_val_at(i)));
+    group.row_.left_most_rid_ = child_output.left_most_rid_;
+    return g;
+}
 
-        // if the hash key exists we need to load it first.
-        if(aggregated_values_.count(hash_key)){
-            output_ = aggregated_values_[hash_key].first;
-        } else if(hash_key != str_lit("PREFIX_")){
-            for(int i = 0; i < aggregates_->size(); ++i) {
-                if((*aggregates_)[i]->distinct_) distinct_counters_[hash_key][i] = std::set<String8>();
-            }
+void AggregationExecutor::aggregate_row(const Tuple& child_output) {
+    output_.put_tuple_at_start(&child_output);
 
-            //int total_size = output_schema_->getCols().size() + 1;
-            //aggregated_values_[hash_key] = Vector<Value> (total_size, Value(NULL_TYPE));
-            Tuple t(&ctx_->arena_);
-            t.resize(output_schema_->numOfCols());
-            aggregated_values_[hash_key] = {
-                t,
-                0
-            };
-
-            int agg_base_idx = total_size - (aggregates_->size());
-            for(int i = 0;i < aggregates_->size(); ++i) {
-                if((*aggregates_)[i]->type_ == COUNT)
-                    aggregated_values_[hash_key].first.put_val_at(i+agg_base_idx, Value(0)); // count can't be null.
-            }
-            output_ = aggregated_values_[hash_key].first;
-        }
+    // the group by values are hashed and compared by their types.
+    for(int i = 0; i < group_by_->size(); i++)
+        keys_[i] = materialize_value(&ctx_->temp_arena_, evaluate_expression(ctx_, (*group_by_)[i], output_));
+    u64 hash = agg_keys_hash(keys_, group_by_->size());
+    u32 g = groups_.find(keys_, hash);
+    if(g == AGG_NO_GROUP) g = new_group(child_output, hash);
 
-        output_.put_tuple_at_start(&child_output);
+    for(int i = 0; i < aggregates_->size(); i++){
+        AggregateFuncNode* agg = (*aggregates_)[i];
+        // count(*) is the only aggregate without an argument, every other one skips nulls.
+        if(!agg->exp_) {
+            ++groups_.groups_[g].states_[i].count_;
+            continue;
+        }
+        Value val = materialize_value(&ctx_->temp_arena_, evaluate_expression(ctx_, agg->exp_, output_));
+        if(error_status_)  return;
+        if(val.isNull()) continue;
+        update_state(g, i, val);
+    }
+}
 
-        // update the extra counter.
-        //if(output_[output_.size() - 1].isNull()) output_[output_.size() - 1] = Value(0);
-        //output_[output_.size() - 1] += 1; 
-        //Value* counter = &output_[output_.size() - 1];
-        int* counter = &aggregated_values_[hash_key].second;
-        *counter += 1;
+void AggregationExecutor::update_state(u32 g, u32 agg, const Value& val) {
+    if((*aggregates_)[agg]->distinct_ && !groups_.insert_distinct(groups_arena_, g, agg, val)) return;
+    AggState& state = groups_.groups_[g].states_[agg];
+    switch((*aggregates_)[agg]->type_){
+        case COUNT:
+            ++state.count_;
+            break;
+        case AVG:
+        case SUM:
+            if(state.val_.isNull()) state.val_ = Value(0);
+            state.val_ += val;
+            ++state.count_;
+            break;
+        case MIN:
+            if(state.val_.isNull() || state.val_ > val) 
+                state.val_ = copy_var_len_value(groups_arena_, val);
+            break;
+        case MAX:
+            if(state.val_.isNull() || state.val_ < val) 
+                state.val_ = copy_var_len_value(groups_arena_, val);
+            break;
+        default :
+            break;
+    }
+}
 
-        int base_size = child_output.size();
-        for(int i = 0; i < aggregates_->size(); i++){
-            ExpressionNode* exp = (*aggregates_)[i]->exp_;
-            if(exp){
-                Value val = evaluate_expression(ctx_, exp, output_);
-                String str_val = val.toString();
+void AggregationExecutor::finalize_group(AggGroup& group) {
+    int agg_base_idx = output_schema_->numOfCols() - aggregates_->size();
+    for(int i = 0; i < aggregates_->size(); i++){
+        AggState& state = group.states_[i];
+        Value result = state.val_;
+        switch((*aggregates_)[i]->type_){
+            case COUNT:
+                result = state.count_ > MAX_I32 ? Value((i64)state.count_) : Value((i32)state.count_);
+                break;
+            case AVG:
+                if(!result.isNull()) result /= Value((float)state.count_);
+                break;
+            default :
+                break;
+        }
+        group.row_.put_val_at(agg_base_idx + i, result);
+    }
+}
 
-                String8 v = str_alloc(&ctx_->arena_, str_val.size());
-                memcpy(v.str_, str_val.c_str(), str_val.size());
+bool AggregationExecutor::over_budget() {
+    // the last level is aggregated in memory whatever its size (usually a few huge groups).
+    return level_ < AGG_MAX_LEVEL && groups_arena_->alloc_pos_ + groups_.memory_usage() > ctx_->work_mem_;
+}
 
-                if((*aggregates_)[i]->distinct_){
-                    if(distinct_counters_[hash_key][i].count(v)) continue;
-                    distinct_counters_[hash_key][i].insert(v);
-                }
-            }
-            int idx = base_size+i;
-            switch((*aggregates_)[i]->type_){
-                case COUNT:
-                    {
-                        if(exp == nullptr){
-                            ++output_.get_val_at(idx);
-                            break;
-                        }
-                        Value val = evaluate_expression(ctx_, exp, output_);
-                        if(!val.isNull()){
-                            ++output_.get_val_at(idx);
-                        }
-                    }
-                    break;
-                case AVG:
-                case SUM:
-                    {
-                        Value val = evaluate_expression(ctx_, exp, output_);
-                        if(output_.get_val_at(idx).isNull() 
-                                && !val.isNull()) output_.put_val_at(idx, Value(0));
-                        if(!val.isNull()) {
-                            output_.get_val_at(idx) += val;
-                        }
-                        else if(val.isNull())
-                            *counter += -1;
-                    }
-                    break;
-                case MIN:
-                    {
-                        Value val = evaluate_expression(ctx_, exp, output_);
-                        if(!val.isNull()) {
-                            if(output_.get_val_at(idx).isNull() || output_.get_val_at(idx) > val) 
-                                output_.put_val_at(idx, val);
-                            //output_[idx] = std::min<Value>(output_[idx], val);
-                        }
-                    }
-                    break;
-                case MAX:
-                    {
-                        Value val = evaluate_expression(ctx_, exp, output_);
-                        if(!val.isNull()) {
-                            if(output_.get_val_at(idx).isNull() || output_.get_val_at(idx) < val) 
-                                output_.put_val_at(idx, val);
-                            //output_[idx] = std::max<Value>(output_[i], val);
-                        }
-                    }
-                    break;
-                default :
-                    break;
-            }
-            if(error_status_)  return;
+void AggregationExecutor::spill_groups(u32 level) {
+    if(partitions_.size() == 0) partitions_.assign(HASH_JOIN_FANOUT, nullptr);
+    spilled_ = true;
+    u32 num_keys = group_by_->size();
+    u32 num_cols = output_schema_->numOfCols() - aggregates_->size();
+    for(u32 g = 0; !error_status_ && g < groups_.size(); ++g){
+        AggGroup& group = groups_.groups_[g];
+        TableSchema** table = &partitions_[join_partition_of(group.hash_, level)];
+        if(!*table) *table = new_spill_table(ctx_);
+        if(!*table) {
+            error_status_ = 1;
+            break;
+        }
+        // kind, keys, the first row, then the value and the count of every aggregate.
+        ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+        Tuple record(&ctx_->temp_arena_);
+        record.resize(1 + num_keys + num_cols + 2 * aggregates_->size());
+        u32 pos = 0;
+        record.put_val_at(pos++, Value(AGG_SPILL_GROUP));
+        for(u32 i = 0; i < num_keys; ++i)
+            record.put_val_at(pos++, group.keys_[i]);
+        for(u32 i = 0; i < num_cols; ++i)
+            record.put_val_at(pos++, group.row_.get_val_at(i));
+        for(u32 i = 0; i < aggregates_->size(); ++i){
+            record.put_val_at(pos++, group.states_[i].val_);
+            record.put_val_at(pos++, Value((i64)group.states_[i].count_));
         }
-        aggregated_values_[hash_key].first = output_;
-        if(!child_executor_) break;
+        if(write_spill_row(ctx_, *table, record)) error_status_ = 1;
+        ctx_->temp_arena_.clear_temp_arena(scratch);
+    }
+    // kind, keys, the aggregate, the value.
+    for(u32 e = 0; !error_status_ && e < groups_.distinct_.size(); ++e){
+        AggDistinctEntry& entry = groups_.distinct_[e];
+        AggGroup& group = groups_.groups_[entry.group_];
+        ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+        Tuple record(&ctx_->temp_arena_);
+        record.resize(num_keys + 3);
+        record.put_val_at(0, Value(AGG_SPILL_DISTINCT));
+        for(u32 i = 0; i < num_keys; ++i)
+            record.put_val_at(1 + i, group.keys_[i]);
+        record.put_val_at(num_keys + 1, Value((i32)entry.agg_));
+        record.put_val_at(num_keys + 2, entry.val_);
+        if(write_spill_row(ctx_, partitions_[join_partition_of(group.hash_, level)], record)) error_status_ = 1;
+        ctx_->temp_arena_.clear_temp_arena(scratch);
     }
-    if(aggregated_values_.size() > 1) aggregated_values_.erase(str_lit("PREFIX_"));
-    it_ = aggregated_values_.begin();
+    groups_.init(num_keys, aggregates_->size());
+    groups_arena_->clear();
 }
 
-Tuple AggregationExecutor::next() {
-    if(error_status_ || finished_)  return {};
-    if(it_== aggregated_values_.end()){
-        finished_ = true;
-        return {};
+void AggregationExecutor::merge_spilled(const Tuple& record) {
+    u32 num_keys = group_by_->size();
+    u32 num_cols = output_schema_->numOfCols() - aggregates_->size();
+    for(u32 i = 0; i < num_keys; ++i)
+        keys_[i] = record.get_val_at(1 + i);
+    u64 hash = agg_keys_hash(keys_, num_keys);
+    u32 g = groups_.find(keys_, hash);
+    if(record.get_val_at(0).getIntVal() == AGG_SPILL_DISTINCT) {
+        if(g == AGG_NO_GROUP) g = new_group({}, hash);
+        update_state(g, record.get_val_at(num_keys + 1).getIntVal(), record.get_val_at(num_keys + 2));
+        return;
     }
-    output_ = it_->second.first;
-    int cnt = it_->second.second;
-    for(int i = 0; i < aggregates_->size(); i++){
-        int idx = (i + output_schema_->numOfCols() - aggregates_->size());
-        if((*aggregates_)[i]->type_ == AVG && cnt != 0) {
-            if(output_.get_val_at(idx).isNull()){
+    if(g == AGG_NO_GROUP) {
+        Tuple first_row(&ctx_->temp_arena_);
+        first_row.resize(num_cols);
+        for(u32 i = 0; i < num_cols; ++i)
+            first_row.put_val_at(i, record.get_val_at(1 + num_keys + i));
+        g = new_group(first_row, hash);
+    }
+    u32 pos = 1 + num_keys + num_cols;
+    for(u32 i = 0; i < aggregates_->size(); ++i, pos += 2){
+        AggregateFuncNode* agg = (*aggregates_)[i];
+        AggState& state = groups_.groups_[g].states_[i];
+        const Value& val = record.get_val_at(pos);
+        i64 count = record.get_val_at(pos + 1).getBigIntVal();
+        // rebuilt from the distinct values that follow the group.
+        if(agg->distinct_) continue;
+        switch(agg->type_){
+            case COUNT:
+                state.count_ += count;
+                break;
+            case AVG:
+            case SUM:
+                if(val.isNull()) break;
+                if(state.val_.isNull()) state.val_ = Value(0);
+                state.val_ += val;
+                state.count_ += count;
+                break;
+            case MIN:
+            case MAX:
+                if(!val.isNull()) update_state(g, i, val);
+                break;
+            default :
+                break;
+        }
+    }
+}
+
+bool AggregationExecutor::load_partition() {
+    while(!error_status_){
+        // the groups of the finished level go to the partitions of the next one.
+        if(spilled_) {
+            spill_groups(level_);
+            for(int i = 0; i < partitions_.size(); ++i){
+                if(partitions_[i]) pending_.push_back({.table_ = partitions_[i], .level_ = level_ + 1});
+            }
+            partitions_.clear();
+            spilled_ = false;
+        }
+        if(error_status_ || pending_.size() == 0) return false;
+        AggPartition part = pending_.back();
+        pending_.pop_back();
+        level_ = part.level_;
+        group_pos_ = 0;
+        groups_.init(group_by_->size(), aggregates_->size());
+        groups_arena_->clear();
+
+        TableIterator it = part.table_->begin();
+        it.init();
+        Tuple record;
+        ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+        while(!error_status_ && it.advance()){
+            spill_arena_->clear();
+            if(read_spill_row(&it, spill_arena_, &record)) {
+                error_status_ = 1;
                 break;
-            } 
-            else {
-                float denom = cnt;
-                if((*aggregates_)[i]->distinct_) 
-                    denom = distinct_counters_[it_->first][i].size();
-                output_.get_val_at(idx) /= Value(denom);
             }
+            merge_spilled(record);
+            ctx_->temp_arena_.clear_temp_arena(scratch);
+            if(over_budget()) spill_groups(level_);
         }
+        it.destroy();
+        drop_spill_table(ctx_, part.table_);
+        if(!spilled_) return !error_status_;
     }
-    ++it_;
-    if(it_== aggregated_values_.end())
+    return false;
+}
+
+Tuple AggregationExecutor::next() {
+    return next_from_batch();
+}
+
+bool AggregationExecutor::next_batch(RowBatch* batch) {
+    batch->reset();
+    if(error_status_ || finished_)  return false;
+    while(!batch->is_full()){
+        // the groups of a spilled partition are returned before merging the next one.
+        if(group_pos_ >= groups_.size() && (batch->size() || !load_partition())) break;
+        if(group_pos_ >= groups_.size()) continue;
+        AggGroup& group = groups_.groups_[group_pos_++];
+        finalize_group(group);
+        batch->append(group.row_, false);
+    }
+    if(error_status_) return false;
+    if(batch->size() == 0) {
         finished_ = true;
-    return output_;
+        return false;
+    }
+    return true;
 }
 
 ProjectionExecutor::ProjectionExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child_executor):
-    Executor(arena, ctx, plan_node, nullptr, child_executor, PROJECTION_EXECUTOR), fields_(arena)
+    Executor(arena, ctx, plan_node, nullptr, child_executor, PROJECTION_EXECUTOR), fields_(arena),
+    child_row_(arena)
 {
     assert(plan_node != nullptr && plan_node->type_ == PROJECTION);
     //type_ = PROJECTION_EXECUTOR;
@@ -1435,6 +3194,8 @@ ProjectionExecutor::ProjectionExecutor(Arena* arena, QueryCTX* ctx, AlgebraOpera
 void ProjectionExecutor::init() {
     finished_ = 0;
     error_status_ = 0;
+    evaluated_ = false;
+    reset_batch();
     Vector<ExpressionNode*> *cur_fields = &((ProjectionOperation*)plan_node_)->fields_;
     if(child_executor_) {
         child_executor_->init();
@@ -1459,21 +3220,10 @@ void ProjectionExecutor::init() {
 }
 
 Tuple ProjectionExecutor::next() {
-    if(error_status_ || finished_)  return {};
-
-    Tuple child_output = {};
-
-    if(child_executor_){
-        child_output = child_executor_->next();
-        error_status_ = child_executor_->error_status_;
-        finished_ = child_executor_->finished_;
-    } else {
-        finished_ = true;
-    }
-
-    if(child_executor_ && ((finished_ || error_status_) && child_output.is_empty())) return {};
-
+    return next_from_batch();
+}
 
+void ProjectionExecutor::project(const Tuple& child_output) {
     int cur_idx = 0;
     for(int i = 0; i < fields_.size(); i++){
         if(fields_[i] == nullptr){
@@ -1484,12 +3234,47 @@ Tuple ProjectionExecutor::next() {
             cur_idx++;
         }
     }
-    return output_;
+}
+
+bool ProjectionExecutor::next_batch(RowBatch* batch) {
+    batch->reset();
+    if(error_status_ || finished_)  return false;
+
+    if(!child_executor_) {
+        if(evaluated_) {
+            finished_ = true;
+            return false;
+        }
+        evaluated_ = true;
+        project({});
+        batch->append(output_, true);
+        return true;
+    }
+
+    if(!input_) {
+        input_ = ALLOCATE(ctx_->arena_, RowBatch);
+        new(input_) RowBatch();
+        input_->init(ctx_);
+    }
+    input_->capacity_ = batch->capacity_;
+    ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+    while(child_executor_->next_batch(input_)){
+        for(u32 i = 0; i < input_->size(); ++i){
+            input_->get_row(i, &child_row_);
+            project(child_row_);
+            batch->append(output_, true);
+            ctx_->temp_arena_.clear_temp_arena(scratch);
+        }
+        if(batch->size()) return true;
+    }
+    error_status_ = child_executor_->error_status_;
+    finished_ = true;
+    return false;
 }
 
 SortExecutor::SortExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child_executor):
     Executor(arena, ctx, plan_node, nullptr, child_executor, SORT_EXECUTOR),
-    tuples_(arena)
+    entries_(arena), runs_(arena), merge_(arena)
 {
     assert(plan_node != nullptr && plan_node->type_ == SORT);
     assert(child_executor != nullptr);
@@ -1504,56 +3289,308 @@ SortExecutor::SortExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_n
     parent_query_idx_ = ctx->queries_call_stack_[query_idx_]->parent_idx_;
     
     order_by_list_ = &((SortOperation*)plan_node_)->order_by_list_;
+    order_by_desc_ = &((SortOperation*)plan_node_)->order_by_desc_;
+    limit_ = ((SortOperation*)plan_node_)->limit_;
 
     output_.resize(output_schema_->numOfCols());
 }
 
 void SortExecutor::init() {
-    if(idx_ != 0) {
+    // the input is sorted once, later calls start over from the first row.
+    if(sorted_) {
         idx_ = 0;
         finished_ = 0;
-        error_status_ = 0;
+        if(!error_status_ && runs_.size()) open_runs(0, runs_.size());
         return;
     }
     child_executor_->init();
+    error_status_ = child_executor_->error_status_;
+    if(error_status_) return;
+
+    if(!input_) {
+        input_ = ALLOCATE(ctx_->arena_, RowBatch);
+        new(input_) RowBatch();
+        input_->init(ctx_);
+        rows_arena_ = ALLOCATE(ctx_->arena_, Arena);
+        new(rows_arena_) Arena();
+        rows_arena_->init();
+        ctx_->batch_arenas_.push_back(rows_arena_);
+        if(limit_ != MAX_U64) {
+            spare_arena_ = ALLOCATE(ctx_->arena_, Arena);
+            new(spare_arena_) Arena();
+            spare_arena_->init();
+            ctx_->batch_arenas_.push_back(spare_arena_);
+        }
+    }
 
-    while(true){
-        Tuple t; 
-        t = child_executor_->next();
-        error_status_ = child_executor_->error_status_;
-        if(error_status_)  return;
-        if(!t.is_empty())
-            tuples_.push_back(t.duplicate(&ctx_->arena_));
-        if(child_executor_->finished_) break;
-    }
-
-    std::sort(tuples_.begin(), tuples_.end(), 
-            [this](Tuple& lhs, Tuple& rhs){
-            auto order_by_list_ = this->order_by_list_;
-            for(int i = 0; i < order_by_list_->size(); i++){
-            auto lhs_val = lhs.get_val_at((*order_by_list_)[i]);
-            auto rhs_val = rhs.get_val_at((*order_by_list_)[i]);
-            if(lhs_val.isNull() && !rhs_val.isNull()) return true;
-            if(!lhs_val.isNull()&& rhs_val.isNull()) return false;
-            if(lhs_val.isNull() && rhs_val.isNull()) return false;
-            if(lhs_val != rhs_val) {
-            return lhs_val < rhs_val;
+    top_n_ = limit_ != MAX_U64;
+    Tuple row(&ctx_->arena_);
+    while(!error_status_ && child_executor_->next_batch(input_)){
+        for(u32 i = 0; i < input_->size(); ++i){
+            input_->get_row(i, &row);
+            if(top_n_) {
+                push_top_n(row);
+                continue;
             }
+            Tuple t = row.duplicate(rows_arena_);
+            materialize_key_columns(&t, *order_by_list_, rows_arena_);
+            entries_.push_back({build_sort_key(rows_arena_, t, *order_by_list_, *order_by_desc_), t});
+            if(rows_arena_->alloc_pos_ + entries_.size() * sizeof(SortEntry) > ctx_->work_mem_)
+                spill_run();
+        }
+    }
+    if(child_executor_->error_status_) error_status_ = 1;
+    if(error_status_) return;
+
+    if(top_n_) {
+        std::sort_heap(entries_.begin(), entries_.end(), sort_entry_less);
+    } else if(runs_.size() == 0) {
+        std::stable_sort(entries_.begin(), entries_.end(), [](const SortEntry& lhs, const SortEntry& rhs){
+                return sort_key_cmp(lhs.key_, rhs.key_) < 0;
+                });
+    } else {
+        if(entries_.size()) spill_run();
+        while(!error_status_ && runs_.size() > SORT_MERGE_FANIN){
+            Vector<TableSchema*> merged(&ctx_->arena_);
+            for(u32 i = 0; !error_status_ && i < runs_.size(); i += SORT_MERGE_FANIN){
+                u32 count = std::min((u32)SORT_MERGE_FANIN, (u32)runs_.size() - i);
+                merged.push_back(count == 1 ? runs_[i] : merge_runs(i, count));
             }
-            return false;
+            runs_ = merged;
+        }
+        if(!error_status_) open_runs(0, runs_.size());
+    }
+    sorted_ = true;
+    idx_ = 0;
+}
+
+void SortExecutor::push_top_n(Tuple row) {
+    if(limit_ == 0) return;
+    ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+    materialize_key_columns(&row, *order_by_list_, &ctx_->temp_arena_);
+    String8 key = build_sort_key(&ctx_->temp_arena_, row, *order_by_list_, *order_by_desc_);
+    // equal keys are won by the row that came first, so the new row has to be strictly smaller than the largest one.
+    if(entries_.size() == limit_ && sort_key_cmp(key, entries_[0].key_) >= 0) {
+        ctx_->temp_arena_.clear_temp_arena(scratch);
+        return;
+    }
+    SortEntry entry = {
+        .key_   = str_copy(rows_arena_, key),
+        .tuple_ = row.duplicate(rows_arena_),
+        .seq_   = next_seq_++,
+    };
+    ctx_->temp_arena_.clear_temp_arena(scratch);
+    if(entries_.size() == limit_) {
+        std::pop_heap(entries_.begin(), entries_.end(), sort_entry_less);
+        entries_.back() = entry;
+        ++replaced_;
+    } else {
+        entries_.push_back(entry);
+    }
+    std::push_heap(entries_.begin(), entries_.end(), sort_entry_less);
+
+    bool over_budget = rows_arena_->alloc_pos_ + entries_.size() * sizeof(SortEntry) > ctx_->work_mem_;
+    if(replaced_ && (replaced_ >= entries_.size() || over_budget))
+        compact_top_n();
+    // the top rows themselves don't fit in memory, continue as a normal external sort.
+    if(rows_arena_->alloc_pos_ + entries_.size() * sizeof(SortEntry) > ctx_->work_mem_) {
+        std::sort_heap(entries_.begin(), entries_.end(), sort_entry_less);
+        top_n_ = false;
+    }
+}
+
+void SortExecutor::compact_top_n() {
+    spare_arena_->clear();
+    for(u32 i = 0; i < entries_.size(); ++i){
+        entries_[i].key_   = str_copy(spare_arena_, entries_[i].key_);
+        entries_[i].tuple_ = entries_[i].tuple_.duplicate(spare_arena_);
+    }
+    rows_arena_->clear();
+    std::swap(rows_arena_, spare_arena_);
+    replaced_ = 0;
+}
+
+void SortExecutor::spill_run() {
+    std::stable_sort(entries_.begin(), entries_.end(), [](const SortEntry& lhs, const SortEntry& rhs){
+            return sort_key_cmp(lhs.key_, rhs.key_) < 0;
             });
+    TableSchema* run = new_spill_table(ctx_);
+    if(!run) error_status_ = 1;
+    for(u32 i = 0; !error_status_ && i < entries_.size(); ++i){
+        ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+        String8 row = entries_[i].tuple_.serialize(&ctx_->temp_arena_);
+        u32 key_size = entries_[i].key_.size_;
+        String8 data = {};
+        data.size_ = sizeof(u32) + key_size + row.size_;
+        data.str_ = (u8*)ctx_->temp_arena_.alloc(data.size_);
+        memcpy(data.str_, &key_size, sizeof(u32));
+        memcpy(data.str_ + sizeof(u32), entries_[i].key_.str_, key_size);
+        memcpy(data.str_ + sizeof(u32) + key_size, row.str_, row.size_);
+        if(write_spill_data(ctx_, run, data)) error_status_ = 1;
+        ctx_->temp_arena_.clear_temp_arena(scratch);
+    }
+    runs_.push_back(run);
+    entries_.clear();
+    rows_arena_->clear();
+}
+
+void SortExecutor::open_runs(u32 first, u32 count) {
+    assert(count <= SORT_MERGE_FANIN);
+    if(!run_its_) {
+        run_its_    = (TableIterator*) ctx_->arena_.alloc(sizeof(TableIterator) * SORT_MERGE_FANIN);
+        run_arenas_ = (Arena**)        ctx_->arena_.alloc(sizeof(Arena*) * SORT_MERGE_FANIN);
+        run_data_   = (String8*)       ctx_->arena_.alloc(sizeof(String8) * SORT_MERGE_FANIN);
+        run_rows_   = (Tuple*)         ctx_->arena_.alloc(sizeof(Tuple) * SORT_MERGE_FANIN);
+        for(u32 i = 0; i < SORT_MERGE_FANIN; ++i){
+            new(&run_its_[i]) TableIterator();
+            new(&run_rows_[i]) Tuple();
+            ctx_->table_handles_.push_back(&run_its_[i]);
+            run_arenas_[i] = ALLOCATE(ctx_->arena_, Arena);
+            new(run_arenas_[i]) Arena();
+            run_arenas_[i]->init();
+            ctx_->batch_arenas_.push_back(run_arenas_[i]);
+        }
+    }
+    first_run_ = first;
+    merge_.init(count);
+    for(u32 i = 0; i < count; ++i){
+        run_its_[i].destroy();
+        run_its_[i] = runs_[first + i]->begin();
+        run_its_[i].init();
+        advance_run(i);
+    }
+    merge_.build();
+    advance_winner_ = false;
+}
+
+void SortExecutor::advance_run(u32 source) {
+    run_arenas_[source]->clear();
+    merge_.keys_[source] = {};
+    if(error_status_ || !run_its_[source].advance()) return;
+    String8 data = read_spill_data(&run_its_[source], run_arenas_[source]);
+    u32 key_size = 0;
+    if(data.size_ >= sizeof(u32)) memcpy(&key_size, data.str_, sizeof(u32));
+    String8 row = {.str_ = data.str_ + sizeof(u32) + key_size, .size_ = data.size_ - sizeof(u32) - key_size};
+    run_rows_[source] = Tuple(run_arenas_[source]);
+    if(!data.str_ || data.size_ < sizeof(u32) + key_size || run_rows_[source].deserialize(row)) {
+        error_status_ = 1;
+        return;
+    }
+    run_data_[source] = data;
+    merge_.keys_[source] = {.str_ = data.str_ + sizeof(u32), .size_ = key_size};
+}
+
+TableSchema* SortExecutor::merge_runs(u32 first, u32 count) {
+    TableSchema* run = new_spill_table(ctx_);
+    if(!run) {
+        error_status_ = 1;
+        return nullptr;
+    }
+    open_runs(first, count);
+    while(!error_status_){
+        u32 winner = merge_.winner();
+        if(!merge_.keys_[winner].str_) break;
+        if(write_spill_data(ctx_, run, run_data_[winner])) error_status_ = 1;
+        advance_run(winner);
+        merge_.replay();
+    }
+    for(u32 i = 0; i < count; ++i){
+        run_its_[i].destroy();
+        drop_spill_table(ctx_, runs_[first + i]);
+    }
+    return run;
+}
+
+Tuple SortExecutor::merge_next() {
+    if(advance_winner_) {
+        advance_run(merge_.winner());
+        merge_.replay();
+        advance_winner_ = false;
+    }
+    u32 winner = merge_.winner();
+    if(error_status_ || !merge_.keys_[winner].str_) {
+        finished_ = true;
+        return {};
+    }
+    advance_winner_ = true;
+    output_ = run_rows_[winner];
+    return output_;
 }
 
 Tuple SortExecutor::next() {
-    finished_ = (idx_ >= tuples_.size());
-    if(error_status_ || finished_)  return {};
-    output_ = tuples_[idx_++];
+    if(error_status_) return {};
+    if(runs_.size()) return merge_next();
+    finished_ = (idx_ >= entries_.size());
+    if(finished_)  return {};
+    output_ = entries_[idx_++].tuple_;
     return output_;
 }
 
+LimitExecutor::LimitExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child_executor):
+    Executor(arena, ctx, plan_node, nullptr, child_executor, LIMIT_EXECUTOR)
+{
+    assert(plan_node != nullptr && plan_node->type_ == LIMIT);
+    assert(child_executor != nullptr);
+    output_schema_ = child_executor_->output_schema_;
+
+    query_idx_ = plan_node->query_idx_;
+    assert(query_idx_ < ctx->queries_call_stack_.size());
+    parent_query_idx_ = ctx->queries_call_stack_[query_idx_]->parent_idx_;
+
+    limit_  = ((LimitOperation*)plan_node_)->limit_;
+    offset_ = ((LimitOperation*)plan_node_)->offset_;
+}
+
+void LimitExecutor::init() {
+    finished_ = 0;
+    error_status_ = 0;
+    skipped_  = 0;
+    returned_ = 0;
+    reset_batch();
+    // LIMIT 0 never needs the child.
+    if(limit_ == 0) {
+        finished_ = true;
+        return;
+    }
+    child_executor_->init();
+    error_status_ = child_executor_->error_status_;
+}
+
+Tuple LimitExecutor::next() {
+    return next_from_batch();
+}
+
+bool LimitExecutor::next_batch(RowBatch* batch) {
+    batch->reset();
+    if(error_status_ || finished_ || returned_ >= limit_) {
+        finished_ = true;
+        return false;
+    }
+    u32 capacity = batch->capacity_;
+    while(true){
+        u64 needed = (offset_ - skipped_) + (limit_ - returned_);
+        if(needed < limit_ - returned_) needed = MAX_U64; // overflow.
+        batch->capacity_ = std::min<u64>(capacity, needed);
+        bool has_rows = child_executor_->next_batch(batch);
+        batch->capacity_ = capacity;
+        if(!has_rows) break;
+
+        u32 skip = std::min<u64>(batch->size(), offset_ - skipped_);
+        u32 take = std::min<u64>(batch->size() - skip, limit_ - returned_);
+        memmove(batch->sel_, batch->sel_ + skip, take * sizeof(u16));
+        batch->sel_count_ = take;
+        skipped_  += skip;
+        returned_ += take;
+        if(take) return true;
+    }
+    error_status_ = child_executor_->error_status_;
+    finished_ = true;
+    return false;
+}
+
 DistinctExecutor::DistinctExecutor(Arena* arena, QueryCTX* ctx, Executor* child_executor):
     Executor(arena, ctx, nullptr, nullptr, child_executor, DISTINCT_EXECUTOR),
-    hashed_tuples_(arena)
+    set_(arena)
 {
     assert(child_executor != nullptr);
     //type_ = DISTINCT_EXECUTOR;
@@ -1572,33 +3609,68 @@ void DistinctExecutor::init() {
     finished_ = 0;
     error_status_ = 0;
     child_executor_->init();
+    has_last_ = false;
+    if(!sorted_input_) {
+        set_.init(ctx_, SET_DISTINCT, false);
+        return;
+    }
+    if(!last_arena_) {
+        Arena** arenas[] = {&last_arena_, &spare_arena_};
+        for(int i = 0; i < 2; ++i){
+            *arenas[i] = ALLOCATE(ctx_->arena_, Arena);
+            new(*arenas[i]) Arena();
+            (*arenas[i])->init();
+            ctx_->batch_arenas_.push_back(*arenas[i]);
+        }
+    }
 }
 
 Tuple DistinctExecutor::next() {
     if(error_status_ || finished_)  return {};
-    while(true){
-        if(finished_ || error_status_) return {};
+    while(!child_executor_->finished_){
         Tuple t = child_executor_->next();
-        if(t.is_empty()) {
-            finished_ = true;
+        if(child_executor_->error_status_) {
+            error_status_ = true;
             return {};
         }
-        error_status_ = child_executor_->error_status_;
-        finished_ = child_executor_->finished_;
-        String stringified_tuple = t.stringify();
-        String8 key = str_alloc(&ctx_->arena_, stringified_tuple.size());
-        memcpy(key.str_, stringified_tuple.c_str(), stringified_tuple.size());
-
-        if(hashed_tuples_.count(key)) continue; // duplicated tuple => skip it.
-        hashed_tuples_[key] =  1;
+        if(t.is_empty()) break;
+        if(sorted_input_) {
+            ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+            Tuple row = materialize_row(&ctx_->temp_arena_, t);
+            bool duplicate = has_last_ && set_row_eq(row, last_row_);
+            // the copy goes to the spare arena while the last row is still needed, then the two are swapped.
+            if(!duplicate) {
+                spare_arena_->clear();
+                last_row_ = row.duplicate(spare_arena_);
+                std::swap(last_arena_, spare_arena_);
+                has_last_ = true;
+            }
+            ctx_->temp_arena_.clear_temp_arena(scratch);
+            if(duplicate) continue; // duplicated tuple => skip it.
+            output_ = t;
+            return output_;
+        }
+        if(!set_.probe(t)) {
+            if(set_.error_status_) {
+                error_status_ = true;
+                return {};
+            }
+            continue; // duplicated tuple => skip it.
+        }
         output_ = t;
         return output_;
     }
+    if(!sorted_input_) {
+        if(set_.next_spilled(&output_)) return output_;
+        error_status_ = set_.error_status_;
+    }
+    finished_ = true;
+    return {};
 }
 
 SubQueryExecutor::SubQueryExecutor(Arena* arena, QueryCTX* ctx, Executor* child_executor):
     Executor(arena, ctx, nullptr, nullptr, child_executor, SUB_QUERY_EXECUTOR),
-    tuple_list_(arena)
+    tuple_list_(arena), value_set_(arena)
 {
     assert(child_executor != nullptr);
     //type_ = SUB_QUERY_EXECUTOR;
@@ -1648,6 +3720,36 @@ Tuple SubQueryExecutor::next() {
     return output_;
 }
 
+Value SubQueryExecutor::match(const Value& val) {
+    if(val.isNull()) return Value(NULL_TYPE);
+    if(!cached_) init();
+    if(error_status_) return Value();
+    if(!value_set_built_) {
+        for(Tuple& t : tuple_list_) {
+            Value& v = t.get_val_at(0);
+            if(v.isNull()) {
+                value_set_has_null_ = true;
+                continue;
+            }
+            if(v.type_ == OVERFLOW_ITERATOR) v = Value(v.getStringView(&ctx_->arena_));
+            value_set_.insert(t, value_hash(v), false);
+        }
+        value_set_.build();
+        value_set_built_ = true;
+    }
+    Value key = val;
+    if(key.type_ == OVERFLOW_ITERATOR) key = Value(key.getStringView(&ctx_->temp_arena_));
+    u64 hash = value_hash(key);
+    if(value_set_.may_contain(hash)) {
+        for(u32 r = value_set_.find(hash); r != JOIN_NO_ROW; r = value_set_.rows_[r].next_) {
+            JoinRow& row = value_set_.rows_[r];
+            if(row.hash_ == hash && value_key_eq(row.tuple_.get_val_at(0), key)) return val;
+        }
+    }
+    if(value_set_has_null_) return Value(NULL_TYPE);
+    return Value(INVALID);
+}
+
 FilterExecutor::FilterExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child_executor):
     Executor(arena, ctx, plan_node, nullptr, child_executor, FILTER_EXECUTOR)
 {
@@ -1672,6 +3774,8 @@ FilterExecutor::FilterExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* pl
 void FilterExecutor::init() {
     error_status_ = 0;
     finished_ = 0;
+    evaluated_ = false;
+    reset_batch();
     if(child_executor_) {
         child_executor_->init();
     }
@@ -1689,24 +3793,48 @@ void FilterExecutor::init() {
 
 
 Tuple FilterExecutor::next() {
-    while(true){
-        if(error_status_ || finished_)  return {};
-        if(child_executor_) {
-            output_ = child_executor_->next();
-            error_status_ = child_executor_->error_status_;
-            finished_ = child_executor_->finished_;
-        } else {
-            finished_ = true;
-        }
-
-        if(child_executor_ && ((finished_ || error_status_) && output_.is_empty())) return {};
+    return next_from_batch();
+}
 
-        Value exp = evaluate_flat_expression(ctx_, *filter_, output_);
-        if(!exp.isNull() && exp.getBoolVal() != false){
-            if(!child_executor_){
+// the child fills the batch of the parent directly, the rows that don't pass are dropped from the selection vector.
+bool FilterExecutor::next_batch(RowBatch* batch) {
+    if(error_status_ || finished_) {
+        batch->reset();
+        return false;
+    }
+    if(!child_executor_) {
+        batch->reset();
+        if(!evaluated_) {
+            evaluated_ = true;
+            Value exp = evaluate_flat_expression(ctx_, *filter_, output_);
+            if(!exp.isNull() && exp.getBoolVal() != false){
                 output_.put_val_at(0, exp);
+                batch->append(output_, true);
+                return true;
             }
-            return output_;
         }
+        finished_ = true;
+        return false;
+    }
+
+    ArenaTemp scratch = ctx_->temp_arena_.start_temp_arena();
+    while(child_executor_->next_batch(batch)){
+        if(filter_batch(ctx_, *filter_, batch)) {
+            if(batch->size()) return true;
+            continue;
+        }
+        u32 selected = 0;
+        for(u32 i = 0; i < batch->size(); ++i){
+            batch->get_row(i, &output_);
+            Value exp = evaluate_flat_expression(ctx_, *filter_, output_);
+            ctx_->temp_arena_.clear_temp_arena(scratch);
+            if(!exp.isNull() && exp.getBoolVal() != false)
+                batch->sel_[selected++] = batch->sel_[i];
+        }
+        batch->sel_count_ = selected;
+        if(selected) return true;
     }
+    error_status_ = child_executor_->error_status_;
+    finished_ = true;
+    return false;
 }
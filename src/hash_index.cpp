@@ -0,0 +1,330 @@
+#pragma once
+#include <shared_mutex>
+#include <mutex>
+#include "cache_manager.cpp"
+#include "page.cpp"
+#include "record.cpp"
+#include "btree_index.cpp"
+#include "hash_index.h"
+
+void HashIndex::init(CacheManager* cm, FileID fid, int nkey_cols, bool is_unique) {
+    cache_manager_ = cm;
+    fid_ = fid;
+    nkey_cols_ = nkey_cols;
+    is_unique_index_ = is_unique;
+
+    PageID zero_pid = {.fid_ = fid_, .page_num_ = 0};
+    // page number 0 is reserved for meta data of the disk manager, it only points to our own meta page.
+    Page* zero_page = cache_manager_->fetchPage(zero_pid);
+    assert(zero_page != 0);
+    meta_pnum_ = *(PageNum*)(zero_page->data_+ROOT_PNUM_OFFSET);
+    cache_manager_->unpinPage(zero_pid, false);
+
+    if(meta_pnum_ == 0) {
+        create_meta();
+        return;
+    }
+
+    // load the directory into memory.
+    PageID meta_pid = {.fid_ = fid_, .page_num_ = meta_pnum_};
+    Page* meta_page = cache_manager_->fetchPage(meta_pid);
+    assert(meta_page != 0);
+    level_      = *(u32*)(meta_page->data_ + HASH_META_LEVEL_OFFSET);
+    split_ptr_  = *(u32*)(meta_page->data_ + HASH_META_SPLIT_PTR_OFFSET);
+    used_bytes_ = *(u64*)(meta_page->data_ + HASH_META_USED_BYTES_OFFSET);
+    u32 num_dir_pages = *(u32*)(meta_page->data_ + HASH_META_NUM_DIR_OFFSET);
+    for(u32 i = 0; i < num_dir_pages; ++i)
+        dir_pages_.push_back(*(PageNum*)(meta_page->data_ + HASH_META_DIR_OFFSET + i*sizeof(PageNum)));
+    cache_manager_->unpinPage(meta_pid, false);
+
+    u32 num_buckets = (HASH_INITIAL_BUCKETS << level_) + split_ptr_;
+    buckets_.reserve(num_buckets);
+    for(u32 i = 0; i < dir_pages_.size() && buckets_.size() < num_buckets; ++i) {
+        PageID dir_pid = {.fid_ = fid_, .page_num_ = dir_pages_[i]};
+        Page* dir_page = cache_manager_->fetchPage(dir_pid);
+        assert(dir_page != 0);
+        for(u32 j = 0; j < HASH_BUCKETS_PER_DIR_PAGE && buckets_.size() < num_buckets; ++j)
+            buckets_.push_back(*(PageNum*)(dir_page->data_ + j*sizeof(PageNum)));
+        cache_manager_->unpinPage(dir_pid, false);
+    }
+    assert(buckets_.size() == num_buckets);
+}
+
+void HashIndex::destroy(){}
+
+void HashIndex::resize_nkey_cols(int nkey_cols){
+    nkey_cols_ = nkey_cols;
+}
+
+FileID HashIndex::get_fid(){
+    return fid_;
+}
+
+bool HashIndex::is_unique(){
+    return is_unique_index_;
+}
+
+void HashIndex::create_meta() {
+    Page* meta_page = cache_manager_->newPage(fid_);
+    assert(meta_page != 0);
+    meta_pnum_ = meta_page->page_id_.page_num_;
+    cache_manager_->unpinPage(meta_page->page_id_, false);
+    cache_manager_->update_root_page_number(fid_, meta_pnum_);
+
+    level_      = 0;
+    split_ptr_  = 0;
+    used_bytes_ = 0;
+    for(u32 i = 0; i < HASH_INITIAL_BUCKETS; ++i) {
+        buckets_.push_back(new_bucket_page());
+        persist_bucket_pnum(i);
+    }
+    persist_meta();
+}
+
+void HashIndex::persist_meta() {
+    PageID meta_pid = {.fid_ = fid_, .page_num_ = meta_pnum_};
+    Page* meta_page = cache_manager_->fetchPage(meta_pid);
+    assert(meta_page != 0);
+    *(u32*)(meta_page->data_ + HASH_META_LEVEL_OFFSET)      = level_;
+    *(u32*)(meta_page->data_ + HASH_META_SPLIT_PTR_OFFSET)  = split_ptr_;
+    *(u64*)(meta_page->data_ + HASH_META_USED_BYTES_OFFSET) = used_bytes_;
+    *(u32*)(meta_page->data_ + HASH_META_NUM_DIR_OFFSET)    = dir_pages_.size();
+    for(u32 i = 0; i < dir_pages_.size(); ++i)
+        *(PageNum*)(meta_page->data_ + HASH_META_DIR_OFFSET + i*sizeof(PageNum)) = dir_pages_[i];
+    cache_manager_->unpinPage(meta_pid, true);
+}
+
+void HashIndex::persist_bucket_pnum(u32 bucket) {
+    assert(bucket < buckets_.size());
+    u32 dir_idx = bucket / HASH_BUCKETS_PER_DIR_PAGE;
+    if(dir_idx >= dir_pages_.size()) {
+        assert(dir_idx == dir_pages_.size() && dir_idx < HASH_MAX_DIR_PAGES);
+        Page* dir_page = cache_manager_->newPage(fid_);
+        assert(dir_page != 0);
+        dir_pages_.push_back(dir_page->page_id_.page_num_);
+        cache_manager_->unpinPage(dir_page->page_id_, false);
+        persist_meta();
+    }
+    PageID dir_pid = {.fid_ = fid_, .page_num_ = dir_pages_[dir_idx]};
+    Page* dir_page = cache_manager_->fetchPage(dir_pid);
+    assert(dir_page != 0);
+    *(PageNum*)(dir_page->data_ + (bucket % HASH_BUCKETS_PER_DIR_PAGE)*sizeof(PageNum)) = buckets_[bucket];
+    cache_manager_->unpinPage(dir_pid, true);
+}
+
+PageNum HashIndex::new_bucket_page() {
+    Page* page = cache_manager_->newPage(fid_);
+    assert(page != 0);
+    memset(page->data_, 0, PAGE_SIZE);
+    *(u16*)(page->data_ + HASH_BUCKET_FREE_OFFSET) = HASH_BUCKET_HEADER_SIZE;
+    PageNum pnum = page->page_id_.page_num_;
+    cache_manager_->unpinPage(page->page_id_, true);
+    return pnum;
+}
+
+u32 HashIndex::bucket_of(u64 hash) {
+    u64 nbuckets = HASH_INITIAL_BUCKETS << level_;
+    u32 bucket = hash % nbuckets;
+    // this bucket was already split in the current round.
+    if(bucket < split_ptr_) bucket = hash % (nbuckets << 1);
+    return bucket;
+}
+
+bool HashIndex::insert_into_bucket(u32 bucket, const char* data, u16 size) {
+    u16 entry_size = size + HASH_ENTRY_HEADER_SIZE;
+    if(entry_size > HASH_BUCKET_CAPACITY) return false;
+
+    PageID pid = {.fid_ = fid_, .page_num_ = buckets_[bucket]};
+    while(true) {
+        Page* page = cache_manager_->fetchPage(pid);
+        assert(page != 0);
+        u16 free_offset = *(u16*)(page->data_ + HASH_BUCKET_FREE_OFFSET);
+        if(PAGE_SIZE - free_offset >= entry_size) {
+            memcpy(page->data_ + free_offset, &size, HASH_ENTRY_HEADER_SIZE);
+            memcpy(page->data_ + free_offset + HASH_ENTRY_HEADER_SIZE, data, size);
+            *(u16*)(page->data_ + HASH_BUCKET_COUNT_OFFSET) += 1;
+            *(u16*)(page->data_ + HASH_BUCKET_FREE_OFFSET)  = free_offset + entry_size;
+            cache_manager_->unpinPage(pid, true);
+            return true;
+        }
+        PageNum next = *(PageNum*)(page->data_ + HASH_BUCKET_NEXT_OFFSET);
+        if(next == 0) {
+            // the chain is full, link a new overflow page at its end.
+            next = new_bucket_page();
+            *(PageNum*)(page->data_ + HASH_BUCKET_NEXT_OFFSET) = next;
+            cache_manager_->unpinPage(pid, true);
+        } else {
+            cache_manager_->unpinPage(pid, false);
+        }
+        pid.page_num_ = next;
+    }
+}
+
+// split the bucket at the split pointer into itself and its buddy bucket at the end of the table.
+void HashIndex::split() {
+    u32 nbuckets   = HASH_INITIAL_BUCKETS << level_;
+    u32 old_bucket = split_ptr_;
+    assert(buckets_.size() == nbuckets + split_ptr_);
+
+    buckets_.push_back(new_bucket_page());
+    persist_bucket_pnum(buckets_.size()-1);
+
+    // move every entry of the chain out then reset it to a single empty page.
+    std::vector<char> entries;
+    PageID pid = {.fid_ = fid_, .page_num_ = buckets_[old_bucket]};
+    bool is_primary = true;
+    while(true) {
+        Page* page = cache_manager_->fetchPage(pid);
+        assert(page != 0);
+        u16 free_offset = *(u16*)(page->data_ + HASH_BUCKET_FREE_OFFSET);
+        entries.insert(entries.end(), page->data_ + HASH_BUCKET_HEADER_SIZE, page->data_ + free_offset);
+        PageNum next = *(PageNum*)(page->data_ + HASH_BUCKET_NEXT_OFFSET);
+        if(is_primary) {
+            memset(page->data_, 0, PAGE_SIZE);
+            *(u16*)(page->data_ + HASH_BUCKET_FREE_OFFSET) = HASH_BUCKET_HEADER_SIZE;
+            cache_manager_->unpinPage(pid, true);
+        } else {
+            cache_manager_->unpinPage(pid, false);
+            cache_manager_->deletePage(pid);
+        }
+        if(next == 0) break;
+        pid.page_num_ = next;
+        is_primary = false;
+    }
+
+    split_ptr_++;
+    if(split_ptr_ == nbuckets) {
+        level_++;
+        split_ptr_ = 0;
+    }
+
+    // redistribute the entries between the old bucket and its buddy.
+    for(u32 offset = 0; offset < entries.size();) {
+        u16 size = *(u16*)(entries.data() + offset);
+        IndexKey k = {.data_ = entries.data() + offset + HASH_ENTRY_HEADER_SIZE, .size_ = size};
+        bool inserted = insert_into_bucket(bucket_of(index_key_hash(k, nkey_cols_)), k.data_, size);
+        assert(inserted);
+        offset += size + HASH_ENTRY_HEADER_SIZE;
+    }
+}
+
+bool HashIndex::Insert(QueryCTX* ctx, const IndexKey &key) {
+    assert(key.data_ && key.size_);
+    std::unique_lock locker(lock_);
+    if(key.size_ + HASH_ENTRY_HEADER_SIZE > HASH_BUCKET_CAPACITY) return false;
+
+    u32 bucket = bucket_of(index_key_hash(key, nkey_cols_));
+    if(is_unique_index_) {
+        PageID pid = {.fid_ = fid_, .page_num_ = buckets_[bucket]};
+        while(pid.page_num_ != 0) {
+            Page* page = cache_manager_->fetchPage(pid);
+            assert(page != 0);
+            u16 free_offset = *(u16*)(page->data_ + HASH_BUCKET_FREE_OFFSET);
+            for(u16 offset = HASH_BUCKET_HEADER_SIZE; offset < free_offset;) {
+                u16 size = *(u16*)(page->data_ + offset);
+                IndexKey cur = {.data_ = page->data_ + offset + HASH_ENTRY_HEADER_SIZE, .size_ = size};
+                if(index_key_prefix_eq(cur, key, nkey_cols_)) {
+                    cache_manager_->unpinPage(pid, false);
+                    return false;
+                }
+                offset += size + HASH_ENTRY_HEADER_SIZE;
+            }
+            PageNum next = *(PageNum*)(page->data_ + HASH_BUCKET_NEXT_OFFSET);
+            cache_manager_->unpinPage(pid, false);
+            pid.page_num_ = next;
+        }
+    }
+
+    bool inserted = insert_into_bucket(bucket, key.data_, key.size_);
+    if(!inserted) return false;
+    used_bytes_ += key.size_ + HASH_ENTRY_HEADER_SIZE;
+
+    // keep the average bucket at most 3/4 full.
+    if(used_bytes_ * 4 > (u64)buckets_.size() * HASH_BUCKET_CAPACITY * 3 && buckets_.size() < HASH_MAX_BUCKETS)
+        split();
+    persist_meta();
+    return true;
+}
+
+void HashIndex::Remove(QueryCTX* ctx, const IndexKey &key) {
+    assert(key.data_ && key.size_);
+    std::unique_lock locker(lock_);
+
+    u32 bucket = bucket_of(index_key_hash(key, nkey_cols_));
+    PageID pid = {.fid_ = fid_, .page_num_ = buckets_[bucket]};
+    PageNum prev = 0; // 0 while pid is the primary bucket page.
+    while(pid.page_num_ != 0) {
+        Page* page = cache_manager_->fetchPage(pid);
+        assert(page != 0);
+        u16 free_offset = *(u16*)(page->data_ + HASH_BUCKET_FREE_OFFSET);
+        for(u16 offset = HASH_BUCKET_HEADER_SIZE; offset < free_offset;) {
+            u16 size = *(u16*)(page->data_ + offset);
+            u16 entry_size = size + HASH_ENTRY_HEADER_SIZE;
+            IndexKey cur = {.data_ = page->data_ + offset + HASH_ENTRY_HEADER_SIZE, .size_ = size};
+            // the key is followed by the record id (2 columns) so it matches exactly one entry.
+            if(index_key_prefix_eq(cur, key, nkey_cols_ + 2)) {
+                memmove(page->data_ + offset, page->data_ + offset + entry_size, free_offset - offset - entry_size);
+                *(u16*)(page->data_ + HASH_BUCKET_COUNT_OFFSET) -= 1;
+                *(u16*)(page->data_ + HASH_BUCKET_FREE_OFFSET)  = free_offset - entry_size;
+                PageNum next = *(PageNum*)(page->data_ + HASH_BUCKET_NEXT_OFFSET);
+                bool is_empty = *(u16*)(page->data_ + HASH_BUCKET_COUNT_OFFSET) == 0;
+                cache_manager_->unpinPage(pid, true);
+                // unlink an overflow page once it is empty, the primary page always stays.
+                if(prev != 0 && is_empty) {
+                    PageID prev_pid = {.fid_ = fid_, .page_num_ = prev};
+                    Page* prev_page = cache_manager_->fetchPage(prev_pid);
+                    assert(prev_page != 0);
+                    *(PageNum*)(prev_page->data_ + HASH_BUCKET_NEXT_OFFSET) = next;
+                    cache_manager_->unpinPage(prev_pid, true);
+                    cache_manager_->deletePage(pid);
+                }
+                used_bytes_ -= entry_size;
+                persist_meta();
+                return;
+            }
+            offset += entry_size;
+        }
+        PageNum next = *(PageNum*)(page->data_ + HASH_BUCKET_NEXT_OFFSET);
+        cache_manager_->unpinPage(pid, false);
+        prev = pid.page_num_;
+        pid.page_num_ = next;
+    }
+}
+
+void HashIndex::find(const IndexKey &key, FileID table_fid, Vector<RecordID>* rids) {
+    assert(key.data_ && key.size_ && rids);
+    std::shared_lock locker(lock_);
+
+    u32 bucket = bucket_of(index_key_hash(key, nkey_cols_));
+    PageID pid = {.fid_ = fid_, .page_num_ = buckets_[bucket]};
+    while(pid.page_num_ != 0) {
+        Page* page = cache_manager_->fetchPage(pid);
+        assert(page != 0);
+        u16 free_offset = *(u16*)(page->data_ + HASH_BUCKET_FREE_OFFSET);
+        for(u16 offset = HASH_BUCKET_HEADER_SIZE; offset < free_offset;) {
+            u16 size = *(u16*)(page->data_ + offset);
+            IndexKey cur = {.data_ = page->data_ + offset + HASH_ENTRY_HEADER_SIZE, .size_ = size};
+            if(index_key_prefix_eq(cur, key, nkey_cols_))
+                rids->push_back(cur.getRID(table_fid));
+            offset += size + HASH_ENTRY_HEADER_SIZE;
+        }
+        PageNum next = *(PageNum*)(page->data_ + HASH_BUCKET_NEXT_OFFSET);
+        cache_manager_->unpinPage(pid, false);
+        pid.page_num_ = next;
+    }
+}
+
+bool IndexHeader::insert(QueryCTX* ctx, const IndexKey& k) {
+    if(hash_index_) return hash_index_->Insert(ctx, k);
+    return index_->Insert(ctx, k);
+}
+
+void IndexHeader::remove(QueryCTX* ctx, const IndexKey& k) {
+    if(hash_index_) hash_index_->Remove(ctx, k);
+    else index_->Remove(ctx, k);
+}
+
+bool IndexHeader::is_unique() const {
+    if(hash_index_) return hash_index_->is_unique();
+    return index_ && index_->is_unique();
+}
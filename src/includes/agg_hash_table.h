@@ -0,0 +1,107 @@
+#ifndef AGG_HASH_TABLE_H
+#define AGG_HASH_TABLE_H
+
+#include "value.h"
+#include "tuple.h"
+#include "ast_nodes.h"
+
+/*
+ * in-memory hash table of the groups of an aggregation.
+ * keys are the typed values of the group by expressions (no string formatting), nulls are equal to each other
+ * so all of them end up in the same group.
+ *
+ * groups   : contiguous array of the groups, every group has its key values, the hash of the keys,
+ *            a copy of the first row of the group and a fixed slot for the state of every aggregate function.
+ *            all of them are allocated once when the group is created, updating a group allocates nothing
+ *            (except when a new text value becomes the MIN or the MAX).
+ * slots    : open addressing (linear probing) from the hash to the group, grows when it is half full.
+ * distinct : the values seen by the DISTINCT aggregates of every group, one open addressing set
+ *            keyed by (group, aggregate, value).
+ */
+
+#define AGG_NO_GROUP ((u32)-1)
+
+/*
+ * spilling hash aggregation (see join_hash_table.h for the partitioning):
+ * once the groups exceed the budget the partial state of every group is written to its partition
+ * and the aggregation goes on with an empty table. a partition is read back by merging the partial states of the same group.
+ * partial results of DISTINCT aggregates can't be merged, so the distinct values of every group are spilled after it
+ * and those aggregates are computed again from them.
+ */
+#define AGG_MAX_LEVEL     4
+
+// the kinds of rows in a partition: the partial state of a group and a value seen by a DISTINCT aggregate of a group.
+#define AGG_SPILL_GROUP    0
+#define AGG_SPILL_DISTINCT 1
+
+class TableSchema;
+
+// a temp table of spilled group states, level_ is the level used to split it if it does not fit in memory.
+struct AggPartition {
+    TableSchema* table_ = nullptr;
+    u32 level_ = 0;
+};
+
+// the running state of one aggregate function of one group.
+struct AggState {
+    // SUM, AVG: the sum so far. MIN, MAX: the current minimum or maximum. null until the first non null value.
+    Value val_ = Value(NULL_TYPE);
+    // COUNT: the result. AVG: the number of summed values.
+    i64   count_ = 0;
+};
+
+struct AggGroup {
+    Value*    keys_   = nullptr;
+    u64       hash_   = 0;
+    // the first row of the group followed by one column for every aggregate.
+    Tuple     row_;
+    AggState* states_ = nullptr;
+};
+
+struct AggSlot {
+    u64 hash_  = 0;
+    u32 group_ = AGG_NO_GROUP;
+};
+
+struct AggDistinctEntry {
+    Value val_;
+    u64   hash_  = 0;
+    u32   group_ = AGG_NO_GROUP;
+    u32   agg_   = 0;
+};
+
+struct AggHashTable {
+    AggHashTable(Arena* arena);
+
+    void init(u32 num_keys, u32 num_aggregates);
+    void clear();
+    // returns the group of the key values or AGG_NO_GROUP.
+    u32  find(const Value* keys, u64 hash);
+    // creates a new group with empty states, the keys are copied into the arena (the caller fills row_).
+    u32  insert(Arena* arena, const Value* keys, u64 hash);
+    // false if the aggregate of the group has already seen the value (nulls are never added).
+    bool insert_distinct(Arena* arena, u32 group, u32 agg, const Value& val);
+    u32  size();
+    // the bytes used by the table itself, the groups data is counted by its arena.
+    u64  memory_usage();
+
+    Vector<AggGroup>         groups_;
+    Vector<AggSlot>          slots_;
+    Vector<AggDistinctEntry> distinct_;
+    Vector<u32>              distinct_slots_;
+    u64 slot_mask_          = 0;
+    u64 distinct_slot_mask_ = 0;
+    u32 num_keys_       = 0;
+    u32 num_aggregates_ = 0;
+
+    private:
+    void grow();
+    void grow_distinct();
+};
+
+// hash of the group key values, nulls are hashed too.
+u64  agg_keys_hash(const Value* keys, u32 num_keys);
+// typed equality of two group keys, two nulls are equal.
+bool agg_key_eq(const Value& lhs, const Value& rhs);
+
+#endif // AGG_HASH_TABLE_H
@@ -31,6 +31,46 @@ enum AlgebraOperationType {
 enum ScanType {
     SEQ_SCAN,
     INDEX_SCAN,
+    RID_SET_SCAN,
+    LOOSE_INDEX_SCAN,
+};
+
+// how a filter restricts an index key column.
+enum IndexFilterKind {
+    INDEX_FILTER_EQ,    // col = val
+    INDEX_FILTER_IN,    // col IN (val1, val2, ...)
+    INDEX_FILTER_RANGE, // col (<, <=, >, >=) val
+};
+
+// a column of the rows of an operator: below the projection of a query it is the column col_ of the table 
+// that query query_idx_ reads as table_ (its rename), above it (query_idx_ = -1, empty table_) it is the output column 
+// at position col_.
+struct PlanColumn {
+    int     query_idx_ = -1;
+    String8 table_     = {};
+    int     col_       = -1;
+    // only used by orders.
+    bool    desc_      = false;
+    // text keys of indexes that share a prefix are equal, so the rows only come in the exact order of the values 
+    // of the column if it is not a text index key.
+    bool    exact_     = true;
+};
+
+/*
+ * physical properties of the rows of an operator (see AlgebraEngine::derive_properties):
+ * order_      : the rows are sorted by these columns (nulls are the smallest values), empty if the order is unknown.
+ * fixed_      : columns that have the same value in every row (equality filters of index scans), 
+ *               they can be skipped when matching an order or a unique key.
+ * unique_     : no two rows have the same values for the columns of unique_key_ (two nulls are equal),
+ *               an empty key means that there is at most one row.
+ */
+struct PlanProperties {
+    PlanProperties(Arena* arena);
+
+    Vector<PlanColumn> order_;
+    Vector<PlanColumn> fixed_;
+    Vector<PlanColumn> unique_key_;
+    bool unique_ = false;
 };
 
 struct AlgebraOperation {
@@ -41,7 +81,12 @@ struct AlgebraOperation {
     int query_idx_ = -1;
     int query_parent_idx_ = -1;
     bool distinct_ = false;
-
+    // the output rows come sorted by these output columns (positions in the ORDER BY list of the query),
+    // nullptr if the order is unknown. set by the planner on the top operators of a select.
+    Vector<int>*  sorted_by_   = nullptr;
+    Vector<bool>* sorted_desc_ = nullptr;
+    // computed once by the planner, nullptr until then.
+    PlanProperties* props_ = nullptr;
 };
 
 struct ScanOperation: AlgebraOperation {
@@ -54,6 +99,18 @@ struct ScanOperation: AlgebraOperation {
     ScanType scan_type_  = SEQ_SCAN;
     Vector<ASTNode*> filters_ = {};
     Vector<ASTNode*> index_filters_ = {};
+    // only used by RID_SET_SCAN: every rid scan is an INDEX_SCAN over the same table,
+    // the record ids of all of them are either unioned (index-OR) or intersected (index-AND) 
+    // before fetching any table pages.
+    Vector<ScanOperation*> rid_scans_ = {};
+    bool rid_set_union_ = false;
+    // only used by LOOSE_INDEX_SCAN: returns one entry for every distinct value of the first loose_prefix_len_ 
+    // index columns by jumping over the rest of the group, if loose_min_max_ is set the first and the last 
+    // non-null entries of the next index column are returned for every group to answer MIN/MAX.
+    int  loose_prefix_len_ = 0;
+    bool loose_min_max_ = false;
+    // only used by INDEX_SCAN: walk the index from its last entry to its first one.
+    bool index_reverse_ = false;
 };
 
 struct UnionOperation: AlgebraOperation {
@@ -93,7 +150,9 @@ struct ProductOperation: AlgebraOperation {
 
 enum JoinAlgorithm {
     NESTED_LOOP_JOIN,
-    HASH_JOIN
+    HASH_JOIN,
+    MERGE_JOIN,
+    INDEX_NESTED_LOOP_JOIN
 };
 
 struct JoinOperation: AlgebraOperation {
@@ -109,6 +168,29 @@ struct JoinOperation: AlgebraOperation {
     ExpressionNode* filter_;
     JoinType join_type_ = INNER_JOIN;
     JoinAlgorithm join_algo_ = NESTED_LOOP_JOIN;
+    // only used by MERGE_JOIN: both inputs are sorted by their keys, the rows of one input (the driver) are read in order
+    // and the rows of the other one are kept in a window while their key is between merge_lower_ and merge_upper_,
+    // the bounds are expressions of the driver key that never decrease when the driver key grows.
+    FieldNode* merge_driver_key_ = nullptr;
+    FieldNode* merge_window_key_ = nullptr;
+    ASTNode* merge_lower_ = nullptr;
+    ASTNode* merge_upper_ = nullptr;
+    bool merge_lower_inclusive_ = true;
+    bool merge_upper_inclusive_ = true;
+    // the driver is the left input.
+    bool merge_driver_left_ = true;
+    // only used by INDEX_NESTED_LOOP_JOIN: the inner input is a scan that is not read as a whole, instead its index
+    // (index_name_ of the scan) is probed once for every row of the outer input, 
+    // index_probe_keys_[i] is an expression of the outer row that gives the value of the i-th index column.
+    Vector<ASTNode*> index_probe_keys_ = {};
+    // the inner input is the left input.
+    bool index_inner_left_ = false;
+    // only used by the hash SEMI_JOIN and ANTI_JOIN of x [NOT] IN (sub-query): there is no lhs_, the left input is 
+    // the plan of the (uncorrelated) sub-query semi_query_idx_ and the only key is its single column = semi_key_.
+    int semi_query_idx_ = -1;
+    FieldNode* semi_key_ = nullptr;
+    // NOT IN: nothing passes if the sub-query returned a null, a null key only passes if the sub-query is empty.
+    bool null_aware_ = false;
 };
 
 struct InsertionOperation: AlgebraOperation {
@@ -167,11 +249,25 @@ struct ProjectionOperation: AlgebraOperation {
 };
 
 struct SortOperation: AlgebraOperation {
-    SortOperation(Arena* arena, int query_idx, AlgebraOperation* child, Vector<int>& order_by_list);
+    SortOperation(Arena* arena, int query_idx, AlgebraOperation* child, Vector<int>& order_by_list, 
+            Vector<bool>& order_by_desc);
     void print(int prefix_space_cnt);
 
     AlgebraOperation* child_ = nullptr;
     Vector<int> order_by_list_;
+    Vector<bool> order_by_desc_;
+    // set when only the first limit_ rows are consumed (ORDER BY ... LIMIT), the sort keeps just the top limit_ rows.
+    u64 limit_ = MAX_U64;
+};
+
+// skips the first offset_ rows of the child then returns at most limit_ rows.
+struct LimitOperation: AlgebraOperation {
+    LimitOperation(Arena* arena, int query_idx, AlgebraOperation* child, u64 limit, u64 offset);
+    void print(int prefix_space_cnt);
+
+    AlgebraOperation* child_ = nullptr;
+    u64 limit_  = MAX_U64;
+    u64 offset_ = 0;
 };
 
 #endif // ALGEBRA_OPERATION_H
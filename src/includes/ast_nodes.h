@@ -40,7 +40,10 @@ enum JoinType {
     INNER_JOIN = 0,
     LEFT_JOIN,
     RIGHT_JOIN,
-    FULL_JOIN
+    FULL_JOIN,
+    // only made by the optimizer, they return the rows of the right input that have (don't have) a match in the left one.
+    SEMI_JOIN,
+    ANTI_JOIN
 };
 
 struct JoinedTablesData {
@@ -175,6 +178,9 @@ struct SubQueryNode : ASTNode {
     int idx_ = -1;
     int parent_idx_ = -1;
     bool used_with_exists_ = false;
+    // a scalar sub-query that was unnested into a join of its parent is replaced by this expression,
+    // it reads the value of the sub-query from the joined row (see AlgebraEngine::unnest_scalar_subquery).
+    ASTNode* unnested_ = nullptr;
 };
 
 struct TypeCastNode : ASTNode {
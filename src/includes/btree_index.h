@@ -14,6 +14,13 @@
 #include "table_schema.h"
 #include "query_ctx.h"
 
+// the version of the page layout, kept in the header of the index file (FORMAT_VERSION_OFFSET).
+// 0: files written before it was stored.
+// 1: leaf pages link to their previous leaf page right before the slot array.
+// 2: a text key comes after the keys that are a prefix of it (they used to compare equal).
+// 3: integer keys that are far apart are ordered by value (their difference used to be truncated to 32 bits).
+#define BTREE_FORMAT_VERSION 3
+
 class BTreeIndex {
     public:
         void init(CacheManager* cm, FileID fid, int nkey_cols, bool is_unique);
@@ -36,15 +43,23 @@ class BTreeIndex {
         void Remove(QueryCTX* ctx, const IndexKey &key);
         IndexIterator begin();
         IndexIterator end();
+        // the last entry of the index.
+        IndexIterator rbegin();
         // for range queries
         IndexIterator lower_bound(const IndexKey &key);
         IndexIterator upper_bound(const IndexKey &key);
+        // for backward range queries: the last entry that is less than key (or equal to key if inclusive is set).
+        IndexIterator reverse_bound(const IndexKey &key, bool inclusive);
         void See();
         void ToString(BTreePage* page, std::ofstream& out);
         FileID get_fid();
+        bool is_unique();
+        // true if the pages of the file use an older layout than BTREE_FORMAT_VERSION.
+        bool is_outdated();
 
     private:
         bool isEmpty();
+        void set_prev_link(PageID page_id, PageID prev_page_id);
         CacheManager* cache_manager_ = nullptr;
         FileID fid_                  = INVALID_FID;
         PageID root_page_id_         = INVALID_PAGE_ID; // TODO: just turn this into a page number.
@@ -52,6 +67,7 @@ class BTreeIndex {
 
         int  nkey_cols_ = -1;
         bool is_unique_index_ = false;
+        u32  format_version_ = 0;
         // nkey_cols_ => indicates the number of columns in the IndexKey 
         // that will be used for comparisons (the key part),
         // while (the value part) is always at the end of the IndexKey and the key itself is at the start.
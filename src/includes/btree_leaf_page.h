@@ -13,6 +13,10 @@ class BTreeLeafPage : public BTreePage {
         void SetNextPageId(PageID next_page_id);
         PageNum get_next_page_number();
         void set_next_page_number(PageNum next_page_num);
+        PageID GetPrevPageId(FileID fid);
+        void SetPrevPageId(PageID prev_page_id);
+        PageNum get_prev_page_number();
+        void set_prev_page_number(PageNum prev_page_num);
 
         //bool split_with_and_insert(BTreeLeafPage* new_page, IndexKey k, RecordID v);
         bool split_with_and_insert(Arena* arena, i32 nvals, bool unique_insertion,
@@ -20,6 +20,13 @@
 #define BTREE_M_CONST (((BTREE_U_CONST-BTREE_HEADER_SIZE)*32/255)-23)
 // TODO: provide compile time assertions for positive values.
 
+// a key that goes to overflow pages keeps its local part followed by 
+// the full size (varint of at most 9 bytes) and the number of its first overflow page (4 bytes).
+#define BTREE_OVERFLOW_HEADER_SIZE (9 + 4)
+// Insert only accepts keys that fit BTREE_MIN_KEYS_PER_PAGE times in a page with BTREE_KEY_SLACK extra bytes each.
+#define BTREE_MIN_KEYS_PER_PAGE 3
+#define BTREE_KEY_SLACK         16
+
 u64 normalize_index_key_size(const IndexKey& key) {
     if(key.size_ <= BTREE_X_CONST) return key.size_;
 	u64 k =  BTREE_M_CONST+((key.size_-BTREE_M_CONST)%(BTREE_U_CONST-4));
@@ -39,6 +46,10 @@ class BTreePage {
   void SetPageType(BTreePageType page_type);
 
   static int get_max_key_size();
+  // the largest key that BTreeIndex::Insert accepts.
+  static int get_max_insert_key_size();
+  // the most bytes any accepted key takes in a page (not counting its slot).
+  static int get_max_local_key_size();
 
   uint32_t get_num_of_slots() const;
 
@@ -98,11 +109,12 @@ class BTreePage {
   static const size_t NEXT_PAGE_NUMBER_OFFSET_ = 5;     //  4 bytes (only used for leaf pages).
   static const size_t FREE_SPACE_PTR_OFFSET_ = 9;      //  4 bytes.
   static const size_t NUMBER_OF_SLOTS_OFFSET_ = 13;     //  4 bytes.
-  static const size_t SLOT_ARRAY_OFFSET_ = 17;          //  4 bytes.
+  static const size_t PREV_PAGE_NUMBER_OFFSET_ = 17;    //  4 bytes (only used for leaf pages).
+  static const size_t SLOT_ARRAY_OFFSET_ = 21;          //  4 bytes.
   static const size_t SLOT_ARRAY_KEY_SIZE_ = 4;         //  2 bytes(offset) + 2 bytes(size).
   static const size_t INTERNAL_SLOT_ENTRY_SIZE_ = SLOT_ARRAY_KEY_SIZE_  + 4;//  4 bytes key + 4  bytes page number.
   static const size_t LEAF_SLOT_ENTRY_SIZE_ = SLOT_ARRAY_KEY_SIZE_;         //  4 bytes key.
-  static const size_t HEADER_SIZE_ = BTREE_HEADER_SIZE; // 25 bytes are used for storing header data.
+  static const size_t HEADER_SIZE_ = BTREE_HEADER_SIZE; // 21 bytes are used for storing header data.
 };
 
 #endif //BTREE_PAGE_H
@@ -30,6 +30,7 @@ class CacheManager {
         bool deleteFile(FileID fid);
         // this function call skips the cache manager and updates the disk directly.
         bool update_root_page_number(FileID fid, PageNum pnum);
+        bool update_format_version(FileID fid, u32 version);
 
     private:
 
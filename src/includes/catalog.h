@@ -11,6 +11,7 @@
 #include "table_schema.h"
 #include "arena.h"
 #include "index_key.h"
+#include "statistics.h"
 #include <sstream>
 #include <algorithm>
 #include <cstdint>
@@ -40,6 +41,9 @@
 #define META_DATA_TABLE  "NILEDB_META_DATA"
 #define INDEX_KEYS_TABLE "NDB_INDEX_KEYS"
 #define INDEX_META_TABLE "NDB_INDEX_META"
+// statistics collected by ANALYZE (see statistics.h).
+#define TABLE_STATS_TABLE  "NDB_TABLE_STATS"
+#define COLUMN_STATS_TABLE "NDB_COLUMN_STATS"
 
 
 class Catalog {
@@ -54,7 +58,7 @@ class Catalog {
         TableSchema* get_table_schema(String8 table_name);
 
         bool create_index(QueryCTX* ctx, String8 table_name, String8 index_name,
-                Vector<IndexField> &fields, bool is_unique, bool deep_copy = true);
+                Vector<IndexField> &fields, bool is_unique, bool deep_copy = true, bool is_hash = false);
         IndexHeader create_temp_index(QueryCTX* ctx, Vector<NumberedIndexField> &fields, bool is_unique);
         int delete_temp_index(QueryCTX* ctx, IndexHeader& header);
         bool load_indexes();
@@ -68,13 +72,28 @@ class Catalog {
         int delete_index(QueryCTX* ctx, String8 index_name);
         int delete_table(QueryCTX* ctx, String8 table_name);
 
+        // collects and persists the statistics of a table, an empty name analyzes every table except the catalog's own.
+        // ret => 0 on success.
+        int analyze_table(QueryCTX* ctx, String8 table_name);
+        // nullptr if the table was never analyzed.
+        TableStats* get_table_stats(String8 table_name);
+
         // TODO: implement alter index and alter table.
     private:
+        // inserts every row of the table into the index.
+        void fill_index(QueryCTX* ctx, TableSchema* table, String8 index_name);
+        void rebuild_outdated_indexes();
+        bool load_stats();
+        void create_stats_tables();
+        void delete_stats(QueryCTX* ctx, String8 table_name);
+        bool is_catalog_table(String8 table_name);
+
         CacheManager* cache_manager_;
         Arena arena_;
         std::unordered_map<String8, TableSchema*, String_hash, String_eq> tables_;
         std::unordered_map<String8, Vector<String8>, String_hash, String_eq> indexes_of_table_;
         std::unordered_map<String8, IndexHeader, String_hash, String_eq> indexes_;
+        std::unordered_map<String8, TableStats, String_hash, String_eq> stats_;
         FreeSpaceMap* free_space_map_;
         // hard coded data:
         TableSchema* meta_table_schema_;
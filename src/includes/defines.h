@@ -22,6 +22,7 @@
 
 #define MAX_U16 ((u16)(0xFFFF))
 #define MAX_U32 ((u32)(0xFFFFFFFF))
+#define MAX_U64 ((u64)(0xFFFFFFFFFFFFFFFF))
 #define MAX_I32 ((u32)(0x7FFFFFFF))
 #define MAX_F32 ((f32)(0x1.fffffep+127))
 #define MAX_I8 127
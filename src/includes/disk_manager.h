@@ -13,12 +13,14 @@
 
 
 #define ROOT_PNUM_OFFSET 8
+#define FORMAT_VERSION_OFFSET 12
 // meta data for managing files:
 // num_of_pages_ >= 1, there is always at least one meta page on a file.
 // page number 0 is only touchable through the disk manager.
 // byte numbers 0-3  reserved for freelist_ptr_.
 // byte numbers 4-7  reserved for num_of_pages_.
 // byte numbers 8-11 reserved for root page numbers of tables and indexes.
+// byte numbers 12-15 reserved for the on-disk format version of indexes (0 for files that predate it).
 struct FileMeta {
     std::fstream fs_;
     int freelist_ptr_;   
@@ -37,12 +39,15 @@ class DiskManager {
         // page_id is the output and return value 1 in case of failure.
         int allocateNewPage(FileID fid, char* buffer ,PageID *page_id);
         int update_root_page_number(FileID fid, PageNum pnum);
+        int update_format_version(FileID fid, u32 version);
         int deallocatePage(PageID page_id);
         bool deleteFile(FileID fid);
 
     private:
         // 1 on failure, 0 on success.
         int openFile(String8 file_name);
+        // writes 4 bytes of the meta data of the file at offset directly to the disk.
+        int write_file_meta(FileID fid, u32 offset, u32 val);
         // first 4 bytes of a file indicates the next free page number.
         // second 4 bytes of a file indicates the number of pages on a file. 
         // in case of value of 0 means no current free pages
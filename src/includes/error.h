@@ -19,6 +19,7 @@ enum class Error {
     EXPECTED_EXPRESSION_IN_WHERE_CLAUSE,
     EXPECTED_EXPRESSION_IN_HAVING_CLAUSE,
     EXPECTED_GROUP_BY_LIST,
+    EXPECTED_LIMIT_COUNT,
     NO_EXPRESSION_CONTEXT,
     CANT_HAVE_AGGREGATION,
     CANT_CALL_FUNCTION,
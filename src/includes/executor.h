@@ -4,15 +4,24 @@
 #include "string"
 #include "ast_nodes.h"
 #include "algebra_operation.h"
+#include "join_hash_table.h"
+#include "agg_hash_table.h"
+#include "sort_key.h"
+#include "subquery_cache.h"
+#include "set_hash_table.h"
 
 struct QueryCTX;
 struct FlatExpr;
+struct RecordPredicate;
 struct InsertStatementData;
 struct DeleteStatementData;
 struct UpdateStatementData;
+struct IndexScanExecutor;
 enum ExecutorType {
     SEQUENTIAL_SCAN_EXECUTOR = 0,
     INDEX_SCAN_EXECUTOR,
+    RID_SET_SCAN_EXECUTOR,
+    LOOSE_INDEX_SCAN_EXECUTOR,
 
     INSERTION_EXECUTOR,
     DELETION_EXECUTOR,
@@ -22,11 +31,14 @@ enum ExecutorType {
     AGGREGATION_EXECUTOR,
     PROJECTION_EXECUTOR,
     SORT_EXECUTOR,
+    LIMIT_EXECUTOR,
     DISTINCT_EXECUTOR,
     PRODUCT_EXECUTOR,
 
     NESTED_LOOP_JOIN_EXECUTOR, 
-    HASH_JOIN_EXECUTOR, // only in-memory hash joins for now. 
+    HASH_JOIN_EXECUTOR, // hybrid hash join, spills to temp tables when the build side does not fit in memory.
+    MERGE_JOIN_EXECUTOR, // joins inputs that are sorted by their keys, supports equality and range-band conditions.
+    INDEX_NESTED_LOOP_JOIN_EXECUTOR, // looks up the rows of the inner table in its index for every outer row.
 
     SUB_QUERY_EXECUTOR, // used as a cache for non-corelated subqueries.
 
@@ -35,6 +47,38 @@ enum ExecutorType {
     INTERSECT_EXECUTOR,
 };
 
+#define BATCH_SIZE 1024
+
+// up to BATCH_SIZE rows stored column by column, columns_[c][r] is the value of column c of row r.
+// only the rows listed in the selection vector are visible, filters drop rows by shrinking it
+// instead of moving the values around.
+// the values live in the arena of the batch and stay valid until the batch is refilled.
+struct RowBatch {
+    void init(QueryCTX* ctx);
+    void reset();
+    bool is_full();
+    // number of selected rows.
+    u32  size();
+    // deep_copy copies the variable length values of the row into the arena of the batch.
+    void append(const Tuple& t, bool deep_copy);
+    // gathers the i-th selected row into out.
+    void get_row(u32 i, Tuple* out);
+    Value& at(u32 col, u32 i);
+
+    QueryCTX* ctx_       = nullptr;
+    Arena*    arena_     = nullptr;
+    Value**   columns_   = nullptr;
+    RecordID* rids_      = nullptr;
+    u16*      sel_       = nullptr;
+    u32       width_     = 0;
+    u32       max_width_ = 0;
+    u32       count_     = 0;
+    u32       sel_count_ = 0;
+    // producers stop at capacity_ rows, batches that are consumed one row at a time start small
+    // so that a consumer that only needs the first few rows (EXISTS, scalar sub-queries) does not pay for a full batch.
+    u32       capacity_  = BATCH_SIZE;
+};
+
 struct Executor {
 
     Executor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, TableSchema* output_schema,
@@ -42,6 +86,13 @@ struct Executor {
             ExecutorType type);
     virtual void init() = 0;
     virtual Tuple next() = 0;
+    // fills the batch with the next rows, returns false (and sets finished_) only when there are no more rows.
+    // the default pulls rows from next(), executors that work on batches natively override it
+    // and implement next() as next_from_batch().
+    virtual bool next_batch(RowBatch* batch);
+    Tuple next_from_batch();
+    // should be called by the init() of executors that use next_from_batch().
+    void reset_batch();
 
     Tuple output_;
     QueryCTX* ctx_ = nullptr;
@@ -53,6 +104,9 @@ struct Executor {
     ExecutorType type_;
     bool error_status_ = 0;
     bool finished_ = 0;
+    // the batch behind next_from_batch().
+    RowBatch* row_batch_ = nullptr;
+    u32 row_batch_pos_ = 0;
 };
 
 struct FilterExecutor : public Executor {
@@ -60,8 +114,11 @@ struct FilterExecutor : public Executor {
     FilterExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child);
     void init();
     Tuple next();
+    bool next_batch(RowBatch* batch);
 
     FlatExpr* filter_ = nullptr;
+    // filters without a child are evaluated once.
+    bool evaluated_ = false;
     /*
     Vector<ExpressionNode*> fields_ = {};
     Vector<String> field_names_ = {};
@@ -98,28 +155,244 @@ struct HashJoinExecutor : public Executor {
 
     HashJoinExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs);
     void init();
-    // TODO: implement merg and nested loop joines, 
-    // hash join is not good for cases of none equality conditions, and full outer joins.
     Tuple next();
+    bool next_batch(RowBatch* batch);
+    Tuple join_next();
+    Tuple join_in_memory();
+    Tuple probe_next();
+    bool  over_budget();
+    void  start_spill();
+    void  spill_resident();
+    void  spill_row(JoinPartition* part, bool build_side, const Tuple& row);
+    void  repartition(JoinPartition part);
+    // loads the build rows of the next spilled partition and starts probing it, false if there are none left.
+    bool  load_partition();
 
     Executor* left_child_ = nullptr;
     Executor* right_child_ = nullptr;
+    // the left child is hashed batch by batch, the right child is probed one batch at a time.
+    RowBatch* build_batch_ = nullptr;
+    RowBatch* probe_batch_ = nullptr;
+    u32 probe_pos_ = 0;
+    bool probe_done_ = false;
+    Tuple probe_row_;
+    // the joined row that is being built, its right part is the current probe row.
+    Tuple joined_;
     Vector<int> left_child_fields_;
     Vector<int> right_child_fields_;
-    // duplicated_idx tracks last used hashed value in case of hashing on non unique keys.
-    // for example: the hash key is the field 'a' and this field is not unique and may have a duplicated value of 1,
-    // in that case when a join happens we store it in the hash table as 1 -> {tuple 1, tuple 2, tuple 3}.
-    // when we call next() on a a key such as the previous example we track the last tuple that has been returned.
-    String8 prev_key_ = {};
-    std::pmr::unordered_map<String8, Vector<Tuple>, String_hash, String_eq> hashed_left_child_;
-    // tracks left keys that didn't find a match and can be used for left and full outer joins.
-    std::pmr::set<String8> non_visited_left_keys_; 
+    JoinHashTable hash_table_;
+    // the next build row to check against the current probe row (follows the chain of its hash).
+    u32 chain_pos_ = JOIN_NO_ROW;
+    u64 probe_hash_ = 0;
+    bool probe_null_key_ = false;
+    bool has_probe_row_ = false;
+    // the current probe row passed the filter with at least one build row (for right and full joins).
+    bool probe_matched_ = false;
+    // the next build row to check for left and full joins once the probe side is exhausted.
+    u32 unmatched_pos_ = 0;
     FlatExpr* filter_ = nullptr;
     JoinType join_type_ = INNER_JOIN;
-    // the value of -1 means that we will use the first tuple.
-    int duplicated_idx_ = -1; 
+    // the schema of joined_ that the filter sees, semi and anti joins only return its right part.
+    TableSchema* joined_schema_ = nullptr;
+    // semi and anti joins: the number of build rows and if any of them has a null key (for NOT IN).
+    u64  build_rows_ = 0;
+    bool build_has_null_ = false;
+    // the build side is an uncorrelated sub-query: its hash table is built once and kept by later calls to init().
+    bool build_cached_ = false;
+    // the build rows that are in memory.
+    Arena* build_arena_ = nullptr;
+    // the resident rows are compacted into it when the join starts spilling, then the two arenas are swapped.
+    Arena* spare_arena_ = nullptr;
+    // the current probe row when it is read back from a temp table.
+    Arena* spill_arena_ = nullptr;
+    bool spilled_ = false;
+    // partition 0 of the first level is still in memory.
+    bool resident_ = false;
+    // the first level partitions are filled while reading the inputs, then joined after the resident partition.
+    Vector<JoinPartition> partitions_;
+    Vector<JoinPartition> pending_;
+    // the partition that is being probed from its temp table.
+    JoinPartition current_;
+    bool reading_partition_ = false;
+    TableIterator spill_it_;
+};
+
+// a right row inside of the window of a merge join.
+struct MergeRow {
+    Tuple tuple_;
+    // the row matched at least one driver row, rows that never match are returned by outer joins.
+    bool  visited_ = false;
+};
+
+// both inputs arrive sorted by their join keys (index scans or sorts), the driver input is read one row at a time
+// and the other input slides through a window that holds its rows whose key is between the bounds computed 
+// from the current driver row (see JoinOperation), the bounds never decrease so every row enters and leaves the window once.
+// every row of the window is checked against the join filter, rows with a null key never match,
+// unmatched window rows are returned by outer joins when they leave the window.
+struct MergeJoinExecutor : public Executor {
+
+    MergeJoinExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs);
+    void init();
+    Tuple next();
+    bool next_batch(RowBatch* batch);
+    Tuple join_next();
+    // the next row of the driver in driver_row_, false when the driver is exhausted.
+    bool next_driver();
+    // makes window_row_ the next unread row of the window input without consuming it.
+    bool peek_window();
+    // moves the rows that are still in the window to the spare arena.
+    void compact_window();
+    // the window row combined with null driver columns.
+    Tuple unmatched_window_row(const Tuple& row);
+
+    Executor* left_child_ = nullptr;
+    Executor* right_child_ = nullptr;
+    Executor* driver_child_ = nullptr;
+    Executor* window_child_ = nullptr;
+    bool driver_left_ = true;
+    RowBatch* driver_batch_ = nullptr;
+    RowBatch* window_batch_ = nullptr;
+    u32 driver_pos_ = 0;
+    u32 window_input_pos_ = 0;
+    bool window_done_ = false;
+    Tuple driver_row_;
+    Tuple window_row_;
+    // the joined row that is being built, it holds the current driver row.
+    Tuple joined_;
+    int driver_key_ = -1;
+    int window_key_ = -1;
+    FlatExpr* filter_ = nullptr;
+    FlatExpr* lower_ = nullptr;
+    FlatExpr* upper_ = nullptr;
+    bool lower_inclusive_ = true;
+    bool upper_inclusive_ = true;
+    Value lower_val_;
+    Value upper_val_;
+    // the driver row has a null key or null bounds.
+    bool no_bounds_ = false;
+    // unmatched rows are returned for the driver input and the window input.
+    bool driver_outer_ = false;
+    bool window_outer_ = false;
+    enum { MERGE_NEXT_DRIVER, MERGE_SLIDE, MERGE_MATCH, MERGE_DRAIN } state_ = MERGE_NEXT_DRIVER;
+    bool driver_matched_ = false;
+    // the window is [window_start_, window_.size()), the rows before it already left.
+    Vector<MergeRow> window_;
+    u32 window_start_ = 0;
+    // the next window row to check against the current driver row.
+    u32 match_pos_ = 0;
+    Arena* window_arena_ = nullptr;
+    Arena* spare_arena_ = nullptr;
+    JoinType join_type_ = INNER_JOIN;
+};
+
+// index nested loop join: for every row of the outer child the probe keys are evaluated and the inner index scan is
+// restarted on the entries that are equal to them, then the joined rows are checked by the join condition.
+// supports inner joins and outer joins that keep the rows of the outer child.
+struct IndexNestedLoopJoinExecutor : public Executor {
+
+    IndexNestedLoopJoinExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* outer, 
+            IndexScanExecutor* inner, bool inner_left);
+    void init();
+    Tuple next();
+    // starts the lookup of the inner rows of the next outer row, false if there are no more outer rows.
+    bool next_outer();
+
+    Executor* outer_child_ = nullptr;
+    IndexScanExecutor* inner_child_ = nullptr;
+    bool inner_left_ = false;
+    // the outer row is copied into the arena because the inner lookups reuse the temp arena,
+    // the arena is cleared for every outer row.
+    Tuple outer_row_;
+    Arena* outer_arena_ = nullptr;
+    // evaluated against the outer row.
+    Vector<FlatExpr*> probe_keys_;
+    // the types of the index columns, the probe values are converted to them.
+    Vector<Type> key_types_;
+    Vector<Value> key_vals_;
+    FlatExpr* filter_ = nullptr;
+    JoinType join_type_ = INNER_JOIN;
+    bool has_outer_ = false;
+    // the probe keys of the current outer row can't be equal to any index entry (nulls, fractions on integer columns).
+    bool no_match_ = false;
+    bool outer_matched_ = false;
+};
+
+// the hash table of a set operator with its spilled partitions (see set_hash_table.h).
+// the right input of INTERSECT and EXCEPT is added by build(), then the rows of the left input
+// (or the only input of DISTINCT) are checked by probe(), the rows of the spilled partitions are returned
+// by next_spilled() once all the inputs are done.
+// ALL keeps the duplicates: INTERSECT ALL returns a row min(l, r) times and EXCEPT ALL max(l - r, 0) times.
+struct SetOpState {
+    SetOpState(Arena* arena);
+
+    void init(QueryCTX* ctx, SetOpType type, bool all);
+    void build(const Tuple& row);
+    // true if the row is part of the output.
+    bool probe(const Tuple& row);
+    // the next output row of the spilled partitions, false if there are none left.
+    // the row lives in spill_arena_ until the next call.
+    bool next_spilled(Tuple* out);
+
+    QueryCTX* ctx_ = nullptr;
+    SetOpType type_ = SET_DISTINCT;
+    bool all_ = false;
+    bool error_status_ = false;
+    SetHashTable table_;
+    Arena* table_arena_ = nullptr;
+    Arena* spill_arena_ = nullptr;
+    u32  level_  = 0;
+    // the table is over the budget, the rows that are not in it go to the partitions of the next level.
+    bool frozen_ = false;
+    Vector<JoinPartition> partitions_;
+    Vector<JoinPartition> pending_;
+    // the partition whose probe rows are being read.
+    JoinPartition current_;
+    bool reading_partition_ = false;
+    TableIterator spill_it_;
+
+    private:
+    bool over_budget();
+    void freeze();
+    void spill_row(u64 hash, bool build_side, const Tuple& row);
+    // loads the build rows of the next pending partition and starts reading its probe rows.
+    bool load_partition();
+};
+
+// INTERSECT and EXCEPT of two inputs that are sorted the same way on all of their columns (see sorted_on_all_columns):
+// the inputs are merged by comparing the sort keys of their rows, only the current row of each input
+// and the key of the last returned row are kept in memory.
+struct SetMergeState {
+    void init(QueryCTX* ctx, SetOpType type, bool all, Vector<int>* cols, Vector<bool>* desc);
+    // the next output row, false if there are none left.
+    // the row lives in left_arena_ until the next call.
+    bool next(Executor* left_child, Executor* right_child, Tuple* out);
+
+    QueryCTX* ctx_ = nullptr;
+    SetOpType type_ = SET_INTERSECT;
+    bool all_ = false;
+    bool error_status_ = false;
+    Vector<int>*  cols_ = nullptr;
+    Vector<bool>* desc_ = nullptr;
+    Arena* left_arena_  = nullptr;
+    Arena* right_arena_ = nullptr;
+    Arena* last_arena_  = nullptr;
+    Tuple   left_row_;
+    Tuple   right_row_;
+    String8 left_key_  = {};
+    String8 right_key_ = {};
+    // the key of the last returned row, without ALL the rows that are equal to it are skipped.
+    String8 last_key_  = {};
+    bool has_left_  = false;
+    bool has_right_ = false;
+    bool has_last_  = false;
+    bool right_done_ = false;
+
+    private:
+    // reads the next row of the child and its sort key into the arena, false at the end of the input or on errors.
+    bool read_row(Executor* child, Arena* arena, Tuple* row, String8* key);
 };
 
+// UNION ALL returns the rows of both inputs, UNION drops the duplicates using its own set table.
 struct UnionExecutor : public Executor {
 
     UnionExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* lhs, Executor* rhs);
@@ -128,6 +401,8 @@ struct UnionExecutor : public Executor {
 
     Executor* left_child_ = nullptr;
     Executor* right_child_ = nullptr;
+    bool all_ = false;
+    SetOpState set_;
 };
 
 struct ExceptExecutor : public Executor {
@@ -138,7 +413,11 @@ struct ExceptExecutor : public Executor {
 
     Executor* left_child_ = nullptr;
     Executor* right_child_ = nullptr;
-    std::pmr::unordered_map<String8, int, String_hash, String_eq> hashed_tuples_;
+    SetOpState set_;
+    // set by the planner when both inputs are sorted by these columns, the inputs are merged instead of hashed.
+    Vector<int>*  merge_cols_ = nullptr;
+    Vector<bool>* merge_desc_ = nullptr;
+    SetMergeState merge_;
 };
 
 struct IntersectExecutor : public Executor {
@@ -149,7 +428,11 @@ struct IntersectExecutor : public Executor {
 
     Executor* left_child_ = nullptr;
     Executor* right_child_ = nullptr;
-    std::pmr::unordered_map<String8, int, String_hash, String_eq> hashed_tuples_;
+    SetOpState set_;
+    // set by the planner when both inputs are sorted by these columns, the inputs are merged instead of hashed.
+    Vector<int>*  merge_cols_ = nullptr;
+    Vector<bool>* merge_desc_ = nullptr;
+    SetMergeState merge_;
 };
 
 
@@ -159,26 +442,96 @@ struct SeqScanExecutor : public Executor {
     SeqScanExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, TableSchema* table);
     void init();
     Tuple next();
+    bool next_batch(RowBatch* batch);
+    bool next_filtered_batch(RowBatch* batch);
+    // checks the record predicates on the current record before it is decoded, and on the zone map of its page
+    // when the scan enters a new page. recheck is set if the pushed filters should be evaluated over the decoded record.
+    bool record_rejected(bool* recheck);
 
     TableSchema* table_        = nullptr;
     Vector<FlatExpr*> filters_;
+    // the filters that were turned into record_preds_ (see record_predicates_of), 
+    // they are only evaluated for the records that the predicates can't decide.
+    Vector<FlatExpr*> pushed_filters_;
+    Vector<RecordPredicate> record_preds_;
+    ZoneMap* zone_map_ = nullptr;
+    PageNum cur_page_ = INVALID_PAGE_NUM;
     TableIterator it_;
 };
 
+// a range of index keys, the scan seeks to start_key_ and stops at the first key that is past end_key_.
+struct IndexRange {
+    IndexKey start_key_;       // a null start key means scan from the start of the index.
+    IndexKey end_key_;         // a null end key means scan to the end of the index.
+    bool start_after_ = false; // start at the first key that is greater than start_key_.
+    bool end_inclusive_ = true;
+};
+
 struct IndexScanExecutor : public Executor {
 
     IndexScanExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, TableSchema* table, IndexHeader index);
     void assign_iterators();
+    void seek_next_range();
+    void step();
+    bool seek_valid_entry();
     void init();
     Tuple next();
+    RecordID next_rid();
+    // restarts the scan on the entries whose leading key columns are equal to key_vals (one value per column,
+    // of the same types as the columns), the key is allocated in the arena.
+    void probe(Arena* arena, const Vector<Value>& key_vals);
 
     IndexHeader index_header_ = {};
     TableSchema* table_ = nullptr;
     FileID table_fid_ = INVALID_FID;
-    Vector<FlatExpr*> index_filters_;
     Vector<FlatExpr*> filters_;
     IndexIterator start_it_{};
-    IndexKey search_key_;
+    // sorted in index order, IN-lists create one range per value.
+    Vector<IndexRange> ranges_;
+    int cur_range_ = -1;
+    char* sort_order_ = nullptr;
+    // the ranges are scanned in reverse index order, each one from its end key back to its start key.
+    bool reverse_ = false;
+    // hash indexes answer a range (always a single full key) by collecting the record ids of all of its matches.
+    Vector<RecordID> hash_rids_;
+    int hash_pos_ = 0;
+};
+
+// collects record ids from multiple index scans and either unions (index-OR) or intersects (index-AND) them,
+// then fetches the records in page order.
+struct RidSetScanExecutor : public Executor {
+
+    RidSetScanExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, TableSchema* table,
+            Vector<IndexScanExecutor*> index_scans);
+    void init();
+    Tuple next();
+
+    TableSchema* table_ = nullptr;
+    Vector<IndexScanExecutor*> index_scans_;
+    Vector<FlatExpr*> filters_;
+    Vector<RecordID> rids_;
+    int cur_rid_ = 0;
+};
+
+// returns the first entry of every distinct prefix of the index key then seeks directly to the next prefix,
+// in MIN/MAX mode the first and the last non-null entries of the next key column are returned for every prefix.
+struct LooseIndexScanExecutor : public Executor {
+
+    LooseIndexScanExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, TableSchema* table, IndexHeader index);
+    void init();
+    Tuple next();
+    bool in_group(IndexKey key, IndexKey prefix);
+    bool fetch_tuple(RecordID rid);
+
+    IndexHeader index_header_ = {};
+    TableSchema* table_ = nullptr;
+    FileID table_fid_ = INVALID_FID;
+    IndexIterator it_{};
+    char* sort_order_ = nullptr;
+    int prefix_len_ = 0;
+    bool min_max_ = false;
+    // the last entry of the current group is returned right after the first one.
+    RecordID pending_rid_ = INVALID_RID;
 };
 
 struct InsertionExecutor : public Executor {
@@ -222,19 +575,41 @@ struct AggregationExecutor : public Executor {
     AggregationExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child_executor);
     void init();
     Tuple next();
-
+    bool next_batch(RowBatch* batch);
+    void aggregate_row(const Tuple& child_output);
+    // creates the group of the current key values, it keeps a copy of the first row of the group.
+    u32  new_group(const Tuple& child_output, u64 hash);
+    // writes the final value of every aggregate into the row of the group.
+    void finalize_group(AggGroup& group);
+    // adds a non null value to the state of an aggregate of a group.
+    void update_state(u32 g, u32 agg, const Value& val);
+    bool over_budget();
+    // writes the partial state of every group to its partition at the level and empties the table.
+    void spill_groups(u32 level);
+    // merges a spilled row (see agg_hash_table.h) into the table.
+    void merge_spilled(const Tuple& record);
+    // merges the partial states of the next spilled partition, false if there are none left.
+    bool load_partition();
+
+    RowBatch* input_ = nullptr;
+    Tuple child_row_;
     Vector<AggregateFuncNode*> *aggregates_;
     Vector<ASTNode*> *group_by_;
-    std::pmr::unordered_map<String8, std::pair<Tuple, int>, String_hash, String_eq> aggregated_values_;
-    // this hash table holds a set of values for each aggregate function 
-    // if that function uses the distinct keyword inside the clause e.g: count(distinct a).
-    // the mapping string is the hashed_key that is generated from the group by clause,
-    // and each key has it's own distinct couter map inside of it, and each map has two values,
-    // first value is the index of the function inside of the aggregates_ array,
-    // second value is the set of values that has been parameters to that function so far.
-    // TODO: pick a better structure to implement this functionality
-    std::pmr::unordered_map<String8, std::unordered_map<int, std::set<String8>>, String_hash, String_eq> distinct_counters_; 
-    std::pmr::unordered_map<String8, std::pair<Tuple, int>>::iterator it_;
+    AggHashTable groups_;
+    // the group by values of the current row.
+    Value* keys_ = nullptr;
+    // the next group to return.
+    u32 group_pos_ = 0;
+    // the data of the groups in memory (keys, first rows, text states and distinct values).
+    Arena* groups_arena_ = nullptr;
+    // the current row of a partition that is read back.
+    Arena* spill_arena_ = nullptr;
+    // the level of the groups in memory, 0 while reading the child and the level of the partition after that.
+    u32 level_ = 0;
+    // the groups of the current level were spilled, the rest of them has to be spilled too when the level is done.
+    bool spilled_ = false;
+    Vector<TableSchema*> partitions_;
+    Vector<AggPartition> pending_;
 };
 
 struct ProjectionExecutor : public Executor {
@@ -242,9 +617,15 @@ struct ProjectionExecutor : public Executor {
     ProjectionExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child_executor);
     void init();
     Tuple next();
+    bool next_batch(RowBatch* batch);
+    void project(const Tuple& child_output);
 
     // child_executor_ is optional in case of projection for example : select 1 + 1 should work without a from clause.
     Vector<FlatExpr*> fields_ {};
+    RowBatch* input_ = nullptr;
+    Tuple child_row_;
+    // projections without a child return a single row.
+    bool evaluated_ = false;
 };
 
 struct SortExecutor : public Executor {
@@ -253,9 +634,60 @@ struct SortExecutor : public Executor {
     void init();
     Tuple next();
 
+    // writes the sorted entries_ to a temp table as a new run.
+    void spill_run();
+    // merges runs [first, first + count) into a new run.
+    TableSchema* merge_runs(u32 first, u32 count);
+    // starts a merge of runs [first, first + count).
+    void open_runs(u32 first, u32 count);
+    // reads the next row of a run into the merge, the key is emptied when the run is exhausted.
+    void advance_run(u32 source);
+    Tuple merge_next();
+    // keeps the row if it is one of the smallest limit_ rows so far.
+    void push_top_n(Tuple row);
+    // copies the kept rows into spare_arena_ to free the rows that were pushed out of the heap.
+    void compact_top_n();
+
     Vector<int> *order_by_list_;
-    Vector<Tuple> tuples_;
-    int idx_ = 0;
+    Vector<bool> *order_by_desc_;
+    // top-N sort: entries_ is a max heap of the smallest limit_ rows, MAX_U64 means sort everything.
+    u64 limit_ = MAX_U64;
+    bool top_n_ = false;
+    u64 next_seq_ = 0;
+    u64 replaced_ = 0;
+    Arena* spare_arena_ = nullptr;
+    // the rows in memory and their sort keys.
+    Vector<SortEntry> entries_;
+    Arena* rows_arena_ = nullptr;
+    RowBatch* input_ = nullptr;
+    u32 idx_ = 0;
+    bool sorted_ = false;
+    // sorted runs in temp tables (see sort_key.h).
+    Vector<TableSchema*> runs_;
+    LoserTree merge_;
+    u32 first_run_ = 0;
+    // SORT_MERGE_FANIN of each: the open runs, the arenas and data of their current rows.
+    TableIterator* run_its_ = nullptr;
+    Arena** run_arenas_ = nullptr;
+    String8* run_data_ = nullptr;
+    Tuple* run_rows_ = nullptr;
+    // the winner is advanced on the next call so the returned row stays valid until then.
+    bool advance_winner_ = false;
+};
+
+// skips offset_ rows then returns at most limit_ rows, the child is never asked for more rows than that
+// (the capacity of the batch is lowered to the number of rows still needed).
+struct LimitExecutor : public Executor {
+
+    LimitExecutor(Arena* arena, QueryCTX* ctx, AlgebraOperation* plan_node, Executor* child_executor);
+    void init();
+    Tuple next();
+    bool next_batch(RowBatch* batch);
+
+    u64 limit_  = MAX_U64;
+    u64 offset_ = 0;
+    u64 skipped_  = 0;
+    u64 returned_ = 0;
 };
 
 struct DistinctExecutor : public Executor {
@@ -264,7 +696,14 @@ struct DistinctExecutor : public Executor {
     void init();
     Tuple next();
 
-    std::pmr::unordered_map<String8, int, String_hash, String_eq> hashed_tuples_;
+    SetOpState set_;
+    // set by the planner when the input is sorted on all of its columns, the duplicates of a row come right after it
+    // so only the last returned row is kept instead of a hash table.
+    bool sorted_input_ = false;
+    Tuple last_row_;
+    bool has_last_ = false;
+    Arena* last_arena_  = nullptr;
+    Arena* spare_arena_ = nullptr;
 };
 
 struct SubQueryExecutor : public Executor {
@@ -273,10 +712,17 @@ struct SubQueryExecutor : public Executor {
     void init();
     Tuple next();
 
+    // val IN (sub-query): val if the cached rows have it, otherwise null if they have a null and INVALID if not.
+    // the rows are hashed on the first call.
+    Value match(const Value& val);
+
     // TODO: replace this with a tempory table.
     std::pmr::list<Tuple> tuple_list_; 
     std::pmr::list<Tuple>::iterator it_; 
     bool cached_ = false;
+    JoinHashTable value_set_;
+    bool value_set_built_ = false;
+    bool value_set_has_null_ = false;
 };
 
 #endif // EXECUTOR_H
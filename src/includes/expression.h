@@ -8,10 +8,12 @@
 #include <string>
 #include <unordered_map>
 #include <stack>
+#include <functional>
+#include <type_traits>
 
 Value evaluate_subquery(QueryCTX* ctx, const Tuple& cur_tuple, ASTNode* item);
 void get_fields_of_query_deep(QueryCTX& ctx, QueryData* data, Vector<FieldNode*>& fields);
-Value evaluate_subquery_flat(QueryCTX* ctx, i32 query_idx);
+Value evaluate_subquery_flat(QueryCTX* ctx, i32 query_idx, bool used_with_exists = false);
 Value match_with_subquery(QueryCTX* ctx, i32 query_idx, Value val);
 
 
@@ -68,6 +70,30 @@ std::function<Value(std::vector<Value>&)> reserved_functions [] = {
     nullif_func,
 };
 
+/*
+ * typed opcodes: flatten_expression infers the static type of every register (the types of the columns and the constants)
+ * and emits a comparison or an arithmetic step whose operands have the same known type as a typed opcode that works on the
+ * raw values directly instead of going through the Value operators (value_cmp, operator+= ...) that dispatch on type_ at every step.
+ * the _CONST variants read their rhs operand straight from the constants_pool_, constant operands are converted to the type
+ * of the other operand at compile time and steps with constant operands only are folded into constants.
+ * a typed opcode still checks the runtime types of its operands (nulls, large text values, results that were widened
+ * by an earlier overflow) and falls back to the generic opcode if they don't match, or if the result overflows.
+ *
+ * X(NAME, OP, T, RHS_CONST): the typed opcode NAME specializes the generic opcode OP for operands of type T.
+ */
+#define EXPR_TYPED_OPS_OF(X, OP, T) \
+    X(OP##_##T, OP, T, false) X(OP##_##T##_CONST, OP, T, true)
+#define EXPR_TYPED_CMP_OPS(X, T) \
+    EXPR_TYPED_OPS_OF(X, EQ, T) EXPR_TYPED_OPS_OF(X, NEQ, T) EXPR_TYPED_OPS_OF(X, LT, T) \
+    EXPR_TYPED_OPS_OF(X, LTE, T) EXPR_TYPED_OPS_OF(X, GT, T) EXPR_TYPED_OPS_OF(X, GTE, T)
+#define EXPR_TYPED_ARITH_OPS(X, T) \
+    EXPR_TYPED_OPS_OF(X, ADD, T) EXPR_TYPED_OPS_OF(X, SUBTRACT, T) EXPR_TYPED_OPS_OF(X, MULTIPLY, T)
+// CMP and ARITH are applied to the comparisons and the arithmetic opcodes.
+#define EXPR_TYPED_OPS(CMP, ARITH) \
+    EXPR_TYPED_CMP_OPS(CMP, INT) EXPR_TYPED_CMP_OPS(CMP, BIGINT) \
+    EXPR_TYPED_CMP_OPS(CMP, DOUBLE) EXPR_TYPED_CMP_OPS(CMP, VARCHAR) \
+    EXPR_TYPED_ARITH_OPS(ARITH, INT) EXPR_TYPED_ARITH_OPS(ARITH, BIGINT) EXPR_TYPED_ARITH_OPS(ARITH, DOUBLE)
+
 enum class ExprOpCode: u8 {
     NOT,
     IS,
@@ -79,6 +105,7 @@ enum class ExprOpCode: u8 {
     GT,
     GTE,
     SUB_QUERY,
+    SUB_QUERY_EXISTS,
     SUB_QUERY_MATCH,
     ADD,
     SUBTRACT,
@@ -101,24 +128,332 @@ enum class ExprOpCode: u8 {
     OR,
     BETWEEN,
     IN, 
+
+    // typed opcodes, see push_binary.
+#define EXPR_OP_ENUM(NAME, OP, T, RHS_CONST) NAME,
+    EXPR_TYPED_OPS(EXPR_OP_ENUM, EXPR_OP_ENUM)
+#undef EXPR_OP_ENUM
 };
 
+// the generic semantics of the comparison and arithmetic opcodes, nulls make the result null.
+Value expr_binary_op(ExprOpCode op, const Value& lhs, const Value& rhs) {
+    if(lhs.isNull() || rhs.isNull()) return Value(NULL_TYPE);
+    switch(op) {
+        case ExprOpCode::EQ : return Value((bool)(lhs == rhs));
+        case ExprOpCode::NEQ: return Value((bool)(lhs != rhs));
+        case ExprOpCode::LT : return Value((bool)(lhs <  rhs));
+        case ExprOpCode::LTE: return Value((bool)(lhs <= rhs));
+        case ExprOpCode::GT : return Value((bool)(lhs >  rhs));
+        case ExprOpCode::GTE: return Value((bool)(lhs >= rhs));
+        case ExprOpCode::ADD:
+            {
+                Value res = lhs;
+                res += rhs;
+                return res;
+            }
+        case ExprOpCode::SUBTRACT:
+            {
+                Value res = lhs;
+                return res - rhs;
+            }
+        case ExprOpCode::MULTIPLY:
+            {
+                Value res = lhs;
+                res *= rhs;
+                return res;
+            }
+        case ExprOpCode::DEVIDE:
+            {
+                Value res = lhs;
+                res /= rhs;
+                return res;
+            }
+        default:
+            assert(0 && "UNREACHABLE!");
+    }
+    return Value(NULL_TYPE);
+}
+
+Value expr_not(const Value& v) {
+    if(v.isNull()) return v;
+    return Value(!((bool)v.getBoolVal()));
+}
+
+Value expr_is(const Value& lhs, const Value& rhs) {
+    if(lhs.isNull() || rhs.isNull()) return Value((bool)(lhs.isNull() && rhs.isNull()));
+    return Value((bool)(lhs == rhs));
+}
+
+Value expr_is_not(const Value& lhs, const Value& rhs) {
+    if(lhs.isNull()) return Value((bool)(!rhs.isNull()));
+    if(rhs.isNull()) return Value((bool)(!lhs.isNull()));
+    return Value((bool)(lhs != rhs));
+}
+
+Value expr_negate(const Value& v) {
+    if(v.isNull()) return Value(NULL_TYPE);
+    Value res = Value((int)0);
+    res -= v;
+    return res;
+}
+
+bool expr_is_false(const Value& v) {
+    return !v.isNull() && !v.getBoolVal();
+}
+
+bool expr_is_true(const Value& v) {
+    return !v.isNull() && v.getBoolVal();
+}
+
+// three valued logic: false AND null is false, true OR null is true.
+Value expr_and(const Value& lhs, const Value& rhs) {
+    if(expr_is_false(lhs) || expr_is_false(rhs)) return Value(false);
+    if(lhs.isNull() || rhs.isNull()) return Value(NULL_TYPE);
+    return Value(true);
+}
+
+Value expr_or(const Value& lhs, const Value& rhs) {
+    if(expr_is_true(lhs) || expr_is_true(rhs)) return Value(true);
+    if(lhs.isNull() || rhs.isNull()) return Value(NULL_TYPE);
+    return Value(false);
+}
+
+// test IN (item(0), ..., item(count - 1)).
+template<typename F> Value expr_in(const Value& test, i32 count, F item) {
+    if(test.isNull()) return test;
+    Value res = Value(false);
+    for(i32 k = 0; k < count; ++k){
+        const Value& v = item(k);
+        if(v.isNull()) {
+            res = Value(NULL_TYPE);
+            continue;
+        }
+        if(v == test) return Value(true);
+    }
+    return res;
+}
+
+bool expr_is_number(Type t) {
+    return t == INT || t == BIGINT || t == FLOAT || t == DOUBLE;
+}
+
+// constant operands are folded at compile time unless the generic opcode could fail at runtime
+// (division by zero, arithmetic on text), that is left for the runtime to report.
+bool expr_can_fold(ExprOpCode op, const Value& lhs, const Value& rhs) {
+    if(lhs.isNull() || rhs.isNull()) return op != ExprOpCode::DEVIDE;
+    switch(op) {
+        case ExprOpCode::EQ :
+        case ExprOpCode::NEQ:
+        case ExprOpCode::LT :
+        case ExprOpCode::LTE:
+        case ExprOpCode::GT :
+        case ExprOpCode::GTE:
+            return (expr_is_number(lhs.type_) && expr_is_number(rhs.type_)) || 
+                (lhs.type_ == VARCHAR && rhs.type_ == VARCHAR);
+        case ExprOpCode::ADD:
+        case ExprOpCode::SUBTRACT:
+        case ExprOpCode::MULTIPLY:
+            return expr_is_number(lhs.type_) && expr_is_number(rhs.type_);
+        default:
+            return false;
+    }
+}
+
+// the opcode with its operands swapped, false if the operands can't be swapped.
+bool expr_mirror_op(ExprOpCode op, ExprOpCode* out) {
+    switch(op) {
+        case ExprOpCode::EQ :
+        case ExprOpCode::NEQ:
+        case ExprOpCode::ADD:
+        case ExprOpCode::MULTIPLY:
+            *out = op;
+            return true;
+        case ExprOpCode::LT : *out = ExprOpCode::GT;  return true;
+        case ExprOpCode::LTE: *out = ExprOpCode::GTE; return true;
+        case ExprOpCode::GT : *out = ExprOpCode::LT;  return true;
+        case ExprOpCode::GTE: *out = ExprOpCode::LTE; return true;
+        default:
+            return false;
+    }
+}
+
+// the constant converted to type t the same way the generic opcodes convert it before comparing or computing,
+// false if it can't be converted without changing the result.
+bool expr_coerce_const(const Value& val, Type t, Value* out) {
+    if(val.type_ == t) {
+        *out = val;
+        return true;
+    }
+    if(t == BIGINT && val.type_ == INT) {
+        *out = Value((i64)val.getIntVal());
+        return true;
+    }
+    if(t == DOUBLE && (val.type_ == INT || val.type_ == BIGINT || val.type_ == FLOAT)) {
+        if(val.type_ == INT)    *out = Value((double)val.getIntVal());
+        if(val.type_ == BIGINT) *out = Value((double)val.getBigIntVal());
+        if(val.type_ == FLOAT)  *out = Value((double)val.getFloatVal());
+        return true;
+    }
+    return false;
+}
+
+// the typed opcode that specializes op for operands of type t, op itself if there is none.
+ExprOpCode expr_typed_op(ExprOpCode op, Type t, bool rhs_const) {
+#define EXPR_TYPED_OP(NAME, OP, T, RHS_CONST) \
+    if(op == ExprOpCode::OP && t == T && rhs_const == RHS_CONST) return ExprOpCode::NAME;
+    EXPR_TYPED_OPS(EXPR_TYPED_OP, EXPR_TYPED_OP)
+#undef EXPR_TYPED_OP
+    return op;
+}
+
+// the generic opcode of a typed opcode and the type it specializes, INVALID if op is not typed.
+ExprOpCode expr_untyped_op(ExprOpCode op, Type* t, bool* rhs_const) {
+#define EXPR_UNTYPED_OP(NAME, OP, T, RHS_CONST) \
+    if(op == ExprOpCode::NAME) { *t = T; *rhs_const = RHS_CONST; return ExprOpCode::OP; }
+    EXPR_TYPED_OPS(EXPR_UNTYPED_OP, EXPR_UNTYPED_OP)
+#undef EXPR_UNTYPED_OP
+    *t = INVALID;
+    *rhs_const = false;
+    return op;
+}
+
+// the raw value of a typed operand.
+template<Type T> inline auto expr_get(const Value& v) {
+    if constexpr(T == INT) return v.as_int();
+    else if constexpr(T == BIGINT) return v.as_bigint();
+    else return v.as_double();
+}
+
+// -1 if lhs < rhs, 0 if they are equal and 1 if lhs > rhs, the same order as value_cmp.
+template<Type T> inline int expr_cmp(const Value& lhs, const Value& rhs) {
+    if constexpr(T == VARCHAR) {
+        return text_cmp(lhs.as_varchar(), lhs.size_, rhs.as_varchar(), rhs.size_);
+    } else if constexpr(T == DOUBLE) {
+        // doubles within EPS of each other are equal.
+        double diff = lhs.as_double() - rhs.as_double();
+        return diff > EPS ? 1 : (diff < -EPS ? -1 : 0);
+    } else {
+        return (expr_get<T>(lhs) > expr_get<T>(rhs)) - (expr_get<T>(lhs) < expr_get<T>(rhs));
+    }
+}
+
+bool expr_cmp_holds(ExprOpCode op, int cmp) {
+    switch(op) {
+        case ExprOpCode::EQ : return cmp == 0;
+        case ExprOpCode::NEQ: return cmp != 0;
+        case ExprOpCode::LT : return cmp < 0;
+        case ExprOpCode::LTE: return cmp <= 0;
+        case ExprOpCode::GT : return cmp > 0;
+        case ExprOpCode::GTE: return cmp >= 0;
+        default:
+            assert(0 && "NOT A COMPARISON!");
+            return false;
+    }
+}
+
+template<ExprOpCode OP> inline bool expr_cmp_holds(int cmp) {
+    if constexpr(OP == ExprOpCode::EQ)  return cmp == 0;
+    if constexpr(OP == ExprOpCode::NEQ) return cmp != 0;
+    if constexpr(OP == ExprOpCode::LT)  return cmp <  0;
+    if constexpr(OP == ExprOpCode::LTE) return cmp <= 0;
+    if constexpr(OP == ExprOpCode::GT)  return cmp >  0;
+    return cmp >= 0;
+}
+
+// false if the result overflows, the generic opcode takes over then and widens the type of the result.
+template<ExprOpCode OP, typename C> inline bool expr_arith(C lhs, C rhs, C* res) {
+    if constexpr(std::is_floating_point_v<C>) {
+        if constexpr(OP == ExprOpCode::ADD)           *res = lhs + rhs;
+        else if constexpr(OP == ExprOpCode::SUBTRACT) *res = lhs - rhs;
+        else                                          *res = lhs * rhs;
+        return true;
+    } else {
+        if constexpr(OP == ExprOpCode::ADD)           return !__builtin_add_overflow(lhs, rhs, res);
+        else if constexpr(OP == ExprOpCode::SUBTRACT) return !__builtin_sub_overflow(lhs, rhs, res);
+        else                                          return !__builtin_mul_overflow(lhs, rhs, res);
+    }
+}
+
 struct ExprStep {
     ExprOpCode op_;
     i32 r1, r2, r3; // r1 holds the final result of a step while r2, r3 hold operands.
 };
 
+/*
+ * a comparison between a column of a scanned table and a constant that is checked on the bytes of the record
+ * inside of its page, the records that it rejects are never copied or decoded into tuples (see SeqScanExecutor).
+ */
+struct RecordPredicate {
+    i32 col_ = -1;
+    Type col_type_ = INVALID;
+    // EQ, NEQ, LT, LTE, GT, GTE, IS (col IS NULL) or IS_NOT (col IS NOT NULL).
+    ExprOpCode op_ = ExprOpCode::EQ;
+    // the type of the typed opcode that the predicate came from, INVALID for the generic opcodes.
+    Type type_ = INVALID;
+    Value val_;
+};
+
+enum RecordCheck {
+    RECORD_REJECTED,
+    RECORD_ACCEPTED,
+    // the predicates need the decoded record (text stored in overflow pages).
+    RECORD_UNKNOWN,
+};
+
 struct FlatExpr {
     // fields used during runtime.
     Vector<ExprStep> steps_;
     Vector<Value> constants_pool_;
     Vector<Value> registers_;
     i32 query_idx_;
+    // fields used by batch evaluation (see filter_batch), set up by its first call.
+    // -1: not prepared yet, 0: the expression can only be evaluated one row at a time, 1: batches.
+    i8      batch_mode_     = -1;
+    // every register is a vector of BATCH_SIZE values indexed by the row of the batch,
+    // batch_inputs_[r] is the vector that register r is read from, a column of the batch or batch_regs_[r].
+    Value*  batch_regs_     = nullptr;
+    Value** batch_inputs_   = nullptr;
+    // the first step of the rhs of every AND/OR step (-1 for other steps) and the AND/OR step
+    // whose rhs starts at every step (-1 if none).
+    i32*    batch_rhs_from_ = nullptr;
+    i32*    batch_rhs_of_   = nullptr;
+    // a stack of selection vectors and their sizes, one for every AND/OR whose rhs is being evaluated.
+    u16*    batch_sels_     = nullptr;
+    u32*    batch_sel_counts_ = nullptr;
     
     // fields used during compilation.
     u32 sp_ = 1;
     u32 max_sp_ = 1;
     std::stack<i32> in_expr_vals_;
+    // the static type of every register and the constants_pool_ index of its value if it holds a constant (-1 otherwise),
+    // both describe the value written by the last step that wrote the register.
+    Vector<Type> reg_types_;
+    Vector<i32>  reg_consts_;
+
+    void set_reg(i32 reg, Type type, i32 const_idx = -1) {
+        if(reg_types_.size() <= reg) {
+            reg_types_.resize(reg + 1, INVALID);
+            reg_consts_.resize(reg + 1, -1);
+        }
+        reg_types_[reg] = type;
+        reg_consts_[reg] = const_idx;
+    }
+
+    Type reg_type(i32 reg) {
+        return reg < reg_types_.size() ? reg_types_[reg] : INVALID;
+    }
+
+    i32 reg_const(i32 reg) {
+        return reg < reg_consts_.size() ? reg_consts_[reg] : -1;
+    }
+
+    // true if the last step loads the constant of the register.
+    bool last_step_loads(i32 reg, u32 from_end = 1) {
+        if(steps_.size() < from_end || reg_const(reg) < 0) return false;
+        const ExprStep& step = steps_[steps_.size() - from_end];
+        return step.r1 == reg && (step.op_ == ExprOpCode::STRING_CONST || step.op_ == ExprOpCode::FLOAT_CONST ||
+                step.op_ == ExprOpCode::INT_CONST || step.op_ == ExprOpCode::NULL_CONST);
+    }
 
     u32 allocate_register() {
         sp_++;
@@ -133,6 +468,74 @@ struct FlatExpr {
 
     void push_step(ExprOpCode op, i32 r1 = 0, i32 r2 = 0, i32 r3 = 0) {
         steps_.push_back({op, r1, r2, r3});
+        // jumps don't write their r1.
+        if(op != ExprOpCode::JUMP && op != ExprOpCode::JUMP_IF_FALSY) set_reg(r1, INVALID);
+    }
+
+    void push_const(i32 r1, const Value& val) {
+        if(val.isNull()) {
+            push_step(ExprOpCode::NULL_CONST, r1);
+            set_reg(r1, NULL_TYPE, 0);
+            return;
+        }
+        i32 idx = constants_pool_.size();
+        constants_pool_.push_back(val);
+        if(val.type_ == VARCHAR) push_step(ExprOpCode::STRING_CONST, r1, idx);
+        else if(val.type_ == FLOAT || val.type_ == DOUBLE) push_step(ExprOpCode::FLOAT_CONST, r1, idx);
+        else push_step(ExprOpCode::INT_CONST, r1, idx);
+        set_reg(r1, val.type_, idx);
+    }
+
+    // pushes a comparison or an arithmetic step r1 = r2 op r3, folds it if both operands are constants
+    // or emits the typed opcode of the types of its operands if there is one.
+    // shared_operands is set if the operand registers are read by other steps too (CASE, BETWEEN),
+    // they are never removed or swapped then.
+    void push_binary(ExprOpCode op, i32 r1, i32 r2, i32 r3, bool shared_operands = false) {
+        i32 c2 = reg_const(r2);
+        i32 c3 = reg_const(r3);
+        if(!shared_operands && last_step_loads(r2, 2) && last_step_loads(r3, 1) &&
+                expr_can_fold(op, constants_pool_[c2], constants_pool_[c3])) {
+            Value res = expr_binary_op(op, constants_pool_[c2], constants_pool_[c3]);
+            steps_.resize(steps_.size() - 2);
+            push_const(r1, res);
+            return;
+        }
+        bool cmp = op == ExprOpCode::EQ || op == ExprOpCode::NEQ || op == ExprOpCode::LT || 
+            op == ExprOpCode::LTE || op == ExprOpCode::GT || op == ExprOpCode::GTE;
+        Type t2 = reg_type(r2);
+        Type t3 = reg_type(r3);
+        ExprOpCode typed = op;
+        ExprOpCode mirrored = op;
+        Value coerced;
+        bool rhs_const = false;
+        if(c3 >= 0 && c2 < 0 && expr_coerce_const(constants_pool_[c3], t2, &coerced)) {
+            typed = expr_typed_op(op, t2, true);
+            rhs_const = true;
+        } else if(!shared_operands && c2 >= 0 && c3 < 0 && expr_mirror_op(op, &mirrored) && 
+                expr_coerce_const(constants_pool_[c2], t3, &coerced) && expr_typed_op(mirrored, t3, true) != mirrored) {
+            // the constant goes to the rhs where the typed opcode reads it from.
+            op = mirrored;
+            typed = expr_typed_op(op, t3, true);
+            rhs_const = true;
+            std::swap(r2, r3);
+            std::swap(t2, t3);
+        } else if(t2 == t3) {
+            typed = expr_typed_op(op, t2, false);
+        }
+        if(typed == op) {
+            push_step(op, r1, r2, r3);
+            set_reg(r1, cmp ? BOOLEAN : (t2 == t3 ? t2 : INVALID));
+            return;
+        }
+        Type res_type = cmp ? BOOLEAN : t2;
+        if(rhs_const) {
+            // the rhs is read from the constants pool, its load is not needed if this is the only step that reads it.
+            if(!shared_operands && last_step_loads(r3)) steps_.pop_back();
+            r3 = constants_pool_.size();
+            constants_pool_.push_back(coerced);
+        }
+        push_step(typed, r1, r2, r3);
+        set_reg(r1, res_type);
     }
 
     void print(){
@@ -200,6 +603,11 @@ struct FlatExpr {
                         name = "SubQuery";
                         break;
                     }
+                case ExprOpCode::SUB_QUERY_EXISTS:
+                    {
+                        name = "SubQueryExists";
+                        break;
+                    }
                 case ExprOpCode::SUB_QUERY_MATCH:
                     {
                         name = "SubQueryMatch";
@@ -283,6 +691,9 @@ struct FlatExpr {
                         name = "In";
                         break;
                     }
+#define EXPR_OP_NAME(NAME, OP, T, RHS_CONST) case ExprOpCode::NAME: name = #NAME; break;
+                EXPR_TYPED_OPS(EXPR_OP_NAME, EXPR_OP_NAME)
+#undef EXPR_OP_NAME
                 default:;
                     assert(0 && "TODO!");
             }
@@ -354,10 +765,10 @@ i32 flatten_expression (
                             out_expr->push_step(ExprOpCode::IS_NOT    , r1, r2, r3);
                         break;
                         case TokenType::EQ :
-                            out_expr->push_step(ExprOpCode::EQ        , r1, r2, r3);
+                            out_expr->push_binary(ExprOpCode::EQ        , r1, r2, r3);
                         break;
                         case TokenType::NEQ :
-                            out_expr->push_step(ExprOpCode::NEQ       , r1, r2, r3);
+                            out_expr->push_binary(ExprOpCode::NEQ       , r1, r2, r3);
                         break;
                         default:
                             assert(0 && "UNREACHABLE!");
@@ -392,16 +803,16 @@ i32 flatten_expression (
 
                     switch(op){
                         case TokenType::GT :
-                            out_expr->push_step(ExprOpCode::GT , r1, r2, r3);
+                            out_expr->push_binary(ExprOpCode::GT , r1, r2, r3);
                         break;
                         case TokenType::GTE :
-                            out_expr->push_step(ExprOpCode::GTE, r1, r2, r3);
+                            out_expr->push_binary(ExprOpCode::GTE, r1, r2, r3);
                         break;
                         case TokenType::LT :
-                            out_expr->push_step(ExprOpCode::LT , r1, r2, r3);
+                            out_expr->push_binary(ExprOpCode::LT , r1, r2, r3);
                         break;
                         case TokenType::LTE :
-                            out_expr->push_step(ExprOpCode::LTE, r1, r2, r3);
+                            out_expr->push_binary(ExprOpCode::LTE, r1, r2, r3);
                         break;
                         default:
                             assert(0 && "UNREACHABLE!");
@@ -421,9 +832,12 @@ i32 flatten_expression (
         case SUB_QUERY:
             {
                 auto sub_query = reinterpret_cast<SubQueryNode*>(in_expr);
+                if(sub_query->unnested_) return flatten_expression(ctx, sub_query->unnested_, out_expr);
                 i32 r1 = out_expr->allocate_register();
                 i32 r2 = sub_query->idx_; 
-                if(out_expr->in_expr_vals_.size())
+                if(sub_query->used_with_exists_)
+                    out_expr->push_step(ExprOpCode::SUB_QUERY_EXISTS, r1, r2); 
+                else if(out_expr->in_expr_vals_.size())
                     out_expr->push_step(ExprOpCode::SUB_QUERY_MATCH, r1, r2, out_expr->in_expr_vals_.top());
                 else
                     out_expr->push_step(ExprOpCode::SUB_QUERY, r1, r2); 
@@ -446,8 +860,8 @@ i32 flatten_expression (
                 ASTNode* ptr = t->next_;
                 while(ptr){
                     i32 r3 = flatten_expression(ctx, ptr, out_expr, ptr->category_ == TERM);
-                    if(op == TokenType::PLUS) out_expr->push_step(ExprOpCode::ADD     , r1, r2, r3);
-                    else if (op == TokenType::MINUS) out_expr->push_step(ExprOpCode::SUBTRACT, r1, r2, r3);
+                    if(op == TokenType::PLUS) out_expr->push_binary(ExprOpCode::ADD     , r1, r2, r3);
+                    else if (op == TokenType::MINUS) out_expr->push_binary(ExprOpCode::SUBTRACT, r1, r2, r3);
                     else assert(0 && "Unexpected token type!");
 
                     out_expr->reset_sp(r1);
@@ -480,9 +894,9 @@ i32 flatten_expression (
                             ptr->category_ == FACTOR);
 
                     if(op == TokenType::STAR) 
-                        out_expr->push_step(ExprOpCode::MULTIPLY , r1, r2, r3);
+                        out_expr->push_binary(ExprOpCode::MULTIPLY , r1, r2, r3);
                     else if (op == TokenType::SLASH)
-                        out_expr->push_step(ExprOpCode::DEVIDE , r1, r2, r3);
+                        out_expr->push_binary(ExprOpCode::DEVIDE , r1, r2, r3);
                     else assert(0 && "Unexpected TokenType");
 
                     out_expr->reset_sp(r1);
@@ -504,7 +918,16 @@ i32 flatten_expression (
                 i32 r1 = out_expr->allocate_register();
                 i32 r2 = flatten_expression(ctx, u->cur_, out_expr, true);
                 if(u->token_.type_ == TokenType::MINUS){
-                    out_expr->push_step(ExprOpCode::NEGATE , r1, r2);
+                    i32 c2 = out_expr->reg_const(r2);
+                    if(out_expr->last_step_loads(r2) && expr_is_number(out_expr->constants_pool_[c2].type_)) {
+                        // negative literals are folded.
+                        Value res = Value((int)0);
+                        res -= out_expr->constants_pool_[c2];
+                        out_expr->steps_.pop_back();
+                        out_expr->push_const(r1, res);
+                    } else {
+                        out_expr->push_step(ExprOpCode::NEGATE , r1, r2);
+                    }
                 }
                 out_expr->reset_sp(r1);
                 return r1;
@@ -528,6 +951,7 @@ i32 flatten_expression (
                 out_expr->constants_pool_.emplace_back(in_expr->token_.val_);
 
                 out_expr->push_step(ExprOpCode::STRING_CONST, r1, r2);
+                out_expr->set_reg(r1, VARCHAR, r2);
                 return r1;
             }
         case FLOAT_CONSTANT:
@@ -540,6 +964,7 @@ i32 flatten_expression (
                 else out_expr->constants_pool_.emplace_back(val);
 
                 out_expr->push_step(ExprOpCode::FLOAT_CONST, r1, r2);
+                out_expr->set_reg(r1, out_expr->constants_pool_[r2].type_, r2);
                 return r1;
             }
         case INTEGER_CONSTANT: 
@@ -553,12 +978,14 @@ i32 flatten_expression (
                 else  out_expr->constants_pool_.emplace_back((i64) val);
 
                 out_expr->push_step(ExprOpCode::INT_CONST, r1, r2);
+                out_expr->set_reg(r1, out_expr->constants_pool_[r2].type_, r2);
                 return r1;
             }
         case NULL_CONSTANT: 
             {
                 i32 r1 = out_expr->allocate_register();
                 out_expr->push_step(ExprOpCode::NULL_CONST, r1);
+                out_expr->set_reg(r1, NULL_TYPE, 0);
                 return r1;
             }
         case FIELD_EXPR: 
@@ -572,6 +999,7 @@ i32 flatten_expression (
 
                 assert(r1 >= 0 && "Field does not exist in the provided schema!");
                 out_expr->push_step(ExprOpCode::FIELD, r1, r2, r3);
+                if(r2 >= 0) out_expr->set_reg(r1, field->schema_->getCol(r2).getType());
                 return r1;
             }
         case CASE_EXPRESSION  : 
@@ -597,7 +1025,7 @@ i32 flatten_expression (
                         i32 r1 = out_expr->allocate_register();
                         i32 r3 = flatten_expression(ctx, when, out_expr);
 
-                        out_expr->push_step(ExprOpCode::EQ, r1, r2, r3);
+                        out_expr->push_binary(ExprOpCode::EQ, r1, r2, r3, true);
 
                         u32 jump_if_falsy_idx = out_expr->steps_.size();
 
@@ -659,6 +1087,8 @@ i32 flatten_expression (
                 for(int i = 0; i < jump_instructions_idxs.size(); ++i) {
                     out_expr->steps_[jump_instructions_idxs[i]].r2 = out_expr->steps_.size();
                 }
+                // the result is written by every branch.
+                out_expr->set_reg(save_point + 1, INVALID);
 
                 return save_point + 1;
             }
@@ -758,8 +1188,8 @@ i32 flatten_expression (
                 i32 lhs_res = flatten_expression(ctx, between->lhs_, out_expr, false);
                 i32 rhs_res = flatten_expression(ctx, between->rhs_, out_expr, false);
 
-                out_expr->push_step(ExprOpCode::GTE, r2, val_res, lhs_res);
-                out_expr->push_step(ExprOpCode::LTE, r3, val_res, rhs_res);
+                out_expr->push_binary(ExprOpCode::GTE, r2, val_res, lhs_res, true);
+                out_expr->push_binary(ExprOpCode::LTE, r3, val_res, rhs_res, true);
                 //out_expr->push_step(ExprOpCode::AND, r1, r2, r3);
                 if(between->negated_){
                     i32 negated_reg = out_expr->allocate_register();
@@ -820,94 +1250,60 @@ Value evaluate_flat_expression(QueryCTX* ctx, FlatExpr& expr, const Tuple& cur_t
         switch(expr.steps_[pc].op_){
             case ExprOpCode::NOT: 
                 {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-
-                    if(v2->isNull()) *v1 = *v2;
-                    else *v1 = Value(!((bool)v2->getBoolVal()));
+                    expr.registers_[r1] = expr_not(expr.registers_[r2]);
                     break;
                 }
             case ExprOpCode::IS:
                 {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-                    
-                    if(v3->isNull() || v2->isNull()) *v1 = Value((bool)(v2->isNull() && v3->isNull()));
-                    else *v1 = Value((bool)(*v2 == *v3));
+                    expr.registers_[r1] = expr_is(expr.registers_[r2], expr.registers_[r3]);
                     break;
                 }
             case ExprOpCode::IS_NOT:
                 {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull()) *v1 = Value((bool)(!v3->isNull()));
-                    else if(v3->isNull()) *v1 = Value((bool)(!v2->isNull()));
-                    else *v1 = Value((bool)(*v2 != *v3));
+                    expr.registers_[r1] = expr_is_not(expr.registers_[r2], expr.registers_[r3]);
                     break;
                 }
             case ExprOpCode::EQ: 
-                {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else *v1 = Value((bool)(*v2 == *v3));
-                    break;
-                }
             case ExprOpCode::NEQ: 
-                {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else *v1 = Value((bool)(*v2 != *v3));
-                    break;
-                }
             case ExprOpCode::LT:
-                {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else *v1 = Value((bool)(*v2 < *v3));
-                    break;
-                }
             case ExprOpCode::LTE:
-                {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else *v1 = Value((bool)(*v2 <= *v3));
-                    break;
-                }
             case ExprOpCode::GT:
-                {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else *v1 = Value((bool)(*v2 > *v3));
-                    break;
-                }
             case ExprOpCode::GTE:
+            case ExprOpCode::ADD:
+            case ExprOpCode::SUBTRACT:
+            case ExprOpCode::MULTIPLY:
+            case ExprOpCode::DEVIDE:
                 {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else *v1 = Value((bool)(*v2 >= *v3));
+                    expr.registers_[r1] = expr_binary_op(expr.steps_[pc].op_, expr.registers_[r2], expr.registers_[r3]);
                     break;
                 }
+#define EXPR_CMP_CASE(NAME, OP, T, RHS_CONST)                                                              \
+            case ExprOpCode::NAME:                                                                         \
+                {                                                                                          \
+                    const Value& lhs = expr.registers_[r2];                                                \
+                    const Value& rhs = RHS_CONST ? expr.constants_pool_[r3] : expr.registers_[r3];         \
+                    if(lhs.type_ == T && rhs.type_ == T)                                                   \
+                        expr.registers_[r1] = Value(expr_cmp_holds<ExprOpCode::OP>(expr_cmp<T>(lhs, rhs))); \
+                    else                                                                                   \
+                        expr.registers_[r1] = expr_binary_op(ExprOpCode::OP, lhs, rhs);                    \
+                    break;                                                                                 \
+                }
+#define EXPR_ARITH_CASE(NAME, OP, T, RHS_CONST)                                                            \
+            case ExprOpCode::NAME:                                                                         \
+                {                                                                                          \
+                    const Value& lhs = expr.registers_[r2];                                                \
+                    const Value& rhs = RHS_CONST ? expr.constants_pool_[r3] : expr.registers_[r3];         \
+                    decltype(expr_get<T>(lhs)) res;                                                        \
+                    if(lhs.type_ == T && rhs.type_ == T &&                                                 \
+                            expr_arith<ExprOpCode::OP>(expr_get<T>(lhs), expr_get<T>(rhs), &res))          \
+                        expr.registers_[r1] = Value(res);                                                  \
+                    else                                                                                   \
+                        expr.registers_[r1] = expr_binary_op(ExprOpCode::OP, lhs, rhs);                    \
+                    break;                                                                                 \
+                }
+            EXPR_TYPED_OPS(EXPR_CMP_CASE, EXPR_ARITH_CASE)
+#undef EXPR_CMP_CASE
+#undef EXPR_ARITH_CASE
             case ExprOpCode::SUB_QUERY:
                 {
                     Value* v1 = &expr.registers_[r1];
@@ -915,73 +1311,24 @@ Value evaluate_flat_expression(QueryCTX* ctx, FlatExpr& expr, const Tuple& cur_t
                     *v1 = evaluate_subquery_flat(ctx, r2);
                     break;
                 }
-            case ExprOpCode::SUB_QUERY_MATCH:
+            case ExprOpCode::SUB_QUERY_EXISTS:
                 {
                     Value* v1 = &expr.registers_[r1];
-                    Value* v3 = &expr.registers_[r3];
                     ctx->query_inputs[expr.query_idx_] = cur_tuple; 
-                    *v1 = match_with_subquery(ctx, r2, *v3);
-                    break;
-                }
-            case ExprOpCode::ADD:
-                {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else {
-                        *v2 += *v3;
-                        *v1 = *v2;
-                    }
-                    break;
-                }
-            case ExprOpCode::SUBTRACT:
-                {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else *v1 = (*v2 - *v3);
+                    *v1 = evaluate_subquery_flat(ctx, r2, true);
                     break;
                 }
-            case ExprOpCode::MULTIPLY:
-                {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else {
-                        *v2 *= *v3;
-                        *v1 = *v2;
-                    }
-                    break;
-                }
-            case ExprOpCode::DEVIDE:
+            case ExprOpCode::SUB_QUERY_MATCH:
                 {
                     Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
                     Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else {
-                        *v2 /= *v3;
-                        *v1 = *v2;
-                    }
+                    ctx->query_inputs[expr.query_idx_] = cur_tuple; 
+                    *v1 = match_with_subquery(ctx, r2, *v3);
                     break;
                 }
             case ExprOpCode::NEGATE:
                 {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-
-                    if(v2->isNull()) *v1 = Value(NULL_TYPE);
-                    else {
-                        *v1 = Value((int)0);
-                        *v1 -= *v2;
-                    }
+                    expr.registers_[r1] = expr_negate(expr.registers_[r2]);
                     break;
                 }
             case ExprOpCode::TYPE_CAST:
@@ -1061,50 +1408,19 @@ Value evaluate_flat_expression(QueryCTX* ctx, FlatExpr& expr, const Tuple& cur_t
                 }
             case ExprOpCode::AND:
                 {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() || v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else {
-                        *v1 = Value((bool)(v2->getBoolVal() && v3->getBoolVal()));
-                    }
+                    expr.registers_[r1] = expr_and(expr.registers_[r2], expr.registers_[r3]);
                     break;
                 }
             case ExprOpCode::OR:
                 {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* v2 = &expr.registers_[r2];
-                    Value* v3 = &expr.registers_[r3];
-
-                    if(v2->isNull() && v3->isNull()) *v1 = Value(NULL_TYPE);
-                    else if(v2->isNull()) *v1 = v3->getBoolVal();
-                    else if(v3->isNull()) *v1 = v2->getBoolVal();
-                    else {
-                        *v1 = Value((bool)((v2->getBoolVal() || v3->getBoolVal())));
-                    }
+                    expr.registers_[r1] = expr_or(expr.registers_[r2], expr.registers_[r3]);
                     break;
                 }
             case ExprOpCode::IN:
                 {
-                    Value* v1 = &expr.registers_[r1];
-                    Value* test_val = &expr.registers_[r2];
-                    if(test_val->isNull()) {
-                        *v1 = *test_val;
-                        break;
-                    }
-                    *v1 = Value(false);
-
-                    for(i32 i = r1-r3; i < r1; ++i){
-                        if(expr.registers_[i].isNull()) {
-                            *v1 = Value(NULL_TYPE);
-                            continue;
-                        }
-                        if(expr.registers_[i] == *test_val) {
-                            *v1 = Value(true);
-                            break;
-                        }
-                    }
+                    expr.registers_[r1] = expr_in(expr.registers_[r2], r3, [&](i32 k) -> const Value& {
+                        return expr.registers_[r1 - r3 + k];
+                    });
                     break;
                 }
             default:
@@ -1117,6 +1433,411 @@ Value evaluate_flat_expression(QueryCTX* ctx, FlatExpr& expr, const Tuple& cur_t
 }
 
 
+// steps that can run over a whole batch, the others (sub-queries, function calls, CASE jumps and type casts)
+// are left to evaluate_flat_expression one row at a time.
+bool batch_step_supported(ExprOpCode op) {
+    switch(op) {
+        case ExprOpCode::SUB_QUERY:
+        case ExprOpCode::SUB_QUERY_EXISTS:
+        case ExprOpCode::SUB_QUERY_MATCH:
+        case ExprOpCode::TYPE_CAST:
+        case ExprOpCode::JUMP:
+        case ExprOpCode::JUMP_IF_FALSY:
+        case ExprOpCode::JUMP_IF_NULL:
+        case ExprOpCode::FUNC_CALL:
+        case ExprOpCode::BETWEEN:
+            return false;
+        default:
+            return true;
+    }
+}
+
+void prepare_batch_evaluation(QueryCTX* ctx, FlatExpr& expr) {
+    expr.batch_mode_ = 0;
+    i32 num_steps = expr.steps_.size();
+    if(num_steps == 0) return;
+    for(i32 k = 0; k < num_steps; ++k)
+        if(!batch_step_supported(expr.steps_[k].op_)) return;
+
+    u32 num_regs = std::max<u32>(expr.max_sp_, 1);
+    expr.batch_regs_   = (Value*)  ctx->arena_.alloc(sizeof(Value) * BATCH_SIZE * num_regs);
+    expr.batch_inputs_ = (Value**) ctx->arena_.alloc(sizeof(Value*) * num_regs);
+    for(u32 r = 0; r < num_regs; ++r) expr.batch_inputs_[r] = expr.batch_regs_ + (u64)r * BATCH_SIZE;
+
+    expr.batch_rhs_from_ = (i32*) ctx->arena_.alloc(sizeof(i32) * num_steps);
+    expr.batch_rhs_of_   = (i32*) ctx->arena_.alloc(sizeof(i32) * num_steps);
+    for(i32 k = 0; k < num_steps; ++k) expr.batch_rhs_from_[k] = expr.batch_rhs_of_[k] = -1;
+    u32 depth = 1;
+    for(i32 k = 0; k < num_steps; ++k) {
+        const ExprStep& step = expr.steps_[k];
+        if(step.op_ != ExprOpCode::AND && step.op_ != ExprOpCode::OR) continue;
+        // the rhs of the step is every step after the last write of its lhs.
+        i32 lhs_at = -1;
+        i32 rhs_at = -1;
+        for(i32 j = k - 1; j >= 0 && lhs_at == -1; --j) {
+            if(expr.steps_[j].r1 == step.r3 && rhs_at == -1) rhs_at = j;
+            if(expr.steps_[j].r1 == step.r2) lhs_at = j;
+        }
+        if(lhs_at == -1 || rhs_at <= lhs_at || expr.batch_rhs_of_[lhs_at + 1] != -1) continue;
+        expr.batch_rhs_from_[k] = lhs_at + 1;
+        expr.batch_rhs_of_[lhs_at + 1] = k;
+        ++depth;
+    }
+    expr.batch_sels_       = (u16*) ctx->arena_.alloc(sizeof(u16) * BATCH_SIZE * depth);
+    expr.batch_sel_counts_ = (u32*) ctx->arena_.alloc(sizeof(u32) * depth);
+    expr.batch_mode_ = 1;
+}
+
+bool can_filter_batch(QueryCTX* ctx, FlatExpr& expr) {
+    if(expr.batch_mode_ == -1) prepare_batch_evaluation(ctx, expr);
+    return expr.batch_mode_ == 1;
+}
+
+// the batch kernels: rows whose operands don't have type T are evaluated by the generic opcode.
+template<ExprOpCode OP, Type T, bool RHS_CONST> 
+void batch_cmp(const Value* lhs, const Value* rhs, Value* out, const u16* sel, u32 n) {
+    for(u32 k = 0; k < n; ++k) {
+        u16 i = sel[k];
+        const Value& b = RHS_CONST ? rhs[0] : rhs[i];
+        if(lhs[i].type_ == T && b.type_ == T) out[i] = Value(expr_cmp_holds<OP>(expr_cmp<T>(lhs[i], b)));
+        else out[i] = expr_binary_op(OP, lhs[i], b);
+    }
+}
+
+template<ExprOpCode OP, Type T, bool RHS_CONST> 
+void batch_arith(const Value* lhs, const Value* rhs, Value* out, const u16* sel, u32 n) {
+    for(u32 k = 0; k < n; ++k) {
+        u16 i = sel[k];
+        const Value& b = RHS_CONST ? rhs[0] : rhs[i];
+        decltype(expr_get<T>(b)) res;
+        if(lhs[i].type_ == T && b.type_ == T && expr_arith<OP>(expr_get<T>(lhs[i]), expr_get<T>(b), &res)) 
+            out[i] = Value(res);
+        else 
+            out[i] = expr_binary_op(OP, lhs[i], b);
+    }
+}
+
+// runs one step over the rows of the batch in sel.
+void evaluate_step_batch(QueryCTX* ctx, FlatExpr& expr, const ExprStep& step, RowBatch* batch, const u16* sel, u32 n) {
+    i32 r1 = step.r1;
+    i32 r2 = step.r2;
+    i32 r3 = step.r3;
+    Value** in = expr.batch_inputs_;
+    Value* out = expr.batch_regs_ + (u64)r1 * BATCH_SIZE;
+    switch(step.op_) {
+        case ExprOpCode::FIELD:
+            {
+                if(r3 == expr.query_idx_) {
+                    // the register is read straight from the column of the batch.
+                    in[r1] = batch->columns_[r2];
+                    return;
+                }
+                const Value& v = ctx->query_inputs[r3].get_val_at(r2);
+                for(u32 k = 0; k < n; ++k) out[sel[k]] = v;
+                break;
+            }
+        case ExprOpCode::STRING_CONST:
+        case ExprOpCode::FLOAT_CONST:
+        case ExprOpCode::INT_CONST:
+        case ExprOpCode::NULL_CONST:
+            {
+                const Value& v = expr.constants_pool_[step.op_ == ExprOpCode::NULL_CONST ? 0 : r2];
+                for(u32 k = 0; k < n; ++k) out[sel[k]] = v;
+                break;
+            }
+        case ExprOpCode::NOT:
+            for(u32 k = 0; k < n; ++k) out[sel[k]] = expr_not(in[r2][sel[k]]);
+            break;
+        case ExprOpCode::IS:
+            for(u32 k = 0; k < n; ++k) out[sel[k]] = expr_is(in[r2][sel[k]], in[r3][sel[k]]);
+            break;
+        case ExprOpCode::IS_NOT:
+            for(u32 k = 0; k < n; ++k) out[sel[k]] = expr_is_not(in[r2][sel[k]], in[r3][sel[k]]);
+            break;
+        case ExprOpCode::NEGATE:
+            for(u32 k = 0; k < n; ++k) out[sel[k]] = expr_negate(in[r2][sel[k]]);
+            break;
+        // the rhs was only evaluated for the rows whose lhs does not decide the result, 
+        // expr_and and expr_or don't read it for the other rows.
+        case ExprOpCode::AND:
+            for(u32 k = 0; k < n; ++k) out[sel[k]] = expr_and(in[r2][sel[k]], in[r3][sel[k]]);
+            break;
+        case ExprOpCode::OR:
+            for(u32 k = 0; k < n; ++k) out[sel[k]] = expr_or(in[r2][sel[k]], in[r3][sel[k]]);
+            break;
+        case ExprOpCode::IN:
+            for(u32 k = 0; k < n; ++k) {
+                u16 i = sel[k];
+                out[i] = expr_in(in[r2][i], r3, [&](i32 item) -> const Value& { return in[r1 - r3 + item][i]; });
+            }
+            break;
+        case ExprOpCode::EQ: 
+        case ExprOpCode::NEQ: 
+        case ExprOpCode::LT:
+        case ExprOpCode::LTE:
+        case ExprOpCode::GT:
+        case ExprOpCode::GTE:
+        case ExprOpCode::ADD:
+        case ExprOpCode::SUBTRACT:
+        case ExprOpCode::MULTIPLY:
+        case ExprOpCode::DEVIDE:
+            for(u32 k = 0; k < n; ++k) out[sel[k]] = expr_binary_op(step.op_, in[r2][sel[k]], in[r3][sel[k]]);
+            break;
+#define EXPR_BATCH_CMP_CASE(NAME, OP, T, RHS_CONST)                                                  \
+        case ExprOpCode::NAME:                                                                       \
+            batch_cmp<ExprOpCode::OP, T, RHS_CONST>(in[r2],                                          \
+                    RHS_CONST ? &expr.constants_pool_[r3] : in[r3], out, sel, n);                    \
+            break;
+#define EXPR_BATCH_ARITH_CASE(NAME, OP, T, RHS_CONST)                                                \
+        case ExprOpCode::NAME:                                                                       \
+            batch_arith<ExprOpCode::OP, T, RHS_CONST>(in[r2],                                        \
+                    RHS_CONST ? &expr.constants_pool_[r3] : in[r3], out, sel, n);                    \
+            break;
+        EXPR_TYPED_OPS(EXPR_BATCH_CMP_CASE, EXPR_BATCH_ARITH_CASE)
+#undef EXPR_BATCH_CMP_CASE
+#undef EXPR_BATCH_ARITH_CASE
+        default:
+            assert(0 && "UNREACHABLE!");
+    }
+    in[r1] = out;
+}
+
+// evaluates a filter over all the selected rows of the batch, one step at a time, and drops the rows that it does not
+// accept from the selection vector of the batch.
+// the rhs of an AND (OR) only runs over the rows whose lhs is not false (true), on a selection vector of its own.
+// returns false and leaves the batch untouched if the filter can only be evaluated one row at a time.
+bool filter_batch(QueryCTX* ctx, FlatExpr& expr, RowBatch* batch) {
+    if(!can_filter_batch(ctx, expr)) return false;
+    if(batch->size() == 0) return true;
+
+    u32 depth = 0;
+    expr.batch_sel_counts_[0] = batch->sel_count_;
+    auto level = [&](u32 d) -> u16* { return d == 0 ? batch->sel_ : expr.batch_sels_ + (u64)(d - 1) * BATCH_SIZE; };
+    for(u32 k = 0; k < expr.steps_.size(); ++k) {
+        // the rhs of this AND/OR is done.
+        if(expr.batch_rhs_from_[k] != -1) --depth;
+        i32 logic_step = expr.batch_rhs_of_[k];
+        if(logic_step != -1) {
+            const ExprStep& logic = expr.steps_[logic_step];
+            const Value* lhs = expr.batch_inputs_[logic.r2];
+            bool is_and = logic.op_ == ExprOpCode::AND;
+            u16* from = level(depth);
+            u16* to = level(depth + 1);
+            u32 count = expr.batch_sel_counts_[depth];
+            u32 m = 0;
+            for(u32 q = 0; q < count; ++q) {
+                u16 i = from[q];
+                if(is_and ? !expr_is_false(lhs[i]) : !expr_is_true(lhs[i])) to[m++] = i;
+            }
+            expr.batch_sel_counts_[++depth] = m;
+        }
+        evaluate_step_batch(ctx, expr, expr.steps_[k], batch, level(depth), expr.batch_sel_counts_[depth]);
+    }
+    const Value* res = expr.batch_inputs_[expr.steps_.back().r1];
+    u32 selected = 0;
+    for(u32 q = 0; q < batch->sel_count_; ++q) {
+        u16 i = batch->sel_[q];
+        if(expr_is_true(res[i])) batch->sel_[selected++] = i;
+    }
+    batch->sel_count_ = selected;
+    return true;
+}
+
+// collects the conjuncts of a scan filter that compare a column of the scanned table to a constant 
+// (=, <>, <, <=, >, >=, BETWEEN, IS [NOT] NULL), returns false if the filter has any other kind of step.
+bool record_predicates_of(FlatExpr& expr, Vector<RecordPredicate>* out) {
+    enum RegKind : u8 { REG_UNKNOWN, REG_COLUMN, REG_CONST, REG_PREDICATES };
+    struct RegState {
+        RegKind kind_ = REG_UNKNOWN;
+        i32 idx_ = -1; // the column or the constant.
+        Vector<RecordPredicate> preds_;
+    };
+    if(expr.steps_.size() == 0) return false;
+    Vector<RegState> regs(std::max<u32>(expr.max_sp_, 1));
+    for(u32 k = 0; k < expr.steps_.size(); ++k) {
+        const ExprStep& step = expr.steps_[k];
+        i32 r1 = step.r1;
+        i32 r2 = step.r2;
+        i32 r3 = step.r3;
+        RegState res;
+        Type t = INVALID;
+        bool rhs_const = false;
+        ExprOpCode op = expr_untyped_op(step.op_, &t, &rhs_const);
+        switch(op) {
+            case ExprOpCode::FIELD:
+                if(r3 != expr.query_idx_) return false;
+                res.kind_ = REG_COLUMN;
+                res.idx_ = r2;
+                break;
+            case ExprOpCode::STRING_CONST:
+            case ExprOpCode::FLOAT_CONST:
+            case ExprOpCode::INT_CONST:
+                res.kind_ = REG_CONST;
+                res.idx_ = r2;
+                break;
+            case ExprOpCode::NULL_CONST:
+                res.kind_ = REG_CONST;
+                res.idx_ = 0;
+                break;
+            case ExprOpCode::EQ: 
+            case ExprOpCode::NEQ: 
+            case ExprOpCode::LT:
+            case ExprOpCode::LTE:
+            case ExprOpCode::GT:
+            case ExprOpCode::GTE:
+            case ExprOpCode::IS:
+            case ExprOpCode::IS_NOT:
+                {
+                    RegState lhs = regs[r2];
+                    RegState rhs;
+                    if(rhs_const) {
+                        rhs.kind_ = REG_CONST;
+                        rhs.idx_ = r3;
+                    } else {
+                        rhs = regs[r3];
+                    }
+                    if(lhs.kind_ == REG_CONST && rhs.kind_ == REG_COLUMN) {
+                        if(!expr_mirror_op(op, &op) && op != ExprOpCode::IS && op != ExprOpCode::IS_NOT) return false;
+                        std::swap(lhs, rhs);
+                    }
+                    if(lhs.kind_ != REG_COLUMN || rhs.kind_ != REG_CONST) return false;
+                    RecordPredicate pred;
+                    pred.col_ = lhs.idx_;
+                    pred.op_ = op;
+                    pred.type_ = t;
+                    pred.val_ = expr.constants_pool_[rhs.idx_];
+                    // IS and IS NOT only test for nulls.
+                    bool is = op == ExprOpCode::IS || op == ExprOpCode::IS_NOT;
+                    if(is != pred.val_.isNull()) return false;
+                    res.kind_ = REG_PREDICATES;
+                    res.preds_.push_back(pred);
+                    break;
+                }
+            case ExprOpCode::AND:
+                {
+                    if(regs[r2].kind_ != REG_PREDICATES || regs[r3].kind_ != REG_PREDICATES) return false;
+                    res.kind_ = REG_PREDICATES;
+                    res.preds_ = regs[r2].preds_;
+                    res.preds_.insert(res.preds_.end(), regs[r3].preds_.begin(), regs[r3].preds_.end());
+                    break;
+                }
+            default:
+                return false;
+        }
+        regs[r1] = res;
+    }
+    RegState& result = regs[expr.steps_.back().r1];
+    if(result.kind_ != REG_PREDICATES) return false;
+    out->insert(out->end(), result.preds_.begin(), result.preds_.end());
+    return true;
+}
+
+// checks a predicate against the bytes of a non null value, typed predicates compare them as expr_cmp<type_> does,
+// the others build a view over them and use the generic opcode.
+bool record_predicate_holds(const RecordPredicate& pred, char* content, u16 size, Type col_type) {
+    if(pred.type_ != col_type || pred.val_.type_ != col_type) 
+        return expr_is_true(expr_binary_op(pred.op_, Value(content, col_type, size), pred.val_));
+    int cmp = 0;
+    switch(col_type) {
+        case INT:
+            {
+                i32 lhs = 0;
+                memcpy(&lhs, content, sizeof(lhs));
+                cmp = (lhs > pred.val_.as_int()) - (lhs < pred.val_.as_int());
+                break;
+            }
+        case BIGINT:
+            {
+                i64 lhs = 0;
+                memcpy(&lhs, content, sizeof(lhs));
+                cmp = (lhs > pred.val_.as_bigint()) - (lhs < pred.val_.as_bigint());
+                break;
+            }
+        case DOUBLE:
+            {
+                double lhs = 0;
+                memcpy(&lhs, content, sizeof(lhs));
+                double diff = lhs - pred.val_.as_double();
+                cmp = diff > EPS ? 1 : (diff < -EPS ? -1 : 0);
+                break;
+            }
+        case VARCHAR:
+            cmp = text_cmp(content, size, pred.val_.as_varchar(), pred.val_.size_);
+            break;
+        default:
+            assert(0 && "NOT A TYPED COMPARISON!");
+    }
+    return expr_cmp_holds(pred.op_, cmp);
+}
+
+RecordCheck check_record_predicates(TableSchema* schema, Record& r, const Vector<RecordPredicate>& preds) {
+    RecordCheck res = RECORD_ACCEPTED;
+    char* bitmap = r.getFixedPtr(schema->getSize());
+    for(u32 i = 0; i < preds.size(); ++i) {
+        const RecordPredicate& pred = preds[i];
+        bool is_null = bitmap[pred.col_ / 8] & (1 << (pred.col_ % 8));
+        if(pred.op_ == ExprOpCode::IS || pred.op_ == ExprOpCode::IS_NOT) {
+            if(is_null != (pred.op_ == ExprOpCode::IS)) return RECORD_REJECTED;
+            continue;
+        }
+        // nothing compares to null.
+        if(is_null) return RECORD_REJECTED;
+        u16 size = 0;
+        char* content = schema->getValue(pred.col_, r, &size);
+        if(!content) return RECORD_UNKNOWN;
+        // text that is stored in overflow pages.
+        if(pred.col_type_ == VARCHAR && size == MAX_U16) {
+            res = RECORD_UNKNOWN;
+            continue;
+        }
+        if(!record_predicate_holds(pred, content, size, pred.col_type_)) return RECORD_REJECTED;
+    }
+    return res;
+}
+
+// true if the summary of the column shows that none of its values can pass the predicate.
+bool zone_rejects(const Zone& zone, const RecordPredicate& pred) {
+    if(pred.op_ == ExprOpCode::IS) return zone.nulls_ == 0;
+    // nothing compares to null.
+    if(zone.values_ == 0) return true;
+    if(pred.op_ == ExprOpCode::IS_NOT) return false;
+    // only typed predicates compare the values the same way min and max are ordered.
+    if(pred.type_ != pred.col_type_ || pred.val_.type_ != pred.col_type_) return false;
+    if(pred.col_type_ == DOUBLE) {
+        // values within EPS of the constant are equal to it.
+        double lo = zone.min_double_ - pred.val_.as_double();
+        double hi = zone.max_double_ - pred.val_.as_double();
+        switch(pred.op_) {
+            case ExprOpCode::EQ : return lo > EPS || hi < -EPS;
+            case ExprOpCode::NEQ: return lo >= -EPS && hi <= EPS;
+            case ExprOpCode::LT : return lo >= -EPS;
+            case ExprOpCode::LTE: return lo > EPS;
+            case ExprOpCode::GT : return hi <= EPS;
+            case ExprOpCode::GTE: return hi < -EPS;
+            default: return false;
+        }
+    }
+    i64 val = pred.col_type_ == INT ? pred.val_.as_int() : pred.val_.as_bigint();
+    switch(pred.op_) {
+        case ExprOpCode::EQ : return val < zone.min_int_ || val > zone.max_int_;
+        case ExprOpCode::NEQ: return zone.min_int_ == val && zone.max_int_ == val;
+        case ExprOpCode::LT : return zone.min_int_ >= val;
+        case ExprOpCode::LTE: return zone.min_int_ > val;
+        case ExprOpCode::GT : return zone.max_int_ <= val;
+        case ExprOpCode::GTE: return zone.max_int_ < val;
+        default: return false;
+    }
+}
+
+// true if the zone map of the page shows that none of its records can pass all of the predicates.
+bool zone_map_rejects_page(ZoneMap* zone_map, PageNum pnum, const Vector<RecordPredicate>& preds) {
+    for(u32 i = 0; i < preds.size(); ++i) {
+        const Zone* zone = zone_map->get_zone(pnum, preds[i].col_);
+        if(zone && zone_rejects(*zone, preds[i])) return true;
+    }
+    return false;
+}
+
 Value evaluate_expression(
         QueryCTX* ctx, 
         ASTNode* expression, 
@@ -1173,40 +1894,14 @@ Value evaluate_expression(
                 for(int i = 0; i < in->list_.size(); ++i){
                     Value tmp = evaluate_expression(ctx, in->list_[i], cur_tuple, false, false);
                     if(tmp.type_ == Type::EXECUTOR_ID){
-                        int idx = tmp.getIntVal();
-                        Executor* sub_query_executor = ctx->executors_call_stack_[idx]; 
-                        sub_query_executor->init();
-                        // TODO: register errors to ctx object and stop execution.
-                        if(sub_query_executor->error_status_){
-                            std::cout << "[ERROR] could not initialize sub-query" << std::endl;
-                            return Value();
-                        }
-
-                        while(!answer && !sub_query_executor->finished_ && !sub_query_executor->error_status_){
-                            Tuple sub_query_output = sub_query_executor->next();
-                            if(sub_query_output.size() == 0 && sub_query_executor->finished_) {
-                                break;
-                            }
-
-                            if(sub_query_executor->error_status_) {
-                                std::cout << "[ERROR] could not execute sub-query" << std::endl;
-                                ctx->error_status_ = (Error)1; // TODO: better error handling.
-                                return Value();
-                            }
-
-                            if(sub_query_output.size() != 1) {
-                                std::cout << "[ERROR] sub-query should return exactly 1 column" << std::endl;
-                                ctx->error_status_ = (Error)1; // TODO: better error handling.
-                                return Value();
-                            }
-                            if(sub_query_output.get_val_at(0).isNull()){
-                                null_ret = true;
-                            }
-                            else if(val == sub_query_output.get_val_at(0)){
-                                answer = true;
-                                null_ret = false;
-                                break;
-                            }
+                        Value matched = match_with_subquery(ctx, tmp.getIntVal(), val);
+                        if(ctx->error_status_ != Error::NO_ERROR) return Value();
+                        if(matched.isNull()) {
+                            null_ret = true;
+                        } else if(matched.type_ != INVALID) {
+                            answer = true;
+                            null_ret = false;
+                            break;
                         }
                     } else if(tmp.isNull() || val.isNull()) {
                         null_ret = true;
@@ -1377,8 +2072,10 @@ Value evaluate_expression(
             } 
         case SUB_QUERY:
             {
-                if(eval_sub_query) return evaluate_subquery(ctx, cur_tuple, expression);
                 auto sub_query = reinterpret_cast<SubQueryNode*>(expression);
+                if(sub_query->unnested_) 
+                    return evaluate_expression(ctx, sub_query->unnested_, cur_tuple, true, eval_sub_query);
+                if(eval_sub_query) return evaluate_subquery(ctx, cur_tuple, expression);
                 auto v = Value(sub_query->idx_);
                 v.type_ = Type::EXECUTOR_ID;
                 return v;
@@ -1938,11 +2635,16 @@ void accessed_fields(ASTNode* expression, Vector<FieldNode*>& fields, bool only_
                           accessed_fields(func->exp_, fields);
                           return;
                       }
+        case SUB_QUERY: 
+                      {
+                          auto sub_query = (SubQueryNode*)(expression);
+                          accessed_fields(sub_query->unnested_, fields);
+                          return;
+                      }
         case STRING_CONSTANT: 
         case FLOAT_CONSTANT: 
         case INTEGER_CONSTANT: 
         case NULL_CONSTANT: 
-        case SUB_QUERY: 
                       return;
         default:
                       assert(0);
@@ -2137,6 +2839,7 @@ void accessed_fields_deep(QueryCTX& ctx, ASTNode* expression, Vector<FieldNode*>
         case SUB_QUERY: 
                       {
                           auto sub_query = (SubQueryNode*)(expression);
+                          if(sub_query->unnested_) return accessed_fields_deep(ctx, sub_query->unnested_, fields);
                           QueryData* data = ctx.queries_call_stack_[sub_query->idx_];
                           get_fields_of_query_deep(ctx, data, fields);
                       }
@@ -2262,8 +2965,85 @@ Value evaluate_subquery(QueryCTX* ctx, const Tuple& cur_tuple, ASTNode* item) {
     return tmp.get_val_at(0);
 }
 
-Value evaluate_subquery_flat(QueryCTX* ctx, i32 query_idx) {
-    bool used_with_exists = false;
+// the results cache of a corelated sub-query (see subquery_cache.h), nullptr for other queries.
+// the cache of x IN (sub-query) has x as its last key.
+SubQueryCache* subquery_cache(QueryCTX* ctx, i32 query_idx, bool with_value) {
+    if(query_idx <= 0 || query_idx >= ctx->queries_call_stack_.size()) return nullptr;
+    QueryData* data = ctx->queries_call_stack_[query_idx];
+    if(!data->corelated_) return nullptr;
+    if(ctx->sub_query_caches_.size() < ctx->queries_call_stack_.size())
+        ctx->sub_query_caches_.resize(ctx->queries_call_stack_.size(), nullptr);
+    if(ctx->sub_query_caches_[query_idx]) return ctx->sub_query_caches_[query_idx];
+
+    SubQueryCache* cache = new(ALLOCATE(ctx->arena_, SubQueryCache)) SubQueryCache(&ctx->arena_);
+    // the parameters are the fields of the outer queries that are read by this query or by its own sub-queries.
+    Vector<FieldNode*> fields;
+    get_fields_of_query_deep(*ctx, data, fields);
+    for(int i = 0; i < fields.size(); ++i) {
+        bool outer = false;
+        for(int q = data->parent_idx_; q != -1 && !outer; q = ctx->queries_call_stack_[q]->parent_idx_)
+            outer = (fields[i]->query_idx_ == q);
+        for(int j = 0; outer && j < cache->params_.size(); ++j) {
+            FieldNode* param = cache->params_[j];
+            if(param->query_idx_ == fields[i]->query_idx_ && param->token_.val_ == fields[i]->token_.val_ &&
+                    param->table_name_->token_.val_ == fields[i]->table_name_->token_.val_) outer = false;
+        }
+        if(outer) cache->params_.push_back(fields[i]);
+    }
+    Arena* arenas[2];
+    for(int i = 0; i < 2; ++i){
+        arenas[i] = ALLOCATE(ctx->arena_, Arena);
+        new(arenas[i]) Arena();
+        arenas[i]->init();
+        ctx->batch_arenas_.push_back(arenas[i]);
+    }
+    cache->init(cache->params_.size() + with_value, arenas[0], arenas[1]);
+    ctx->sub_query_caches_[query_idx] = cache;
+    return cache;
+}
+
+// the cache keys of the current outer rows (the values of the parameters then val if it is given),
+// false if a parameter can't be read (its outer row is not there).
+bool subquery_cache_key(QueryCTX* ctx, SubQueryCache* cache, const Value* val, Value** keys, u64* hash) {
+    Value* out = (Value*) ctx->temp_arena_.alloc(sizeof(Value) * cache->num_keys_);
+    for(int i = 0; i < cache->params_.size(); ++i) {
+        FieldNode* param = cache->params_[i];
+        if(!param->schema_ || param->query_idx_ >= ctx->query_inputs.size()) return false;
+        const Tuple& row = ctx->query_inputs[param->query_idx_];
+        int col = param->schema_->col_exist(param->token_.val_, param->table_name_->token_.val_);
+        if(col < 0 || col >= row.size()) return false;
+        new(&out[i]) Value(row.get_val_at(col));
+    }
+    if(val) new(&out[cache->num_keys_ - 1]) Value(*val);
+    for(int i = 0; i < cache->num_keys_; ++i)
+        if(out[i].type_ == OVERFLOW_ITERATOR) out[i] = Value(out[i].getStringView(&ctx->temp_arena_));
+    *keys = out;
+    *hash = agg_keys_hash(out, cache->num_keys_);
+    return true;
+}
+
+void subquery_cache_insert(QueryCTX* ctx, SubQueryCache* cache, Value* keys, u64 hash, Value result) {
+    if(ctx->error_status_ != Error::NO_ERROR) return;
+    if(result.type_ == OVERFLOW_ITERATOR) result = Value(result.getStringView(&ctx->temp_arena_));
+    cache->insert(keys, hash, result);
+}
+
+Value run_subquery_flat(QueryCTX* ctx, i32 query_idx, bool used_with_exists);
+Value match_with_subquery_rows(QueryCTX* ctx, i32 query_idx, Value val);
+
+Value evaluate_subquery_flat(QueryCTX* ctx, i32 query_idx, bool used_with_exists) {
+    SubQueryCache* cache = subquery_cache(ctx, query_idx, false);
+    Value* keys = nullptr;
+    u64 hash = 0;
+    Value result;
+    if(cache && subquery_cache_key(ctx, cache, nullptr, &keys, &hash) && cache->find(keys, hash, &result))
+        return result;
+    result = run_subquery_flat(ctx, query_idx, used_with_exists);
+    if(keys) subquery_cache_insert(ctx, cache, keys, hash, result);
+    return result;
+}
+
+Value run_subquery_flat(QueryCTX* ctx, i32 query_idx, bool used_with_exists) {
     Executor* sub_query_executor = ctx->executors_call_stack_[query_idx]; 
     sub_query_executor->init();
     if(sub_query_executor->error_status_){
@@ -2299,6 +3079,35 @@ Value match_with_subquery(QueryCTX* ctx, i32 query_idx, Value val) {
     //if(val.getIntVal() == 0) asm("int3");
     if(val.isNull()) return Value(NULL_TYPE);
 
+    Executor* sub_query_executor = ctx->executors_call_stack_[query_idx]; 
+    // uncorrelated sub-queries are hashed once instead of being scanned for every value.
+    if(sub_query_executor->type_ == SUB_QUERY_EXECUTOR) {
+        if(sub_query_executor->output_schema_->numOfCols() != 1) {
+            std::cout << "[ERROR] sub-query should return exactly 1 column" << std::endl;
+            ctx->error_status_ = (Error)1; // TODO: better error handling.
+            return Value();
+        }
+        Value matched = ((SubQueryExecutor*)sub_query_executor)->match(val);
+        if(sub_query_executor->error_status_) {
+            std::cout << "[ERROR] could not execute sub-query" << std::endl;
+            ctx->error_status_ = (Error)1; // TODO: better error handling.
+            return Value();
+        }
+        return matched;
+    }
+    SubQueryCache* cache = subquery_cache(ctx, query_idx, true);
+    Value* keys = nullptr;
+    u64 hash = 0;
+    Value result;
+    if(cache && subquery_cache_key(ctx, cache, &val, &keys, &hash) && cache->find(keys, hash, &result))
+        return result;
+    result = match_with_subquery_rows(ctx, query_idx, val);
+    if(keys) subquery_cache_insert(ctx, cache, keys, hash, result);
+    return result;
+}
+
+// scans the rows of the sub-query until one of them is equal to val.
+Value match_with_subquery_rows(QueryCTX* ctx, i32 query_idx, Value val) {
     Executor* sub_query_executor = ctx->executors_call_stack_[query_idx]; 
     sub_query_executor->init();
     if(sub_query_executor->error_status_){
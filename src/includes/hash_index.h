@@ -0,0 +1,90 @@
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include <shared_mutex>
+#include "cache_manager.h"
+#include "page.h"
+#include "record.h"
+#include "index_key.h"
+#include "query_ctx.h"
+
+/*
+ * linear hash index: 'CREATE INDEX ... USING HASH'.
+ * it only answers equality lookups on all of its key columns, in exchange a lookup costs one bucket page read
+ * (plus its overflow chain if any) regardless of the size of the table.
+ *
+ * file layout:
+ * page 0     : reserved for the disk manager, its root page number slot points to the meta page.
+ * meta page  : level (4 bytes), split pointer (4 bytes), used bytes (8 bytes),
+ *              number of directory pages (4 bytes), then the page numbers of the directory pages.
+ * dir pages  : arrays of the page numbers of the primary bucket pages.
+ * buckets    : next overflow page number (4 bytes), number of entries (2 bytes), free space offset (2 bytes),
+ *              then the entries each one is (2 bytes size) followed by the IndexKey bytes (key columns + rid).
+ *              an overflow page is unlinked from its chain and freed as soon as it becomes empty.
+ *
+ * the number of buckets is (HASH_INITIAL_BUCKETS << level) + split pointer, a key goes to bucket
+ * hash % (HASH_INITIAL_BUCKETS << level) unless that bucket was already split in the current round,
+ * in that case it goes to hash % (HASH_INITIAL_BUCKETS << (level + 1)).
+ * buckets are split one at a time in order whenever the used bytes exceed 3/4 of the total bucket capacity.
+ */
+
+#define HASH_INITIAL_BUCKETS 4
+
+#define HASH_META_LEVEL_OFFSET       0
+#define HASH_META_SPLIT_PTR_OFFSET   4
+#define HASH_META_USED_BYTES_OFFSET  8
+#define HASH_META_NUM_DIR_OFFSET     16
+#define HASH_META_DIR_OFFSET         20
+#define HASH_MAX_DIR_PAGES          ((PAGE_SIZE - HASH_META_DIR_OFFSET) / sizeof(PageNum))
+#define HASH_BUCKETS_PER_DIR_PAGE   (PAGE_SIZE / sizeof(PageNum))
+#define HASH_MAX_BUCKETS            (HASH_MAX_DIR_PAGES * HASH_BUCKETS_PER_DIR_PAGE)
+
+#define HASH_BUCKET_NEXT_OFFSET      0
+#define HASH_BUCKET_COUNT_OFFSET     4
+#define HASH_BUCKET_FREE_OFFSET      6
+#define HASH_BUCKET_HEADER_SIZE      8
+#define HASH_BUCKET_CAPACITY        (PAGE_SIZE - HASH_BUCKET_HEADER_SIZE)
+#define HASH_ENTRY_HEADER_SIZE       2
+
+class HashIndex {
+    public:
+        void init(CacheManager* cm, FileID fid, int nkey_cols, bool is_unique);
+        void destroy();
+
+        void resize_nkey_cols(int nkey_cols);
+        // return true if inserted successfully.
+        bool Insert(QueryCTX* ctx, const IndexKey &key);
+        void Remove(QueryCTX* ctx, const IndexKey &key);
+        // append the record ids (of the table with table_fid) of all entries that match
+        // the first nkey_cols columns of the key.
+        void find(const IndexKey &key, FileID table_fid, Vector<RecordID>* rids);
+        FileID get_fid();
+        bool is_unique();
+
+    private:
+        void     create_meta();
+        void     persist_meta();
+        void     persist_bucket_pnum(u32 bucket);
+        u32      bucket_of(u64 hash);
+        PageNum  new_bucket_page();
+        // insert into the chain of the bucket without checking uniqueness or splitting.
+        bool     insert_into_bucket(u32 bucket, const char* data, u16 size);
+        void     split();
+
+        CacheManager* cache_manager_ = nullptr;
+        FileID fid_                  = INVALID_FID;
+        PageNum meta_pnum_           = INVALID_PAGE_NUM;
+        std::shared_mutex lock_;
+
+        u32 level_      = 0;
+        u32 split_ptr_  = 0;
+        u64 used_bytes_ = 0;
+        // in-memory copy of the directory, directory pages are only read at init.
+        Vector<PageNum> buckets_;
+        Vector<PageNum> dir_pages_;
+
+        int  nkey_cols_ = -1;
+        bool is_unique_index_ = false;
+};
+
+#endif //HASH_INDEX_H
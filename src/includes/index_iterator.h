@@ -22,6 +22,9 @@ class IndexIterator {
         void assign_to_null_page();
         // 0 in case of no more records.
         int advance();
+        // moves backward, an iterator that is past the last entry of its page moves to that entry.
+        // 0 in case of no more records.
+        int retreat();
 
         IndexKey getCurKey();
         RecordID getCurRecordID(FileID fid);
@@ -5,10 +5,13 @@
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <cmath>
 #include "tuple.h"
 
 struct IndexKey;
+struct QueryCTX;
 class BTreeIndex;
+class HashIndex;
 bool is_desc_order(char* bitmap, int idx);
 int index_key_cmp(IndexKey lhs,IndexKey rhs);
 IndexKey temp_index_key_from_values(Vector<Value>& vals);
@@ -80,10 +83,22 @@ struct IndexHeader {
     IndexHeader(BTreeIndex* index, String8 index_name, Vector<NumberedIndexField> fields_numbers = {}):
         index_(index), index_name_(index_name), fields_numbers_(fields_numbers)
     {};
+    IndexHeader(HashIndex* hash_index, String8 index_name, Vector<NumberedIndexField> fields_numbers = {}):
+        index_(nullptr), hash_index_(hash_index), index_name_(index_name), fields_numbers_(fields_numbers)
+    {};
     IndexHeader(Arena* arena):
         fields_numbers_(arena)
     {}
-    BTreeIndex* index_;
+    // dispatch to whichever access method backs this index (defined in hash_index.cpp).
+    bool insert(QueryCTX* ctx, const IndexKey& k);
+    void remove(QueryCTX* ctx, const IndexKey& k);
+    bool is_hash() const { return hash_index_ != nullptr; }
+    // no two entries have the same key.
+    bool is_unique() const;
+
+    BTreeIndex* index_ = nullptr;
+    // only set for 'USING HASH' indexes, index_ is null in that case.
+    HashIndex* hash_index_ = nullptr;
     String8 index_name_;
     Vector<NumberedIndexField> fields_numbers_;
 };
@@ -380,6 +395,148 @@ IndexKey index_key_resize_cpy(Arena* arena, IndexKey k, i32 n){
     };
 }
 
+// hash indexes compare keys by value, so numbers are widened to (LONG, DOUBLE) before hashing or comparing,
+// the same value can be stored as an INT or a LONG depending on where the tuple came from,
+// and a real without a fraction is turned into a LONG so that 2.0 finds the keys of 2.
+struct IndexKeyColumn {
+    u8  type_ = (u8)SerialType::NIL;
+    u8* payload_ = nullptr;
+    u32 size_ = 0;
+    i64 long_val_ = 0;
+    f64 double_val_ = 0;
+};
+
+// decode the next column of the key and advance the header and payload pointers past it.
+// return false if there are no more columns.
+bool index_key_next_column(u8** header, u64* header_size, u8** payload_ptr, IndexKeyColumn* col) {
+    if(*header_size == 0) return false;
+    u64 header_val = 0;
+    u8 bytes_read = varint_decode(*header, &header_val);
+    *header_size -= bytes_read;
+    *header      += bytes_read;
+    col->payload_ = *payload_ptr;
+    col->size_    = 0;
+    switch(header_val) {
+        case (u8)SerialType::NIL:
+        case (u8)SerialType::BOOL_TRUE:
+        case (u8)SerialType::BOOL_FALSE:
+            col->type_ = header_val;
+            break;
+        case (u8)SerialType::INT:
+        case (u8)SerialType::LONG:
+            col->type_     = (u8)SerialType::LONG;
+            col->long_val_ = header_val == (u8)SerialType::INT ? *(i32*)*payload_ptr : *(i64*)*payload_ptr;
+            col->payload_  = (u8*)&col->long_val_;
+            col->size_     = 8;
+            *payload_ptr  += header_val == (u8)SerialType::INT ? 4 : 8;
+            break;
+        case (u8)SerialType::FLOAT:
+        case (u8)SerialType::DOUBLE:
+            col->type_       = (u8)SerialType::DOUBLE;
+            col->double_val_ = header_val == (u8)SerialType::FLOAT ? *(f32*)*payload_ptr : *(f64*)*payload_ptr;
+            col->payload_    = (u8*)&col->double_val_;
+            col->size_       = 8;
+            *payload_ptr    += header_val == (u8)SerialType::FLOAT ? 4 : 8;
+            // [-2^63, 2^63) is the range of a LONG.
+            if(col->double_val_ == std::trunc(col->double_val_) 
+                    && col->double_val_ >= -9223372036854775808.0 && col->double_val_ < 9223372036854775808.0) {
+                col->type_     = (u8)SerialType::LONG;
+                col->long_val_ = (i64)col->double_val_;
+                col->payload_  = (u8*)&col->long_val_;
+            }
+            break;
+        case (u8)SerialType::TEXT:
+        default: // text is the default.
+            col->type_    = (u8)SerialType::TEXT;
+            col->size_    = header_val - (u8)SerialType::TEXT;
+            *payload_ptr += col->size_;
+            break;
+    }
+    return true;
+}
+
+// hash the first n columns of the key (FNV-1a over their widened types and payloads).
+u64 index_key_hash(IndexKey k, i32 n) {
+    assert(k.data_ && k.size_ && n);
+    u64 header_size  = 0;
+    u8* header       = (u8*)k.data_ + varint_decode((u8*)k.data_, &header_size);
+    u8* payload_ptr  = (u8*)k.data_ + header_size;
+    header_size     -= (header - (u8*)k.data_);
+
+    u64 hash = 14695981039346656037ULL;
+    IndexKeyColumn col;
+    while(n-- && index_key_next_column(&header, &header_size, &payload_ptr, &col)) {
+        hash = (hash ^ col.type_) * 1099511628211ULL;
+        for(u32 i = 0; i < col.size_; ++i)
+            hash = (hash ^ col.payload_[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// equality of the first n columns of both keys by value,
+// unlike index_key_cmp it never asserts on keys of different types it just reports them as different.
+bool index_key_prefix_eq(IndexKey lhs, IndexKey rhs, i32 n) {
+    assert(lhs.data_ && lhs.size_ && rhs.data_ && rhs.size_);
+    u64 lhs_header_size  = 0;
+    u8* lhs_header       = (u8*)lhs.data_ + varint_decode((u8*)lhs.data_, &lhs_header_size);
+    u8* lhs_payload_ptr  = (u8*)lhs.data_ + lhs_header_size;
+    lhs_header_size     -= (lhs_header - (u8*)lhs.data_);
+
+    u64 rhs_header_size  = 0;
+    u8* rhs_header       = (u8*)rhs.data_ + varint_decode((u8*)rhs.data_, &rhs_header_size);
+    u8* rhs_payload_ptr  = (u8*)rhs.data_ + rhs_header_size;
+    rhs_header_size     -= (rhs_header - (u8*)rhs.data_);
+
+    IndexKeyColumn lhs_col, rhs_col;
+    while(n--) {
+        bool has_lhs = index_key_next_column(&lhs_header, &lhs_header_size, &lhs_payload_ptr, &lhs_col);
+        bool has_rhs = index_key_next_column(&rhs_header, &rhs_header_size, &rhs_payload_ptr, &rhs_col);
+        if(has_lhs != has_rhs) return false;
+        if(!has_lhs) return true;
+        if(lhs_col.type_ != rhs_col.type_ || lhs_col.size_ != rhs_col.size_ 
+                || memcmp(lhs_col.payload_, rhs_col.payload_, lhs_col.size_) != 0)
+            return false;
+    }
+    return true;
+}
+
+// copy the first n columns of the key followed by a null column, 
+// seeking to the upper bound of the result skips all the nulls of the next column within the same prefix.
+IndexKey index_key_prefix_with_null(Arena* arena, IndexKey k, i32 n) {
+    if(n == 0) {
+        u8* buf = (u8*)arena->alloc(2);
+        buf[0] = 2;
+        buf[1] = (u8)SerialType::NIL;
+        return {
+            .data_ = (char*)buf,
+            .size_ = 2,
+        };
+    }
+    IndexKey prefix = index_key_resize_cpy(arena, k, n);
+
+    u64 header_size = 0;
+    u8 old_byte_cnt = varint_decode((u8*)prefix.data_, &header_size);
+    u32 types_size   = header_size - old_byte_cnt;
+    u32 payload_size = prefix.size_ - header_size;
+
+    u32 new_header_size = types_size + 1;
+    u8 byte_cnt = varint_encode(nullptr, new_header_size);
+    new_header_size += byte_cnt;
+    if(varint_encode(nullptr, new_header_size) != byte_cnt)
+        new_header_size++;
+
+    u8* buf = (u8*)arena->alloc(new_header_size + payload_size);
+    u8* header_ptr = buf + varint_encode(buf, new_header_size);
+    memcpy(header_ptr, prefix.data_ + old_byte_cnt, types_size);
+    header_ptr += types_size;
+    *header_ptr++ = (u8)SerialType::NIL;
+    memcpy(buf + new_header_size, prefix.data_ + header_size, payload_size);
+    return {
+        .data_ = (char*)buf,
+        .size_ = new_header_size + payload_size,
+    };
+}
+
 // -1 ==> lhs < rhs, 0 eq, 1 ==> lhs > rhs
 int index_key_cmp(IndexKey lhs, IndexKey rhs) {
     assert(lhs.sort_order_ != nullptr || rhs.sort_order_ != nullptr); // at least one key should know the order
@@ -415,6 +572,7 @@ int index_key_cmp(IndexKey lhs, IndexKey rhs) {
         if(header_val == (u8)SerialType::NIL && rhs_header_val == (u8)SerialType::NIL) { // both are null.
             header++;
             rhs_header++;
+            ++idx;
             continue; 
         }
 
@@ -441,7 +599,9 @@ int index_key_cmp(IndexKey lhs, IndexKey rhs) {
                 }
             case (u8)SerialType::INT:
                 {
-                    diff = *(i32*) payload_ptr - *(i32*) rhs_payload_ptr;
+                    i32 lval = *(i32*) payload_ptr;
+                    i32 rval = *(i32*) rhs_payload_ptr;
+                    diff = (lval > rval) - (lval < rval);
                     header++;
                     rhs_header++;
                     payload_ptr     += 4;
@@ -450,7 +610,9 @@ int index_key_cmp(IndexKey lhs, IndexKey rhs) {
                 }
             case (u8)SerialType::LONG:
                 {
-                    diff = *(i64*) payload_ptr - *(i64*) rhs_payload_ptr;
+                    i64 lval = *(i64*) payload_ptr;
+                    i64 rval = *(i64*) rhs_payload_ptr;
+                    diff = (lval > rval) - (lval < rval);
                     header++;
                     rhs_header++;
                     payload_ptr     += 8;
@@ -499,6 +661,8 @@ int index_key_cmp(IndexKey lhs, IndexKey rhs) {
 
                     diff = memcmp(payload_ptr, rhs_payload_ptr, 
                             std::min(header_val, rhs_header_val)-(u8)SerialType::TEXT);
+                    // a text that is a prefix of the other one comes first.
+                    if(!diff) diff = (header_val > rhs_header_val) - (header_val < rhs_header_val);
 
                     payload_ptr     += header_val     - (u8)SerialType::TEXT;
                     rhs_payload_ptr += rhs_header_val - (u8)SerialType::TEXT;
@@ -0,0 +1,97 @@
+#ifndef JOIN_HASH_TABLE_H
+#define JOIN_HASH_TABLE_H
+
+#include "value.h"
+#include "tuple.h"
+
+/*
+ * in-memory hash table for the build side of hash joins.
+ * keys are the typed values of the join columns (no string formatting), their hashes are computed once
+ * when the row is inserted and stored next to it.
+ *
+ * rows       : contiguous array of the build rows with their hash, the rows of the same hash are chained
+ *              through next_ in insertion order.
+ * slots      : open addressing (linear probing) from the hash to the first row of its chain,
+ *              the number of slots is a power of two of at least twice the number of rows.
+ * bloom      : 2 bits per key in a bit array of about 8 bits per row, the probe side checks it
+ *              before touching the slots so most misses cost a single cache line.
+ * rows with a null key column never match, they are only kept for outer joins.
+ */
+
+#define JOIN_NO_ROW ((u32)-1)
+#define JOIN_BLOOM_BITS_PER_ROW 8
+
+/*
+ * partitioning (shared by the hash join, the hash aggregation and the hash set operations):
+ * rows are split into HASH_JOIN_FANOUT partitions by join_partition_of(), which mixes the hash of the keys
+ * with the level so a partition is split again by different bits than the ones that made it.
+ * every partition is a temp table that is processed on its own once its input is done, one that still does not fit
+ * in the work_mem_ of the query is split again at the next level. the number of levels is capped,
+ * deeper partitions are usually a single skewed key that can't be split and they are processed in memory anyway.
+ *
+ * hybrid hash join:
+ * the build rows stay in memory as long as they fit, once the budget is exceeded both inputs are partitioned
+ * by their key hashes. partition 0 stays in memory (while it fits) and is joined while the probe side streams by,
+ * the other partitions are joined one pair of build and probe tables at a time after that, up to HASH_JOIN_MAX_LEVEL levels.
+ */
+#define HASH_JOIN_FANOUT        16
+#define HASH_JOIN_MAX_LEVEL     4
+
+class TableSchema;
+
+// a pair of temp tables holding the build and probe rows of one partition, a side without rows has no table.
+struct JoinPartition {
+    TableSchema* build_ = nullptr;
+    TableSchema* probe_ = nullptr;
+    u32 level_ = 0;
+};
+
+struct JoinRow {
+    Tuple tuple_;
+    u64   hash_     = 0;
+    u32   next_     = JOIN_NO_ROW;
+    bool  null_key_ = false;
+    // the row matched at least one probe row, rows that never match are returned by left and full joins.
+    bool  visited_  = false;
+};
+
+struct JoinSlot {
+    u64 hash_ = 0;
+    u32 head_ = JOIN_NO_ROW;
+};
+
+struct JoinHashTable {
+    JoinHashTable(Arena* arena);
+
+    void clear();
+    // the tuple should outlive the table.
+    void insert(const Tuple& t, u64 hash, bool null_key);
+    // builds the slots and the bloom filter after all rows are inserted.
+    void build();
+    bool may_contain(u64 hash);
+    // returns the first row of the chain of the hash or JOIN_NO_ROW.
+    u32  find(u64 hash);
+    u32  size();
+
+    Vector<JoinRow>  rows_;
+    Vector<JoinSlot> slots_;
+    Vector<u64>      bloom_;
+    u64 slot_mask_  = 0;
+    u64 bloom_mask_ = 0;
+};
+
+u64  hash_mix(u64 h);
+// the partition of a key hash at a given level of the hybrid hash join, every level uses independent bits.
+u32  join_partition_of(u64 hash, u32 level);
+// equal values hash the same regardless of their numeric type (1 = 1.0), nulls are not hashed.
+u64  value_hash(const Value& v);
+// typed equality of two key values, a null is not equal to anything.
+bool value_key_eq(const Value& lhs, const Value& rhs);
+// three way comparison of two non null numeric key values (merge joins).
+int  value_key_cmp(const Value& lhs, const Value& rhs);
+u64  hash_key_columns(const Tuple& t, const Vector<int>& cols, bool* has_null);
+bool key_columns_eq(const Tuple& lhs, const Vector<int>& lhs_cols, const Tuple& rhs, const Vector<int>& rhs_cols);
+// replaces large (overflow) text key values with their content so they can be hashed and compared.
+void materialize_key_columns(Tuple* t, const Vector<int>& cols, Arena* arena);
+
+#endif // JOIN_HASH_TABLE_H
@@ -11,8 +11,13 @@
 #define TableID FileID
 #define IndexID FileID
 
+class Catalog;
+class TableSchema;
+
 // assuming average token size is 4.
 #define AVG_TOKEN_SIZE 4
+// the default of QueryCTX::work_mem_.
+#define DEFAULT_WORK_MEM (64ULL << 20)
 
 // each query has its own context that is passed around the system.
 struct QueryCTX {
@@ -48,12 +53,20 @@ struct QueryCTX {
     Vector<QueryData*> set_operations_ = {};
     Vector<IndexIterator*> index_handles_ = {};
     Vector<TableIterator*> table_handles_ = {};
+    Vector<Arena*> batch_arenas_ = {}; // the payload arenas of the row batches of the executors.
+    Vector<TableSchema*> temp_tables_ = {}; // the spill files of the executors, deleted by clean() if still there.
+    Catalog* catalog_ = nullptr; // creates and deletes the temp tables.
     Vector<AlgebraOperation*> operators_call_stack_ = {};
     Vector<Executor*> executors_call_stack_ = {};
     std::vector<Tuple> query_inputs = {};
+    // the results caches of the corelated sub-queries by query index, created when they are first evaluated.
+    Vector<SubQueryCache*> sub_query_caches_ = {};
     Arena arena_;  // this arena lasts for the entire duration of the query.
     Arena temp_arena_; // this arena gets cleaned up after every call to next().
     uint32_t cursor_ = 0;
+    // the bytes that every sort, hash join, aggregation and set operation of the query can keep in memory
+    // before it spills to temp tables.
+    u64 work_mem_ = DEFAULT_WORK_MEM;
     Error error_status_ = Error::NO_ERROR;
     bool direct_execution_ = 0;    // directly execeute without translating to algebra, Usually set to true for DDL.
 };
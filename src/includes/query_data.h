@@ -17,6 +17,7 @@ enum QueryType {
     INSERT_DATA,
     DELETE_DATA,
     UPDATE_DATA,
+    ANALYZE_DATA,
     // set operations.
     UNION,
     INTERSECT,
@@ -43,6 +44,8 @@ struct QueryData {
     // the top level query is always not corelated and has a parent_query_idx of -1.
     // TODO: if the top level query is corelated that is an error, indicate that.
     bool corelated_ = false; 
+    // a corelated sub-query that is planned as a join of its parent, it has no plan of its own.
+    bool unnested_ = false;
 };
 
 // SQL statement data wrappers.
@@ -53,10 +56,14 @@ struct SelectStatementData : QueryData {
     Vector<ExpressionNode*> fields_ = {};
     Vector<AggregateFuncNode*> aggregates_;  
     Vector<int> order_by_list_ = {};
+    Vector<bool> order_by_desc_ = {};
     Vector<ASTNode*> group_by_ = {}; 
     bool has_star_ = false;
     ExpressionNode* having_ = nullptr;
     bool distinct_ = false;
+    // LIMIT count OFFSET count, MAX_U64 means no limit.
+    u64 limit_  = MAX_U64;
+    u64 offset_ = 0;
 
 };
 
@@ -90,6 +97,8 @@ struct CreateIndexStatementData : QueryData {
     String8 index_name_ = {};
     String8 table_name_ = {};
     bool is_unique_index_ = false;
+    // CREATE INDEX ... USING HASH.
+    bool is_hash_index_ = false;
 };
 
 struct DropTableStatementData : QueryData {
@@ -104,6 +113,13 @@ struct DropIndexStatementData : QueryData {
     String8 index_name_ = {};
 };
 
+struct AnalyzeStatementData : QueryData {
+    AnalyzeStatementData(Arena* arena, int parent_idx);
+
+    // empty means every table.
+    String8 table_name_ = {};
+};
+
 struct InsertStatementData : QueryData {
     InsertStatementData(Arena* arena, int parent_idx);
 
@@ -0,0 +1,72 @@
+#ifndef SET_HASH_TABLE_H
+#define SET_HASH_TABLE_H
+
+#include "value.h"
+#include "tuple.h"
+
+/*
+ * in-memory hash table of the rows of the set operators (DISTINCT, UNION, INTERSECT and EXCEPT).
+ * rows are hashed and compared by their typed values (no string formatting), two nulls are equal
+ * the same way they are for group by keys.
+ *
+ * entries : contiguous array of the distinct rows, every entry has a copy of the row, its hash,
+ *           the number of times it is left in the right input (INTERSECT and EXCEPT) and if it was already returned.
+ * slots   : open addressing (linear probing) from the hash to the entry, grows when it is half full.
+ */
+
+#define SET_NO_ENTRY ((u32)-1)
+
+/*
+ * spilling set operations (see join_hash_table.h for the partitioning):
+ * once the table exceeds the budget it is frozen: the rows that are already in it keep being matched in memory,
+ * every other row is written to its partition, the right input rows to the build side and the left input rows
+ * (or the only input of DISTINCT) to the probe side.
+ * a row that is not in the frozen table can't be equal to any row in it, so the partitions don't need it anymore.
+ */
+#define SET_MAX_LEVEL     4
+
+enum SetOpType {
+    SET_DISTINCT = 0,
+    SET_INTERSECT,
+    SET_EXCEPT,
+};
+
+struct SetEntry {
+    Tuple row_;
+    u64   hash_    = 0;
+    // the number of copies of the row in the right input that were not matched yet.
+    i64   count_   = 0;
+    bool  emitted_ = false;
+};
+
+struct SetSlot {
+    u64 hash_  = 0;
+    u32 entry_ = SET_NO_ENTRY;
+};
+
+struct SetHashTable {
+    SetHashTable(Arena* arena);
+
+    void clear();
+    // returns the entry of the row or SET_NO_ENTRY.
+    u32  find(const Tuple& row, u64 hash);
+    // creates a new entry, the row is copied into the arena.
+    u32  insert(Arena* arena, const Tuple& row, u64 hash);
+    u32  size();
+    // the bytes used by the table itself, the rows are counted by their arena.
+    u64  memory_usage();
+
+    Vector<SetEntry> entries_;
+    Vector<SetSlot>  slots_;
+    u64 slot_mask_ = 0;
+
+    private:
+    void grow();
+};
+
+// hash of all the values of the row, overflow values should be materialized by the caller.
+u64  set_row_hash(const Tuple& row);
+// typed equality of two rows of the same width, two nulls are equal.
+bool set_row_eq(const Tuple& lhs, const Tuple& rhs);
+
+#endif // SET_HASH_TABLE_H
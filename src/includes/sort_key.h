@@ -0,0 +1,71 @@
+#ifndef SORT_KEY_H
+#define SORT_KEY_H
+
+#include "value.h"
+#include "tuple.h"
+
+/*
+ * normalized sort keys: the ORDER BY columns of a row are encoded into one byte string so that comparing two rows
+ * is a single memcmp instead of comparing Values column by column.
+ * each column starts with a tag byte: 0 null, 1 number, 2 text, so nulls are the smallest values.
+ * numbers : the value as a double (sign flipped, big endian) followed by the value as an integer,
+ *           so integers and reals compare by their numeric value and large integers stay exact.
+ * text    : the bytes with every 0 byte escaped as (0, 0xFF), terminated by (0, 0).
+ * descending columns have all the bytes of their part inverted.
+ */
+
+/*
+ * external sort:
+ * rows and their keys are collected until they take the work_mem_ of the query, then they are sorted and written to a temp table
+ * as a sorted run. the runs are merged with a loser tree, at most SORT_MERGE_FANIN at a time because every open run
+ * pins a page in the buffer pool, while there are more runs than that groups of them are merged into longer runs first.
+ * a run row is stored as: key size (4 bytes), the key, then the serialized row.
+ */
+#define SORT_MERGE_FANIN 16
+
+#define SORT_KEY_NULL   0
+#define SORT_KEY_NUMBER 1
+#define SORT_KEY_TEXT   2
+
+// the columns should not hold overflow values (see materialize_key_columns).
+String8 build_sort_key(Arena* arena, const Tuple& t, const Vector<int>& cols, const Vector<bool>& desc);
+int     sort_key_cmp(String8 lhs, String8 rhs);
+
+struct SortEntry {
+    String8 key_;
+    Tuple   tuple_;
+    // input order, only used to keep the top-N sort stable.
+    u64     seq_ = 0;
+};
+
+// orders by the key then by the input order.
+bool sort_entry_less(const SortEntry& lhs, const SortEntry& rhs);
+
+/*
+ * tournament tree of losers for k-way merges: every internal node keeps the loser of the match played there
+ * and tree_[0] keeps the overall winner, replacing the key of the winner replays only the path to the root
+ * (log k comparisons and no swaps of the keys themselves).
+ * a source with an empty key (nullptr) is exhausted and loses to everything,
+ * equal keys are won by the source with the smaller index so merging runs in input order is stable.
+ */
+struct LoserTree {
+    LoserTree(Arena* arena);
+
+    void init(u32 k);
+    // plays all matches, call after setting the first key of every source.
+    void build();
+    // the source with the smallest key, check keys_[winner()] to know if all sources are exhausted.
+    u32  winner();
+    // call after changing the key of the winner.
+    void replay();
+
+    Vector<String8> keys_;
+    Vector<u32> tree_;
+    u32 k_ = 0;
+
+    private:
+    bool beats(u32 a, u32 b);
+    u32  build_node(u32 node);
+};
+
+#endif // SORT_KEY_H
@@ -0,0 +1,74 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include "value.h"
+#include "tuple.h"
+#include <unordered_set>
+
+/*
+ * table statistics collected by the ANALYZE command and used by the optimizer to estimate the number of rows
+ * produced by scans, filters and joins.
+ * table  : the number of rows.
+ * column : the number of distinct non null values (ndv), the fraction of null values and an equi-depth histogram
+ *          of the numeric columns: STATS_HISTOGRAM_BUCKETS buckets that hold the same number of rows each,
+ *          bounds_[0] is the smallest value and bounds_[i] is the largest value of the i-th bucket.
+ * distinct values are counted exactly (by their hashes) over all rows, histograms are built from a reservoir sample
+ * of at most STATS_SAMPLE_SIZE values per column so ANALYZE never sorts a whole table.
+ *
+ * the statistics are persisted by the catalog in two tables next to NILEDB_META_DATA:
+ * NDB_TABLE_STATS  (table_name TEXT, row_count BIGINT).
+ * NDB_COLUMN_STATS (table_name TEXT, field_number INTEGER, ndv BIGINT, null_frac REAL, histogram TEXT),
+ * the histogram is stored as its bounds separated by spaces, it is empty for text columns.
+ * statistics are not updated by DML, they describe the table as it was during the last ANALYZE.
+ */
+
+#define STATS_HISTOGRAM_BUCKETS 32
+#define STATS_SAMPLE_SIZE       30000
+
+// default selectivities of predicates that the statistics can't help with.
+#define STATS_DEFAULT_EQ_SEL    0.1
+#define STATS_DEFAULT_RANGE_SEL (1.0 / 3.0)
+
+struct ColumnStats {
+    i64 ndv_ = 0;
+    double null_frac_ = 0;
+    Vector<double> bounds_;
+};
+
+struct TableStats {
+    i64 row_count_ = 0;
+    Vector<ColumnStats> columns_;
+};
+
+// collects the statistics of one table, one row at a time.
+struct StatsCollector {
+    void init(u32 num_cols);
+    // overflow values should be materialized by the caller.
+    void add_row(const Tuple& t);
+    void finish(TableStats* out);
+
+    private:
+    struct ColumnState {
+        std::unordered_set<u64> hashes_;
+        Vector<double> sample_;
+        i64 nulls_   = 0;
+        i64 numbers_ = 0;
+    };
+    u64 next_random();
+
+    Vector<ColumnState> columns_;
+    i64 rows_ = 0;
+    u64 random_state_ = 0x9e3779b97f4a7c15ULL;
+};
+
+// the numeric value of a number or a boolean, false for other types.
+bool stats_number(const Value& v, double* out);
+// fraction of the rows that are equal to one value of the column.
+double stats_eq_selectivity(const ColumnStats& col);
+// fraction of the rows with a value less than (or equal to) val, STATS_DEFAULT_RANGE_SEL if there is no histogram.
+double stats_less_selectivity(const ColumnStats& col, double val, bool inclusive);
+
+String stats_histogram_to_str(const Vector<double>& bounds);
+Vector<double> stats_histogram_from_str(String8 str);
+
+#endif // STATISTICS_H
@@ -0,0 +1,70 @@
+#ifndef SUBQUERY_CACHE_H
+#define SUBQUERY_CACHE_H
+
+#include "value.h"
+#include "arena.h"
+
+/*
+ * results cache of a corelated sub-query that could not be unnested (see AlgebraEngine::unnest_subqueries).
+ * the result of a corelated sub-query only depends on the values of the outer fields it reads (its parameters),
+ * so the results are kept by those values and the inner plan runs once for every distinct set of them
+ * instead of once for every outer row. x IN (sub-query) caches the result of matching x, so x is a key as well.
+ *
+ * entries : at most SUBQUERY_CACHE_ENTRIES, chained from buckets_ by the hash of their keys (nulls are equal keys)
+ *           and linked from the most to the least recently used, the least recently used entry
+ *           is evicted to make room once the cache is full.
+ * memory  : keys and results are copied into arena_, evicted entries leave their copies behind so when the arena
+ *           grows over SUBQUERY_CACHE_MEMORY the live entries are copied into spare_arena_ and the two are swapped.
+ */
+#define SUBQUERY_CACHE_ENTRIES 4096
+#define SUBQUERY_CACHE_MEMORY  (16ULL << 20)
+
+#define SUBQUERY_CACHE_NO_ENTRY ((u32)-1)
+
+struct FieldNode;
+
+struct SubQueryCacheEntry {
+    Value* keys_  = nullptr;
+    Value  result_;
+    u64    hash_  = 0;
+    // the next entry of the same bucket.
+    u32    chain_ = SUBQUERY_CACHE_NO_ENTRY;
+    // the recently used list.
+    u32    prev_  = SUBQUERY_CACHE_NO_ENTRY;
+    u32    next_  = SUBQUERY_CACHE_NO_ENTRY;
+};
+
+struct SubQueryCache {
+    SubQueryCache(Arena* arena);
+
+    // arena and spare_arena are owned by the caller.
+    void init(u32 num_keys, Arena* arena, Arena* spare_arena);
+    // copies the cached result of the keys into result and marks it as the most recently used.
+    bool find(const Value* keys, u64 hash, Value* result);
+    // overflow values should be materialized by the caller.
+    void insert(const Value* keys, u64 hash, const Value& result);
+    void clear();
+
+    // the outer fields read by the sub-query, set by the caller (see subquery_cache in expression.h).
+    Vector<FieldNode*> params_;
+    Vector<SubQueryCacheEntry> entries_;
+    Vector<u32> buckets_;
+    u32 num_keys_ = 0;
+    u64 hits_      = 0;
+    u64 misses_    = 0;
+    u64 evictions_ = 0;
+
+    private:
+    void unlink(u32 e);
+    void push_front(u32 e);
+    void unchain(u32 e);
+    void copy_entry(Arena* arena, SubQueryCacheEntry& entry, const Value* keys, const Value& result);
+    void compact();
+
+    Arena* arena_       = nullptr;
+    Arena* spare_arena_ = nullptr;
+    u32 head_ = SUBQUERY_CACHE_NO_ENTRY;
+    u32 tail_ = SUBQUERY_CACHE_NO_ENTRY;
+};
+
+#endif // SUBQUERY_CACHE_H
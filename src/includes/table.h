@@ -8,6 +8,7 @@
 #include "record.h"
 #include "table_data_page.h"
 #include "overflow_page.h"
+#include "zone_map.h"
 
 class TableIterator;
 class OverflowIterator;
@@ -38,6 +39,13 @@ class Table {
         void init(CacheManager* cm, FileID fid);
         void destroy();
         void update_first_page_number(PageNum pnum);
+        // rows are always added to the last page (no free space map) so scans return them in insertion order,
+        // used by temp tables that are written once then scanned.
+        void set_append_only();
+        // starts keeping zone maps of the numeric columns, does nothing for append only tables.
+        void init_zone_map(const Vector<Column>& columns, u32 fixed_size);
+        // nullptr if the table has no zone maps.
+        ZoneMap* get_zone_map();
 
 
     private:
@@ -52,6 +60,8 @@ class Table {
         // rid is both an input to find the record and an output of the new position of the updated record. 
         // updates are performed by deleting the old record followed by an insertion of the new one.
         int updateRecord(RecordID *rid, Record &new_record);
+        // the record in the slot is about to be deleted.
+        void remove_from_zone_map(TableDataPage* table_page, u32 slot);
     public:
 
         OverflowPage* new_overflow_page();
@@ -62,6 +72,8 @@ class Table {
         // read only pages.
         TableDataPage* get_data_page(PageNum pnum);
         void release_data_page(PageNum pnum);
+        // copy the record into the arena, return an invalid record in case of an error.
+        Record getRecordCpy(Arena* arena, RecordID &rid);
 
         // we allow only forward scans for now via tableIterator.advance().
         TableIterator begin(TableSchema* schema);
@@ -72,6 +84,9 @@ class Table {
         CacheManager* cache_manager_ = nullptr;
         FileID fid_ = INVALID_FID;
         PageNum first_pnum_ = INVALID_PAGE_NUM;
+        bool append_only_ = false;
+        PageNum last_pnum_ = INVALID_PAGE_NUM;
+        ZoneMap zone_map_;
 };
 
 #endif // TABLE_H 
@@ -23,11 +23,18 @@ class TableIterator {
         int advance();
 
     private:
-        Record getCurRecord();
         Record getCurRecordCpy(Arena* arena);
     public:
+        // a view over the current record inside of its page, valid until the iterator moves to the next page.
+        Record getCurRecord();
         int    getCurTupleCpy(Arena& arena, Tuple* out);
         RecordID getCurRecordID();
+        TableDataPage* getCurPage();
+        // the next advance() moves to the first record of the next page.
+        void skipCurPage();
+        // the page that advance() moves to once the current one is done, 0 if the current page is the last one.
+        u32  getNextPageNumber();
+        void setNextPageNumber(u32 next_page_number);
     private:
         PageID cur_page_id_ = INVALID_PAGE_ID;
         CacheManager *cache_manager_ = nullptr;
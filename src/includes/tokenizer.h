@@ -50,6 +50,7 @@ enum class TokenType {
     PRIMARY,
     KEY,
     UNIQUE,
+    HASH,
     UNION,
     EXCEPT,
     INTERSECT,
@@ -75,6 +76,8 @@ enum class TokenType {
     AS,
     ON,
     HAVING,
+    LIMIT,
+    OFFSET,
     DISTINCT,
     INSERT,
     FROM,
@@ -91,6 +94,7 @@ enum class TokenType {
     CREATE,
     DROP,
     TABLE,
+    ANALYZE,
     SUM,
     COUNT,
     AVG,
@@ -24,6 +24,12 @@ struct Tuple {
     void put_val_at(int idx, Value v);
     Value& get_val_at(uint32_t idx) const;
     bool is_empty();
+    // flattens the tuple into a single byte string (rid, then the type, size and bytes of each value)
+    // so it can be stored as a text value in a temp table, large (overflow) values are read into the string.
+    String8 serialize(Arena* arena) const;
+    // the inverse of serialize, the values point into data so it should outlive the tuple.
+    // return 1 in case of an error.
+    int deserialize(String8 data);
 };
 
 #endif //TUPLE_H
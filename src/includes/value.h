@@ -1,5 +1,7 @@
 #pragma once
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <string>
 #include "column.h"
 #include "utils.h"
@@ -21,6 +23,14 @@ enum MathOp {
 // check for overflows and underflows for 64 bit.
 bool is_valid_operation64(int64_t a, int64_t b, MathOp op);
 
+// compares two texts of the given sizes (they don't need to be null terminated),
+// a text that is a prefix of the other one comes first.
+inline int text_cmp(const char* lhs, u32 lhs_size, const char* rhs, u32 rhs_size) {
+    int cmp = strncmp(lhs, rhs, std::min(lhs_size, rhs_size));
+    if(cmp != 0) return cmp;
+    return (lhs_size > rhs_size) - (lhs_size < rhs_size);
+}
+
 class Value {
     private:
         uintptr_t content_ = 0;
@@ -75,6 +85,11 @@ class Value {
         long long getBigIntVal() const;
         float getFloatVal() const;
         double getDoubleVal() const;
+        // raw reads without any type checks, used by the typed expression opcodes that already checked type_.
+        inline i32 as_int() const            { return *(i32*)&content_; }
+        inline i64 as_bigint() const         { return *(i64*)&content_; }
+        inline double as_double() const      { return *(double*)&content_; }
+        inline const char* as_varchar() const { return (const char*)content_; }
 
         bool operator==(const Value &rhs) const;
         bool operator!=(const Value &rhs) const;
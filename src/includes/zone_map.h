@@ -0,0 +1,72 @@
+#ifndef ZONE_MAP_H
+#define ZONE_MAP_H
+
+#include "column.h"
+#include "page.h"
+
+/*
+ * per page summaries (zone maps) of the numeric columns of a heap table: the smallest and the largest value and
+ * the number of null and non null values of every INT, BIGINT and DOUBLE column of the records in the page.
+ * a sequential scan skips the pages whose summaries show that none of their records can pass its record predicates
+ * (see zone_map_rejects_page in expression.h).
+ *
+ * every summary also keeps the number of the next page of the table, so a scan can check the pages ahead of it
+ * and jump over the rejected ones without fetching them.
+ *
+ * the summaries are kept in memory next to the table (they are not written to disk) and are maintained by
+ * Table::insertRecord, deleteRecord and updateRecord. removing a record only updates the counts, min and max stay
+ * as wide as they were which is still safe for skipping pages.
+ * pages that were written before the table got opened have no summary until a scan reads them (see summarize_page),
+ * pages without a summary are never skipped, so the first scan after opening the table still reads every page.
+ * temporary (append only) tables have no zone maps.
+ */
+
+class Record;
+class TableDataPage;
+
+struct Zone {
+    i64    min_int_    = INT64_MAX;
+    i64    max_int_    = INT64_MIN;
+    double min_double_ = std::numeric_limits<double>::infinity();
+    double max_double_ = -std::numeric_limits<double>::infinity();
+    u32    nulls_      = 0;
+    u32    values_     = 0;
+};
+
+struct ZoneColumn {
+    u32  col_    = 0;
+    Type type_   = INVALID;
+    u32  offset_ = 0;
+};
+
+struct ZoneMap {
+    // fixed_size is the size of the fixed part of the records, the null bitmap comes right after it.
+    void init(const Vector<Column>& columns, u32 fixed_size);
+    bool enabled();
+    // a new empty page.
+    void reset_page(PageNum pnum);
+    void add(PageNum pnum, Record& r);
+    void remove(PageNum pnum, Record& r);
+    bool has_summary(PageNum pnum);
+    // builds the summary of a page from its records.
+    void summarize_page(PageNum pnum, TableDataPage* page);
+    // the summary of a column in a page, nullptr if the page or the column have no summary.
+    const Zone* get_zone(PageNum pnum, u32 col);
+    // the page after pnum in the page list of the table (0 for the last page), only known for pages with a summary.
+    PageNum next_page(PageNum pnum);
+    void set_next_page(PageNum pnum, PageNum next);
+
+    private:
+    Zone* page_zones(PageNum pnum);
+
+    Vector<ZoneColumn> columns_;
+    // the index of a table column in columns_, -1 for the columns without summaries.
+    Vector<i32> zone_of_col_;
+    // the summaries of page p are zones_[p * columns_.size(), (p + 1) * columns_.size()).
+    Vector<Zone> zones_;
+    Vector<bool> has_summary_;
+    Vector<PageNum> next_pages_;
+    u32 bitmap_offset_ = 0;
+};
+
+#endif // ZONE_MAP_H
@@ -80,6 +80,29 @@ int IndexIterator::advance() {
     return 1;
 }
 
+// 0 in case of no more records.
+int IndexIterator::retreat() {
+    if(cur_page_id_ == INVALID_PAGE_ID || !cur_page_) return 0;
+    int sz = cur_page_->get_num_of_slots();
+    if(entry_idx_ > sz) entry_idx_ = sz;
+    if(entry_idx_ > 0) {
+        entry_idx_--;
+        return 1;
+    }
+    PageID prev_page_id = cur_page_id_;
+    prev_page_id.page_num_ = cur_page_->get_prev_page_number();
+    cache_manager_->unpinPage(cur_page_id_, false);
+    if(!prev_page_id.isValidPage()) {
+        assign_to_null_page();
+        return 0;
+    }
+    cur_raw_page_ = cache_manager_->fetchPage(prev_page_id);
+    cur_page_ = reinterpret_cast<BTreeLeafPage*>(cur_raw_page_->data_);
+    cur_page_id_ = prev_page_id;
+    entry_idx_ = cur_page_->get_num_of_slots();
+    return retreat();
+}
+
 IndexKey IndexIterator::getCurKey() {
     if(isNull() || entry_idx_ > cur_page_->get_num_of_slots()) return IndexKey();
     //std::pair<IndexKey, RecordID> cur_entry = cur_page_->getPointer(entry_idx_);
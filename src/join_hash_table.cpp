@@ -0,0 +1,189 @@
+#pragma once
+#include "join_hash_table.h"
+#include "value.cpp"
+#include "tuple.cpp"
+
+// numeric key values are hashed and compared in one of these two domains.
+enum KeyDomain {
+    KEY_INTEGER,
+    KEY_REAL,
+    KEY_BYTES,
+};
+
+static KeyDomain key_domain(const Value& v, i64* ival, double* dval) {
+    switch(v.type_) {
+        case BOOLEAN: *ival = v.getBoolVal();    return KEY_INTEGER;
+        case INT:     *ival = v.getIntVal();     return KEY_INTEGER;
+        case BIGINT:  *ival = v.getBigIntVal();  return KEY_INTEGER;
+        case FLOAT:   *dval = v.getFloatVal();   break;
+        case DOUBLE:  *dval = v.getDoubleVal();  break;
+        default:      return KEY_BYTES;
+    }
+    // integral reals are hashed as integers so that 1 and 1.0 land in the same chain.
+    if(*dval >= -9.2e18 && *dval <= 9.2e18 && *dval == (double)(i64)*dval) {
+        *ival = (i64)*dval;
+        return KEY_INTEGER;
+    }
+    return KEY_REAL;
+}
+
+// the finalizer of murmur3.
+u64 hash_mix(u64 h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+u32 join_partition_of(u64 hash, u32 level) {
+    return hash_mix(hash + (level + 1) * 0x9e3779b97f4a7c15ULL) & (HASH_JOIN_FANOUT - 1);
+}
+
+u64 value_hash(const Value& v) {
+    i64 ival = 0;
+    double dval = 0;
+    switch(key_domain(v, &ival, &dval)) {
+        case KEY_INTEGER: return hash_mix((u64)ival);
+        case KEY_REAL:    {
+                              u64 bits = 0;
+                              memcpy(&bits, &dval, sizeof(bits));
+                              return hash_mix(bits ^ 0x9e3779b97f4a7c15ULL);
+                          }
+        case KEY_BYTES:   break;
+    }
+    const u8* ptr = (const u8*)v.get_ptr();
+    u64 hash = FNV_offset_basis;
+    for(u32 i = 0; i < v.size_; ++i) {
+        hash ^= ptr[i];
+        hash *= FNV_prime;
+    }
+    return hash_mix(hash ^ v.size_);
+}
+
+bool value_key_eq(const Value& lhs, const Value& rhs) {
+    if(lhs.isNull() || rhs.isNull()) return false;
+    i64 lint = 0, rint = 0;
+    double lreal = 0, rreal = 0;
+    KeyDomain ldomain = key_domain(lhs, &lint, &lreal);
+    KeyDomain rdomain = key_domain(rhs, &rint, &rreal);
+    if(ldomain != rdomain) return false;
+    if(ldomain == KEY_INTEGER) return lint == rint;
+    if(ldomain == KEY_REAL) return lreal == rreal;
+    if(lhs.type_ != rhs.type_ || lhs.size_ != rhs.size_) return false;
+    return memcmp(lhs.get_ptr(), rhs.get_ptr(), lhs.size_) == 0;
+}
+
+int value_key_cmp(const Value& lhs, const Value& rhs) {
+    i64 lint = 0, rint = 0;
+    double lreal = 0, rreal = 0;
+    KeyDomain ldomain = key_domain(lhs, &lint, &lreal);
+    KeyDomain rdomain = key_domain(rhs, &rint, &rreal);
+    assert(ldomain != KEY_BYTES && rdomain != KEY_BYTES);
+    if(ldomain == KEY_INTEGER && rdomain == KEY_INTEGER) return (lint > rint) - (lint < rint);
+    if(ldomain == KEY_INTEGER) lreal = (double)lint;
+    if(rdomain == KEY_INTEGER) rreal = (double)rint;
+    return (lreal > rreal) - (lreal < rreal);
+}
+
+u64 hash_key_columns(const Tuple& t, const Vector<int>& cols, bool* has_null) {
+    u64 hash = FNV_offset_basis;
+    *has_null = false;
+    for(int i = 0; i < cols.size(); ++i) {
+        const Value& v = t.get_val_at(cols[i]);
+        if(v.isNull()) {
+            *has_null = true;
+            return 0;
+        }
+        hash = hash_mix(hash ^ value_hash(v)) + i;
+    }
+    return hash;
+}
+
+bool key_columns_eq(const Tuple& lhs, const Vector<int>& lhs_cols, const Tuple& rhs, const Vector<int>& rhs_cols) {
+    assert(lhs_cols.size() == rhs_cols.size());
+    for(int i = 0; i < lhs_cols.size(); ++i) {
+        if(!value_key_eq(lhs.get_val_at(lhs_cols[i]), rhs.get_val_at(rhs_cols[i])))
+            return false;
+    }
+    return true;
+}
+
+void materialize_key_columns(Tuple* t, const Vector<int>& cols, Arena* arena) {
+    for(int i = 0; i < cols.size(); ++i) {
+        Value& v = t->get_val_at(cols[i]);
+        if(v.type_ != OVERFLOW_ITERATOR) continue;
+        v = Value(v.getStringView(arena));
+    }
+}
+
+JoinHashTable::JoinHashTable(Arena* arena):
+    rows_(arena), slots_(arena), bloom_(arena)
+{}
+
+void JoinHashTable::clear() {
+    rows_.clear();
+    slots_.clear();
+    bloom_.clear();
+    slot_mask_ = 0;
+    bloom_mask_ = 0;
+}
+
+void JoinHashTable::insert(const Tuple& t, u64 hash, bool null_key) {
+    JoinRow row;
+    row.tuple_ = t;
+    row.hash_ = hash;
+    row.null_key_ = null_key;
+    rows_.push_back(row);
+}
+
+void JoinHashTable::build() {
+    u64 n_slots = 16;
+    while(n_slots < rows_.size() * 2) n_slots <<= 1;
+    slots_.assign(n_slots, JoinSlot());
+    slot_mask_ = n_slots - 1;
+
+    u64 n_bits = 64;
+    while(n_bits < rows_.size() * JOIN_BLOOM_BITS_PER_ROW) n_bits <<= 1;
+    bloom_.assign(n_bits / 64, 0);
+    bloom_mask_ = n_bits - 1;
+
+    // rows are pushed to the front of their chains in reverse so the chains keep the insertion order.
+    for(u32 r = rows_.size(); r-- > 0;) {
+        JoinRow& row = rows_[r];
+        if(row.null_key_) continue;
+        u64 b1 = (row.hash_ >> 16) & bloom_mask_;
+        u64 b2 = (row.hash_ >> 40) & bloom_mask_;
+        bloom_[b1 >> 6] |= (1ULL << (b1 & 63));
+        bloom_[b2 >> 6] |= (1ULL << (b2 & 63));
+
+        u64 idx = row.hash_ & slot_mask_;
+        while(slots_[idx].head_ != JOIN_NO_ROW && slots_[idx].hash_ != row.hash_)
+            idx = (idx + 1) & slot_mask_;
+        row.next_ = slots_[idx].head_;
+        slots_[idx].hash_ = row.hash_;
+        slots_[idx].head_ = r;
+    }
+}
+
+bool JoinHashTable::may_contain(u64 hash) {
+    if(bloom_.size() == 0) return false;
+    u64 b1 = (hash >> 16) & bloom_mask_;
+    u64 b2 = (hash >> 40) & bloom_mask_;
+    return (bloom_[b1 >> 6] & (1ULL << (b1 & 63))) && (bloom_[b2 >> 6] & (1ULL << (b2 & 63)));
+}
+
+u32 JoinHashTable::find(u64 hash) {
+    if(slots_.size() == 0) return JOIN_NO_ROW;
+    u64 idx = hash & slot_mask_;
+    while(slots_[idx].head_ != JOIN_NO_ROW) {
+        if(slots_[idx].hash_ == hash) return slots_[idx].head_;
+        idx = (idx + 1) & slot_mask_;
+    }
+    return JOIN_NO_ROW;
+}
+
+u32 JoinHashTable::size() {
+    return rows_.size();
+}
@@ -47,11 +47,14 @@ int main() {
             Vector<Vector<String>> full_result;
 
             u64 row_cnt = 0;
+            RowBatch batch;
+            batch.init(&query_ctx);
+            Tuple res(&query_ctx.arena_);
             while(result && !result->error_status_ && !result->finished_){
-                Tuple res = result->next();
-                if(res.size() == 0 || result->error_status_) break;
-                row_cnt++;
-                if(show_results){
+                if(!result->next_batch(&batch) || result->error_status_) break;
+                row_cnt += batch.size();
+                for(u32 r = 0; show_results && r < batch.size(); ++r){
+                    batch.get_row(r, &res);
                     size_t sz = res.size();
                     Vector<String> cur_tuple;
                     cur_tuple.resize(sz);
@@ -86,6 +89,13 @@ int main() {
             std::cout << "Time: " << elapsed_in_ms << " ms" << std::endl;
             std::cout << "Main arena usage: " << query_ctx.arena_.alloc_pos_ / 1000 << " KB\n";
             std::cout << "temp arena usage: " << query_ctx.temp_arena_.alloc_pos_ / 1000 << " KB\n";
+            for(int i = 0; i < query_ctx.sub_query_caches_.size(); ++i) {
+                SubQueryCache* cache = query_ctx.sub_query_caches_[i];
+                if(!cache) continue;
+                u64 lookups = cache->hits_ + cache->misses_;
+                std::cout << "sub-query (" << i << ") cache: " << cache->hits_ << " hits of " << lookups << " lookups ("
+                    << (lookups ? 100.0 * cache->hits_ / lookups : 0) << "%), " << cache->evictions_ << " evictions\n";
+            }
             query_ctx.clean();
         }
     }
@@ -45,6 +45,7 @@ class Parser {
         void selectList(QueryCTX& ctx, int query_idx);
         void groupByList(QueryCTX& ctx, int query_idx);
         void orderByList(QueryCTX& ctx, int query_idx);
+        u64  limitCount(QueryCTX& ctx);
         void fieldDefList(QueryCTX& ctx, int query_idx);
         void fieldList(QueryCTX& ctx, int query_idx);
 
@@ -63,6 +64,7 @@ class Parser {
         void createIndexStatement(QueryCTX& ctx, int parent_idx);
         void dropTableStatement(QueryCTX& ctx, int parent_idx);
         void dropIndexStatement(QueryCTX& ctx, int parent_idx);
+        void analyzeStatement(QueryCTX& ctx, int parent_idx);
 
         void parse(QueryCTX& ctx);
 
@@ -135,6 +137,9 @@ void Parser::parse(QueryCTX& ctx){
                 break;
               }
             }
+        case TokenType::ANALYZE:
+            analyzeStatement(ctx,-1);
+            break;
         case TokenType::DROP:
             {
               if(ctx.tokens_.size() >= 2 && ctx.tokens_[1].type_ == TokenType::TABLE){
@@ -369,6 +374,18 @@ void Parser::tableList(QueryCTX& ctx, int query_idx){
 }
 
 
+// the row count of LIMIT and OFFSET, only non negative integer constants are allowed.
+u64 Parser::limitCount(QueryCTX& ctx){
+    if((bool)ctx.error_status_) return 0;
+    Value val = constVal(ctx);
+    if(val.type_ != Type::INT && val.type_ != Type::BIGINT){
+        ctx.error_status_ = Error::EXPECTED_LIMIT_COUNT;
+        return 0;
+    }
+    ++ctx;
+    return val.type_ == Type::INT ? val.getIntVal() : val.getBigIntVal();
+}
+
 void Parser::orderByList(QueryCTX& ctx, int query_idx){
     if((bool)ctx.error_status_) return; 
     auto query = reinterpret_cast<SelectStatementData*>(ctx.queries_call_stack_[query_idx]);
@@ -377,8 +394,15 @@ void Parser::orderByList(QueryCTX& ctx, int query_idx){
         if(val.isInvalid())
             return;
         ++ctx;
-        if(val.type_ == Type::INT) 
+        bool desc = false; // ascending order is the default.
+        if(ctx.matchAnyTokenType({TokenType::ASC, TokenType::DESC})) {
+            desc = ctx.matchTokenType(TokenType::DESC);
+            ++ctx;
+        }
+        if(val.type_ == Type::INT) {
             query->order_by_list_.push_back(val.getIntVal() - 1); 
+            query->order_by_desc_.push_back(desc); 
+        }
 
         if(!ctx.matchTokenType(TokenType::COMMA)) 
             break;
@@ -1198,6 +1222,17 @@ void Parser::selectStatement(QueryCTX& ctx, int parent_idx){
         }
     }
 
+    if(ctx.matchTokenType(TokenType::LIMIT)){
+        ++ctx;
+        statement->limit_ = limitCount(ctx);
+        if((bool)ctx.error_status_) return;
+    }
+
+    if(ctx.matchTokenType(TokenType::OFFSET)){
+        ++ctx;
+        statement->offset_ = limitCount(ctx);
+        if((bool)ctx.error_status_) return;
+    }
 }
 
 void Parser::createTableStatement(QueryCTX& ctx, int parent_idx){
@@ -1259,6 +1294,11 @@ void Parser::createIndexStatement(QueryCTX& ctx, int parent_idx){
     }
     ++ctx;
     statement->table_name_ = ctx.getCurrentToken().val_; ++ctx;
+    // optional access method: USING HASH, either before or after the column list.
+    if(ctx.matchMultiTokenType({TokenType::USING, TokenType::HASH})){
+        statement->is_hash_index_ = true;
+        ctx += 2;
+    }
     if(!ctx.matchTokenType(TokenType::LP)){
         ctx.error_status_ = Error::EXPECTED_LEFT_PARANTH; 
         return;
@@ -1291,6 +1331,10 @@ void Parser::createIndexStatement(QueryCTX& ctx, int parent_idx){
         return;
     }
     ++ctx;
+    if(!statement->is_hash_index_ && ctx.matchMultiTokenType({TokenType::USING, TokenType::HASH})){
+        statement->is_hash_index_ = true;
+        ctx += 2;
+    }
     ctx.direct_execution_ = 1;
 }
 
@@ -1313,6 +1357,24 @@ void Parser::dropIndexStatement(QueryCTX& ctx, int parent_idx){
     ctx.direct_execution_ = 1;
 }
 
+// ANALYZE [table_name].
+void Parser::analyzeStatement(QueryCTX& ctx, int parent_idx){
+    if((bool)ctx.error_status_) return; 
+    if(!ctx.matchTokenType(TokenType::ANALYZE)){
+        ctx.error_status_ = Error::QUERY_NOT_SUPPORTED;
+        return;
+    }
+    ++ctx;
+    AnalyzeStatementData* statement = New(AnalyzeStatementData, ctx.arena_, parent_idx);
+    statement->idx_ = ctx.queries_call_stack_.size();
+    ctx.queries_call_stack_.push_back(statement);
+
+    if(ctx.matchTokenType(TokenType::IDENTIFIER)){
+        statement->table_name_ = ctx.getCurrentToken().val_; ++ctx;
+    }
+    ctx.direct_execution_ = 1;
+}
+
 void Parser::dropTableStatement(QueryCTX& ctx, int parent_idx){
     if((bool)ctx.error_status_) return; 
     if(!ctx.matchMultiTokenType({TokenType::DROP , TokenType::TABLE})){
@@ -62,6 +62,12 @@ void QueryCTX::clean() {
     for(int i = 0; i < table_handles_.size(); ++i){
         table_handles_[i]->destroy();
     }
+    for(int i = 0; i < batch_arenas_.size(); ++i){
+        batch_arenas_[i]->destroy();
+    }
+    for(int i = 0; i < temp_tables_.size(); ++i){
+        catalog_->delete_temp_table(temp_tables_[i]);
+    }
     arena_.destroy();
     temp_arena_.destroy();
 }
@@ -75,7 +75,7 @@ QueryData::QueryData(Arena* arena, QueryType type, int parent_idx):
 SelectStatementData::SelectStatementData (Arena* arena, int parent_idx):
     QueryData(arena, SELECT_DATA, parent_idx),
     field_names_(arena), fields_(arena), aggregates_(arena),
-    order_by_list_(arena), group_by_(arena)
+    order_by_list_(arena), order_by_desc_(arena), group_by_(arena)
 {}
 
 Intersect::Intersect(Arena* arena, int parent_idx, QueryData* lhs, Intersect* rhs, bool all):
@@ -106,6 +106,10 @@ DropIndexStatementData::DropIndexStatementData(Arena* arena, int parent_idx):
     QueryData(arena, DROP_INDEX_DATA, parent_idx)
 {}
 
+AnalyzeStatementData::AnalyzeStatementData(Arena* arena, int parent_idx):
+    QueryData(arena, ANALYZE_DATA, parent_idx)
+{}
+
 InsertStatementData::InsertStatementData(Arena* arena, int parent_idx):
     QueryData(arena, INSERT_DATA, parent_idx), fields_(arena), values_(arena)
 {}
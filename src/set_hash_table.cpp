@@ -0,0 +1,72 @@
+#pragma once
+#include "set_hash_table.h"
+#include "agg_hash_table.cpp"
+
+u64 set_row_hash(const Tuple& row) {
+    return agg_keys_hash(row.values_, row.size());
+}
+
+bool set_row_eq(const Tuple& lhs, const Tuple& rhs) {
+    if(lhs.size() != rhs.size()) return false;
+    for(u32 i = 0; i < lhs.size(); ++i)
+        if(!agg_key_eq(lhs.values_[i], rhs.values_[i])) return false;
+    return true;
+}
+
+SetHashTable::SetHashTable(Arena* arena):
+    entries_(arena), slots_(arena)
+{}
+
+void SetHashTable::clear() {
+    entries_.clear();
+    slots_.clear();
+    slot_mask_ = 0;
+}
+
+u32 SetHashTable::find(const Tuple& row, u64 hash) {
+    if(slots_.size() == 0) return SET_NO_ENTRY;
+    u64 idx = hash & slot_mask_;
+    while(slots_[idx].entry_ != SET_NO_ENTRY) {
+        if(slots_[idx].hash_ == hash && set_row_eq(entries_[slots_[idx].entry_].row_, row))
+            return slots_[idx].entry_;
+        idx = (idx + 1) & slot_mask_;
+    }
+    return SET_NO_ENTRY;
+}
+
+u32 SetHashTable::insert(Arena* arena, const Tuple& row, u64 hash) {
+    if((entries_.size() + 1) * 2 > slots_.size()) grow();
+    SetEntry entry;
+    entry.row_ = row.duplicate(arena);
+    entry.hash_ = hash;
+    u32 e = entries_.size();
+    entries_.push_back(entry);
+
+    u64 idx = hash & slot_mask_;
+    while(slots_[idx].entry_ != SET_NO_ENTRY)
+        idx = (idx + 1) & slot_mask_;
+    slots_[idx].hash_ = hash;
+    slots_[idx].entry_ = e;
+    return e;
+}
+
+void SetHashTable::grow() {
+    u64 n_slots = std::max<u64>(16, slots_.size() * 2);
+    slots_.assign(n_slots, SetSlot());
+    slot_mask_ = n_slots - 1;
+    for(u32 e = 0; e < entries_.size(); ++e) {
+        u64 idx = entries_[e].hash_ & slot_mask_;
+        while(slots_[idx].entry_ != SET_NO_ENTRY)
+            idx = (idx + 1) & slot_mask_;
+        slots_[idx].hash_ = entries_[e].hash_;
+        slots_[idx].entry_ = e;
+    }
+}
+
+u32 SetHashTable::size() {
+    return entries_.size();
+}
+
+u64 SetHashTable::memory_usage() {
+    return entries_.size() * sizeof(SetEntry) + slots_.size() * sizeof(SetSlot);
+}
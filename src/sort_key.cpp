@@ -0,0 +1,136 @@
+#pragma once
+#include "sort_key.h"
+#include "value.cpp"
+#include "tuple.cpp"
+
+static void put_u64_be(u8* ptr, u64 val) {
+    for(int i = 7; i >= 0; --i, val >>= 8)
+        ptr[i] = (u8)val;
+}
+
+static bool sort_key_number(const Value& v, double* dval, i64* ival) {
+    switch(v.type_) {
+        case BOOLEAN: *ival = v.getBoolVal();   *dval = *ival; return true;
+        case INT:     *ival = v.getIntVal();    *dval = *ival; return true;
+        case BIGINT:  *ival = v.getBigIntVal(); *dval = *ival; return true;
+        case FLOAT:   *dval = v.getFloatVal();  break;
+        case DOUBLE:  *dval = v.getDoubleVal(); break;
+        default:      return false;
+    }
+    if(*dval == 0) *dval = 0; // -0.0
+    // reals only need the integer part to break ties with integers that round to the same double.
+    if(*dval >= 9.2e18)       *ival = INT64_MAX;
+    else if(*dval <= -9.2e18) *ival = -INT64_MAX;
+    else                      *ival = (i64)*dval;
+    return true;
+}
+
+static u32 sort_key_size(const Value& v) {
+    double dval = 0;
+    i64 ival = 0;
+    if(v.isNull()) return 1;
+    if(sort_key_number(v, &dval, &ival)) return 1 + 16;
+    u32 size = 1 + v.size_ + 2;
+    const u8* ptr = (const u8*)v.get_ptr();
+    for(u32 i = 0; i < v.size_; ++i)
+        size += (ptr[i] == 0);
+    return size;
+}
+
+String8 build_sort_key(Arena* arena, const Tuple& t, const Vector<int>& cols, const Vector<bool>& desc) {
+    u64 size = 0;
+    for(int i = 0; i < cols.size(); ++i)
+        size += sort_key_size(t.get_val_at(cols[i]));
+    u8* key = (u8*)arena->alloc(size);
+    u8* ptr = key;
+    for(int i = 0; i < cols.size(); ++i){
+        const Value& v = t.get_val_at(cols[i]);
+        u8* start = ptr;
+        double dval = 0;
+        i64 ival = 0;
+        if(v.isNull()) {
+            *ptr++ = SORT_KEY_NULL;
+        } else if(sort_key_number(v, &dval, &ival)) {
+            *ptr++ = SORT_KEY_NUMBER;
+            u64 bits = 0;
+            memcpy(&bits, &dval, sizeof(bits));
+            bits = (bits & (1ULL << 63)) ? ~bits : bits ^ (1ULL << 63);
+            put_u64_be(ptr, bits);
+            put_u64_be(ptr + 8, (u64)ival ^ (1ULL << 63));
+            ptr += 16;
+        } else {
+            assert(v.type_ == VARCHAR);
+            *ptr++ = SORT_KEY_TEXT;
+            const u8* str = (const u8*)v.get_ptr();
+            for(u32 j = 0; j < v.size_; ++j){
+                *ptr++ = str[j];
+                if(str[j] == 0) *ptr++ = 0xFF;
+            }
+            *ptr++ = 0;
+            *ptr++ = 0;
+        }
+        if(i < desc.size() && desc[i]) {
+            for(u8* p = start; p < ptr; ++p)
+                *p = ~*p;
+        }
+    }
+    return {.str_ = key, .size_ = size};
+}
+
+int sort_key_cmp(String8 lhs, String8 rhs) {
+    int cmp = memcmp(lhs.str_, rhs.str_, std::min(lhs.size_, rhs.size_));
+    if(cmp != 0) return cmp;
+    return (lhs.size_ > rhs.size_) - (lhs.size_ < rhs.size_);
+}
+
+bool sort_entry_less(const SortEntry& lhs, const SortEntry& rhs) {
+    int cmp = sort_key_cmp(lhs.key_, rhs.key_);
+    return cmp != 0 ? cmp < 0 : lhs.seq_ < rhs.seq_;
+}
+
+LoserTree::LoserTree(Arena* arena):
+    keys_(arena), tree_(arena)
+{}
+
+void LoserTree::init(u32 k) {
+    k_ = k;
+    keys_.assign(k, String8{});
+    tree_.assign(std::max(k, 1u), 0);
+}
+
+bool LoserTree::beats(u32 a, u32 b) {
+    bool a_done = keys_[a].str_ == nullptr;
+    bool b_done = keys_[b].str_ == nullptr;
+    if(a_done || b_done) return a_done == b_done ? a < b : b_done;
+    int cmp = sort_key_cmp(keys_[a], keys_[b]);
+    return cmp != 0 ? cmp < 0 : a < b;
+}
+
+// the leaf of source s is node s + k, returns the winner of the subtree.
+u32 LoserTree::build_node(u32 node) {
+    if(node >= k_) return node - k_;
+    u32 lhs = build_node(2 * node);
+    u32 rhs = build_node(2 * node + 1);
+    if(beats(lhs, rhs)) {
+        tree_[node] = rhs;
+        return lhs;
+    }
+    tree_[node] = lhs;
+    return rhs;
+}
+
+void LoserTree::build() {
+    tree_[0] = k_ > 1 ? build_node(1) : 0;
+}
+
+u32 LoserTree::winner() {
+    return tree_[0];
+}
+
+void LoserTree::replay() {
+    u32 winner = tree_[0];
+    for(u32 node = (winner + k_) / 2; node > 0; node /= 2){
+        if(beats(tree_[node], winner)) std::swap(tree_[node], winner);
+    }
+    tree_[0] = winner;
+}
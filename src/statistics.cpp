@@ -0,0 +1,121 @@
+#pragma once
+#include "statistics.h"
+#include "join_hash_table.cpp"
+
+bool stats_number(const Value& v, double* out) {
+    switch(v.type_) {
+        case BOOLEAN: *out = v.getBoolVal();   return true;
+        case INT:     *out = v.getIntVal();    return true;
+        case BIGINT:  *out = v.getBigIntVal(); return true;
+        case FLOAT:   *out = v.getFloatVal();  return true;
+        case DOUBLE:  *out = v.getDoubleVal(); return true;
+        default:      return false;
+    }
+}
+
+void StatsCollector::init(u32 num_cols) {
+    columns_.clear();
+    columns_.resize(num_cols);
+    rows_ = 0;
+}
+
+// xorshift64, the same sample is taken every time the same table is analyzed.
+u64 StatsCollector::next_random() {
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 7;
+    random_state_ ^= random_state_ << 17;
+    return random_state_;
+}
+
+void StatsCollector::add_row(const Tuple& t) {
+    ++rows_;
+    for(u32 i = 0; i < columns_.size() && i < t.size(); ++i) {
+        ColumnState& col = columns_[i];
+        const Value& v = t.get_val_at(i);
+        if(v.isNull()) {
+            ++col.nulls_;
+            continue;
+        }
+        col.hashes_.insert(value_hash(v));
+        double num = 0;
+        if(!stats_number(v, &num)) continue;
+        // reservoir sampling: the n-th number replaces a random sample with probability SIZE / n.
+        ++col.numbers_;
+        if(col.sample_.size() < STATS_SAMPLE_SIZE) {
+            col.sample_.push_back(num);
+        } else {
+            u64 idx = next_random() % col.numbers_;
+            if(idx < STATS_SAMPLE_SIZE) col.sample_[idx] = num;
+        }
+    }
+}
+
+void StatsCollector::finish(TableStats* out) {
+    out->row_count_ = rows_;
+    out->columns_.clear();
+    out->columns_.resize(columns_.size());
+    for(u32 i = 0; i < columns_.size(); ++i) {
+        ColumnState& col = columns_[i];
+        ColumnStats& stats = out->columns_[i];
+        stats.ndv_ = col.hashes_.size();
+        stats.null_frac_ = rows_ ? (double)col.nulls_ / rows_ : 0;
+        if(col.sample_.empty()) continue;
+        std::sort(col.sample_.begin(), col.sample_.end());
+        u64 n = col.sample_.size();
+        u32 buckets = std::min<u64>(STATS_HISTOGRAM_BUCKETS, n);
+        stats.bounds_.push_back(col.sample_[0]);
+        for(u32 b = 1; b <= buckets; ++b)
+            stats.bounds_.push_back(col.sample_[(b * n + buckets - 1) / buckets - 1]);
+    }
+}
+
+double stats_eq_selectivity(const ColumnStats& col) {
+    if(col.ndv_ <= 0) return 0;
+    return (1 - col.null_frac_) / col.ndv_;
+}
+
+double stats_less_selectivity(const ColumnStats& col, double val, bool inclusive) {
+    const Vector<double>& b = col.bounds_;
+    if(b.size() < 2) return STATS_DEFAULT_RANGE_SEL;
+    u32 buckets = b.size() - 1;
+    double frac = 0;
+    if(val < b[0]) {
+        frac = 0;
+    } else if(val > b[buckets]) {
+        frac = 1;
+    } else {
+        // the first bucket that ends at or after val, the values are assumed to be uniform inside of it.
+        u32 i = std::lower_bound(b.begin() + 1, b.end(), val) - b.begin();
+        double lo = b[i - 1], hi = b[i];
+        double within = hi > lo ? (val - lo) / (hi - lo) : 0.5;
+        frac = ((i - 1) + within) / buckets;
+        if(inclusive && col.ndv_ > 0) frac += 1.0 / col.ndv_;
+        frac = std::min(1.0, std::max(0.0, frac));
+    }
+    return frac * (1 - col.null_frac_);
+}
+
+String stats_histogram_to_str(const Vector<double>& bounds) {
+    String out;
+    char buf[32];
+    for(u32 i = 0; i < bounds.size(); ++i) {
+        snprintf(buf, sizeof(buf), "%.17g", bounds[i]);
+        if(i) out += ' ';
+        out += buf;
+    }
+    return out;
+}
+
+Vector<double> stats_histogram_from_str(String8 str) {
+    Vector<double> bounds;
+    std::string tmp((char*)str.str_, str.size_);
+    const char* ptr = tmp.c_str();
+    char* end = nullptr;
+    while(*ptr) {
+        double val = strtod(ptr, &end);
+        if(end == ptr) break;
+        bounds.push_back(val);
+        ptr = end;
+    }
+    return bounds;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "subquery_cache.h"
+#include "agg_hash_table.cpp"
+
+SubQueryCache::SubQueryCache(Arena* arena):
+    params_(arena), entries_(arena), buckets_(arena)
+{}
+
+void SubQueryCache::init(u32 num_keys, Arena* arena, Arena* spare_arena) {
+    num_keys_ = num_keys;
+    arena_ = arena;
+    spare_arena_ = spare_arena;
+    entries_.clear();
+    entries_.reserve(SUBQUERY_CACHE_ENTRIES);
+    // twice as many buckets as entries keeps the chains short.
+    buckets_.assign(SUBQUERY_CACHE_ENTRIES * 2, SUBQUERY_CACHE_NO_ENTRY);
+    head_ = tail_ = SUBQUERY_CACHE_NO_ENTRY;
+}
+
+bool SubQueryCache::find(const Value* keys, u64 hash, Value* result) {
+    u32 e = buckets_[hash & (buckets_.size() - 1)];
+    for(; e != SUBQUERY_CACHE_NO_ENTRY; e = entries_[e].chain_) {
+        SubQueryCacheEntry& entry = entries_[e];
+        if(entry.hash_ != hash) continue;
+        bool eq = true;
+        for(u32 i = 0; eq && i < num_keys_; ++i)
+            eq = agg_key_eq(entry.keys_[i], keys[i]);
+        if(!eq) continue;
+        unlink(e);
+        push_front(e);
+        *result = entry.result_;
+        ++hits_;
+        return true;
+    }
+    ++misses_;
+    return false;
+}
+
+void SubQueryCache::clear() {
+    entries_.clear();
+    buckets_.assign(buckets_.size(), SUBQUERY_CACHE_NO_ENTRY);
+    head_ = tail_ = SUBQUERY_CACHE_NO_ENTRY;
+    arena_->clear();
+}
+
+void SubQueryCache::insert(const Value* keys, u64 hash, const Value& result) {
+    if(arena_->alloc_pos_ > SUBQUERY_CACHE_MEMORY) {
+        compact();
+        // the live entries alone take most of the memory (large text keys), start over.
+        if(arena_->alloc_pos_ > SUBQUERY_CACHE_MEMORY / 2) {
+            evictions_ += entries_.size();
+            clear();
+        }
+    }
+    u32 e = SUBQUERY_CACHE_NO_ENTRY;
+    if(entries_.size() < SUBQUERY_CACHE_ENTRIES) {
+        e = entries_.size();
+        entries_.emplace_back();
+    } else {
+        // reuse the least recently used entry.
+        e = tail_;
+        unlink(e);
+        unchain(e);
+        ++evictions_;
+    }
+    SubQueryCacheEntry& entry = entries_[e];
+    copy_entry(arena_, entry, keys, result);
+    entry.hash_ = hash;
+    u32& bucket = buckets_[hash & (buckets_.size() - 1)];
+    entry.chain_ = bucket;
+    bucket = e;
+    push_front(e);
+}
+
+void SubQueryCache::copy_entry(Arena* arena, SubQueryCacheEntry& entry, const Value* keys, const Value& result) {
+    Value* copy = (Value*) arena->alloc(sizeof(Value) * num_keys_);
+    for(u32 i = 0; i < num_keys_; ++i)
+        copy[i] = Value(keys[i]).get_copy(arena);
+    entry.keys_ = copy;
+    entry.result_ = Value(result).get_copy(arena);
+}
+
+// copies the keys and results of the live entries into the spare arena and swaps the arenas.
+void SubQueryCache::compact() {
+    spare_arena_->clear();
+    for(u32 e = head_; e != SUBQUERY_CACHE_NO_ENTRY; e = entries_[e].next_)
+        copy_entry(spare_arena_, entries_[e], entries_[e].keys_, entries_[e].result_);
+    std::swap(arena_, spare_arena_);
+}
+
+void SubQueryCache::unlink(u32 e) {
+    SubQueryCacheEntry& entry = entries_[e];
+    if(entry.prev_ != SUBQUERY_CACHE_NO_ENTRY) entries_[entry.prev_].next_ = entry.next_;
+    else head_ = entry.next_;
+    if(entry.next_ != SUBQUERY_CACHE_NO_ENTRY) entries_[entry.next_].prev_ = entry.prev_;
+    else tail_ = entry.prev_;
+    entry.prev_ = entry.next_ = SUBQUERY_CACHE_NO_ENTRY;
+}
+
+void SubQueryCache::push_front(u32 e) {
+    SubQueryCacheEntry& entry = entries_[e];
+    entry.prev_ = SUBQUERY_CACHE_NO_ENTRY;
+    entry.next_ = head_;
+    if(head_ != SUBQUERY_CACHE_NO_ENTRY) entries_[head_].prev_ = e;
+    head_ = e;
+    if(tail_ == SUBQUERY_CACHE_NO_ENTRY) tail_ = e;
+}
+
+// removes the entry from the chain of its bucket.
+void SubQueryCache::unchain(u32 e) {
+    u32* link = &buckets_[entries_[e].hash_ & (buckets_.size() - 1)];
+    while(*link != e) link = &entries_[*link].chain_;
+    *link = entries_[e].chain_;
+    entries_[e].chain_ = SUBQUERY_CACHE_NO_ENTRY;
+}
@@ -7,6 +7,7 @@
 #include "table_iterator.cpp"
 #include "record.cpp"
 #include "table_data_page.cpp"
+#include "zone_map.cpp"
 
 
 
@@ -25,7 +26,6 @@ void Table::init(CacheManager* cm, FileID fid) {
     first_pnum_ = *(PageNum*)(meta_page->data_+ROOT_PNUM_OFFSET);
     if(first_pnum_ == 0) first_pnum_ = INVALID_PAGE_NUM;
     cache_manager_->unpinPage(zero_pid, false);
-    std::cout << "first_pnum_: " << first_pnum_ << "\n";
     // fsm file id is by convention the next file id after the table's file id.
     free_space_map_.init(cm, fid_+1); 
 }
@@ -35,6 +35,19 @@ void Table::update_first_page_number(PageNum pnum) {
     cache_manager_->update_root_page_number(fid_, pnum);
 }
 
+void Table::set_append_only() {
+    append_only_ = true;
+}
+
+void Table::init_zone_map(const Vector<Column>& columns, u32 fixed_size) {
+    if(append_only_ || zone_map_.enabled()) return;
+    zone_map_.init(columns, fixed_size);
+}
+
+ZoneMap* Table::get_zone_map() {
+    return zone_map_.enabled() ? &zone_map_ : nullptr;
+}
+
 void Table::destroy(){}
 
 // rid (output)
@@ -52,8 +65,19 @@ int Table::insertRecord(RecordID* rid, Record &record){
     // if inserting into the page fails retry with worst case maybe ?,
     // (inserting with the slot entry size) => this assumes that there is no free slots inside of the page.
     // worst case.
-    int no_free_space = 
-        free_space_map_.getFreePageNum(record.getRecordSize() + TABLE_SLOT_ENTRY_SIZE, &page_num);
+    int no_free_space = 1;
+    if(append_only_ && last_pnum_ != INVALID_PAGE_NUM) {
+        PageID last_page_id = {.fid_ = fid_, .page_num_ = last_pnum_};
+        auto last_page = (TableDataPage*)cache_manager_->fetchPage(last_page_id);
+        if(last_page && last_page->getFreeSpaceSize() > record.getRecordSize() + TABLE_SLOT_ENTRY_SIZE) {
+            page_num = last_pnum_;
+            no_free_space = 0;
+        }
+        if(last_page) cache_manager_->unpinPage(last_page_id, false);
+    } else if(!append_only_) {
+        no_free_space = 
+            free_space_map_.getFreePageNum(record.getRecordSize() + TABLE_SLOT_ENTRY_SIZE, &page_num);
+    }
     // no free pages
     // allocate a new one with the cache manager
     // or if there is free space fetch the page with enough free space.
@@ -66,13 +90,22 @@ int Table::insertRecord(RecordID* rid, Record &record){
         }
         if(first_pnum_ == INVALID_PAGE_NUM) update_first_page_number(table_page->page_id_.page_num_);
         table_page->init();
+        zone_map_.reset_page(table_page->page_id_.page_num_);
         // this is the last page.
         table_page->setNextPageNumber(0);
         // we assume this is also the first page and will be updated if not.
         table_page->setPrevPageNumber(0);
 
-        // if you are not the first page:
-        if(table_page->page_id_.page_num_ != first_pnum_){
+        if(append_only_ && table_page->page_id_.page_num_ != first_pnum_) {
+            // first_page->p1->p2->last_page->new_page
+            PageID last_page_id = {.fid_ = fid_, .page_num_ = last_pnum_};
+            auto last_page = (TableDataPage*)cache_manager_->fetchPage(last_page_id);
+            table_page->setPrevPageNumber(last_pnum_);
+            last_page->setNextPageNumber(table_page->getPageNumber());
+            zone_map_.set_next_page(last_pnum_, table_page->getPageNumber());
+            cache_manager_->unpinPage(last_page_id, true);
+        } else if(table_page->page_id_.page_num_ != first_pnum_){
+            // if you are not the first page:
             PageID first_page_id = {
                 .fid_ = fid_,
                 .page_num_ = first_pnum_,
@@ -86,12 +119,15 @@ int Table::insertRecord(RecordID* rid, Record &record){
             table_page->setPrevPageNumber(first_page->getPageNumber());
             table_page->setNextPageNumber(first_page->getNextPageNumber());
             first_page->setNextPageNumber(table_page->getPageNumber());
+            zone_map_.set_next_page(first_pnum_, table_page->getPageNumber());
+            zone_map_.set_next_page(table_page->getPageNumber(), table_page->getNextPageNumber());
 
             cache_manager_->unpinPage(first_page->page_id_, true);
         }
         // if you are the first page and you just got created that means,
         // you are the first and last so we don't need to update any other pages.
         rid->page_id_ = table_page->page_id_;
+        last_pnum_ = table_page->page_id_.page_num_;
     } else {
         rid->page_id_.page_num_ = page_num;
         table_page = reinterpret_cast<TableDataPage*>(cache_manager_->fetchPage(rid->page_id_));
@@ -109,7 +145,9 @@ int Table::insertRecord(RecordID* rid, Record &record){
         cache_manager_->unpinPage(table_page->page_id_, true);
         return 1;
     }
-    err = free_space_map_.updateFreeSpace(table_page->page_id_, table_page->getUsedSpaceSize());
+    zone_map_.add(table_page->page_id_.page_num_, record);
+    if(!append_only_)
+        err = free_space_map_.updateFreeSpace(table_page->page_id_, table_page->getUsedSpaceSize());
     if(err){
         std::cout << "could not update free space map" << std::endl;
         cache_manager_->unpinPage(table_page->page_id_, true);
@@ -127,6 +165,7 @@ int Table::insertRecord(RecordID* rid, Record &record){
 int Table::deleteRecord(RecordID &rid){
     TableDataPage* table_page = (TableDataPage *)cache_manager_->fetchPage(rid.page_id_);
     if(table_page == nullptr) return 1;
+    remove_from_zone_map(table_page, rid.slot_number_);
     int err = table_page->deleteRecord(rid.slot_number_);
     if(err) return err;
     free_space_map_.updateFreeSpace(table_page->page_id_, table_page->getUsedSpaceSize());
@@ -139,12 +178,14 @@ int Table::deleteRecord(RecordID &rid){
 int Table::updateRecord(RecordID *rid, Record &new_record){
     TableDataPage* table_page = reinterpret_cast<TableDataPage *>(cache_manager_->fetchPage(rid->page_id_));
     if(table_page == nullptr) return 1;
+    remove_from_zone_map(table_page, rid->slot_number_);
     int err = table_page->deleteRecord(rid->slot_number_);
     if(err) {
         cache_manager_->unpinPage(table_page->page_id_, true);
         return err;
     }
     int insert_err = table_page->insertRecord(new_record.getFixedPtr(0), new_record.getRecordSize(), &rid->slot_number_);
+    if(!insert_err) zone_map_.add(table_page->page_id_.page_num_, new_record);
     free_space_map_.updateFreeSpace(table_page->page_id_, table_page->getUsedSpaceSize());
     // inserted no need to find a new page.
     cache_manager_->unpinPage(table_page->page_id_, true);
@@ -158,10 +199,19 @@ int Table::updateRecord(RecordID *rid, Record &new_record){
     return this->insertRecord(rid, new_record);
 }
 
+void Table::remove_from_zone_map(TableDataPage* table_page, u32 slot) {
+    char* data = nullptr;
+    u32 size = 0;
+    if(!zone_map_.has_summary(table_page->page_id_.page_num_) || table_page->getRecord(&data, &size, slot)) return;
+    Record r(data, size);
+    zone_map_.remove(table_page->page_id_.page_num_, r);
+}
+
 OverflowPage* Table::new_overflow_page() {
     auto pg = (OverflowPage*)cache_manager_->newPage(fid_);
     assert(pg != nullptr);
     // overflow pages are always reserved.
+    if(append_only_) return pg;
     int err = free_space_map_.updateFreeSpace(pg->page_id_, PAGE_SIZE - 1);
     assert(!err);
     return pg;
@@ -189,6 +239,22 @@ void Table::release_data_page(PageNum pnum) {
     cache_manager_->unpinPage({ .fid_ = fid_, .page_num_= pnum }, false);
 }
 
+Record Table::getRecordCpy(Arena* arena, RecordID &rid) {
+    TableDataPage* table_page = get_data_page(rid.page_id_.page_num_);
+    if(!table_page) return Record(nullptr, 0);
+    char* cur_data = nullptr;
+    uint32_t rsize = 0;
+    int err = table_page->getRecord(&cur_data, &rsize, rid.slot_number_);
+    if(err || !cur_data || rsize <= 0) {
+        release_data_page(rid.page_id_.page_num_);
+        return Record(nullptr, 0);
+    }
+    char* data_cpy = (char*) arena->alloc(rsize);
+    memcpy(data_cpy, cur_data, rsize);
+    release_data_page(rid.page_id_.page_num_);
+    return Record(data_cpy, rsize);
+}
+
 // we allow only forward scans for now via tableIterator.advance().
 TableIterator Table::begin(TableSchema* schema) {
     return TableIterator(cache_manager_, schema, {.fid_ = fid_, .page_num_ = first_pnum_});
@@ -128,6 +128,22 @@ int  TableIterator::getCurTupleCpy(Arena& arena, Tuple* out) {
     return 0;
 }
 
+TableDataPage* TableIterator::getCurPage() {
+    return cur_page_;
+}
+
+void TableIterator::skipCurPage() {
+    cur_slot_idx_ = cur_num_of_slots_;
+}
+
+u32 TableIterator::getNextPageNumber() {
+    return next_page_number_;
+}
+
+void TableIterator::setNextPageNumber(u32 next_page_number) {
+    next_page_number_ = next_page_number;
+}
+
 RecordID TableIterator::getCurRecordID(){
     return RecordID(cur_page_id_, cur_slot_idx_);
 }
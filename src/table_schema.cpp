@@ -18,6 +18,8 @@ TableSchema::TableSchema(Arena* arena, String8 name, Table* table, const Vector<
     // TODO: change the constructor to be a function that may or may not fail.
     if(!tmp_schema)
         assert(size_ < MAX_RECORD_SiZE);
+    if(table_ && !tmp_schema)
+        table_->init_zone_map(columns, size_);
 }
 void TableSchema::destroy() {}
 
@@ -25,6 +25,8 @@ Tokenizer::Tokenizer() {
     keywords_.insert({str_lit("AS"), TokenType::AS      });
     keywords_.insert({str_lit("ON"), TokenType::ON      });
     keywords_.insert({str_lit("HAVING"), TokenType::HAVING  });
+    keywords_.insert({str_lit("LIMIT"), TokenType::LIMIT   });
+    keywords_.insert({str_lit("OFFSET"), TokenType::OFFSET  });
     keywords_.insert({str_lit("INSERT"), TokenType::INSERT  });
     keywords_.insert({str_lit("FROM"), TokenType::FROM    });
     keywords_.insert({str_lit("USING"), TokenType::USING   });
@@ -44,6 +46,7 @@ Tokenizer::Tokenizer() {
     keywords_.insert({str_lit("PRIMARY"), TokenType::PRIMARY });
     keywords_.insert({str_lit("KEY"), TokenType::KEY     });
     keywords_.insert({str_lit("UNIQUE"), TokenType::UNIQUE  });
+    keywords_.insert({str_lit("HASH"), TokenType::HASH    });
     keywords_.insert({str_lit("UNION"), TokenType::UNION   });
     keywords_.insert({str_lit("EXCEPT"), TokenType::EXCEPT  });
     keywords_.insert({str_lit("INTERSECT"),TokenType::INTERSECT});
@@ -63,6 +66,7 @@ Tokenizer::Tokenizer() {
     keywords_.insert({str_lit("CREATE"), TokenType::CREATE  });
     keywords_.insert({str_lit("DROP"), TokenType::DROP    });
     keywords_.insert({str_lit("TABLE"), TokenType::TABLE   });
+    keywords_.insert({str_lit("ANALYZE"), TokenType::ANALYZE });
     // aggregate functions
     keywords_.insert({str_lit("SUM"), TokenType::SUM  });
     keywords_.insert({str_lit("COUNT"), TokenType::COUNT});
@@ -87,3 +87,48 @@ Value& Tuple::get_val_at(uint32_t idx) const {
 bool Tuple::is_empty() {
     return (size() == 0);
 }
+
+String8 Tuple::serialize(Arena* arena) const {
+    u64 total_size = sizeof(RecordID) + sizeof(u32);
+    for(int i = 0; i < size(); ++i){
+        Value& v = values_[i];
+        if(v.type_ == OVERFLOW_ITERATOR) v = Value(v.getStringView(arena));
+        total_size += sizeof(Type) + sizeof(u32);
+        if(!v.isNull()) total_size += v.size_;
+    }
+    u8* data = (u8*) arena->alloc(total_size);
+    u8* ptr = data;
+    memcpy(ptr, &left_most_rid_, sizeof(RecordID)); ptr += sizeof(RecordID);
+    memcpy(ptr, &width_, sizeof(u32));              ptr += sizeof(u32);
+    for(int i = 0; i < size(); ++i){
+        const Value& v = values_[i];
+        u32 sz = v.isNull() ? 0 : v.size_;
+        memcpy(ptr, &v.type_, sizeof(Type)); ptr += sizeof(Type);
+        memcpy(ptr, &sz, sizeof(u32));       ptr += sizeof(u32);
+        if(sz) memcpy(ptr, v.get_ptr(), sz);
+        ptr += sz;
+    }
+    return {.str_ = data, .size_ = total_size};
+}
+
+int Tuple::deserialize(String8 data) {
+    u8* ptr = data.str_;
+    u8* end = data.str_ + data.size_;
+    if(data.size_ < sizeof(RecordID) + sizeof(u32)) return 1;
+    u32 width = 0;
+    memcpy(static_cast<void*>(&left_most_rid_), ptr, sizeof(RecordID)); ptr += sizeof(RecordID);
+    memcpy(&width, ptr, sizeof(u32));               ptr += sizeof(u32);
+    if(width != width_) resize(width);
+    for(int i = 0; i < width; ++i){
+        Type type = INVALID;
+        u32 sz = 0;
+        if(ptr + sizeof(Type) + sizeof(u32) > end) return 1;
+        memcpy(&type, ptr, sizeof(Type)); ptr += sizeof(Type);
+        memcpy(&sz, ptr, sizeof(u32));    ptr += sizeof(u32);
+        if(ptr + sz > end) return 1;
+        if(type == NULL_TYPE) values_[i] = Value(NULL_TYPE);
+        else values_[i] = Value((char*)ptr, type, sz);
+        ptr += sz;
+    }
+    return 0;
+}
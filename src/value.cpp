@@ -594,8 +594,7 @@ Value Value::operator-(Value rhs) {
         case VARCHAR: 
                      {
                          if(rhs.type_ == VARCHAR) {
-                             int n = std::min(size_, rhs.size_);
-                             return Value(strncmp((char*)content_, (char*)rhs.content_, n));
+                             return Value(text_cmp((char*)content_, size_, (char*)rhs.content_, rhs.size_));
                          } else if(rhs.type_ == INT || rhs.type_ == FLOAT || rhs.type_ == BIGINT || rhs.type_ == DOUBLE) {
                              return Value(Value(strtod((char*)content_, NULL)) - rhs);
                          } else {
@@ -902,6 +901,13 @@ int value_cmp(Value lhs, Value rhs) {
     if((rhs.type_ == BIGINT || rhs.type_ == DOUBLE) && (lhs.type_ == FLOAT || lhs.type_ == INT))
         lhs.cast_up();
 
+    // the difference of two integers can overflow or not fit in an int, they are compared directly.
+    if((lhs.type_ == INT || lhs.type_ == BIGINT) && (rhs.type_ == INT || rhs.type_ == BIGINT)) {
+        i64 lval = lhs.type_ == INT ? lhs.getIntVal() : lhs.getBigIntVal();
+        i64 rval = rhs.type_ == INT ? rhs.getIntVal() : rhs.getBigIntVal();
+        return (lval > rval) - (lval < rval);
+    }
+
     Value v = lhs - rhs;
     int diff = 0;
     if(v.type_ == FLOAT || v.type_ == DOUBLE){
@@ -0,0 +1,115 @@
+#pragma once
+#include "zone_map.h"
+#include "record.cpp"
+#include "table_data_page.cpp"
+
+void ZoneMap::init(const Vector<Column>& columns, u32 fixed_size) {
+    columns_.clear();
+    zone_of_col_.assign(columns.size(), -1);
+    for(u32 i = 0; i < columns.size(); ++i) {
+        Column col = columns[i];
+        Type t = col.getType();
+        if(t != INT && t != BIGINT && t != DOUBLE) continue;
+        zone_of_col_[i] = columns_.size();
+        columns_.push_back({ .col_ = i, .type_ = t, .offset_ = col.getOffset() });
+    }
+    bitmap_offset_ = fixed_size;
+}
+
+bool ZoneMap::enabled() {
+    return columns_.size() > 0;
+}
+
+Zone* ZoneMap::page_zones(PageNum pnum) {
+    assert(pnum >= 0);
+    if((u32)pnum >= has_summary_.size()) {
+        has_summary_.resize(pnum + 1, false);
+        next_pages_.resize(pnum + 1, 0);
+        zones_.resize((u64)(pnum + 1) * columns_.size());
+    }
+    return &zones_[(u64)pnum * columns_.size()];
+}
+
+void ZoneMap::reset_page(PageNum pnum) {
+    if(!enabled()) return;
+    Zone* zones = page_zones(pnum);
+    for(u32 i = 0; i < columns_.size(); ++i) zones[i] = Zone();
+    has_summary_[pnum] = true;
+    next_pages_[pnum] = 0;
+}
+
+void ZoneMap::add(PageNum pnum, Record& r) {
+    if(!has_summary(pnum)) return;
+    Zone* zones = page_zones(pnum);
+    char* bitmap = r.getFixedPtr(bitmap_offset_);
+    for(u32 i = 0; i < columns_.size(); ++i) {
+        const ZoneColumn& col = columns_[i];
+        Zone& zone = zones[i];
+        if(bitmap[col.col_ / 8] & (1 << (col.col_ % 8))) {
+            ++zone.nulls_;
+            continue;
+        }
+        ++zone.values_;
+        char* content = r.getFixedPtr(col.offset_);
+        if(col.type_ == DOUBLE) {
+            double val = 0;
+            memcpy(&val, content, sizeof(val));
+            zone.min_double_ = std::min(zone.min_double_, val);
+            zone.max_double_ = std::max(zone.max_double_, val);
+            continue;
+        }
+        i64 val = 0;
+        if(col.type_ == INT) {
+            i32 ival = 0;
+            memcpy(&ival, content, sizeof(ival));
+            val = ival;
+        } else {
+            memcpy(&val, content, sizeof(val));
+        }
+        zone.min_int_ = std::min(zone.min_int_, val);
+        zone.max_int_ = std::max(zone.max_int_, val);
+    }
+}
+
+void ZoneMap::remove(PageNum pnum, Record& r) {
+    if(!has_summary(pnum)) return;
+    Zone* zones = page_zones(pnum);
+    char* bitmap = r.getFixedPtr(bitmap_offset_);
+    for(u32 i = 0; i < columns_.size(); ++i) {
+        const ZoneColumn& col = columns_[i];
+        if(bitmap[col.col_ / 8] & (1 << (col.col_ % 8))) --zones[i].nulls_;
+        else --zones[i].values_;
+    }
+}
+
+bool ZoneMap::has_summary(PageNum pnum) {
+    return enabled() && pnum >= 0 && (u32)pnum < has_summary_.size() && has_summary_[pnum];
+}
+
+void ZoneMap::summarize_page(PageNum pnum, TableDataPage* page) {
+    reset_page(pnum);
+    if(!enabled()) return;
+    next_pages_[pnum] = page->getNextPageNumber();
+    for(u32 slot = 0; slot < page->getNumOfSlots(); ++slot) {
+        char* data = nullptr;
+        u32 size = 0;
+        // deleted slot.
+        if(page->getRecord(&data, &size, slot)) continue;
+        Record r(data, size);
+        add(pnum, r);
+    }
+}
+
+const Zone* ZoneMap::get_zone(PageNum pnum, u32 col) {
+    if(!has_summary(pnum) || col >= zone_of_col_.size() || zone_of_col_[col] == -1) return nullptr;
+    return &zones_[(u64)pnum * columns_.size() + zone_of_col_[col]];
+}
+
+PageNum ZoneMap::next_page(PageNum pnum) {
+    assert(has_summary(pnum));
+    return next_pages_[pnum];
+}
+
+void ZoneMap::set_next_page(PageNum pnum, PageNum next) {
+    if(has_summary(pnum)) next_pages_[pnum] = next;
+}
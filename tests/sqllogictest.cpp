@@ -298,6 +298,7 @@ int test_file(const char* file_name){
   long nGot;                           /* Number of bytes read */
   int rc;                              /* Result code from subroutine call */
   int nErr = 0;                        /* Number of errors */
+  u64 workMem = DEFAULT_WORK_MEM;      /* Memory budget of each query */
   int nCmd = 0;                        /* Number of SQL statements processed */
   int nSkipped = 0;                    /* Number of SQL statements skipped */
   int nResult;                         /* Number of query results */
@@ -447,6 +448,7 @@ int test_file(const char* file_name){
       Executor* result_exec = nullptr; 
       QueryCTX query_ctx;
       query_ctx.init(sttmnt.c_str(), sttmnt.size());
+      query_ctx.work_mem_ = workMem;
       rc = !ndb->SQL(query_ctx, &result_exec);
       Vector<Vector<String>> result;
       while(result_exec && !result_exec->error_status_ && !result_exec->finished_){
@@ -479,7 +481,7 @@ int test_file(const char* file_name){
                 sz++;
                 c = result[i][j].c_str()[sz];
             }
-            char* col = (char*) malloc(sz * sizeof(char));
+            char* col = (char*) malloc((sz + 1) * sizeof(char));
             memcpy(col, result[i][j].c_str(), sz*sizeof(char));
             col[sz] = '\0';
             azResult[azidx++] = col;
@@ -560,6 +562,7 @@ int test_file(const char* file_name){
       Executor* result_exec = nullptr; 
       QueryCTX query_ctx;
       query_ctx.init(sttmnt.c_str(), sttmnt.size());
+      query_ctx.work_mem_ = workMem;
       rc = !ndb->SQL(query_ctx, &result_exec);
       Vector<Vector<String>> result;
       while(result_exec && !result_exec->error_status_ && !result_exec->finished_){
@@ -594,7 +597,7 @@ int test_file(const char* file_name){
                 c = result[i][j].c_str()[sz];
             }
 
-            char* col = (char*) malloc(sz * sizeof(char));
+            char* col = (char*) malloc((sz + 1) * sizeof(char));
             memcpy(col, result[i][j].c_str(), sz*sizeof(char));
             col[sz] = '\0';
             azResult[azidx++] = col;
@@ -730,6 +733,12 @@ int test_file(const char* file_name){
       if( !bHt ){
         hashThreshold = atoi(sScript.azToken[1]);
       }
+    }else if( strcmp(sScript.azToken[0],"work-mem")==0 ){
+      /* Set the number of bytes that the sorts, hash joins, aggregations
+      ** and set operations of the following queries keep in memory before
+      ** they spill to temp tables, a small value tests the spilling paths.
+      */
+      workMem = strtoull(sScript.azToken[1], 0, 10);
     }else if( strcmp(sScript.azToken[0],"halt")==0 ){
       /* Used for debugging.  Stop reading the test script and shut down.
       ** A "halt" record can be inserted in the middle of a test script in